@@ -18,15 +18,27 @@
  */
 
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#  include <process.h>
+#  define getpid _getpid
+#else
+#  include <unistd.h>
+#endif
 
 #include "internal.h"
+#include "blocksigner.h"
 #include "net_http.h"
 #include "net_uri.h"
 #include "ctx_impl.h"
 #include "pkitruststore.h"
 #include "policy.h"
+#include "publicationsfile_impl.h"
+#include "hash_impl.h"
 
 KSI_IMPLEMENT_LIST(GlobalCleanupFn, NULL);
 
@@ -176,6 +188,8 @@ static void initOptions(KSI_CTX *ctx) {
 	KSI_CTX_setOption(ctx, KSI_OPT_EXT_PDU_VER, (void*)KSI_EXTENDING_PDU_VERSION);
 	KSI_CTX_setOption(ctx, KSI_OPT_AGGR_HMAC_ALGORITHM, (void*)KSI_getHashAlgorithmByName("default"));
 	KSI_CTX_setOption(ctx, KSI_OPT_EXT_HMAC_ALGORITHM, (void*)KSI_getHashAlgorithmByName("default"));
+	KSI_CTX_setOption(ctx, KSI_OPT_PUBFILE_TTL, (void*)0);
+	KSI_CTX_setOption(ctx, KSI_OPT_COMPACT_ERRORS, (void*)0);
 }
 
 int KSI_CTX_new(KSI_CTX **context) {
@@ -198,6 +212,21 @@ int KSI_CTX_new(KSI_CTX **context) {
 	}
 	ctx->errors_count = 0;
 	ctx->publicationsFile = NULL;
+	ctx->publicationsFileReceived = 0;
+	ctx->publicationsFileLock = NULL;
+	ctx->publicationsFilePending = NULL;
+	ctx->publicationsFilePending_len = 0;
+	ctx->publicationsFilePendingReceived = 0;
+	ctx->publicationsFileCacheDir = NULL;
+	ctx->publicationsFileUrl = NULL;
+	memset(ctx->pubStrCache, 0, sizeof(ctx->pubStrCache));
+	ctx->pubStrCache_next = 0;
+	memset(&ctx->metrics, 0, sizeof(ctx->metrics));
+	ctx->verificationTraceCB = NULL;
+	ctx->verificationTraceCtx = NULL;
+	ctx->randomBytes = KSI_getRandomBytes;
+	memset(ctx->policyStats, 0, sizeof(ctx->policyStats));
+	ctx->policyStats_count = 0;
 	ctx->pkiTruststore = NULL;
 	ctx->netProvider = NULL;
 	ctx->publicationCertEmail_DEPRECATED = NULL;
@@ -217,6 +246,9 @@ int KSI_CTX_new(KSI_CTX **context) {
 	res = KSI_List_new(NULL, &ctx->cleanupFnList);
 	if (res != KSI_OK) goto cleanup;
 
+	res = KSI_Mutex_new(&ctx->publicationsFileLock);
+	if (res != KSI_OK) goto cleanup;
+
 	/* Create and set the logger. */
 	res = KSI_CTX_setLoggerCallback(ctx, KSI_LOG_StreamLogger, stdout);
 	if (res != KSI_OK) goto cleanup;
@@ -306,6 +338,8 @@ static void globalCleanup(KSI_CTX *ctx) {
  *
  */
 void KSI_CTX_free(KSI_CTX *ctx) {
+	size_t i;
+
 	if (ctx != NULL) {
 		/* Call cleanup methods. */
 		globalCleanup(ctx);
@@ -318,11 +352,21 @@ void KSI_CTX_free(KSI_CTX *ctx) {
 		KSI_PKITruststore_free(ctx->pkiTruststore);
 
 		KSI_PublicationsFile_free(ctx->publicationsFile);
+		KSI_free(ctx->publicationsFilePending);
+		KSI_Mutex_free(ctx->publicationsFileLock);
+		KSI_free(ctx->publicationsFileCacheDir);
+		KSI_free(ctx->publicationsFileUrl);
 		KSI_free(ctx->publicationCertEmail_DEPRECATED);
 
 		freeCertConstraintsArray(ctx->certConstraints);
 		KSI_Signature_free(ctx->lastFailedSignature);
 
+		for (i = 0; i < KSI_PUBSTR_CACHE_SIZE; i++) {
+			KSI_free(ctx->pubStrCache[i].pubStr);
+			KSI_Integer_free(ctx->pubStrCache[i].time);
+			KSI_DataHash_free(ctx->pubStrCache[i].imprint);
+		}
+
 		KSI_free(ctx);
 	}
 }
@@ -415,42 +459,578 @@ cleanup:
 
 }
 
-int KSI_receivePublicationsFile(KSI_CTX *ctx, KSI_PublicationsFile **pubFile) {
+#define PUBFILE_CACHE_DATA "bin"
+#define PUBFILE_CACHE_META "meta"
+/* Number of bytes of the URL digest used in the cache file names. */
+#define PUBFILE_CACHE_KEY_LEN 16
+#define PUBFILE_CACHE_VALIDATOR_LEN 256
+/* Length of the hex encoded SHA-256 of the cached file. */
+#define PUBFILE_CACHE_DIGEST_LEN 64
+
+/** Validators of the cached publications file and the time it was last confirmed by the server. */
+typedef struct PubFileCacheMeta_st {
+	time_t fetched;
+	char etag[PUBFILE_CACHE_VALIDATOR_LEN];
+	char lastModified[PUBFILE_CACHE_VALIDATOR_LEN];
+	/* Digest of the file the validators belong to. */
+	char digest[PUBFILE_CACHE_DIGEST_LEN + 2];
+} PubFileCacheMeta;
+
+/* Returns true, if a publications file received at \c since has not expired. */
+static bool isPublicationsFileFresh(KSI_CTX *ctx, time_t since, time_t now) {
+	size_t ttl = ctx->options[KSI_OPT_PUBFILE_TTL];
+
+	if (ttl == 0 || now == (time_t)-1 || now < since) return false;
+
+	return (size_t)(now - since) < ttl;
+}
+
+/* The cache files are named after the publications file URL, so contexts using
+ * different URLs do not share a copy. */
+static int getCachePath(KSI_CTX *ctx, const char *ext, char *buf, size_t buf_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_DataHash *hsh = NULL;
+	const unsigned char *digest = NULL;
+	size_t digest_len = 0;
+	char key[2 * PUBFILE_CACHE_KEY_LEN + 1];
+	size_t i;
+
+	res = KSI_DataHash_create(ctx, ctx->publicationsFileUrl, strlen(ctx->publicationsFileUrl), KSI_HASHALG_SHA2_256, &hsh);
+	if (res != KSI_OK) goto cleanup;
+
+	res = KSI_DataHash_extract(hsh, NULL, &digest, &digest_len);
+	if (res != KSI_OK) goto cleanup;
+
+	if (digest_len < PUBFILE_CACHE_KEY_LEN) {
+		res = KSI_UNKNOWN_ERROR;
+		goto cleanup;
+	}
+
+	for (i = 0; i < PUBFILE_CACHE_KEY_LEN; i++) {
+		KSI_snprintf(key + 2 * i, 3, "%02x", digest[i]);
+	}
+
+	if (strlen(ctx->publicationsFileCacheDir) + strlen(key) + strlen(ext) + 20 > buf_len) {
+		res = KSI_BUFFER_OVERFLOW;
+		goto cleanup;
+	}
+
+	KSI_snprintf(buf, buf_len, "%s/ksi-publications-%s.%s", ctx->publicationsFileCacheDir, key, ext);
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_DataHash_free(hsh);
+
+	return res;
+}
+
+/* Writes the hex encoded SHA-256 of the data into \c buf of at least #PUBFILE_CACHE_DIGEST_LEN + 1 bytes. */
+static int getCacheDigest(KSI_CTX *ctx, const unsigned char *data, size_t data_len, char *buf) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_DataHash *hsh = NULL;
+	const unsigned char *digest = NULL;
+	size_t digest_len = 0;
+	size_t i;
+
+	res = KSI_DataHash_create(ctx, data, data_len, KSI_HASHALG_SHA2_256, &hsh);
+	if (res != KSI_OK) goto cleanup;
+
+	res = KSI_DataHash_extract(hsh, NULL, &digest, &digest_len);
+	if (res != KSI_OK) goto cleanup;
+
+	if (2 * digest_len != PUBFILE_CACHE_DIGEST_LEN) {
+		res = KSI_UNKNOWN_ERROR;
+		goto cleanup;
+	}
+
+	for (i = 0; i < digest_len; i++) {
+		KSI_snprintf(buf + 2 * i, 3, "%02x", digest[i]);
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_DataHash_free(hsh);
+
+	return res;
+}
+
+/* Removes the line terminator and returns the length of the line. */
+static size_t chompLine(char *line) {
+	size_t len = strlen(line);
+
+	while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+
+	return len;
+}
+
+static int readCacheMeta(KSI_CTX *ctx, PubFileCacheMeta *meta) {
+	int res = KSI_UNKNOWN_ERROR;
+	char path[1024];
+	char line[32];
+	FILE *f = NULL;
+
+	res = getCachePath(ctx, PUBFILE_CACHE_META, path, sizeof(path));
+	if (res != KSI_OK) goto cleanup;
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		res = KSI_IO_ERROR;
+		goto cleanup;
+	}
+
+	if (fgets(line, sizeof(line), f) == NULL || fgets(meta->etag, sizeof(meta->etag), f) == NULL ||
+			fgets(meta->lastModified, sizeof(meta->lastModified), f) == NULL ||
+			fgets(meta->digest, sizeof(meta->digest), f) == NULL) {
+		res = KSI_INVALID_FORMAT;
+		goto cleanup;
+	}
+
+	chompLine(line);
+	chompLine(meta->etag);
+	chompLine(meta->lastModified);
+	if (chompLine(meta->digest) != PUBFILE_CACHE_DIGEST_LEN) {
+		res = KSI_INVALID_FORMAT;
+		goto cleanup;
+	}
+
+	meta->fetched = (time_t)strtol(line, NULL, 10);
+	if (meta->fetched <= 0) {
+		res = KSI_INVALID_FORMAT;
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (f != NULL) fclose(f);
+
+	return res;
+}
+
+/* Writes the file under a temporary name and moves it into place, so readers never see a partial file.
+ * The temporary name is unique to the process and the context, as many processes may share the cache. */
+static int writeCacheFile(KSI_CTX *ctx, const char *name, const void *data, size_t data_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	char path[1024];
+	char tmpPath[1024];
+	FILE *f = NULL;
+
+	res = getCachePath(ctx, name, path, sizeof(path));
+	if (res != KSI_OK) goto cleanup;
+
+	if (strlen(path) + 64 > sizeof(tmpPath)) {
+		res = KSI_BUFFER_OVERFLOW;
+		goto cleanup;
+	}
+	KSI_snprintf(tmpPath, sizeof(tmpPath), "%s.%ld.%p.tmp", path, (long)getpid(), (void *)ctx);
+
+	f = fopen(tmpPath, "wb");
+	if (f == NULL) {
+		res = KSI_IO_ERROR;
+		goto cleanup;
+	}
+
+	if (fwrite(data, 1, data_len, f) != data_len) {
+		res = KSI_IO_ERROR;
+		goto cleanup;
+	}
+
+	res = fclose(f);
+	f = NULL;
+	if (res != 0) {
+		res = KSI_IO_ERROR;
+		goto cleanup;
+	}
+
+#ifdef _WIN32
+	/* Rename does not replace existing files on Windows. */
+	remove(path);
+#endif
+
+	if (rename(tmpPath, path) != 0) {
+		res = KSI_IO_ERROR;
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (f != NULL) fclose(f);
+	if (res != KSI_OK) remove(tmpPath);
+
+	return res;
+}
+
+static int writeCacheMeta(KSI_CTX *ctx, time_t fetched, const char *etag, const char *lastModified, const char *digest) {
+	char buf[2 * PUBFILE_CACHE_VALIDATOR_LEN + PUBFILE_CACHE_DIGEST_LEN + 32];
+
+	/* Validators that do not fit are dropped, which only makes the next request unconditional. */
+	if (etag != NULL && strlen(etag) >= PUBFILE_CACHE_VALIDATOR_LEN) etag = NULL;
+	if (lastModified != NULL && strlen(lastModified) >= PUBFILE_CACHE_VALIDATOR_LEN) lastModified = NULL;
+
+	KSI_snprintf(buf, sizeof(buf), "%ld\n%s\n%s\n%s\n", (long)fetched, etag != NULL ? etag : "", lastModified != NULL ? lastModified : "", digest);
+
+	return writeCacheFile(ctx, PUBFILE_CACHE_META, buf, strlen(buf));
+}
+
+/* Loads the cached file, if it is the one described by \c meta. */
+static int loadCachedPublicationsFile(KSI_CTX *ctx, const PubFileCacheMeta *meta, KSI_PublicationsFile **pubFile) {
+	int res = KSI_UNKNOWN_ERROR;
+	char path[1024];
+	char digest[PUBFILE_CACHE_DIGEST_LEN + 1];
+	KSI_PublicationsFile *tmp = NULL;
+
+	res = getCachePath(ctx, PUBFILE_CACHE_DATA, path, sizeof(path));
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	/* Map the file, so the worker processes share one copy. */
+	res = KSI_PublicationsFile_mapFile(ctx, path, &tmp);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, "Unable to read the cached publications file.");
+		goto cleanup;
+	}
+
+	/* The data and the meta file are replaced one after the other. */
+	res = getCacheDigest(ctx, tmp->raw, tmp->raw_len, digest);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	if (strcmp(digest, meta->digest) != 0) {
+		KSI_pushError(ctx, res = KSI_INVALID_FORMAT, "Cached publications file does not match its validators.");
+		goto cleanup;
+	}
+
+	/* The copy was verified before it was stored, but possibly with another truststore
+	 * or other constraints. Repeated verifications are served by the truststore. */
+	res = KSI_PublicationsFile_verify(tmp, ctx);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, "Cached publications file not verified.");
+		goto cleanup;
+	}
+
+	*pubFile = tmp;
+	tmp = NULL;
+
+	KSI_LOG_debug(ctx, "Publications file loaded from cache.");
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_PublicationsFile_free(tmp);
+
+	return res;
+}
+
+/* Stores a verified file in the cache. Failures are logged, as the cache is optional. */
+static void storeCachedPublicationsFile(KSI_CTX *ctx, KSI_PublicationsFile *pubFile, const KSI_RequestHandle *handle) {
+	int res = KSI_UNKNOWN_ERROR;
+	const char *etag = NULL;
+	const char *lastModified = NULL;
+	char digest[PUBFILE_CACHE_DIGEST_LEN + 1];
+
+	res = KSI_RequestHandle_getCacheValidators(handle, &etag, &lastModified);
+	if (res == KSI_OK) {
+		res = getCacheDigest(ctx, pubFile->raw, pubFile->raw_len, digest);
+	}
+	/* The meta file is written after the data, it names the file it belongs to. */
+	if (res == KSI_OK) {
+		res = writeCacheFile(ctx, PUBFILE_CACHE_DATA, pubFile->raw, pubFile->raw_len);
+	}
+	if (res == KSI_OK) {
+		res = writeCacheMeta(ctx, time(NULL), etag, lastModified, digest);
+	}
+
+	if (res != KSI_OK) {
+		KSI_LOG_warn(ctx, "Unable to write the publications file cache: %s", KSI_getErrorString(res));
+		KSI_ERR_clearErrors(ctx);
+	}
+}
+
+/**
+ * Receives the publications file from the cache or the server. If \c verify is set,
+ * only a file that verifies is returned. Files from the cache are always verified.
+ */
+static int downloadPublicationsFile(KSI_CTX *ctx, bool verify, KSI_PublicationsFile **pubFile, time_t *received) {
 	int res = KSI_UNKNOWN_ERROR;
 	KSI_RequestHandle *handle = NULL;
 	const unsigned char *raw = NULL;
 	size_t raw_len = 0;
 	KSI_PublicationsFile *tmp = NULL;
+	const KSI_RequestHandleStatus *status = NULL;
+	PubFileCacheMeta meta;
+	bool cached = false;
+	bool useCache = ctx->publicationsFileCacheDir != NULL && ctx->publicationsFileUrl != NULL;
+	time_t now = time(NULL);
+
+	if (useCache) {
+		cached = readCacheMeta(ctx, &meta) == KSI_OK;
+
+		if (cached && isPublicationsFileFresh(ctx, meta.fetched, now)) {
+			res = loadCachedPublicationsFile(ctx, &meta, &tmp);
+			if (res == KSI_OK) {
+				*received = meta.fetched;
+				goto done;
+			}
+
+			/* Replace the unusable copy. */
+			KSI_LOG_logCtxError(ctx, KSI_LOG_DEBUG);
+			KSI_ERR_clearErrors(ctx);
+			cached = false;
+		}
+	}
 
-	KSI_ERR_clearErrors(ctx);
-	if (ctx == NULL || pubFile == NULL) {
-		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+request:
+
+	KSI_LOG_debug(ctx, "Receiving publications file.");
+
+	res = KSI_sendPublicationRequest(ctx, NULL, 0, &handle);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx,res, NULL);
 		goto cleanup;
 	}
 
-	/* TODO! Implement mechanism for reloading (e.g cache timeout) */
-	if (ctx->publicationsFile == NULL) {
-		KSI_LOG_debug(ctx, "Receiving publications file.");
-
-		res = KSI_sendPublicationRequest(ctx, NULL, 0, &handle);
+	if (cached) {
+		res = KSI_RequestHandle_setCacheValidators(handle,
+				meta.etag[0] != '\0' ? meta.etag : NULL,
+				meta.lastModified[0] != '\0' ? meta.lastModified : NULL);
 		if (res != KSI_OK) {
 			KSI_pushError(ctx,res, NULL);
 			goto cleanup;
 		}
+	}
 
-		res = KSI_RequestHandle_perform(handle);
-		if (res != KSI_OK) {
-			KSI_pushError(ctx,res, NULL);
-			goto cleanup;
+	res = KSI_RequestHandle_perform(handle);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx,res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_RequestHandle_getResponseStatus(handle, &status);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx,res, NULL);
+		goto cleanup;
+	}
+
+	if (cached && status->code == 304) {
+		KSI_LOG_debug(ctx, "Publications file not modified.");
+
+		res = loadCachedPublicationsFile(ctx, &meta, &tmp);
+		if (res == KSI_OK) {
+			if (writeCacheMeta(ctx, now, meta.etag, meta.lastModified, meta.digest) != KSI_OK) {
+				KSI_LOG_warn(ctx, "Unable to update the publications file cache.");
+			}
+
+			*received = now;
+			goto done;
 		}
 
-		res = KSI_RequestHandle_getResponse(handle, &raw, &raw_len);
+		/* The copy is missing, damaged or does not verify here: download it again without the validators. */
+		KSI_LOG_debug(ctx, "Cached publications file not usable, receiving it again.");
+		KSI_LOG_logCtxError(ctx, KSI_LOG_DEBUG);
+		KSI_ERR_clearErrors(ctx);
+		KSI_RequestHandle_free(handle);
+		handle = NULL;
+		cached = false;
+		goto request;
+	}
+
+	res = KSI_RequestHandle_getResponse(handle, &raw, &raw_len);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx,res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_PublicationsFile_parse(ctx, raw, raw_len, &tmp);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx,res, NULL);
+		goto cleanup;
+	}
+
+	if (verify || useCache) {
+		res = KSI_PublicationsFile_verify(tmp, ctx);
 		if (res != KSI_OK) {
-			KSI_pushError(ctx,res, NULL);
+			if (verify) {
+				KSI_pushError(ctx,res, NULL);
+				goto cleanup;
+			}
+
+			/* The caller verifies the file, only the cache needs a verified one. */
+			KSI_LOG_debug(ctx, "Publications file not verified, not caching it.");
+			KSI_ERR_clearErrors(ctx);
+		} else if (useCache) {
+			storeCachedPublicationsFile(ctx, tmp, handle);
+		}
+	}
+
+	*received = now;
+
+	KSI_LOG_debug(ctx, "Publications file received.");
+
+done:
+
+	*pubFile = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_RequestHandle_free(handle);
+	KSI_PublicationsFile_free(tmp);
+
+	return res;
+}
+
+static void setPublicationsFileReceived(KSI_CTX *ctx, time_t received) {
+	KSI_Mutex_lock(ctx->publicationsFileLock);
+	ctx->publicationsFileReceived = received;
+	KSI_Mutex_unlock(ctx->publicationsFileLock);
+}
+
+/**
+ * Replaces the publications file of the context with the one handed over by
+ * #KSI_CTX_refreshPublicationsFile, if there is one. Failures are logged and the
+ * old file is kept.
+ */
+static void adoptPendingPublicationsFile(KSI_CTX *ctx) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_PublicationsFile *tmp = NULL;
+	unsigned char *raw = NULL;
+	size_t raw_len = 0;
+	time_t received = 0;
+
+	KSI_Mutex_lock(ctx->publicationsFileLock);
+	raw = ctx->publicationsFilePending;
+	raw_len = ctx->publicationsFilePending_len;
+	received = ctx->publicationsFilePendingReceived;
+	ctx->publicationsFilePending = NULL;
+	ctx->publicationsFilePending_len = 0;
+	KSI_Mutex_unlock(ctx->publicationsFileLock);
+
+	if (raw == NULL) goto cleanup;
+
+	/* The file was verified by the refreshing context. */
+	res = KSI_PublicationsFile_parse(ctx, raw, raw_len, &tmp);
+	if (res != KSI_OK) {
+		KSI_LOG_warn(ctx, "Unable to parse the refreshed publications file, keeping the previous one.");
+		KSI_LOG_logCtxError(ctx, KSI_LOG_DEBUG);
+		KSI_ERR_clearErrors(ctx);
+		goto cleanup;
+	}
+
+	/* Holders of the old instance keep their reference. */
+	KSI_PublicationsFile_free(ctx->publicationsFile);
+	ctx->publicationsFile = tmp;
+	tmp = NULL;
+	setPublicationsFileReceived(ctx, received);
+
+	KSI_LOG_debug(ctx, "Publications file refreshed.");
+
+cleanup:
+
+	KSI_free(raw);
+	KSI_PublicationsFile_free(tmp);
+}
+
+int KSI_CTX_refreshPublicationsFile(KSI_CTX *ctx, KSI_CTX *worker) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_PublicationsFile *tmp = NULL;
+	unsigned char *raw = NULL;
+	time_t current;
+	time_t received = 0;
+
+	if (ctx == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	if (worker == NULL) worker = ctx;
+
+	KSI_ERR_clearErrors(worker);
+
+	KSI_Mutex_lock(ctx->publicationsFileLock);
+	current = ctx->publicationsFileReceived;
+	KSI_Mutex_unlock(ctx->publicationsFileLock);
+
+	/* Nothing has been received yet or the file was set by the user. */
+	if (current == 0 || isPublicationsFileFresh(worker, current, time(NULL))) {
+		res = KSI_OK;
+		goto cleanup;
+	}
+
+	KSI_LOG_debug(worker, "Publications file has expired.");
+
+	res = downloadPublicationsFile(worker, true, &tmp, &received);
+	if (res != KSI_OK) {
+		KSI_pushError(worker, res, "Unable to refresh the publications file.");
+		goto cleanup;
+	}
+
+	if (worker == ctx) {
+		/* Holders of the old instance keep their reference. */
+		KSI_PublicationsFile_free(ctx->publicationsFile);
+		ctx->publicationsFile = tmp;
+		tmp = NULL;
+		setPublicationsFileReceived(ctx, received);
+
+		KSI_LOG_debug(ctx, "Publications file refreshed.");
+	} else {
+		/* The objects of a context may not be used by other threads, hand over a copy of the raw file. */
+		raw = KSI_malloc(tmp->raw_len);
+		if (raw == NULL) {
+			KSI_pushError(worker, res = KSI_OUT_OF_MEMORY, NULL);
 			goto cleanup;
 		}
+		memcpy(raw, tmp->raw, tmp->raw_len);
+
+		KSI_Mutex_lock(ctx->publicationsFileLock);
+		KSI_free(ctx->publicationsFilePending);
+		ctx->publicationsFilePending = raw;
+		ctx->publicationsFilePending_len = tmp->raw_len;
+		ctx->publicationsFilePendingReceived = received;
+		KSI_Mutex_unlock(ctx->publicationsFileLock);
+		raw = NULL;
+
+		KSI_LOG_debug(worker, "Refreshed publications file handed over.");
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(raw);
+	KSI_PublicationsFile_free(tmp);
+
+	return res;
+}
+
+int KSI_receivePublicationsFile(KSI_CTX *ctx, KSI_PublicationsFile **pubFile) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_PublicationsFile *tmp = NULL;
+	time_t received = 0;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || pubFile == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	adoptPendingPublicationsFile(ctx);
 
-		res = KSI_PublicationsFile_parse(ctx, raw, raw_len, &tmp);
+	if (ctx->publicationsFile == NULL) {
+		res = downloadPublicationsFile(ctx, false, &tmp, &received);
 		if (res != KSI_OK) {
 			KSI_pushError(ctx,res, NULL);
 			goto cleanup;
@@ -458,8 +1038,7 @@ int KSI_receivePublicationsFile(KSI_CTX *ctx, KSI_PublicationsFile **pubFile) {
 
 		ctx->publicationsFile = tmp;
 		tmp = NULL;
-
-		KSI_LOG_debug(ctx, "Publications file received.");
+		setPublicationsFileReceived(ctx, received);
 	}
 
 	*pubFile = KSI_PublicationsFile_ref(ctx->publicationsFile);
@@ -468,7 +1047,6 @@ int KSI_receivePublicationsFile(KSI_CTX *ctx, KSI_PublicationsFile **pubFile) {
 
 cleanup:
 
-	KSI_RequestHandle_free(handle);
 	KSI_PublicationsFile_free(tmp);
 
 	return res;
@@ -754,6 +1332,100 @@ cleanup:
 	return res;
 }
 
+typedef struct BatchSignatures_st {
+	KSI_Signature **sigs;
+	size_t count;
+	size_t size;
+} BatchSignatures;
+
+static int collectBatchSignature(KSI_BlockSignerHandle *handle, KSI_Signature *sig, void *c) {
+	BatchSignatures *batch = c;
+
+	if (batch == NULL || sig == NULL) return KSI_INVALID_ARGUMENT;
+	/* The leafs are reported in the order they were added. */
+	if (batch->count >= batch->size) return KSI_INVALID_STATE;
+
+	batch->sigs[batch->count++] = KSI_Signature_ref(sig);
+
+	return KSI_OK;
+}
+
+int KSI_createSignatures(KSI_CTX *ctx, KSI_DataHash **hashes, size_t hashes_count, KSI_Signature **sigs) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_BlockSigner *signer = NULL;
+	BatchSignatures batch;
+	size_t i;
+
+	batch.sigs = sigs;
+	batch.count = 0;
+	batch.size = hashes_count;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || hashes == NULL || hashes_count == 0 || sigs == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < hashes_count; i++) {
+		sigs[i] = NULL;
+	}
+
+	for (i = 0; i < hashes_count; i++) {
+		if (hashes[i] == NULL) {
+			KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, "Data hash missing from the batch.");
+			goto cleanup;
+		}
+	}
+
+	res = KSI_BlockSigner_newMasked(ctx, KSI_getHashAlgorithmByName("default"), &signer);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < hashes_count; i++) {
+		res = KSI_BlockSigner_add(signer, hashes[i]);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	KSI_LOG_debug(ctx, "Signing a batch of %llu data hashes.", (unsigned long long)hashes_count);
+
+	res = KSI_BlockSigner_closeAndSign(signer);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_BlockSigner_getSignatures(signer, collectBatchSignature, &batch);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	if (batch.count != hashes_count) {
+		KSI_pushError(ctx, res = KSI_INVALID_STATE, "Number of signatures does not match the number of data hashes.");
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (res != KSI_OK && sigs != NULL) {
+		for (i = 0; i < batch.count; i++) {
+			KSI_Signature_free(sigs[i]);
+			sigs[i] = NULL;
+		}
+	}
+
+	KSI_BlockSigner_free(signer);
+
+	return res;
+}
+
 int KSI_extendSignatureWithPolicy(KSI_CTX *ctx, const KSI_Signature *sig, const KSI_Policy *policy, KSI_VerificationContext *context, KSI_Signature **extended) {
 	int res = KSI_UNKNOWN_ERROR;
 	KSI_PublicationsFile *pubFile = NULL;
@@ -838,6 +1510,7 @@ cleanup:
 void KSI_ERR_push(KSI_CTX *ctx, int statusCode, long extErrorCode, const char *fileName, unsigned int lineNr, const char *message) {
 	KSI_ERR *ctxErr = NULL;
 	const char *tmp = NULL;
+	size_t len;
 
 	/* Do nothing if the context is missing. */
 	if (ctx == NULL) return;
@@ -851,10 +1524,26 @@ void KSI_ERR_push(KSI_CTX *ctx, int statusCode, long extErrorCode, const char *f
 	ctxErr->statusCode = statusCode;
 	ctxErr->extErrorCode = extErrorCode;
 	ctxErr->lineNr = lineNr;
-	tmp = KSI_strnvl(fileName);
-	KSI_strncpy(ctxErr->fileName, tmp, sizeof(ctxErr->fileName));
-	tmp = KSI_strnvl(message);
-	KSI_strncpy(ctxErr->message, tmp, sizeof(ctxErr->message));
+
+	if (ctx->options[KSI_OPT_COMPACT_ERRORS]) {
+		/* Keep a reference to the file name and copy only the used part of the message. */
+		ctxErr->fileNameRef = KSI_strnvl(fileName);
+		ctxErr->fileName[0] = '\0';
+
+		len = 0;
+		if (message != NULL) {
+			len = strlen(message);
+			if (len > sizeof(ctxErr->message) - 1) len = sizeof(ctxErr->message) - 1;
+			memcpy(ctxErr->message, message, len);
+		}
+		ctxErr->message[len] = '\0';
+	} else {
+		ctxErr->fileNameRef = NULL;
+		tmp = KSI_strnvl(fileName);
+		KSI_strncpy(ctxErr->fileName, tmp, sizeof(ctxErr->fileName));
+		tmp = KSI_strnvl(message);
+		KSI_strncpy(ctxErr->message, tmp, sizeof(ctxErr->message));
+	}
 
 	ctx->errors_count++;
 }
@@ -887,7 +1576,7 @@ static int ksi_err_toPrinter(KSI_CTX *ctx, void *to, size_t buf_len, void* (*pri
 	/* List all errors, starting from the most general. */
 	for (i = 0; i < ctx->errors_count && i < ctx->errors_size; i++) {
 		err = ctx->errors + ((ctx->errors_count - i - 1) % ctx->errors_size);
-		nextWrite = printer(nextWrite, buf_len - count, &count, "  %3lu) %s:%u - (%d/%ld) %s\n", ctx->errors_count - i, err->fileName, err->lineNr,err->statusCode, err->extErrorCode, *err->message != '\0' ? err->message : KSI_getErrorString(err->statusCode));
+		nextWrite = printer(nextWrite, buf_len - count, &count, "  %3lu) %s:%u - (%d/%ld) %s\n", ctx->errors_count - i, KSI_ERR_getFileName(err), err->lineNr,err->statusCode, err->extErrorCode, *err->message != '\0' ? err->message : KSI_getErrorString(err->statusCode));
 	}
 
 	/* If there where more errors than buffers for the errors, indicate the fact */
@@ -1008,7 +1697,30 @@ int KSI_CTX_setExtender(KSI_CTX *ctx, const char *uri, const char *loginId, cons
 }
 
 int KSI_CTX_setPublicationUrl(KSI_CTX *ctx, const char *uri){
-	return KSI_CTX_setUri(ctx, uri, uri, uri, KSI_UriClient_setPublicationUrl_wrapper);
+	int res = KSI_UNKNOWN_ERROR;
+	char *tmp = NULL;
+
+	res = KSI_CTX_setUri(ctx, uri, uri, uri, KSI_UriClient_setPublicationUrl_wrapper);
+	if (res != KSI_OK) goto cleanup;
+
+	/* Remembered for naming the publications file cache. */
+	res = KSI_strdup(uri, &tmp);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	KSI_free(ctx->publicationsFileUrl);
+	ctx->publicationsFileUrl = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
 }
 
 int KSI_CTX_setOption(KSI_CTX *ctx, KSI_Option opt, void *param) {
@@ -1089,7 +1801,61 @@ cleanup:																					\
 	CTX_VALUEP_GETTER(var, nam, typ)														\
 
 CTX_VALUEP_SETTER(pkiTruststore, PKITruststore, KSI_PKITruststore, KSI_PKITruststore_free)
-CTX_GET_SET_VALUE(publicationsFile, PublicationsFile, KSI_PublicationsFile, KSI_PublicationsFile_free)
+CTX_VALUEP_GETTER(publicationsFile, PublicationsFile, KSI_PublicationsFile)
+
+int KSI_CTX_setPublicationsFile(KSI_CTX *ctx, KSI_PublicationsFile *publicationsFile) {
+	int res = KSI_UNKNOWN_ERROR;
+	if (ctx == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+	if (ctx->publicationsFile != NULL) {
+		KSI_PublicationsFile_free(ctx->publicationsFile);
+	}
+	ctx->publicationsFile = publicationsFile;
+	/* A file provided by the user is not refreshed and replaces a pending one. */
+	KSI_Mutex_lock(ctx->publicationsFileLock);
+	ctx->publicationsFileReceived = 0;
+	KSI_free(ctx->publicationsFilePending);
+	ctx->publicationsFilePending = NULL;
+	ctx->publicationsFilePending_len = 0;
+	KSI_Mutex_unlock(ctx->publicationsFileLock);
+	res = KSI_OK;
+cleanup:
+	return res;
+}
+
+int KSI_CTX_setPublicationsFileCacheDir(KSI_CTX *ctx, const char *dir) {
+	int res = KSI_UNKNOWN_ERROR;
+	char *tmp = NULL;
+
+	if (ctx == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (dir != NULL) {
+		res = KSI_strdup(dir, &tmp);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	KSI_free(ctx->publicationsFileCacheDir);
+	ctx->publicationsFileCacheDir = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
+}
 
 int KSI_CTX_getLastFailedSignature(KSI_CTX *ctx, KSI_Signature **lastFailedSignature) {
 	int res = KSI_UNKNOWN_ERROR;
@@ -1151,6 +1917,10 @@ int KSI_CTX_setNetworkProvider(KSI_CTX *ctx, KSI_NetworkClient *netProvider){
 		KSI_NetworkClient_free (ctx->netProvider);
 	}
 
+	/* The URL of the custom provider is not known. */
+	KSI_free(ctx->publicationsFileUrl);
+	ctx->publicationsFileUrl = NULL;
+
 	ctx->netProvider = netProvider;
 	ctx->isCustomNetProvider = 1;
 	res = KSI_OK;
@@ -21,12 +21,27 @@
 
 #include <string.h>
 #include <assert.h>
-#include <ctype.h>
 
 static const char base32EncodeTable[33] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
 
-static const unsigned char base32NumDecTable[10] = {
-	-1, -1, 26, 27, 28, 29, 30, 31, -1, -1
+/* Values of the base32 digits, both upper and lower case, -1 for other characters. */
+static const signed char base32DecodeTable[256] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, 26, 27, 28, 29, 30, 31, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+	-1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+	15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
 };
 
 static int makeMask(int bit_count)
@@ -42,50 +57,54 @@ static int makeMask(int bit_count)
 	return ret;
 }
 
-static void addBits(unsigned char *buf, int *bits_decoded, int bits)
-{
-	int bits_to_first_byte;
-	int shift_count;
-	int buf_idx;
-	int selected_bits;
-
-	if (bits < 0) {
-		return;
-	}
+/**
+ * Decodes \c base32_len characters into \c buf, which must have room for at least
+ * <tt>base32_len * 5 / 8</tt> bytes.
+ */
+static int base32DecodeInto(const char *base32, size_t base32_len, unsigned char *buf, size_t *data_len) {
+	unsigned acc = 0;
+	unsigned acc_bits = 0;
+	size_t len = 0;
+	size_t i;
 
-	bits_to_first_byte = 8 - *bits_decoded % 8;
-	if (bits_to_first_byte > 5) {
-		bits_to_first_byte = 5;
-	}
+	for (i = 0; i < base32_len; i++) {
+		unsigned char c = (unsigned char)base32[i];
+		int bits = base32DecodeTable[c];
 
-	shift_count = 8 - bits_to_first_byte - *bits_decoded % 8;
-	buf_idx = *bits_decoded / 8;
-	selected_bits = (bits & (makeMask(bits_to_first_byte) <<
-				(5 - bits_to_first_byte))) >> (5 - bits_to_first_byte);
+		if (bits >= 0) {
+			acc = ((acc << 5) | (unsigned)bits) & 0xfff;
+			acc_bits += 5;
 
-	buf[buf_idx] |= selected_bits << shift_count;
-	*bits_decoded += bits_to_first_byte;
+			if (acc_bits >= 8) {
+				acc_bits -= 8;
+				buf[len++] = (unsigned char)(acc >> acc_bits);
+			}
+			continue;
+		}
 
-	if (bits_to_first_byte < 5) {
-		int bits_to_second_byte = 5 - bits_to_first_byte;
+		if (c == '=') {
+			break;
+		}
 
-		shift_count = 8 - bits_to_second_byte;
-		buf_idx++;
-		selected_bits = bits & ((makeMask(bits_to_second_byte) <<
-					(5 - bits_to_second_byte)) >> (5 - bits_to_second_byte));
+		/* The '-' is used for grouping of the base64 encoded string and we may ignore it. */
+		if (c == '-') {
+			continue;
+		}
 
-		buf[buf_idx] |= selected_bits << shift_count;
-		*bits_decoded += bits_to_second_byte;
+		return KSI_INVALID_FORMAT;
 	}
+
+	/* We ignore padding errors. Extra bits at the end (when input bit count was
+	 * not divisible by 8) are truncated. */
+	*data_len = len;
+
+	return KSI_OK;
 }
 
 int KSI_base32Decode(const char *base32, unsigned char **data, size_t *data_len) {
 	int res = KSI_UNKNOWN_ERROR;
-
-	int bits_decoded = 0;
-	char c;
-	size_t i;
 	unsigned char *tmp = NULL;
+	size_t tmp_len = 0;
 	size_t base32_len;
 
 	if (base32 == NULL || data == NULL || data_len == NULL) {
@@ -101,47 +120,48 @@ int KSI_base32Decode(const char *base32, unsigned char **data, size_t *data_len)
 		goto cleanup;
 	}
 
-	for (i = 0; i < base32_len; i++) {
-		c = (char)toupper(base32[i]);
+	res = base32DecodeInto(base32, base32_len, tmp, &tmp_len);
+	if (res != KSI_OK) goto cleanup;
 
-		if (c == '=') {
-			break;
-		}
+	*data_len = tmp_len;
+	*data = tmp;
+	tmp = NULL;
 
-		/* The '-' is used for grouping of the base64 encoded string and we may ignore it. */
-		if (c == '-') {
-			continue;
-		}
+	res = KSI_OK;
 
-		if (isdigit(c)) {
-			addBits(tmp, &bits_decoded, base32NumDecTable[c - '0']);
-			continue;
-		}
-		/* It is not safe to use isalpha() here: it is locale dependent and
-		 * can return true for characters that are invalid for base32 encoding.
-		 */
-		if (c >= 'A' && c <= 'Z') {
-			addBits(tmp, &bits_decoded, c - 'A');
-			continue;
-		}
+cleanup:
 
-		res = KSI_INVALID_FORMAT;
+	KSI_free(tmp);
+	return res;
+}
+
+int KSI_base32DecodeBatch(const char * const *base32, size_t count, unsigned char **data, size_t *data_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	size_t i;
+
+	if ((base32 == NULL || data == NULL || data_len == NULL) && count > 0) {
+		res = KSI_INVALID_ARGUMENT;
 		goto cleanup;
 	}
 
-	/* We ignore padding errors. */
+	for (i = 0; i < count; i++) data[i] = NULL;
 
-	/* This operation also truncates extra bits from the end (when input
-	 * bit count was not divisible by 5). */
-	*data_len = bits_decoded / 8;
-	*data = tmp;
-	tmp = NULL;
+	for (i = 0; i < count; i++) {
+		res = KSI_base32Decode(base32[i], &data[i], &data_len[i]);
+		if (res != KSI_OK) goto cleanup;
+	}
 
 	res = KSI_OK;
 
 cleanup:
 
-	KSI_free(tmp);
+	if (res != KSI_OK && data != NULL) {
+		for (i = 0; i < count; i++) {
+			KSI_free(data[i]);
+			data[i] = NULL;
+		}
+	}
+
 	return res;
 }
 
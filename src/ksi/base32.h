@@ -39,6 +39,20 @@ extern "C" {
 	 */
 	int KSI_base32Decode(const char *base32, unsigned char **data, size_t *data_len);
 
+	/**
+	 * Decodes \c count base32 encoded strings. The decoded value of <tt>base32[i]</tt> is
+	 * returned in <tt>data[i]</tt> and its length in <tt>data_len[i]</tt>.
+	 * \param[in]		base32			Array of base32 encoded source strings.
+	 * \param[in]		count			Number of the source strings.
+	 * \param[out]		data			Array of receiving pointers.
+	 * \param[out]		data_len		Array of raw value lengths.
+	 *
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 * \note The caller is responsible for freeing each output \c data element. If any of the
+	 * strings fails to decode, all the output pointers are set to \c NULL.
+	 */
+	int KSI_base32DecodeBatch(const char * const *base32, size_t count, unsigned char **data, size_t *data_len);
+
 	/**
 	 * Encodes given binary data to base32.
 	 * \param[in]		data			Pointer to the input data.
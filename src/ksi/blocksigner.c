@@ -21,16 +21,28 @@
 #ifndef BLOCKSIGNER_C_
 #define BLOCKSIGNER_C_
 
+#include <string.h>
+
 #include "internal.h"
 #include "blocksigner.h"
 #include "tree_builder.h"
 #include "hashchain.h"
+#include "tlv.h"
+#include "tlv_template.h"
 #include "signature_builder.h"
+#include "signature_builder_impl.h"
+#include "signature_impl.h"
+/* For optimization reasons, we need access to KSI_DataHasher->closeExisting() function. */
+#include "hash_impl.h"
+#include "ctx_impl.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+KSI_IMPORT_TLV_TEMPLATE(KSI_Signature);
+KSI_IMPORT_TLV_TEMPLATE(KSI_AggregationHashChain);
+
 KSI_IMPLEMENT_LIST(KSI_BlockSignerHandle, KSI_BlockSignerHandle_free);
 
 
@@ -47,6 +59,9 @@ struct KSI_BlockSigner_st {
 	/** Common hasher object. */
 	KSI_DataHasher *hsr;
 
+	/** Handles of all the leafs in the order they were added. */
+	KSI_LIST(KSI_BlockSignerHandle) *leafList;
+
 	KSI_TreeBuilderLeafProcessor metaDataProcessor;
 	KSI_TreeBuilderLeafProcessor maskingProcessor;
 };
@@ -129,12 +144,16 @@ cleanup:
 	return res;
 }
 
+/* Masks the leaf with a value derived from the previous leaf. The mask hash and its node are
+ * allocated for every leaf: the node becomes a permanent part of the tree and the hash chains
+ * of the leaf are built from it after the tree is closed, so neither can be reused. */
 static int maskingProcessor(KSI_TreeNode *in, void *c, KSI_TreeNode **out) {
 	int res = KSI_UNKNOWN_ERROR;
 	KSI_BlockSigner *signer = c;
 	KSI_TreeNode *tmp = NULL;
 	KSI_DataHash *mask = NULL;
 	KSI_DataHash *leafHash = NULL;
+	KSI_DataHasher *hsr = NULL;
 	unsigned char tmpLvl;
 
 	if (in == NULL || c == NULL || out == NULL) {
@@ -151,27 +170,35 @@ static int maskingProcessor(KSI_TreeNode *in, void *c, KSI_TreeNode **out) {
 			goto cleanup;
 		}
 
+		if (!KSI_IS_VALID_TREE_LEVEL(in->level + 1)) {
+			KSI_pushError(signer->ctx, res = KSI_INVALID_STATE, "The tree height is too large.");
+			goto cleanup;
+		}
+
+		tmpLvl = (unsigned char)(in->level + 1);
+		hsr = signer->builder->hsr;
+
 		/* Calculate the mask value. */
-		res = KSI_DataHasher_reset(signer->builder->hsr);
+		res = KSI_DataHasher_reset(hsr);
 		if (res != KSI_OK) {
 			KSI_pushError(signer->ctx, res, NULL);
 			goto cleanup;
 		}
 
 		/* Change here, if there is a need, to add previous values that are not nodes containing hash values. */
-		res = KSI_DataHasher_addImprint(signer->builder->hsr, signer->prevLeaf);
+		res = KSI_DataHasher_add(hsr, signer->prevLeaf->imprint, signer->prevLeaf->imprint_length);
 		if (res != KSI_OK) {
 			KSI_pushError(signer->ctx, res, NULL);
 			goto cleanup;
 		}
 
-		res = KSI_DataHasher_addOctetString(signer->builder->hsr, signer->iv);
+		res = KSI_DataHasher_addOctetString(hsr, signer->iv);
 		if (res != KSI_OK) {
 			KSI_pushError(signer->ctx, res, NULL);
 			goto cleanup;
 		}
 
-		res = KSI_DataHasher_close(signer->builder->hsr, &mask);
+		res = KSI_DataHasher_close(hsr, &mask);
 		if (res != KSI_OK) {
 			KSI_pushError(signer->ctx, res, NULL);
 			goto cleanup;
@@ -185,47 +212,51 @@ static int maskingProcessor(KSI_TreeNode *in, void *c, KSI_TreeNode **out) {
 		}
 
 		/* Calculate the actual leaf value. */
-		res = KSI_DataHasher_reset(signer->builder->hsr);
+		res = KSI_DataHasher_reset(hsr);
 		if (res != KSI_OK) {
 			KSI_pushError(signer->ctx, res, NULL);
 			goto cleanup;
 		}
 
-		res = KSI_DataHasher_addImprint(signer->builder->hsr, mask);
+		res = KSI_DataHasher_add(hsr, mask->imprint, mask->imprint_length);
 		if (res != KSI_OK) {
 			KSI_pushError(signer->ctx, res, NULL);
 			goto cleanup;
 		}
 
-		res = KSI_DataHasher_addImprint(signer->builder->hsr, in->hash);
+		res = KSI_DataHasher_add(hsr, in->hash->imprint, in->hash->imprint_length);
 		if (res != KSI_OK) {
 			KSI_pushError(signer->ctx, res, NULL);
 			goto cleanup;
 		}
 
-		if (!KSI_IS_VALID_TREE_LEVEL(in->level + 1)) {
-			KSI_pushError(signer->ctx, res = KSI_INVALID_STATE, "The tree height is too large.");
-			goto cleanup;
-		}
-
-		tmpLvl = (unsigned char)(in->level + 1);
-
-		res = KSI_DataHasher_add(signer->builder->hsr, &tmpLvl, 1);
+		res = KSI_DataHasher_add(hsr, &tmpLvl, 1);
 		if (res != KSI_OK) {
 			KSI_pushError(signer->ctx, res, NULL);
 			goto cleanup;
 		}
 
-		res = KSI_DataHasher_close(signer->builder->hsr, &leafHash);
-		if (res != KSI_OK) {
-			KSI_pushError(signer->ctx, res, NULL);
-			goto cleanup;
+		/* The previous leaf value is only used by the block signer. As long as nobody else holds a
+		 * reference to it (see #KSI_BlockSigner_getPrevLeaf), it can be overwritten in place. */
+		if (signer->prevLeaf->ref == 1) {
+			res = hsr->closeExisting(hsr, signer->prevLeaf);
+			if (res != KSI_OK) {
+				KSI_pushError(signer->ctx, res, NULL);
+				goto cleanup;
+			}
+		} else {
+			res = KSI_DataHasher_close(hsr, &leafHash);
+			if (res != KSI_OK) {
+				KSI_pushError(signer->ctx, res, NULL);
+				goto cleanup;
+			}
+
+			/* Swap the previous leaf hash value. */
+			KSI_DataHash_free(signer->prevLeaf);
+			signer->prevLeaf = leafHash;
+			leafHash = NULL;
 		}
 
-		/* Swap the previous leaf hash value. */
-		KSI_DataHash_free(signer->prevLeaf);
-		signer->prevLeaf = KSI_DataHash_ref(leafHash);
-
 		*out = tmp;
 		tmp = NULL;
 	} else {
@@ -270,6 +301,7 @@ int KSI_BlockSigner_new(KSI_CTX *ctx, KSI_HashAlgorithm algoId, KSI_DataHash *pr
 	tmp->iv = NULL;
 	tmp->metaData = NULL;
 	tmp->hsr = NULL;
+	tmp->leafList = NULL;
 
 	tmp->metaDataProcessor.c = tmp;
 	tmp->metaDataProcessor.fn = metaDataProcessor;
@@ -283,6 +315,12 @@ int KSI_BlockSigner_new(KSI_CTX *ctx, KSI_HashAlgorithm algoId, KSI_DataHash *pr
 	res = KSI_TreeBuilder_new(ctx, algoId, &tmp->builder);
 	if (res != KSI_OK) goto cleanup;
 
+	res = KSI_BlockSignerHandleList_new(&tmp->leafList);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
 	tmp->prevLeaf = KSI_DataHash_ref(prevLeaf);
 	tmp->origPrevLeaf = KSI_DataHash_ref(prevLeaf);
 	tmp->iv = KSI_OctetString_ref(initVal);
@@ -313,6 +351,61 @@ cleanup:
 	return res;
 }
 
+int KSI_BlockSigner_newMasked(KSI_CTX *ctx, KSI_HashAlgorithm algoId, KSI_BlockSigner **signer) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_DataHash *zero = NULL;
+	KSI_OctetString *iv = NULL;
+	unsigned char buf[KSI_MAX_IMPRINT_LEN];
+	unsigned len;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || signer == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	len = KSI_getHashLength(algoId);
+	if (len == 0 || len > sizeof(buf)) {
+		KSI_pushError(ctx, res = KSI_UNAVAILABLE_HASH_ALGORITHM, NULL);
+		goto cleanup;
+	}
+
+	/* The initial value is as long as the output of the hash function. */
+	res = ctx->randomBytes(ctx, buf, len);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, "Unable to generate the initial value for masking.");
+		goto cleanup;
+	}
+
+	res = KSI_OctetString_new(ctx, buf, len, &iv);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_DataHash_createZero(ctx, algoId, &zero);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_BlockSigner_new(ctx, algoId, zero, iv, signer);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_DataHash_free(zero);
+	KSI_OctetString_free(iv);
+
+	return res;
+}
+
 void KSI_BlockSigner_free(KSI_BlockSigner *signer) {
 	if (signer != NULL && --signer->ref == 0) {
 		KSI_TreeBuilder_free(signer->builder);
@@ -321,6 +414,7 @@ void KSI_BlockSigner_free(KSI_BlockSigner *signer) {
 		KSI_DataHash_free(signer->prevLeaf);
 		KSI_DataHash_free(signer->origPrevLeaf);
 		KSI_DataHasher_free(signer->hsr);
+		KSI_BlockSignerHandleList_free(signer->leafList);
 		KSI_free(signer);
 	}
 }
@@ -367,6 +461,7 @@ int KSI_BlockSigner_close(KSI_BlockSigner *signer, void *dummy) {
 int KSI_BlockSigner_reset(KSI_BlockSigner *signer) {
 	int res = KSI_UNKNOWN_ERROR;
 	KSI_TreeBuilder *builder = NULL;
+	KSI_LIST(KSI_BlockSignerHandle) *leafList = NULL;
 
 	if (signer == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -381,9 +476,19 @@ int KSI_BlockSigner_reset(KSI_BlockSigner *signer) {
 		goto cleanup;
 	}
 
+	res = KSI_BlockSignerHandleList_new(&leafList);
+	if (res != KSI_OK) {
+		KSI_pushError(signer->ctx, res, NULL);
+		goto cleanup;
+	}
+
 	KSI_Signature_free(signer->signature);
 	signer->signature = NULL;
 
+	KSI_BlockSignerHandleList_free(signer->leafList);
+	signer->leafList = leafList;
+	leafList = NULL;
+
 	KSI_TreeBuilder_free(signer->builder);
 	signer->builder = builder;
 	builder = NULL;
@@ -409,6 +514,7 @@ int KSI_BlockSigner_reset(KSI_BlockSigner *signer) {
 cleanup:
 
 	KSI_TreeBuilder_free(builder);
+	KSI_BlockSignerHandleList_free(leafList);
 
 	return res;
 }
@@ -442,13 +548,21 @@ int KSI_BlockSigner_addLeaf(KSI_BlockSigner *signer, KSI_DataHash *hsh, int leve
 
 	tmp->leafHandle = leafHandle;
 	tmp->signer = signer;
+	leafHandle = NULL;
+
+	res = KSI_BlockSignerHandleList_append(signer->leafList, KSI_BlockSignerHandle_ref(tmp));
+	if (res != KSI_OK) {
+		/* Cleanup the reference. */
+		KSI_BlockSignerHandle_free(tmp);
+
+		KSI_pushError(signer->ctx, res, NULL);
+		goto cleanup;
+	}
 
 	if (handle != NULL) {
 		*handle = KSI_BlockSignerHandle_ref(tmp);
 	}
 
-	leafHandle = NULL;
-
 	res = KSI_OK;
 
 cleanup:
@@ -541,6 +655,594 @@ cleanup:
 	return res;
 }
 
+/* Shared components of the leaf signatures of a closed block signer. */
+typedef struct LeafTemplate_st {
+	/** Clone of the block signature with the root level removed from the level correction. */
+	KSI_Signature *sig;
+	/** The root level removed from the block signature. */
+	KSI_uint64_t rootLevel;
+	/** Aggregation time of the block signature. */
+	KSI_Integer *aggrTime;
+	/** Chain index of the first aggregation hash chain of the block signature. */
+	KSI_LIST(KSI_Integer) *chainIndex;
+	/** Serialized payload of the block signature. */
+	unsigned char *payload;
+	/** Length of the serialized payload. */
+	size_t payload_len;
+} LeafTemplate;
+
+static void LeafTemplate_clean(LeafTemplate *t) {
+	if (t != NULL) {
+		KSI_Signature_free(t->sig);
+		KSI_free(t->payload);
+
+		t->sig = NULL;
+		t->rootLevel = 0;
+		t->aggrTime = NULL;
+		t->chainIndex = NULL;
+		t->payload = NULL;
+		t->payload_len = 0;
+	}
+}
+
+static int LeafTemplate_init(const KSI_BlockSigner *signer, KSI_uint64_t rootLevel, LeafTemplate *t) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_Signature *sig = NULL;
+	KSI_AggregationHashChain *first = NULL;
+	unsigned char *payload = NULL;
+	size_t payload_len = 0;
+
+	if (signer == NULL || t == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	res = KSI_Signature_clone(signer->signature, &sig);
+	if (res != KSI_OK) {
+		KSI_pushError(signer->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	/* Remove the level correction applied when the root hash was signed. */
+	if (rootLevel != 0) {
+		res = sig->subRootLevel(sig, rootLevel);
+		if (res != KSI_OK) {
+			KSI_pushError(signer->ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	res = KSI_AggregationHashChainList_elementAt(sig->aggregationChainList, 0, &first);
+	if (res != KSI_OK || first == NULL) {
+		KSI_pushError(signer->ctx, res != KSI_OK ? res : (res = KSI_INVALID_STATE), "Signature does not contain any aggregation hash chains.");
+		goto cleanup;
+	}
+
+	res = KSI_AggregationHashChain_getChainIndex(first, &t->chainIndex);
+	if (res != KSI_OK) {
+		KSI_pushError(signer->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_Signature_getSigningTime(sig, &t->aggrTime);
+	if (res != KSI_OK) {
+		KSI_pushError(signer->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	payload = KSI_malloc(0xffff);
+	if (payload == NULL) {
+		KSI_pushError(signer->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	payload_len = 0xffff;
+	res = KSI_TLV_serializePayload(sig->baseTlv, payload, &payload_len);
+	if (res != KSI_OK) {
+		KSI_pushError(signer->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	t->sig = sig;
+	sig = NULL;
+
+	t->payload = payload;
+	payload = NULL;
+
+	t->payload_len = payload_len;
+	t->rootLevel = rootLevel;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(payload);
+	KSI_Signature_free(sig);
+
+	return res;
+}
+
+/* Calculates the level of the aggregation hash chain output without hashing. */
+static int getChainLevel(const KSI_AggregationHashChain *aggr, KSI_uint64_t *level) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_LIST(KSI_HashChainLink) *links = NULL;
+	KSI_uint64_t lvl = 0;
+	size_t i;
+
+	if (aggr == NULL || level == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	res = KSI_AggregationHashChain_getChain(aggr, &links);
+	if (res != KSI_OK) goto cleanup;
+
+	for (i = 0; i < KSI_HashChainLinkList_length(links); i++) {
+		KSI_HashChainLink *link = NULL;
+		KSI_Integer *levelCorrection = NULL;
+
+		res = KSI_HashChainLinkList_elementAt(links, i, &link);
+		if (res != KSI_OK) goto cleanup;
+
+		res = KSI_HashChainLink_getLevelCorrection(link, &levelCorrection);
+		if (res != KSI_OK) goto cleanup;
+
+		lvl += KSI_Integer_getUInt64(levelCorrection) + 1;
+	}
+
+	*level = lvl;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+/* Sets the aggregation time and the chain index of the leaf aggregation hash chain. */
+static int completeLeafChain(KSI_CTX *ctx, const LeafTemplate *t, KSI_AggregationHashChain *aggr) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_LIST(KSI_Integer) *chainIndex = NULL;
+	KSI_Integer *shape = NULL;
+	KSI_uint64_t shapeVal;
+	size_t i;
+
+	if (t == NULL || aggr == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	{
+		KSI_Integer *ref = NULL;
+
+		res = KSI_AggregationHashChain_setAggregationTime(aggr, ref = KSI_Integer_ref(t->aggrTime));
+		if (res != KSI_OK) {
+			/* Cleanup the reference. */
+			KSI_Integer_free(ref);
+
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	res = KSI_IntegerList_new(&chainIndex);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < KSI_IntegerList_length(t->chainIndex); i++) {
+		KSI_Integer *tmp = NULL;
+		KSI_Integer *ref = NULL;
+
+		res = KSI_IntegerList_elementAt(t->chainIndex, i, &tmp);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = KSI_IntegerList_append(chainIndex, ref = KSI_Integer_ref(tmp));
+		if (res != KSI_OK) {
+			/* Cleanup the reference. */
+			KSI_Integer_free(ref);
+
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	res = KSI_AggregationHashChain_calculateShape(aggr, &shapeVal);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_Integer_new(ctx, shapeVal, &shape);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_IntegerList_append(chainIndex, shape);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+	shape = NULL;
+
+	res = KSI_AggregationHashChain_setChainIndex(aggr, chainIndex);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+	chainIndex = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_Integer_free(shape);
+	KSI_IntegerList_free(chainIndex);
+
+	return res;
+}
+
+/* Serializes the leaf signature as the block signature payload followed by the leaf aggregation hash chain. */
+static int serializeLeafSignature(KSI_CTX *ctx, const LeafTemplate *t, KSI_AggregationHashChain *aggr, unsigned char *buf, size_t buf_size, size_t *buf_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	size_t chain_len = 0;
+	size_t len;
+
+	if (t == NULL || aggr == NULL || buf == NULL || buf_len == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	if (buf_size < 4 + t->payload_len) {
+		KSI_pushError(ctx, res = KSI_BUFFER_OVERFLOW, NULL);
+		goto cleanup;
+	}
+
+	memcpy(buf + 4, t->payload, t->payload_len);
+
+	res = KSI_AggregationHashChain_writeBytes(aggr, buf + 4 + t->payload_len, buf_size - 4 - t->payload_len, &chain_len, 0);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	len = t->payload_len + chain_len;
+	if (len > 0xffff) {
+		KSI_pushError(ctx, res = KSI_BUFFER_OVERFLOW, "Leaf signature too large.");
+		goto cleanup;
+	}
+
+	/* Encode the header as TLV16. */
+	buf[0] = (unsigned char) (KSI_TLV_MASK_TLV16 | (0x0800 >> 8));
+	buf[1] = 0x0800 & 0xff;
+	buf[2] = 0xff & len >> 8;
+	buf[3] = 0xff & len;
+
+	*buf_len = len + 4;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+static int createLeafSignature(KSI_CTX *ctx, const LeafTemplate *t, KSI_AggregationHashChain *aggr, KSI_Signature **sig) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_SignatureBuilder *builder = NULL;
+	KSI_TLV *leafTlv = NULL;
+	size_t i;
+
+	if (t == NULL || aggr == NULL || sig == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	res = KSI_SignatureBuilder_open(ctx, &builder);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_SignatureBuilder_addAggregationChain(builder, aggr);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	/* Share the rest of the components with the block signature. */
+	for (i = 0; i < KSI_AggregationHashChainList_length(t->sig->aggregationChainList); i++) {
+		KSI_AggregationHashChain *tmp = NULL;
+
+		res = KSI_AggregationHashChainList_elementAt(t->sig->aggregationChainList, i, &tmp);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = KSI_SignatureBuilder_addAggregationChain(builder, tmp);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	if (t->sig->calendarChain != NULL) {
+		res = KSI_SignatureBuilder_setCalendarHashChain(builder, t->sig->calendarChain);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	if (t->sig->calendarAuthRec != NULL) {
+		res = KSI_SignatureBuilder_setCalendarAuthRecord(builder, t->sig->calendarAuthRec);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	if (t->sig->publication != NULL) {
+		res = KSI_SignatureBuilder_setPublication(builder, t->sig->publication);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	if (t->sig->rfc3161 != NULL) {
+		res = KSI_SignatureBuilder_setRFC3161(builder, t->sig->rfc3161);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	builder->sig->aggregationAuthRec = KSI_AggregationAuthRec_ref(t->sig->aggregationAuthRec);
+
+	/* Encode the shared components in the order of the block signature, followed by the leaf
+	 * aggregation hash chain, the same way #KSI_BlockSignerHandle_getSignature does. */
+	res = KSI_TLV_new(ctx, 0x0800, 0, 0, &builder->sig->baseTlv);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_TlvTemplate_construct(ctx, builder->sig->baseTlv, t->sig, KSI_TLV_TEMPLATE(KSI_Signature));
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_TLV_new(ctx, 0x0801, 0, 0, &leafTlv);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_TlvTemplate_construct(ctx, leafTlv, aggr, KSI_TLV_TEMPLATE(KSI_AggregationHashChain));
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_TLV_appendNestedTlv(builder->sig->baseTlv, leafTlv);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+	leafTlv = NULL;
+
+	/* The leaf hash chain was computed by the tree builder, skip the verification. */
+	builder->noVerify = 1;
+	res = KSI_SignatureBuilder_close(builder, 0, sig);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_TLV_free(leafTlv);
+	KSI_SignatureBuilder_free(builder);
+
+	return res;
+}
+
+static int processRootSignature(KSI_BlockSigner *signer, KSI_BlockSignerHandle *handle, KSI_BlockSignerSignatureCallback sigFn, KSI_BlockSignerWriteCallback writeFn, void *c) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_Signature *sig = NULL;
+	unsigned char *raw = NULL;
+	size_t raw_len = 0;
+
+	if (writeFn != NULL) {
+		res = KSI_Signature_serialize(signer->signature, &raw, &raw_len);
+		if (res != KSI_OK) {
+			KSI_pushError(signer->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = writeFn(handle, raw, raw_len, c);
+		if (res != KSI_OK) {
+			KSI_pushError(signer->ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	if (sigFn != NULL) {
+		res = KSI_Signature_clone(signer->signature, &sig);
+		if (res != KSI_OK) {
+			KSI_pushError(signer->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = sigFn(handle, sig, c);
+		if (res != KSI_OK) {
+			KSI_pushError(signer->ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_Signature_free(sig);
+	KSI_free(raw);
+
+	return res;
+}
+
+static int processLeafSignatures(KSI_BlockSigner *signer, KSI_BlockSignerSignatureCallback sigFn, KSI_BlockSignerWriteCallback writeFn, void *c) {
+	int res = KSI_UNKNOWN_ERROR;
+	LeafTemplate t;
+	KSI_AggregationHashChain *aggr = NULL;
+	KSI_Signature *sig = NULL;
+	unsigned char *buf = NULL;
+	size_t buf_size = 0xffff + 4;
+	size_t buf_len;
+	KSI_uint64_t rootLevel = 0;
+	size_t i;
+
+	memset(&t, 0, sizeof(t));
+
+	if (signer == NULL || (sigFn == NULL && writeFn == NULL)) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_ERR_clearErrors(signer->ctx);
+
+	if (signer->signature == NULL) {
+		KSI_pushError(signer->ctx, res = KSI_INVALID_STATE, "The blocksigner is not closed.");
+		goto cleanup;
+	}
+
+	if (writeFn != NULL) {
+		buf = KSI_malloc(buf_size);
+		if (buf == NULL) {
+			KSI_pushError(signer->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+			goto cleanup;
+		}
+	}
+
+	for (i = 0; i < KSI_BlockSignerHandleList_length(signer->leafList); i++) {
+		KSI_BlockSignerHandle *handle = NULL;
+
+		res = KSI_BlockSignerHandleList_elementAt(signer->leafList, i, &handle);
+		if (res != KSI_OK || handle == NULL) {
+			KSI_pushError(signer->ctx, res != KSI_OK ? res : (res = KSI_INVALID_STATE), NULL);
+			goto cleanup;
+		}
+
+		/* Extract the calculated aggregation hash chain. */
+		res = KSI_TreeLeafHandle_getAggregationChain(handle->leafHandle, &aggr);
+		if (res != KSI_OK) {
+			KSI_pushError(signer->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = getChainLevel(aggr, &rootLevel);
+		if (res != KSI_OK) {
+			KSI_pushError(signer->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		/* A single leaf without masking or meta-data has an empty chain, the block signature is the leaf signature. */
+		if (rootLevel == 0) {
+			res = processRootSignature(signer, handle, sigFn, writeFn, c);
+			if (res != KSI_OK) {
+				KSI_pushError(signer->ctx, res, NULL);
+				goto cleanup;
+			}
+
+			KSI_AggregationHashChain_free(aggr);
+			aggr = NULL;
+			continue;
+		}
+
+		/* The template only needs to be recreated if the leafs have different levels. */
+		if (t.sig == NULL || t.rootLevel != rootLevel) {
+			LeafTemplate_clean(&t);
+
+			res = LeafTemplate_init(signer, rootLevel, &t);
+			if (res != KSI_OK) {
+				KSI_pushError(signer->ctx, res, NULL);
+				goto cleanup;
+			}
+		}
+
+		res = completeLeafChain(signer->ctx, &t, aggr);
+		if (res != KSI_OK) {
+			KSI_pushError(signer->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		if (writeFn != NULL) {
+			res = serializeLeafSignature(signer->ctx, &t, aggr, buf, buf_size, &buf_len);
+			if (res != KSI_OK) {
+				KSI_pushError(signer->ctx, res, NULL);
+				goto cleanup;
+			}
+
+			res = writeFn(handle, buf, buf_len, c);
+			if (res != KSI_OK) {
+				KSI_pushError(signer->ctx, res, NULL);
+				goto cleanup;
+			}
+		}
+
+		if (sigFn != NULL) {
+			res = createLeafSignature(signer->ctx, &t, aggr, &sig);
+			if (res != KSI_OK) {
+				KSI_pushError(signer->ctx, res, NULL);
+				goto cleanup;
+			}
+
+			res = sigFn(handle, sig, c);
+			if (res != KSI_OK) {
+				KSI_pushError(signer->ctx, res, NULL);
+				goto cleanup;
+			}
+
+			KSI_Signature_free(sig);
+			sig = NULL;
+		}
+
+		KSI_AggregationHashChain_free(aggr);
+		aggr = NULL;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	LeafTemplate_clean(&t);
+	KSI_Signature_free(sig);
+	KSI_AggregationHashChain_free(aggr);
+	KSI_free(buf);
+
+	return res;
+}
+
+int KSI_BlockSigner_getSignatures(KSI_BlockSigner *signer, KSI_BlockSignerSignatureCallback fn, void *c) {
+	if (fn == NULL) return KSI_INVALID_ARGUMENT;
+	return processLeafSignatures(signer, fn, NULL, c);
+}
+
+int KSI_BlockSigner_writeSignatures(KSI_BlockSigner *signer, KSI_BlockSignerWriteCallback fn, void *c) {
+	if (fn == NULL) return KSI_INVALID_ARGUMENT;
+	return processLeafSignatures(signer, NULL, fn, c);
+}
+
 
 #ifdef __cplusplus
 }
@@ -51,6 +51,18 @@ KSI_DEFINE_LIST(KSI_BlockSignerHandle);
  */
 int KSI_BlockSigner_new(KSI_CTX *ctx, KSI_HashAlgorithm algoId, KSI_DataHash *prevLeaf, KSI_OctetString *initVal, KSI_BlockSigner **signer);
 
+/**
+ * Create a new instance of #KSI_BlockSigner that masks every leaf. The initial value
+ * is random and the previous leaf is a zero hash, so the signatures of the leafs do
+ * not reveal the other hashes of the block.
+ * \param[in]	ctx			KSI context.
+ * \param[in]	algoId		Algorithm to be used for the internal hash node computation.
+ * \param[out]	signer		Pointer to the receiving pointer.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \see #KSI_BlockSigner_new
+ */
+int KSI_BlockSigner_newMasked(KSI_CTX *ctx, KSI_HashAlgorithm algoId, KSI_BlockSigner **signer);
+
 /**
  * Cleanup method for the #KSI_BlockSigner.
  * \param[in]	signer		Instance of the #KSI_BlockSigner.
@@ -114,6 +126,50 @@ int KSI_BlockSigner_getPrevLeaf(const KSI_BlockSigner *signer, KSI_DataHash **pr
  */
 int KSI_BlockSignerHandle_getSignature(const KSI_BlockSignerHandle *handle, KSI_Signature **sig);
 
+/**
+ * Callback function type for #KSI_BlockSigner_getSignatures.
+ * \param[in]	handle		Handle of the leaf the signature belongs to.
+ * \param[in]	sig			Signature of the leaf.
+ * \param[in]	c			User provided context.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The signature is freed after the callback returns, use #KSI_Signature_ref to keep it.
+ */
+typedef int (*KSI_BlockSignerSignatureCallback)(KSI_BlockSignerHandle *handle, KSI_Signature *sig, void *c);
+
+/**
+ * Callback function type for #KSI_BlockSigner_writeSignatures.
+ * \param[in]	handle		Handle of the leaf the signature belongs to.
+ * \param[in]	raw			Serialized signature of the leaf.
+ * \param[in]	raw_len		Length of the serialized signature.
+ * \param[in]	c			User provided context.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The buffer \c raw is reused for the next leaf and may not be kept by the callback.
+ */
+typedef int (*KSI_BlockSignerWriteCallback)(KSI_BlockSignerHandle *handle, const unsigned char *raw, size_t raw_len, void *c);
+
+/**
+ * Creates the signatures of all the leafs of a closed block signer and passes them to the
+ * callback function in the order the leafs were added. Unlike #KSI_BlockSignerHandle_getSignature,
+ * the components of the block signature are shared by reference and only the aggregation hash chain
+ * of the leaf is computed for each signature. The resulting signatures are not verified.
+ * \param[in]	signer		Instance of the #KSI_BlockSigner.
+ * \param[in]	fn			Callback function.
+ * \param[in]	c			User provided context for the callback function (can be \c NULL).
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \see #KSI_BlockSigner_writeSignatures.
+ */
+int KSI_BlockSigner_getSignatures(KSI_BlockSigner *signer, KSI_BlockSignerSignatureCallback fn, void *c);
+
+/**
+ * Same as #KSI_BlockSigner_getSignatures, but the signatures are only serialized and no #KSI_Signature
+ * objects are created. This is the fastest way to write all the signatures of a block to an output stream.
+ * \param[in]	signer		Instance of the #KSI_BlockSigner.
+ * \param[in]	fn			Callback function.
+ * \param[in]	c			User provided context for the callback function (can be \c NULL).
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ */
+int KSI_BlockSigner_writeSignatures(KSI_BlockSigner *signer, KSI_BlockSignerWriteCallback fn, void *c);
+
 /**
  * Cleanup method for the handle.
  * \param[in]	handle		Instance of the #KSI_BlockSignerHandle
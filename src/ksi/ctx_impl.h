@@ -20,13 +20,27 @@
 #ifndef CTX_IMPL_H_
 #define CTX_IMPL_H_
 
+#include <time.h>
+
 #include "types.h"
+#include "metrics.h"
+#include "thread.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define KSI_ERR_STACK_LEN 16
+#define KSI_PUBSTR_CACHE_SIZE 8
+
+	/**
+	 * Decoded publication string, see #KSI_PublicationData_fromBase32.
+	 */
+	typedef struct KSI_PublicationStringCacheEntry_st {
+		char *pubStr;
+		KSI_Integer *time;
+		KSI_DataHash *imprint;
+	} KSI_PublicationStringCacheEntry;
 
 	typedef void (*GlobalCleanupFn)(void);
 	typedef int (*GlobalInitFn)(void);
@@ -73,6 +87,24 @@ extern "C" {
 		/** Pointer to an instance of a publications file. */
 		KSI_PublicationsFile *publicationsFile;
 
+		/** Time the publications file was received, 0 if it was set by the user. */
+		time_t publicationsFileReceived;
+
+		/** Guards #publicationsFileReceived and the pending file, which other threads access
+		 * through #KSI_CTX_refreshPublicationsFile. */
+		KSI_Mutex *publicationsFileLock;
+
+		/** Publications file verified by another context, adopted by the next #KSI_receivePublicationsFile. */
+		unsigned char *publicationsFilePending;
+		size_t publicationsFilePending_len;
+		time_t publicationsFilePendingReceived;
+
+		/** Directory of the verified publications file cache, NULL if disabled. */
+		char *publicationsFileCacheDir;
+
+		/** Publications file URL set by #KSI_CTX_setPublicationUrl, NULL if unknown. */
+		char *publicationsFileUrl;
+
 		/** This field is kept only for compatibility - will be removed in the future. */
 		char *publicationCertEmail_DEPRECATED;
 
@@ -97,6 +129,26 @@ extern "C" {
 		/** Pointer to the last signature that failed background verification. */
 		KSI_Signature *lastFailedSignature;
 
+		/** Recently decoded publication strings. */
+		KSI_PublicationStringCacheEntry pubStrCache[KSI_PUBSTR_CACHE_SIZE];
+
+		/** Position of the next entry to replace in #pubStrCache. */
+		size_t pubStrCache_next;
+
+		/** Request metrics per endpoint. */
+		KSI_MetricsSnapshot metrics;
+
+		/** Verification trace callback, NULL if tracing is disabled. */
+		KSI_VerificationTraceCallback verificationTraceCB;
+		void *verificationTraceCtx;
+
+		/** Statistics of the traced policies. */
+		KSI_PolicyStats policyStats[KSI_POLICY_STATS_SIZE];
+		size_t policyStats_count;
+
+		/** Source of the initial values for masking, see #KSI_BlockSigner_newMasked. */
+		int (*randomBytes)(KSI_CTX *ctx, unsigned char *buf, size_t len);
+
 	};
 
 #ifdef __cplusplus
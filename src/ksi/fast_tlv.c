@@ -18,6 +18,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "io.h"
 #include "internal.h"
@@ -180,48 +181,238 @@ cleanup:
 	return res;
 }
 
-int KSI_FTLV_memReadN(const unsigned char *buf, size_t buf_len, KSI_FTLV *arr, size_t arr_len, size_t *rd) {
-	int res = KSI_UNKNOWN_ERROR;
-	const unsigned char *ptr = buf;
-	size_t len = buf_len;
+/* Decodes the header of a complete TLV; returns the length of the TLV or 0 if it is truncated. */
+static size_t scanTlv(const unsigned char *ptr, size_t len, KSI_FTLV *t) {
+	size_t isTlv16;
+	size_t hdr_len;
+	size_t dat_len;
+
+	if (len < 2) return 0;
+
+	isTlv16 = (ptr[0] & KSI_TLV_MASK_TLV16) >> 7;
+	hdr_len = 2 + 2 * isTlv16;
+	if (len < hdr_len) return 0;
+
+	/* Both header forms are decoded from the form bit instead of separate code paths. */
+	dat_len = isTlv16 ? (((size_t)ptr[2] << 8) | ptr[3]) : ptr[1];
+	if (len - hdr_len < dat_len) return 0;
+
+	t->tag = ((ptr[0] & KSI_TLV_MASK_TLV8_TYPE) << (8 * isTlv16)) | (ptr[1] & (0xff * isTlv16));
+	t->hdr_len = hdr_len;
+	t->dat_len = dat_len;
+	t->is_nc = (ptr[0] & KSI_TLV_MASK_LENIENT) != 0;
+	t->is_fwd = (ptr[0] & KSI_TLV_MASK_FORWARD) != 0;
+
+	return hdr_len + dat_len;
+}
+
+int KSI_FTLV_memScan(const unsigned char *buf, size_t buf_len, KSI_FTLV *arr, size_t arr_len, size_t *rd, size_t *consumed) {
+	size_t off = 0;
 	size_t i = 0;
+	size_t tlvLen;
 	/* Dummy buffer, used if arr == NULL. */
 	KSI_FTLV dummy;
-	size_t off = 0;
+	KSI_FTLV *target = NULL;
+
+	if ((buf == NULL && buf_len != 0) || (arr != NULL && arr_len == 0) || (arr == NULL && arr_len != 0) || rd == NULL || consumed == NULL) {
+		return KSI_INVALID_ARGUMENT;
+	}
+
+	while (off < buf_len && (arr == NULL || i < arr_len)) {
+		target = (arr == NULL ? &dummy : &arr[i]);
+
+		tlvLen = scanTlv(buf + off, buf_len - off, target);
+		if (tlvLen == 0) break;
+
+		target->off = off;
+		off += tlvLen;
+		++i;
+	}
+
+	*rd = i;
+	*consumed = off;
+
+	return KSI_OK;
+}
+
+int KSI_FTLV_memReadN(const unsigned char *buf, size_t buf_len, KSI_FTLV *arr, size_t arr_len, size_t *rd) {
+	int res = KSI_UNKNOWN_ERROR;
+	size_t count = 0;
+	size_t consumed = 0;
 
 	if (buf == NULL || buf_len == 0 || (arr != NULL && arr_len == 0) || (arr == NULL && arr_len != 0)) {
 		res = KSI_INVALID_ARGUMENT;
 		goto cleanup;
 	}
 
-	/* Read up-to arr_len tlvs from the buffer. */
-	while ((arr_len == 0 || i < arr_len) && len > 0) {
-		size_t tlvLen;
-		KSI_FTLV *target = (arr == NULL ? &dummy : &arr[i]);
+	res = KSI_FTLV_memScan(buf, buf_len, arr, arr_len, &count, &consumed);
+	if (res != KSI_OK) goto cleanup;
+
+	/* The scan only stops early on a full output buffer, anything else is a truncated TLV. */
+	if (consumed < buf_len && (arr == NULL || count < arr_len)) {
+		res = KSI_INVALID_FORMAT;
+		goto cleanup;
+	}
+
+	/* If the output variable is set, evaluate it. */
+	if (rd != NULL) {
+		*rd = count;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+struct KSI_FTLV_Reader_st {
+	/** Header of the current TLV, until it is complete. */
+	unsigned char hdr[4];
+	size_t hdr_fill;
+
+	/** The current TLV, allocated when its header is complete. */
+	unsigned char *raw;
+	size_t raw_len;
+	size_t raw_fill;
+};
+
+int KSI_FTLV_Reader_new(KSI_FTLV_Reader **reader) {
+	KSI_FTLV_Reader *tmp = NULL;
+
+	if (reader == NULL) return KSI_INVALID_ARGUMENT;
+
+	tmp = KSI_new(KSI_FTLV_Reader);
+	if (tmp == NULL) return KSI_OUT_OF_MEMORY;
+
+	tmp->hdr_fill = 0;
+	tmp->raw = NULL;
+	tmp->raw_len = 0;
+	tmp->raw_fill = 0;
+
+	*reader = tmp;
+
+	return KSI_OK;
+}
+
+void KSI_FTLV_Reader_free(KSI_FTLV_Reader *reader) {
+	if (reader != NULL) {
+		KSI_free(reader->raw);
+		KSI_free(reader);
+	}
+}
 
-		/* Read the next tlv. */
-		res = KSI_FTLV_memRead(ptr, len, target);
+int KSI_FTLV_Reader_getWindow(KSI_FTLV_Reader *reader, unsigned char **buf, size_t *len) {
+	if (reader == NULL || buf == NULL || len == NULL) return KSI_INVALID_ARGUMENT;
+
+	if (reader->raw != NULL) {
+		*buf = reader->raw + reader->raw_fill;
+		*len = reader->raw_len - reader->raw_fill;
+	} else {
+		/* The first byte tells whether the header has two or four bytes. */
+		*buf = reader->hdr + reader->hdr_fill;
+		*len = (reader->hdr_fill < 2 ? 2 : 4) - reader->hdr_fill;
+	}
+
+	return KSI_OK;
+}
+
+int KSI_FTLV_Reader_advance(KSI_FTLV_Reader *reader, size_t len, unsigned char **tlv, size_t *tlv_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	unsigned char *window = NULL;
+	size_t window_len = 0;
+	KSI_FTLV t;
+
+	if (reader == NULL || tlv == NULL || tlv_len == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	res = KSI_FTLV_Reader_getWindow(reader, &window, &window_len);
+	if (res != KSI_OK) goto cleanup;
+
+	if (len > window_len) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	*tlv = NULL;
+	*tlv_len = 0;
+
+	if (reader->raw == NULL) {
+		reader->hdr_fill += len;
+
+		if (reader->hdr_fill < 2 || (reader->hdr_fill < 4 && (reader->hdr[0] & KSI_TLV_MASK_TLV16))) {
+			res = KSI_OK;
+			goto cleanup;
+		}
+
+		res = parseHdr(reader->hdr, reader->hdr_fill, &t);
 		if (res != KSI_OK) goto cleanup;
 
-		target->off = off;
+		reader->raw = KSI_malloc(t.hdr_len + t.dat_len);
+		if (reader->raw == NULL) {
+			res = KSI_OUT_OF_MEMORY;
+			goto cleanup;
+		}
+
+		memcpy(reader->raw, reader->hdr, t.hdr_len);
+		reader->raw_len = t.hdr_len + t.dat_len;
+		reader->raw_fill = t.hdr_len;
+		reader->hdr_fill = 0;
+	} else {
+		reader->raw_fill += len;
+	}
 
-		/* Calculate consumed bytes. */
-		tlvLen = target->hdr_len + target->dat_len;
+	if (reader->raw_fill == reader->raw_len) {
+		*tlv = reader->raw;
+		*tlv_len = reader->raw_len;
 
-		ptr += tlvLen;
-		len -= tlvLen;
-		off += tlvLen;
-		++i;
+		reader->raw = NULL;
+		reader->raw_len = 0;
+		reader->raw_fill = 0;
 	}
 
-	/* If the output variable is set, evaluate it. */
-	if (rd != NULL) {
-		*rd = i;
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_FTLV_Reader_feed(KSI_FTLV_Reader *reader, const unsigned char *data, size_t data_len, size_t *consumed, unsigned char **tlv, size_t *tlv_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	unsigned char *window = NULL;
+	size_t window_len = 0;
+	size_t off = 0;
+
+	if (reader == NULL || (data == NULL && data_len != 0) || consumed == NULL || tlv == NULL || tlv_len == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	*tlv = NULL;
+	*tlv_len = 0;
+
+	/* Stop at the end of a TLV, the rest of the data belongs to the next one. */
+	while (off < data_len && *tlv == NULL) {
+		res = KSI_FTLV_Reader_getWindow(reader, &window, &window_len);
+		if (res != KSI_OK) goto cleanup;
+
+		if (window_len > data_len - off) window_len = data_len - off;
+		memcpy(window, data + off, window_len);
+
+		res = KSI_FTLV_Reader_advance(reader, window_len, tlv, tlv_len);
+		if (res != KSI_OK) goto cleanup;
+
+		off += window_len;
 	}
 
 	res = KSI_OK;
 
 cleanup:
 
+	if (consumed != NULL) *consumed = off;
+
 	return res;
 }
@@ -25,6 +25,7 @@ extern "C" {
 #endif
 
 	typedef struct fast_tlv_s KSI_FTLV;
+	typedef struct KSI_FTLV_Reader_st KSI_FTLV_Reader;
 
 	struct fast_tlv_s {
 		/** Offset. */
@@ -101,6 +102,82 @@ extern "C" {
 	 */
 	int KSI_FTLV_memReadN(const unsigned char *buf, size_t buf_len, KSI_FTLV *arr, size_t arr_len, size_t *rd);
 
+	/**
+	 * Splits the buffer into consecutive TLV's, decoding only the headers. Unlike #KSI_FTLV_memReadN,
+	 * a truncated TLV at the end of the buffer is not an error: the scan stops before it and
+	 * \c consumed is set to its offset, so a large stream may be indexed in chunks by calling the
+	 * function again with the rest of the buffer. If \c arr is \c NULL and \c arr_len equals 0,
+	 * the TLV's are only counted.
+	 *
+	 * The scan is sequential and runs in the calling thread. There is no multi-threaded split
+	 * mode: a split point inside the buffer is only known to be a TLV boundary once the header
+	 * chain from the start reaches it, and as the scan reads the headers only and skips the
+	 * payloads, confirming the split points would cost as much as the scan itself. To process
+	 * a large buffer in parallel, scan it first and distribute the returned TLV's.
+	 * \param[in]	buf			Pointer to the memory buffer.
+	 * \param[in]	buf_len		Length of the buffer.
+	 * \param[in]	arr			Pointer to the output buffer (can be \c NULL).
+	 * \param[in]	arr_len		Length of the output buffer (must be equal to 0, if \c arr is \c NULL).
+	 * \param[out]	rd			Output parameter for the number of TLV's read.
+	 * \param[out]	consumed	Output parameter for the number of bytes of the complete TLV's read.
+	 * \return status code (\c KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_FTLV_memScan(const unsigned char *buf, size_t buf_len, KSI_FTLV *arr, size_t arr_len, size_t *rd, size_t *consumed);
+
+	/**
+	 * Creates an incremental TLV reader. The reader collects a TLV from the chunks of a stream
+	 * as they arrive, so it can be used with non-blocking sockets and event loops: a read that
+	 * would block just leaves the reader in its current state.
+	 * \param[out]	reader		Pointer to the receiving pointer.
+	 * \return status code (\c KSI_OK, when operation succeeded, otherwise an error code).
+	 * \see #KSI_FTLV_Reader_free
+	 */
+	int KSI_FTLV_Reader_new(KSI_FTLV_Reader **reader);
+
+	/**
+	 * Cleanup method for the #KSI_FTLV_Reader. A partially read TLV is dropped.
+	 * \param[in]	reader		Instance of the #KSI_FTLV_Reader.
+	 */
+	void KSI_FTLV_Reader_free(KSI_FTLV_Reader *reader);
+
+	/**
+	 * Returns the buffer for the next bytes of the current TLV. Reading at most \c len bytes
+	 * directly into the buffer never consumes the bytes of the next TLV of the stream.
+	 * \param[in]	reader		Instance of the #KSI_FTLV_Reader.
+	 * \param[out]	buf			Pointer to the receiving pointer of the buffer.
+	 * \param[out]	len			Number of bytes still missing from the header or the payload.
+	 * \return status code (\c KSI_OK, when operation succeeded, otherwise an error code).
+	 * \see #KSI_FTLV_Reader_advance
+	 */
+	int KSI_FTLV_Reader_getWindow(KSI_FTLV_Reader *reader, unsigned char **buf, size_t *len);
+
+	/**
+	 * Accounts for \c len bytes written to the buffer returned by #KSI_FTLV_Reader_getWindow.
+	 * \param[in]	reader		Instance of the #KSI_FTLV_Reader.
+	 * \param[in]	len			Number of bytes written.
+	 * \param[out]	tlv			Pointer to the receiving pointer of the complete TLV; set to \c NULL
+	 * 							if the TLV is not complete yet.
+	 * \param[out]	tlv_len		Length of the complete TLV.
+	 * \return status code (\c KSI_OK, when operation succeeded, otherwise an error code).
+	 * \note The complete TLV belongs to the caller and needs to be freed using #KSI_free.
+	 */
+	int KSI_FTLV_Reader_advance(KSI_FTLV_Reader *reader, size_t len, unsigned char **tlv, size_t *tlv_len);
+
+	/**
+	 * Copies the bytes of the stream into the reader, until the current TLV is complete or the data
+	 * runs out.
+	 * \param[in]	reader		Instance of the #KSI_FTLV_Reader.
+	 * \param[in]	data		Next chunk of the stream.
+	 * \param[in]	data_len	Length of the chunk.
+	 * \param[out]	consumed	Number of bytes used; the rest of the chunk belongs to the next TLV.
+	 * \param[out]	tlv			Pointer to the receiving pointer of the complete TLV; set to \c NULL
+	 * 							if the TLV is not complete yet.
+	 * \param[out]	tlv_len		Length of the complete TLV.
+	 * \return status code (\c KSI_OK, when operation succeeded, otherwise an error code).
+	 * \note The complete TLV belongs to the caller and needs to be freed using #KSI_free.
+	 */
+	int KSI_FTLV_Reader_feed(KSI_FTLV_Reader *reader, const unsigned char *data, size_t data_len, size_t *consumed, unsigned char **tlv, size_t *tlv_len);
+
 
 #ifdef __cplusplus
 }
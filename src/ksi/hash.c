@@ -23,6 +23,7 @@
 #include "hash.h"
 #include "internal.h"
 #include "hash_impl.h"
+#include "hash_native.h"
 #include "tlv.h"
 
 #define HASH_ALGO(id, name, bitcount, blocksize, trusted) {(id), (name), (bitcount), (blocksize), (trusted), id##_aliases}
@@ -219,6 +220,37 @@ const char *KSI_getHashAlgorithmName(KSI_HashAlgorithm algo_id) {
 	return NULL;
 }
 
+KSI_HashBackend KSI_getHashBackend(KSI_HashAlgorithm algo_id) {
+#if defined(KSI_NATIVE_HASH) && KSI_HASH_IMPL == KSI_IMPL_OPENSSL
+	return KSI_NativeHash_getBackend(algo_id);
+#else
+	return KSI_HASH_BACKEND_PROVIDER;
+#endif
+}
+
+void KSI_setHashBackendMask(unsigned mask) {
+#if defined(KSI_NATIVE_HASH) && KSI_HASH_IMPL == KSI_IMPL_OPENSSL
+	KSI_NativeHash_setBackendMask(mask);
+#else
+	(void)mask;
+#endif
+}
+
+const char *KSI_getHashBackendName(KSI_HashBackend backend) {
+	switch (backend) {
+		case KSI_HASH_BACKEND_PROVIDER:
+			return "provider";
+		case KSI_HASH_BACKEND_GENERIC:
+			return "generic";
+		case KSI_HASH_BACKEND_SHA_NI:
+			return "sha-ni";
+		case KSI_HASH_BACKEND_AVX2:
+			return "avx2";
+		default:
+			return NULL;
+	}
+}
+
 KSI_HashAlgorithm KSI_getHashAlgorithmByName(const char *name) {
 	size_t i;
 	KSI_HashAlgorithm algo_id = KSI_HASHALG_INVALID;
@@ -276,7 +308,9 @@ cleanup:
 int KSI_DataHash_create(KSI_CTX *ctx, const void *data, size_t data_length, KSI_HashAlgorithm algo_id, KSI_DataHash **hash) {
 	int res = KSI_UNKNOWN_ERROR;
 	KSI_DataHash *hsh = NULL;
-	KSI_DataHasher *hsr = NULL;
+	KSI_HashInput input;
+	unsigned char imprint[KSI_MAX_IMPRINT_LEN];
+	size_t imprint_len = 0;
 
 	KSI_ERR_clearErrors(ctx);
 	if (ctx == NULL || hash == NULL) {
@@ -284,39 +318,193 @@ int KSI_DataHash_create(KSI_CTX *ctx, const void *data, size_t data_length, KSI_
 		goto cleanup;
 	}
 
-	res = KSI_DataHasher_open(ctx, algo_id, &hsr);
+	input.data = data;
+	input.data_length = (data != NULL) ? data_length : 0;
+
+	res = KSI_calculateImprint(ctx, algo_id, &input, 1, imprint, &imprint_len);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
 		goto cleanup;
 	}
 
-	if (data != NULL && data_length > 0) {
-		res = KSI_DataHasher_add(hsr, data, data_length);
+	res = KSI_DataHash_fromImprint(ctx, imprint, imprint_len, &hsh);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	*hash = hsh;
+	hsh = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_DataHash_free(hsh);
+
+	return res;
+}
+
+#if defined(KSI_NATIVE_HASH) && KSI_HASH_IMPL == KSI_IMPL_OPENSSL
+/* The built-in state must fit into KSI_HashState::local. */
+typedef char KSI_HashState_localSizeCheck[(sizeof(KSI_NativeHash) <= sizeof(((KSI_HashState *)NULL)->local)) ? 1 : -1];
+#endif
+
+int KSI_HashState_init(KSI_CTX *ctx, KSI_HashState *state, KSI_HashAlgorithm algo_id) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || state == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	state->ctx = ctx;
+	state->algorithm = KSI_HASHALG_INVALID;
+	state->hasher = NULL;
+
+	res = KSI_HashState_reset(state, algo_id);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_HashState_reset(KSI_HashState *state, KSI_HashAlgorithm algo_id) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	if (state == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+	KSI_ERR_clearErrors(state->ctx);
+
+	state->algorithm = KSI_HASHALG_INVALID;
+
+	if (!KSI_isHashAlgorithmSupported(algo_id)) {
+		KSI_pushError(state->ctx, res = KSI_UNAVAILABLE_HASH_ALGORITHM, NULL);
+		goto cleanup;
+	}
+
+#if defined(KSI_NATIVE_HASH) && KSI_HASH_IMPL == KSI_IMPL_OPENSSL
+	if (KSI_NativeHash_isSupported(algo_id)) {
+		res = KSI_NativeHash_init((KSI_NativeHash *)state->local, algo_id);
 		if (res != KSI_OK) {
-			KSI_pushError(ctx, res, NULL);
+			KSI_pushError(state->ctx, res, NULL);
 			goto cleanup;
 		}
+		state->algorithm = algo_id;
+		goto cleanup;
 	}
+#endif
 
-	res = KSI_DataHasher_close(hsr, &hsh);
+	/* The provider hasher is bound to the algorithm; keep it while the algorithm stays the same. */
+	if (state->hasher != NULL && state->hasher->algorithm == algo_id) {
+		res = KSI_DataHasher_reset(state->hasher);
+	} else {
+		KSI_DataHasher_free(state->hasher);
+		state->hasher = NULL;
+		res = KSI_DataHasher_open(state->ctx, algo_id, &state->hasher);
+	}
 	if (res != KSI_OK) {
-		KSI_pushError(ctx, res, NULL);
+		KSI_pushError(state->ctx, res, NULL);
 		goto cleanup;
 	}
 
-	*hash = hsh;
-	hsh = NULL;
+	state->algorithm = algo_id;
 
 	res = KSI_OK;
 
 cleanup:
 
-	KSI_DataHash_free(hsh);
-	KSI_DataHasher_free(hsr);
+	return res;
+}
+
+int KSI_HashState_add(KSI_HashState *state, const void *data, size_t data_length) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	if (state == NULL || (data == NULL && data_length > 0) || !KSI_isHashAlgorithmSupported(state->algorithm)) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+	KSI_ERR_clearErrors(state->ctx);
+
+	if (data_length == 0) {
+		res = KSI_OK;
+		goto cleanup;
+	}
+
+#if defined(KSI_NATIVE_HASH) && KSI_HASH_IMPL == KSI_IMPL_OPENSSL
+	if (KSI_NativeHash_isSupported(state->algorithm)) {
+		KSI_NativeHash_update((KSI_NativeHash *)state->local, data, data_length);
+		res = KSI_OK;
+		goto cleanup;
+	}
+#endif
+
+	res = KSI_DataHasher_add(state->hasher, data, data_length);
+	if (res != KSI_OK) {
+		KSI_pushError(state->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
 
 	return res;
 }
 
+int KSI_HashState_close(KSI_HashState *state, unsigned char *imprint, size_t *imprint_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_DataHash hsh;
+
+	if (state == NULL || imprint == NULL || imprint_len == NULL || !KSI_isHashAlgorithmSupported(state->algorithm)) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+	KSI_ERR_clearErrors(state->ctx);
+
+#if defined(KSI_NATIVE_HASH) && KSI_HASH_IMPL == KSI_IMPL_OPENSSL
+	if (KSI_NativeHash_isSupported(state->algorithm)) {
+		KSI_NativeHash_final((KSI_NativeHash *)state->local, imprint + 1);
+		imprint[0] = (0xff & state->algorithm);
+		*imprint_len = KSI_getHashLength(state->algorithm) + 1;
+		res = KSI_OK;
+		goto cleanup;
+	}
+#endif
+
+	res = state->hasher->closeExisting(state->hasher, &hsh);
+	if (res != KSI_OK) {
+		KSI_pushError(state->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	memcpy(imprint, hsh.imprint, hsh.imprint_length);
+	*imprint_len = hsh.imprint_length;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+void KSI_HashState_clear(KSI_HashState *state) {
+	if (state != NULL) {
+		KSI_DataHasher_free(state->hasher);
+		state->hasher = NULL;
+		state->algorithm = KSI_HASHALG_INVALID;
+	}
+}
+
 int KSI_DataHash_clone(KSI_DataHash *from, KSI_DataHash **to) {
 	int res = KSI_UNKNOWN_ERROR;
 
@@ -83,6 +83,50 @@ extern "C" {
 	} KSI_HashAlgorithm;
 
 
+	/**
+	 * Implementation used for calculating the hash values of a given algorithm.
+	 * \see #KSI_getHashBackend
+	 */
+	typedef enum KSI_HashBackend_en {
+		/** The hash value is calculated by the crypto provider (OpenSSL or CryptoAPI). */
+		KSI_HASH_BACKEND_PROVIDER = 0,
+		/** The portable built-in implementation. */
+		KSI_HASH_BACKEND_GENERIC = 1,
+		/** The built-in implementation using the x86 SHA extensions. */
+		KSI_HASH_BACKEND_SHA_NI = 2,
+		/** The built-in implementation hashing eight messages at a time using AVX2 (batch hashing only). */
+		KSI_HASH_BACKEND_AVX2 = 3
+	} KSI_HashBackend;
+
+	/**
+	 * A contiguous input buffer for #KSI_calculateImprint.
+	 */
+	typedef struct KSI_HashInput_st {
+		/** Pointer to the data. */
+		const void *data;
+		/** Length of the data. */
+		size_t data_length;
+	} KSI_HashInput;
+
+	/**
+	 * State of an incremental hash computation that may be placed on the stack or
+	 * embedded in another structure. With native hashing enabled the SHA-2 state is
+	 * kept inside the structure and no memory is allocated; other algorithms use a
+	 * provider hasher that is allocated on first use and reused by
+	 * #KSI_HashState_reset. The members are private.
+	 * \see #KSI_HashState_init, #KSI_HashState_clear
+	 */
+	typedef struct KSI_HashState_st {
+		/** KSI context. */
+		KSI_CTX *ctx;
+		/** Algorithm id. */
+		KSI_HashAlgorithm algorithm;
+		/** Provider hasher or \c NULL. */
+		KSI_DataHasher *hasher;
+		/** Storage for the built-in implementation state. */
+		KSI_uint64_t local[28];
+	} KSI_HashState;
+
 	/**
 	 * The maximum length of an imprint.
 	 */
@@ -179,6 +223,102 @@ extern "C" {
 	 */
 	int KSI_DataHash_create(KSI_CTX *ctx, const void *data, size_t data_length, KSI_HashAlgorithm algo_id, KSI_DataHash **hash);
 
+	/**
+	 * Calculates the imprint of the concatenation of the input buffers without
+	 * allocating a #KSI_DataHasher. The imprint (algorithm id followed by the digest)
+	 * is written to the caller provided buffer, which must be at least
+	 * #KSI_MAX_IMPRINT_LEN bytes long. Use this function instead of
+	 * #KSI_DataHasher_open, #KSI_DataHasher_add and #KSI_DataHasher_close when
+	 * all the input is available at once.
+	 *
+	 * \param[in]	ctx				KSI context.
+	 * \param[in]	algo_id			Hash algorithm id.
+	 * \param[in]	input			Array of input buffers.
+	 * \param[in]	input_count		Number of elements in \c input.
+	 * \param[out]	imprint			Buffer receiving the imprint.
+	 * \param[out]	imprint_len		Pointer to the receiving variable of the imprint length.
+	 *
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 * \see #KSI_DataHash_fromImprint
+	 */
+	int KSI_calculateImprint(KSI_CTX *ctx, KSI_HashAlgorithm algo_id, const KSI_HashInput *input, size_t input_count, unsigned char *imprint, size_t *imprint_len);
+
+	/**
+	 * Calculates the imprints of \c count independent messages with the same
+	 * algorithm. Message \c i consists of the \c input_count buffers starting at
+	 * <tt>input[i * input_count]</tt>; its imprint is written to
+	 * <tt>imprint + i * #KSI_MAX_IMPRINT_LEN</tt> and the length to <tt>imprint_len[i]</tt>.
+	 * With native hashing enabled, short SHA-256 messages are processed several at
+	 * a time on CPUs that support it; otherwise this is equivalent to calling
+	 * #KSI_calculateImprint for each message.
+	 *
+	 * \param[in]	ctx				KSI context.
+	 * \param[in]	algo_id			Hash algorithm id.
+	 * \param[in]	input			Array of <tt>count * input_count</tt> input buffers.
+	 * \param[in]	input_count		Number of input buffers per message.
+	 * \param[in]	count			Number of messages.
+	 * \param[out]	imprint			Buffer of at least <tt>count * #KSI_MAX_IMPRINT_LEN</tt> bytes.
+	 * \param[out]	imprint_len		Array of \c count receiving imprint lengths.
+	 *
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 * \see #KSI_calculateImprint
+	 */
+	int KSI_calculateImprintBatch(KSI_CTX *ctx, KSI_HashAlgorithm algo_id, const KSI_HashInput *input, size_t input_count, size_t count, unsigned char *imprint, size_t *imprint_len);
+
+	/**
+	 * Initializes a hash state that has not been used before and starts a new
+	 * computation. The state must be released with #KSI_HashState_clear.
+	 *
+	 * \param[in]	ctx				KSI context.
+	 * \param[in]	state			Hash state.
+	 * \param[in]	algo_id			Hash algorithm id.
+	 *
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 * \see #KSI_HashState_reset
+	 */
+	int KSI_HashState_init(KSI_CTX *ctx, KSI_HashState *state, KSI_HashAlgorithm algo_id);
+
+	/**
+	 * Starts a new computation with an initialized hash state, reusing its resources.
+	 *
+	 * \param[in]	state			Hash state.
+	 * \param[in]	algo_id			Hash algorithm id.
+	 *
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_HashState_reset(KSI_HashState *state, KSI_HashAlgorithm algo_id);
+
+	/**
+	 * Adds data to an open computation.
+	 *
+	 * \param[in]	state			Hash state.
+	 * \param[in]	data			Pointer to the data.
+	 * \param[in]	data_length		Length of the data.
+	 *
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_HashState_add(KSI_HashState *state, const void *data, size_t data_length);
+
+	/**
+	 * Finalizes the computation and writes the imprint to the caller provided buffer,
+	 * which must be at least #KSI_MAX_IMPRINT_LEN bytes long. Call #KSI_HashState_reset
+	 * before calculating the next value.
+	 *
+	 * \param[in]	state			Hash state.
+	 * \param[out]	imprint			Buffer receiving the imprint.
+	 * \param[out]	imprint_len		Pointer to the receiving variable of the imprint length.
+	 *
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_HashState_close(KSI_HashState *state, unsigned char *imprint, size_t *imprint_len);
+
+	/**
+	 * Releases the resources held by the hash state. The structure itself is not freed.
+	 *
+	 * \param[in]	state			Hash state.
+	 */
+	void KSI_HashState_clear(KSI_HashState *state);
+
 	/**
 	 * Creates a clone of the data hash.
 	 *
@@ -293,6 +433,41 @@ extern "C" {
 	 */
 	int KSI_isHashAlgorithmSupported(KSI_HashAlgorithm algo_id);
 
+	/**
+	 * Returns the implementation that is used for calculating the hash values of
+	 * the given algorithm. The built-in implementations are only used when the
+	 * library is built with native hashing enabled (\c --enable-native-hash);
+	 * the kernel is selected at runtime according to the CPU features.
+	 * \param[in]	algo_id			Hash algorithm id.
+	 *
+	 * \return The hash backend; #KSI_HASH_BACKEND_PROVIDER for algorithms without a built-in implementation.
+	 * \see #KSI_getHashBackendName
+	 */
+	KSI_HashBackend KSI_getHashBackend(KSI_HashAlgorithm algo_id);
+
+	/**
+	 * Returns a pointer to constant string containing the name of the hash backend.
+	 * \param[in]	backend			The hash backend.
+	 *
+	 * \return Name of the backend or NULL if the backend is unknown.
+	 * \see #KSI_getHashBackend
+	 */
+	const char *KSI_getHashBackendName(KSI_HashBackend backend);
+
+	/** Bit mask enabling all the hash backends, see #KSI_setHashBackendMask. */
+	#define KSI_HASH_BACKEND_MASK_ALL (~0u)
+
+	/**
+	 * Restricts the built-in kernels that may be used to the ones in \c mask (bit
+	 * <tt>1u << backend</tt> per #KSI_HashBackend). The portable implementation can
+	 * not be disabled. The setting is global and should be changed only while no
+	 * hash values are being calculated. Has no effect when the library is built
+	 * without native hashing.
+	 * \param[in]	mask			Bit mask of the enabled backends; defaults to #KSI_HASH_BACKEND_MASK_ALL.
+	 * \see #KSI_getHashBackend
+	 */
+	void KSI_setHashBackendMask(unsigned mask);
+
 	/**
 	 * Returns a pointer to constant string containing the name of the hash algorithm. Returns NULL if
 	 * the algorithm is unknown.
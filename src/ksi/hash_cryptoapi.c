@@ -17,6 +17,8 @@
  * reserves and retains all trademark rights.
  */
 
+#include <string.h>
+
 #include "internal.h"
 #include "hash_impl.h"
 
@@ -32,8 +34,8 @@ typedef struct CRYPTO_HASH_CTX_st {
 
 static void CRYPTO_HASH_CTX_free(CRYPTO_HASH_CTX *cryptoCtxt){
 	if (cryptoCtxt != NULL){
-		/* All hash objects that have been created by using a specific CSP must be  destroyed before that CSP
-		 * handle is released with the CryptReleaseContext function. */
+		/* All hash objects that have been created by using a specific CSP must be  destroyed before that CSP
+		 * handle is released with the CryptReleaseContext function. */
 		if (cryptoCtxt->pt_hHash) CryptDestroyHash(cryptoCtxt->pt_hHash);
 		if (cryptoCtxt->pt_CSP) CryptReleaseContext(cryptoCtxt->pt_CSP, 0);
 		KSI_free(cryptoCtxt);
@@ -224,6 +226,77 @@ cleanup:
 	return res;
 }
 
+int KSI_calculateImprint(KSI_CTX *ctx, KSI_HashAlgorithm algo_id, const KSI_HashInput *input, size_t input_count, unsigned char *imprint, size_t *imprint_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_DataHasher *hsr = NULL;
+	KSI_DataHash hsh;
+	size_t i;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || (input == NULL && input_count > 0) || imprint == NULL || imprint_len == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	/* CryptoAPI hash objects are bound to a provider handle, so the hasher can not be avoided. */
+	res = KSI_DataHasher_open(ctx, algo_id, &hsr);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < input_count; i++) {
+		if (input[i].data_length == 0) continue;
+		res = KSI_DataHasher_add(hsr, input[i].data, input[i].data_length);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	res = closeExisting(hsr, &hsh);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	memcpy(imprint, hsh.imprint, hsh.imprint_length);
+	*imprint_len = hsh.imprint_length;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_DataHasher_free(hsr);
+
+	return res;
+}
+
+int KSI_calculateImprintBatch(KSI_CTX *ctx, KSI_HashAlgorithm algo_id, const KSI_HashInput *input, size_t input_count, size_t count, unsigned char *imprint, size_t *imprint_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	size_t i;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || (input == NULL && input_count * count > 0) || (count > 0 && (imprint == NULL || imprint_len == NULL))) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < count; i++) {
+		res = KSI_calculateImprint(ctx, algo_id, input + i * input_count, input_count, imprint + i * KSI_MAX_IMPRINT_LEN, &imprint_len[i]);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
 int KSI_DataHasher_reset(KSI_DataHasher *hasher) {
 	int res = KSI_UNKNOWN_ERROR;
 	ALG_ID msHashAlg = 0;
@@ -322,4 +395,37 @@ cleanup:
 	return res;
 }
 
+int KSI_getRandomBytes(KSI_CTX *ctx, unsigned char *buf, size_t len) {
+	int res = KSI_UNKNOWN_ERROR;
+	HCRYPTPROV csp = 0;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || buf == NULL || len > MAXDWORD) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	if (!CryptAcquireContext(&csp, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT)) {
+		char errm[1024];
+		KSI_snprintf(errm, sizeof(errm), "Wincrypt Error (%d)", GetLastError());
+		KSI_pushError(ctx, res = KSI_CRYPTO_FAILURE, errm);
+		goto cleanup;
+	}
+
+	if (!CryptGenRandom(csp, (DWORD)len, buf)) {
+		char errm[1024];
+		KSI_snprintf(errm, sizeof(errm), "Wincrypt Error (%d)", GetLastError());
+		KSI_pushError(ctx, res = KSI_CRYPTO_FAILURE, errm);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (csp) CryptReleaseContext(csp, 0);
+
+	return res;
+}
+
 #endif
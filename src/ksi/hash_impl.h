@@ -61,6 +61,15 @@ extern "C" {
 		int (*closeExisting)(KSI_DataHasher *, KSI_DataHash *);
 	};
 
+	/**
+	 * Fills the buffer with cryptographically strong random bytes of the hash implementation.
+	 * \param[in]	ctx			KSI context.
+	 * \param[out]	buf			Receiving buffer.
+	 * \param[in]	len			Number of bytes to generate.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_getRandomBytes(KSI_CTX *ctx, unsigned char *buf, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,619 @@
+/*
+ * Copyright 2013-2015 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#include <string.h>
+
+#include "internal.h"
+#include "hash_native.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		include <immintrin.h>
+#		define KSI_HAVE_X86_KERNELS 1
+#		define TARGET_SHA_NI
+#		define TARGET_AVX2
+#	elif (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))) || defined(__clang__)
+#		include <cpuid.h>
+#		include <immintrin.h>
+#		define KSI_HAVE_X86_KERNELS 1
+#		define TARGET_SHA_NI __attribute__((target("sha,sse4.1")))
+#		define TARGET_AVX2 __attribute__((target("avx2")))
+#	endif
+#endif
+
+typedef void (*sha256_blocks_fn)(uint32_t *state, const unsigned char *data, size_t blocks);
+
+static const uint32_t K256[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint64_t K512[80] = {
+	0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+	0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+	0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+	0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+	0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+	0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+	0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+	0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+	0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+	0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+	0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+	0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+	0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+	0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+	0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+	0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+	0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+	0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+	0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+	0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+static const uint32_t IV256[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const uint64_t IV384[8] = {
+	0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+	0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL, 0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL
+};
+
+static const uint64_t IV512[8] = {
+	0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+	0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+#define ROR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define ROR64(x, n) (((x) >> (n)) | ((x) << (64 - (n))))
+
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+
+static uint32_t load32(const unsigned char *p) {
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint64_t load64(const unsigned char *p) {
+	return ((uint64_t)load32(p) << 32) | (uint64_t)load32(p + 4);
+}
+
+static void store32(unsigned char *p, uint32_t v) {
+	p[0] = (unsigned char)(v >> 24);
+	p[1] = (unsigned char)(v >> 16);
+	p[2] = (unsigned char)(v >> 8);
+	p[3] = (unsigned char)v;
+}
+
+static void store64(unsigned char *p, uint64_t v) {
+	store32(p, (uint32_t)(v >> 32));
+	store32(p + 4, (uint32_t)v);
+}
+
+static void sha256_blocks_generic(uint32_t *state, const unsigned char *data, size_t blocks) {
+	uint32_t w[64];
+	uint32_t a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	while (blocks--) {
+		for (i = 0; i < 16; i++) {
+			w[i] = load32(data + 4 * i);
+		}
+		for (i = 16; i < 64; i++) {
+			uint32_t s0 = ROR32(w[i - 15], 7) ^ ROR32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			uint32_t s1 = ROR32(w[i - 2], 17) ^ ROR32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		a = state[0]; b = state[1]; c = state[2]; d = state[3];
+		e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+		for (i = 0; i < 64; i++) {
+			t1 = h + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) + CH(e, f, g) + K256[i] + w[i];
+			t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) + MAJ(a, b, c);
+			h = g; g = f; f = e; e = d + t1;
+			d = c; c = b; b = a; a = t1 + t2;
+		}
+
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+
+		data += 64;
+	}
+}
+
+static void sha512_blocks_generic(uint64_t *state, const unsigned char *data, size_t blocks) {
+	uint64_t w[80];
+	uint64_t a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	while (blocks--) {
+		for (i = 0; i < 16; i++) {
+			w[i] = load64(data + 8 * i);
+		}
+		for (i = 16; i < 80; i++) {
+			uint64_t s0 = ROR64(w[i - 15], 1) ^ ROR64(w[i - 15], 8) ^ (w[i - 15] >> 7);
+			uint64_t s1 = ROR64(w[i - 2], 19) ^ ROR64(w[i - 2], 61) ^ (w[i - 2] >> 6);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		a = state[0]; b = state[1]; c = state[2]; d = state[3];
+		e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+		for (i = 0; i < 80; i++) {
+			t1 = h + (ROR64(e, 14) ^ ROR64(e, 18) ^ ROR64(e, 41)) + CH(e, f, g) + K512[i] + w[i];
+			t2 = (ROR64(a, 28) ^ ROR64(a, 34) ^ ROR64(a, 39)) + MAJ(a, b, c);
+			h = g; g = f; f = e; e = d + t1;
+			d = c; c = b; b = a; a = t1 + t2;
+		}
+
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+
+		data += 128;
+	}
+}
+
+#ifdef KSI_HAVE_X86_KERNELS
+
+/* SHA-256 using the x86 SHA extensions. The state is kept in the ABEF/CDGH
+ * layout the sha256rnds2 instruction expects and converted on entry and exit. */
+TARGET_SHA_NI
+static void sha256_blocks_shani(uint32_t *state, const unsigned char *data, size_t blocks) {
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i state0, state1, tmp, w, abef, cdgh;
+	__m128i msg[4];
+	int i;
+
+	tmp = _mm_loadu_si128((const __m128i *)&state[0]);
+	state1 = _mm_loadu_si128((const __m128i *)&state[4]);
+
+	tmp = _mm_shuffle_epi32(tmp, 0xB1);
+	state1 = _mm_shuffle_epi32(state1, 0x1B);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+	while (blocks--) {
+		abef = state0;
+		cdgh = state1;
+
+		/* Each iteration performs four rounds; msg[] holds the last 16 words of the schedule. */
+		for (i = 0; i < 16; i++) {
+			if (i < 4) {
+				msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), mask);
+			} else {
+				tmp = _mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]);
+				tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4));
+				msg[i & 3] = _mm_sha256msg2_epu32(tmp, msg[(i + 3) & 3]);
+			}
+
+			w = _mm_add_epi32(msg[i & 3], _mm_loadu_si128((const __m128i *)&K256[4 * i]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, w);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(w, 0x0E));
+		}
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+
+		data += 64;
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1B);
+	state1 = _mm_shuffle_epi32(state1, 0xB1);
+	state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+	state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+	_mm_storeu_si128((__m128i *)&state[0], state0);
+	_mm_storeu_si128((__m128i *)&state[4], state1);
+}
+
+/* Rotations and the SHA-256 functions on eight 32-bit lanes. */
+#define ROR32x8(x, n) _mm256_or_si256(_mm256_srli_epi32((x), (n)), _mm256_slli_epi32((x), 32 - (n)))
+#define XOR3x8(a, b, c) _mm256_xor_si256(_mm256_xor_si256((a), (b)), (c))
+#define CHx8(x, y, z) _mm256_xor_si256(_mm256_and_si256((x), (y)), _mm256_andnot_si256((x), (z)))
+#define MAJx8(x, y, z) _mm256_or_si256(_mm256_and_si256((x), (y)), _mm256_and_si256((z), _mm256_or_si256((x), (y))))
+
+/* One SHA-256 block for eight independent messages. \c state holds the
+ * transposed chaining values: state[i] contains word i of every lane. */
+TARGET_AVX2
+static void sha256_block_avx2x8(__m256i *state, const unsigned char *const *block) {
+	__m256i w[16];
+	__m256i a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		w[i] = _mm256_set_epi32(
+				(int)load32(block[7] + 4 * i), (int)load32(block[6] + 4 * i), (int)load32(block[5] + 4 * i), (int)load32(block[4] + 4 * i),
+				(int)load32(block[3] + 4 * i), (int)load32(block[2] + 4 * i), (int)load32(block[1] + 4 * i), (int)load32(block[0] + 4 * i));
+	}
+
+	a = state[0]; b = state[1]; c = state[2]; d = state[3];
+	e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+	for (i = 0; i < 64; i++) {
+		if (i >= 16) {
+			__m256i w15 = w[(i - 15) & 15];
+			__m256i w2 = w[(i - 2) & 15];
+			__m256i s0 = XOR3x8(ROR32x8(w15, 7), ROR32x8(w15, 18), _mm256_srli_epi32(w15, 3));
+			__m256i s1 = XOR3x8(ROR32x8(w2, 17), ROR32x8(w2, 19), _mm256_srli_epi32(w2, 10));
+			w[i & 15] = _mm256_add_epi32(_mm256_add_epi32(w[i & 15], s0), _mm256_add_epi32(w[(i - 7) & 15], s1));
+		}
+
+		t1 = _mm256_add_epi32(h, XOR3x8(ROR32x8(e, 6), ROR32x8(e, 11), ROR32x8(e, 25)));
+		t1 = _mm256_add_epi32(t1, CHx8(e, f, g));
+		t1 = _mm256_add_epi32(t1, _mm256_add_epi32(_mm256_set1_epi32((int)K256[i]), w[i & 15]));
+		t2 = _mm256_add_epi32(XOR3x8(ROR32x8(a, 2), ROR32x8(a, 13), ROR32x8(a, 22)), MAJx8(a, b, c));
+		h = g; g = f; f = e; e = _mm256_add_epi32(d, t1);
+		d = c; c = b; b = a; a = _mm256_add_epi32(t1, t2);
+	}
+
+	state[0] = _mm256_add_epi32(state[0], a); state[1] = _mm256_add_epi32(state[1], b);
+	state[2] = _mm256_add_epi32(state[2], c); state[3] = _mm256_add_epi32(state[3], d);
+	state[4] = _mm256_add_epi32(state[4], e); state[5] = _mm256_add_epi32(state[5], f);
+	state[6] = _mm256_add_epi32(state[6], g); state[7] = _mm256_add_epi32(state[7], h);
+}
+
+/* Hashes up to eight pre-padded messages in parallel. Lane \c i consists of
+ * \c blocks[i] blocks starting at \c data[i]; its digest is written to \c digest[i]. */
+TARGET_AVX2
+static void sha256_lanes_avx2x8(const unsigned char *const *data, const size_t *blocks, size_t lanes, unsigned char **digest) {
+	static const unsigned char zero[64] = {0};
+	__m256i state[8];
+	const unsigned char *block[8];
+	uint32_t words[8];
+	size_t maxBlocks = 0;
+	size_t i, j, n;
+
+	for (i = 0; i < 8; i++) {
+		state[i] = _mm256_set1_epi32((int)IV256[i]);
+	}
+
+	for (i = 0; i < lanes; i++) {
+		if (blocks[i] > maxBlocks) maxBlocks = blocks[i];
+	}
+
+	for (n = 0; n < maxBlocks; n++) {
+		/* Lanes that are already complete (or unused) process a dummy block. */
+		for (i = 0; i < 8; i++) {
+			block[i] = (i < lanes && n < blocks[i]) ? data[i] + 64 * n : zero;
+		}
+
+		sha256_block_avx2x8(state, block);
+
+		for (i = 0; i < lanes; i++) {
+			if (blocks[i] != n + 1) continue;
+			for (j = 0; j < 8; j++) {
+				_mm256_storeu_si256((__m256i *)words, state[j]);
+				store32(digest[i] + 4 * j, words[i]);
+			}
+		}
+	}
+}
+
+static void cpuid(unsigned leaf, unsigned sub, unsigned regs[4]) {
+#if defined(_MSC_VER)
+	int tmp[4];
+	__cpuidex(tmp, (int)leaf, (int)sub);
+	regs[0] = tmp[0]; regs[1] = tmp[1]; regs[2] = tmp[2]; regs[3] = tmp[3];
+#else
+	regs[0] = regs[1] = regs[2] = regs[3] = 0;
+	__cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static unsigned long long xgetbv0(void) {
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned eax, edx;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+
+/* Returns the set of usable kernels as a bit mask of backends. */
+static unsigned detectCpuBackends(void) {
+	unsigned regs[4];
+	unsigned mask = 1u << KSI_HASH_BACKEND_GENERIC;
+	unsigned ecx1;
+
+	cpuid(0, 0, regs);
+	if (regs[0] < 7) return mask;
+
+	cpuid(1, 0, regs);
+	ecx1 = regs[2];
+
+	cpuid(7, 0, regs);
+
+	/* SHA extensions (EBX bit 29), SSSE3 (ECX bit 9) and SSE4.1 (ECX bit 19) for the shuffles. */
+	if ((regs[1] & (1u << 29)) && (ecx1 & (1u << 9)) && (ecx1 & (1u << 19))) {
+		mask |= 1u << KSI_HASH_BACKEND_SHA_NI;
+	}
+
+	/* AVX2 (EBX bit 5), provided the OS saves the YMM registers (OSXSAVE, ECX bit 27). */
+	if ((regs[1] & (1u << 5)) && (ecx1 & (1u << 27)) && (xgetbv0() & 0x06) == 0x06) {
+		mask |= 1u << KSI_HASH_BACKEND_AVX2;
+	}
+
+	return mask;
+}
+
+#endif /* KSI_HAVE_X86_KERNELS */
+
+/* Bit mask of the kernels supported by the CPU: 0 until detected. The detection
+ * is idempotent, so concurrent first calls may both run it harmlessly. */
+static volatile unsigned cpu_backends = 0;
+static unsigned enabled_backends = KSI_HASH_BACKEND_MASK_ALL;
+
+static unsigned getBackends(void) {
+	unsigned mask = cpu_backends;
+
+	if (mask == 0) {
+#ifdef KSI_HAVE_X86_KERNELS
+		mask = detectCpuBackends();
+#else
+		mask = 1u << KSI_HASH_BACKEND_GENERIC;
+#endif
+		cpu_backends = mask;
+	}
+
+	return mask & enabled_backends;
+}
+
+static KSI_HashBackend detectSha256Backend(void) {
+	if (getBackends() & (1u << KSI_HASH_BACKEND_SHA_NI)) return KSI_HASH_BACKEND_SHA_NI;
+	return KSI_HASH_BACKEND_GENERIC;
+}
+
+static sha256_blocks_fn getSha256Blocks(void) {
+#ifdef KSI_HAVE_X86_KERNELS
+	if (detectSha256Backend() == KSI_HASH_BACKEND_SHA_NI) return sha256_blocks_shani;
+#endif
+	return sha256_blocks_generic;
+}
+
+static void processBlocks(KSI_NativeHash *hash, const unsigned char *data, size_t blocks) {
+	if (hash->algorithm == KSI_HASHALG_SHA2_256) {
+		getSha256Blocks()(hash->state.h32, data, blocks);
+	} else {
+		sha512_blocks_generic(hash->state.h64, data, blocks);
+	}
+}
+
+int KSI_NativeHash_isSupported(KSI_HashAlgorithm algo_id) {
+	switch (algo_id) {
+		case KSI_HASHALG_SHA2_256:
+		case KSI_HASHALG_SHA2_384:
+		case KSI_HASHALG_SHA2_512:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+KSI_HashBackend KSI_NativeHash_getBackend(KSI_HashAlgorithm algo_id) {
+	switch (algo_id) {
+		case KSI_HASHALG_SHA2_256:
+			return detectSha256Backend();
+		case KSI_HASHALG_SHA2_384:
+		case KSI_HASHALG_SHA2_512:
+			return KSI_HASH_BACKEND_GENERIC;
+		default:
+			return KSI_HASH_BACKEND_PROVIDER;
+	}
+}
+
+KSI_HashBackend KSI_NativeHash_getBatchBackend(KSI_HashAlgorithm algo_id) {
+	/* Interleaving lanes only pays off when there are no SHA instructions. */
+	if (algo_id == KSI_HASHALG_SHA2_256 && detectSha256Backend() != KSI_HASH_BACKEND_SHA_NI
+			&& (getBackends() & (1u << KSI_HASH_BACKEND_AVX2))) {
+		return KSI_HASH_BACKEND_AVX2;
+	}
+	return KSI_NativeHash_getBackend(algo_id);
+}
+
+void KSI_NativeHash_setBackendMask(unsigned mask) {
+	enabled_backends = mask | (1u << KSI_HASH_BACKEND_GENERIC);
+}
+
+int KSI_NativeHash_init(KSI_NativeHash *hash, KSI_HashAlgorithm algo_id) {
+	if (hash == NULL) return KSI_INVALID_ARGUMENT;
+
+	switch (algo_id) {
+		case KSI_HASHALG_SHA2_256:
+			memcpy(hash->state.h32, IV256, sizeof(IV256));
+			break;
+		case KSI_HASHALG_SHA2_384:
+			memcpy(hash->state.h64, IV384, sizeof(IV384));
+			break;
+		case KSI_HASHALG_SHA2_512:
+			memcpy(hash->state.h64, IV512, sizeof(IV512));
+			break;
+		default:
+			return KSI_UNAVAILABLE_HASH_ALGORITHM;
+	}
+
+	hash->algorithm = algo_id;
+	hash->total = 0;
+	hash->buf_len = 0;
+
+	return KSI_OK;
+}
+
+void KSI_NativeHash_update(KSI_NativeHash *hash, const void *data, size_t data_length) {
+	const unsigned char *ptr = data;
+	size_t block_size = (hash->algorithm == KSI_HASHALG_SHA2_256) ? 64 : 128;
+	size_t blocks;
+
+	hash->total += data_length;
+
+	/* Complete a previously buffered block. */
+	if (hash->buf_len > 0) {
+		size_t fill = block_size - hash->buf_len;
+		if (fill > data_length) fill = data_length;
+
+		memcpy(hash->buf + hash->buf_len, ptr, fill);
+		hash->buf_len += fill;
+		ptr += fill;
+		data_length -= fill;
+
+		if (hash->buf_len < block_size) return;
+
+		processBlocks(hash, hash->buf, 1);
+		hash->buf_len = 0;
+	}
+
+	/* Process whole blocks directly from the input. */
+	blocks = data_length / block_size;
+	if (blocks > 0) {
+		processBlocks(hash, ptr, blocks);
+		ptr += blocks * block_size;
+		data_length -= blocks * block_size;
+	}
+
+	if (data_length > 0) {
+		memcpy(hash->buf, ptr, data_length);
+		hash->buf_len = data_length;
+	}
+}
+
+void KSI_NativeHash_final(KSI_NativeHash *hash, unsigned char *digest) {
+	size_t block_size = (hash->algorithm == KSI_HASHALG_SHA2_256) ? 64 : 128;
+	size_t len_size = (hash->algorithm == KSI_HASHALG_SHA2_256) ? 8 : 16;
+	uint64_t bits = hash->total << 3;
+	size_t i;
+
+	hash->buf[hash->buf_len++] = 0x80;
+
+	if (hash->buf_len > block_size - len_size) {
+		memset(hash->buf + hash->buf_len, 0, block_size - hash->buf_len);
+		processBlocks(hash, hash->buf, 1);
+		hash->buf_len = 0;
+	}
+
+	memset(hash->buf + hash->buf_len, 0, block_size - hash->buf_len);
+	if (len_size == 16) {
+		store64(hash->buf + block_size - 16, hash->total >> 61);
+	}
+	store64(hash->buf + block_size - 8, bits);
+	processBlocks(hash, hash->buf, 1);
+
+	switch (hash->algorithm) {
+		case KSI_HASHALG_SHA2_256:
+			for (i = 0; i < 8; i++) store32(digest + 4 * i, hash->state.h32[i]);
+			break;
+		case KSI_HASHALG_SHA2_384:
+			for (i = 0; i < 6; i++) store64(digest + 8 * i, hash->state.h64[i]);
+			break;
+		default:
+			for (i = 0; i < 8; i++) store64(digest + 8 * i, hash->state.h64[i]);
+			break;
+	}
+
+	hash->buf_len = 0;
+}
+
+static void hashMessage(KSI_HashAlgorithm algo_id, const KSI_HashInput *input, size_t input_count, unsigned char *digest) {
+	KSI_NativeHash hash;
+	size_t i;
+
+	KSI_NativeHash_init(&hash, algo_id);
+	for (i = 0; i < input_count; i++) {
+		if (input[i].data_length > 0) KSI_NativeHash_update(&hash, input[i].data, input[i].data_length);
+	}
+	KSI_NativeHash_final(&hash, digest);
+}
+
+#ifdef KSI_HAVE_X86_KERNELS
+
+/* Maximum padded message length for the interleaved lanes; longer messages are hashed one by one. */
+#define LANE_BUF_LEN 256
+
+/* Copies the message into \c buf and appends the SHA-256 padding. Returns the number of blocks. */
+static size_t padMessage(const KSI_HashInput *input, size_t input_count, size_t len, unsigned char *buf) {
+	size_t blocks = (len + 9 + 63) / 64;
+	size_t off = 0;
+	size_t i;
+
+	for (i = 0; i < input_count; i++) {
+		if (input[i].data_length == 0) continue;
+		memcpy(buf + off, input[i].data, input[i].data_length);
+		off += input[i].data_length;
+	}
+
+	buf[off++] = 0x80;
+	memset(buf + off, 0, blocks * 64 - off);
+	store64(buf + blocks * 64 - 8, (uint64_t)len << 3);
+
+	return blocks;
+}
+
+#endif
+
+void KSI_NativeHash_batch(KSI_HashAlgorithm algo_id, const KSI_HashInput *input, size_t input_count, size_t count, unsigned char *digest, size_t digest_stride) {
+	size_t i;
+
+#ifdef KSI_HAVE_X86_KERNELS
+	if (KSI_NativeHash_getBatchBackend(algo_id) == KSI_HASH_BACKEND_AVX2) {
+		unsigned char buf[8][LANE_BUF_LEN];
+		const unsigned char *data[8];
+		unsigned char *out[8];
+		size_t blocks[8];
+		size_t lanes = 0;
+
+		for (i = 0; i < count; i++) {
+			const KSI_HashInput *msg = input + i * input_count;
+			size_t len = 0;
+			size_t j;
+
+			for (j = 0; j < input_count; j++) len += msg[j].data_length;
+
+			if (len + 9 > LANE_BUF_LEN) {
+				hashMessage(algo_id, msg, input_count, digest + i * digest_stride);
+				continue;
+			}
+
+			blocks[lanes] = padMessage(msg, input_count, len, buf[lanes]);
+			data[lanes] = buf[lanes];
+			out[lanes] = digest + i * digest_stride;
+
+			if (++lanes == 8) {
+				sha256_lanes_avx2x8(data, blocks, lanes, out);
+				lanes = 0;
+			}
+		}
+
+		if (lanes > 0) sha256_lanes_avx2x8(data, blocks, lanes, out);
+
+		return;
+	}
+#endif
+
+	for (i = 0; i < count; i++) {
+		hashMessage(algo_id, input + i * input_count, input_count, digest + i * digest_stride);
+	}
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2013-2015 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#ifndef HASH_NATIVE_H_
+#define HASH_NATIVE_H_
+
+#include <stdint.h>
+#include "hash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * State of a native SHA-2 computation. The structure has no pointers to
+	 * owned memory and may be embedded or allocated on the stack.
+	 */
+	typedef struct KSI_NativeHash_st {
+		/** Algorithm id. */
+		KSI_HashAlgorithm algorithm;
+
+		/** Chaining value. SHA-256 uses \c h32, SHA-384 and SHA-512 use \c h64. */
+		union {
+			uint32_t h32[8];
+			uint64_t h64[8];
+		} state;
+
+		/** Total number of bytes processed. */
+		uint64_t total;
+
+		/** Number of bytes pending in \c buf. */
+		size_t buf_len;
+
+		/** Partial input block. */
+		unsigned char buf[128];
+	} KSI_NativeHash;
+
+	/**
+	 * Returns non-zero if \c algo_id has a native implementation.
+	 */
+	int KSI_NativeHash_isSupported(KSI_HashAlgorithm algo_id);
+
+	/**
+	 * Returns the kernel that is used for \c algo_id on the current CPU or
+	 * #KSI_HASH_BACKEND_PROVIDER if there is no native implementation.
+	 */
+	KSI_HashBackend KSI_NativeHash_getBackend(KSI_HashAlgorithm algo_id);
+
+	/**
+	 * Returns the kernel that is used by #KSI_NativeHash_batch for \c algo_id.
+	 */
+	KSI_HashBackend KSI_NativeHash_getBatchBackend(KSI_HashAlgorithm algo_id);
+
+	/**
+	 * Restricts the kernels that may be used to the ones in \c mask (bit
+	 * <tt>1u << backend</tt> per #KSI_HashBackend). The portable implementation
+	 * is always enabled. Defaults to #KSI_HASH_BACKEND_MASK_ALL.
+	 * \see #KSI_setHashBackendMask
+	 */
+	void KSI_NativeHash_setBackendMask(unsigned mask);
+
+	/**
+	 * Initializes (or resets) the computation state.
+	 * \return #KSI_OK or #KSI_UNAVAILABLE_HASH_ALGORITHM.
+	 */
+	int KSI_NativeHash_init(KSI_NativeHash *hash, KSI_HashAlgorithm algo_id);
+
+	/**
+	 * Adds \c data_length bytes to the computation.
+	 */
+	void KSI_NativeHash_update(KSI_NativeHash *hash, const void *data, size_t data_length);
+
+	/**
+	 * Finalizes the computation and writes #KSI_getHashLength bytes to \c digest.
+	 */
+	void KSI_NativeHash_final(KSI_NativeHash *hash, unsigned char *digest);
+
+	/**
+	 * Calculates the digests of \c count independent messages. Message \c i
+	 * consists of the \c input_count buffers starting at <tt>input[i * input_count]</tt>
+	 * and its digest is written to <tt>digest + i * digest_stride</tt>. When AVX2
+	 * is the best available kernel, short SHA-256 messages are hashed eight at
+	 * a time in interleaved lanes.
+	 */
+	void KSI_NativeHash_batch(KSI_HashAlgorithm algo_id, const KSI_HashInput *input, size_t input_count, size_t count, unsigned char *digest, size_t digest_stride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HASH_NATIVE_H_ */
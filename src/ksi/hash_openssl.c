@@ -20,10 +20,20 @@
 #include "internal.h"
 #include "hash_impl.h"
 #include "hash.h"
+#include "hash_native.h"
 
 #if KSI_HASH_IMPL == KSI_IMPL_OPENSSL
 
+#include <limits.h>
 #include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#ifdef KSI_NATIVE_HASH
+/* SHA-2 values are calculated by the built-in kernels, see hash_native.c. */
+#	define isNative(algo_id) KSI_NativeHash_isSupported(algo_id)
+#else
+#	define isNative(algo_id) 0
+#endif
 
 /**
  * Converts hash function ID from hash chain to OpenSSL identifier
@@ -75,8 +85,12 @@ static int closeExisting(KSI_DataHasher *hasher, KSI_DataHash *data_hash) {
 		goto cleanup;
 	}
 
-
-	EVP_DigestFinal_ex(hasher->hashContext, data_hash->imprint + 1, &tmp);
+	if (isNative(hasher->algorithm)) {
+		KSI_NativeHash_final(hasher->hashContext, data_hash->imprint + 1);
+		tmp = (unsigned)hash_length;
+	} else {
+		EVP_DigestFinal_ex(hasher->hashContext, data_hash->imprint + 1, &tmp);
+	}
 
 	/* Make sure the hash length is the same. */
 	if (hash_length != tmp) {
@@ -95,11 +109,119 @@ cleanup:
 }
 
 int KSI_isHashAlgorithmSupported(KSI_HashAlgorithm algo_id) {
-	return hashAlgorithmToEVP(algo_id) != NULL;
+	return isNative(algo_id) || hashAlgorithmToEVP(algo_id) != NULL;
+}
+
+int KSI_calculateImprint(KSI_CTX *ctx, KSI_HashAlgorithm algo_id, const KSI_HashInput *input, size_t input_count, unsigned char *imprint, size_t *imprint_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	const EVP_MD *evp_md = NULL;
+	EVP_MD_CTX md_ctx;
+	int md_ctx_used = 0;
+	KSI_NativeHash native;
+	unsigned digest_len = 0;
+	size_t i;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || (input == NULL && input_count > 0) || imprint == NULL || imprint_len == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	if (!KSI_isHashAlgorithmSupported(algo_id)) {
+		KSI_pushError(ctx, res = KSI_UNAVAILABLE_HASH_ALGORITHM, NULL);
+		goto cleanup;
+	}
+
+	if (isNative(algo_id)) {
+		KSI_NativeHash_init(&native, algo_id);
+		for (i = 0; i < input_count; i++) {
+			if (input[i].data_length > 0) KSI_NativeHash_update(&native, input[i].data, input[i].data_length);
+		}
+		KSI_NativeHash_final(&native, imprint + 1);
+		digest_len = KSI_getHashLength(algo_id);
+	} else {
+		evp_md = hashAlgorithmToEVP(algo_id);
+
+		EVP_MD_CTX_init(&md_ctx);
+		md_ctx_used = 1;
+
+		if (!EVP_DigestInit_ex(&md_ctx, evp_md, NULL)) {
+			KSI_pushError(ctx, res = KSI_CRYPTO_FAILURE, NULL);
+			goto cleanup;
+		}
+
+		for (i = 0; i < input_count; i++) {
+			if (input[i].data_length > 0 && !EVP_DigestUpdate(&md_ctx, input[i].data, input[i].data_length)) {
+				KSI_pushError(ctx, res = KSI_CRYPTO_FAILURE, NULL);
+				goto cleanup;
+			}
+		}
+
+		if (!EVP_DigestFinal_ex(&md_ctx, imprint + 1, &digest_len)) {
+			KSI_pushError(ctx, res = KSI_CRYPTO_FAILURE, NULL);
+			goto cleanup;
+		}
+	}
+
+	if (digest_len != KSI_getHashLength(algo_id)) {
+		KSI_pushError(ctx, res = KSI_UNKNOWN_ERROR, "Internal hash lengths mismatch.");
+		goto cleanup;
+	}
+
+	imprint[0] = (0xff & algo_id);
+	*imprint_len = digest_len + 1;
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (md_ctx_used) EVP_MD_CTX_cleanup(&md_ctx);
+
+	return res;
+}
+
+int KSI_calculateImprintBatch(KSI_CTX *ctx, KSI_HashAlgorithm algo_id, const KSI_HashInput *input, size_t input_count, size_t count, unsigned char *imprint, size_t *imprint_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	size_t digest_len;
+	size_t i;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || (input == NULL && input_count * count > 0) || (count > 0 && (imprint == NULL || imprint_len == NULL))) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	if (!isNative(algo_id)) {
+		for (i = 0; i < count; i++) {
+			res = KSI_calculateImprint(ctx, algo_id, input + i * input_count, input_count, imprint + i * KSI_MAX_IMPRINT_LEN, &imprint_len[i]);
+			if (res != KSI_OK) {
+				KSI_pushError(ctx, res, NULL);
+				goto cleanup;
+			}
+		}
+	} else {
+		KSI_NativeHash_batch(algo_id, input, input_count, count, imprint + 1, KSI_MAX_IMPRINT_LEN);
+
+		digest_len = KSI_getHashLength(algo_id);
+		for (i = 0; i < count; i++) {
+			imprint[i * KSI_MAX_IMPRINT_LEN] = (0xff & algo_id);
+			imprint_len[i] = digest_len + 1;
+		}
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
 }
 
 void KSI_DataHasher_free(KSI_DataHasher *hasher) {
 	if (hasher != NULL) {
+		if (hasher->hashContext != NULL && isNative(hasher->algorithm)) {
+			KSI_free(hasher->hashContext);
+			hasher->hashContext = NULL;
+		}
 		if (hasher->hashContext != NULL) {
 			EVP_MD_CTX_cleanup(hasher->hashContext);
 		}
@@ -164,6 +286,24 @@ int KSI_DataHasher_reset(KSI_DataHasher *hasher) {
 	}
 	KSI_ERR_clearErrors(hasher->ctx);
 
+	if (isNative(hasher->algorithm)) {
+		if (hasher->hashContext == NULL) {
+			hasher->hashContext = KSI_new(KSI_NativeHash);
+			if (hasher->hashContext == NULL) {
+				KSI_pushError(hasher->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+				goto cleanup;
+			}
+		}
+
+		res = KSI_NativeHash_init(hasher->hashContext, hasher->algorithm);
+		if (res != KSI_OK) {
+			KSI_pushError(hasher->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		goto cleanup;
+	}
+
 	evp_md = hashAlgorithmToEVP(hasher->algorithm);
 	if (evp_md == NULL) {
 		KSI_pushError(hasher->ctx, res = KSI_OUT_OF_MEMORY, NULL);
@@ -204,7 +344,9 @@ int KSI_DataHasher_add(KSI_DataHasher *hasher, const void *data, size_t data_len
 	}
 	KSI_ERR_clearErrors(hasher->ctx);
 
-	if (data_length > 0) {
+	if (data_length > 0 && isNative(hasher->algorithm)) {
+		KSI_NativeHash_update(hasher->hashContext, data, data_length);
+	} else if (data_length > 0) {
 		EVP_DigestUpdate(hasher->hashContext, data, data_length);
 	}
 
@@ -215,4 +357,25 @@ cleanup:
 	return res;
 }
 
+int KSI_getRandomBytes(KSI_CTX *ctx, unsigned char *buf, size_t len) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || buf == NULL || len > INT_MAX) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	if (RAND_bytes(buf, (int)len) != 1) {
+		KSI_pushError(ctx, res = KSI_CRYPTO_FAILURE, "Unable to generate random bytes.");
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
 #endif
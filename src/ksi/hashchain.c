@@ -27,8 +27,6 @@
 #include "hashchain_impl.h"
 #include "impl/meta_data_element_impl.h"
 
-/* For optimization reasons, we need need access to KSI_DataHasher->closeExisting() function. */
-#include "hash_impl.h"
 
 KSI_IMPORT_TLV_TEMPLATE(KSI_AggregationHashChain);
 KSI_IMPORT_TLV_TEMPLATE(KSI_HashChainLink);
@@ -49,28 +47,10 @@ static long long int highBit(long long int n) {
 }
 
 
-static int addNvlImprint(const KSI_DataHash *first, const KSI_DataHash *second, KSI_DataHasher *hsr) {
-	int res = KSI_UNKNOWN_ERROR;
-	const KSI_DataHash *hsh = first;
-
-	if (hsh == NULL) {
-		if (second == NULL) {
-			res = KSI_INVALID_ARGUMENT;
-			goto cleanup;
-		}
-		hsh = second;
-	}
-
-	res = KSI_DataHasher_addImprint(hsr, hsh);
-	if (res != KSI_OK) goto cleanup;
-
-	res = KSI_OK;
-
-cleanup:
-	return res;
-}
+/* Size of the buffer for serialized metadata values. */
+#define META_DATA_BUF_LEN (0xffff + 4)
 
-static int addChainImprint(KSI_CTX *ctx, KSI_DataHasher *hsr, const KSI_HashChainLink *link) {
+static int getChainLinkData(KSI_CTX *ctx, const KSI_HashChainLink *link, unsigned char **metaBuf, const unsigned char **data, size_t *data_len) {
 	int res = KSI_UNKNOWN_ERROR;
 	int mode = 0;
 	const unsigned char *imprint = NULL;
@@ -78,11 +58,9 @@ static int addChainImprint(KSI_CTX *ctx, KSI_DataHasher *hsr, const KSI_HashChai
 	KSI_MetaDataElement *metaData = NULL;
 	KSI_OctetString *legacyId = NULL;
 	KSI_DataHash *hash = NULL;
-	KSI_OctetString *tmpOctStr = NULL;
-	unsigned char buf[0xffff + 4];
 
 	KSI_ERR_clearErrors(ctx);
-	if (ctx == NULL || hsr == NULL || link == NULL) {
+	if (ctx == NULL || link == NULL || metaBuf == NULL || data == NULL || data_len == NULL) {
 		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
 		goto cleanup;
 	}
@@ -125,13 +103,22 @@ static int addChainImprint(KSI_CTX *ctx, KSI_DataHasher *hsr, const KSI_HashChai
 			}
 			break;
 		case 0x04:
-			res = KSI_TlvElement_serialize(metaData->impl, buf, sizeof(buf), &imprint_len, KSI_TLV_OPT_NO_HEADER);
+			/* The buffer is allocated on first use and reused for the rest of the chain. */
+			if (*metaBuf == NULL) {
+				*metaBuf = KSI_malloc(META_DATA_BUF_LEN);
+				if (*metaBuf == NULL) {
+					KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+					goto cleanup;
+				}
+			}
+
+			res = KSI_TlvElement_serialize(metaData->impl, *metaBuf, META_DATA_BUF_LEN, &imprint_len, KSI_TLV_OPT_NO_HEADER);
 			if (res != KSI_OK) {
 				KSI_pushError(ctx, res, NULL);
 				goto cleanup;
 			}
 
-			imprint = buf;
+			imprint = *metaBuf;
 
 			KSI_LOG_logBlob(ctx, KSI_LOG_DEBUG, "Serialized metadata:", imprint, imprint_len);
 
@@ -141,11 +128,8 @@ static int addChainImprint(KSI_CTX *ctx, KSI_DataHasher *hsr, const KSI_HashChai
 			goto cleanup;
 	}
 
-	res = KSI_DataHasher_add(hsr, imprint, imprint_len);
-	if (res != KSI_OK) {
-		KSI_pushError(ctx, res, NULL);
-		goto cleanup;
-	}
+	*data = imprint;
+	*data_len = imprint_len;
 
 	res = KSI_OK;
 
@@ -155,32 +139,58 @@ cleanup:
 	KSI_nofree(legacyId);
 	KSI_nofree(metaData);
 	KSI_nofree(imprint);
-	KSI_OctetString_free(tmpOctStr);
 
 	return res;
 }
 
-static int aggregateChain(KSI_CTX *ctx, KSI_LIST(KSI_HashChainLink) *chain, const KSI_DataHash *inputHash, int startLevel, KSI_HashAlgorithm aggr_algo_id, int isCalendar, int *endLevel, KSI_DataHash **outputHash) {
+/* State of a hash chain aggregation in progress. */
+typedef struct ChainState_st {
+	KSI_LIST(KSI_HashChainLink) *chain;
+	/* Index of the next link. */
+	size_t pos;
+	int level;
+	int isCalendar;
+	KSI_HashAlgorithm algo_id;
+	/* Current value (the imprint of the last step or the input hash). */
+	unsigned char value[KSI_MAX_IMPRINT_LEN];
+	size_t value_len;
+	/* Lazily allocated buffer for serialized metadata. */
+	unsigned char *metaBuf;
+	unsigned char chr_level;
+	/* Input of the next step. */
+	KSI_HashInput input[3];
+} ChainState;
+
+static void ChainState_clean(ChainState *state) {
+	if (state != NULL) {
+		KSI_free(state->metaBuf);
+		state->metaBuf = NULL;
+	}
+}
+
+static int ChainState_init(KSI_CTX *ctx, ChainState *state, KSI_LIST(KSI_HashChainLink) *chain, const KSI_DataHash *inputHash, int startLevel, KSI_HashAlgorithm aggr_algo_id, int isCalendar) {
 	int res = KSI_UNKNOWN_ERROR;
-	int level = startLevel;
-	KSI_DataHasher *hsr = NULL;
-	KSI_DataHash *hsh = NULL;
-	KSI_HashChainLink *link = NULL;
-	KSI_HashAlgorithm algo_id = aggr_algo_id;
-	char chr_level;
+	const unsigned char *imprint = NULL;
+	size_t imprint_len = 0;
 	char logMsg[0xff];
-	size_t i;
 
 	KSI_ERR_clearErrors(ctx);
-	if (ctx == NULL || chain == NULL || inputHash == NULL || outputHash == NULL) {
+	if (ctx == NULL || state == NULL || chain == NULL || inputHash == NULL) {
 		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
 		goto cleanup;
 	}
 
+	state->chain = chain;
+	state->pos = 0;
+	state->level = startLevel;
+	state->isCalendar = isCalendar;
+	state->algo_id = aggr_algo_id;
+	state->metaBuf = NULL;
+
 	/* If we are calculating the calendar chain, initialize the hash algorithm id using
 	 * the input hash. */
 	if (isCalendar) {
-		res = KSI_DataHash_extract(inputHash, &algo_id, NULL, NULL);
+		res = KSI_DataHash_extract(inputHash, &state->algo_id, NULL, NULL);
 		if (res != KSI_OK) {
 			KSI_pushError(ctx, res, NULL);
 			goto cleanup;
@@ -190,127 +200,295 @@ static int aggregateChain(KSI_CTX *ctx, KSI_LIST(KSI_HashChainLink) *chain, cons
 	sprintf(logMsg, "Starting %s hash chain aggregation with input hash.", isCalendar ? "calendar": "aggregation");
 	KSI_LOG_logDataHash(ctx, KSI_LOG_DEBUG, logMsg, inputHash);
 
+	/* The intermediate values are kept as raw imprints, only the output is a data hash object. */
+	res = KSI_DataHash_getImprint(inputHash, &imprint, &imprint_len);
+	if (res != KSI_OK || imprint == NULL || imprint_len > sizeof(state->value)) {
+		KSI_pushError(ctx, res != KSI_OK ? res : (res = KSI_INVALID_ARGUMENT), NULL);
+		goto cleanup;
+	}
+	memcpy(state->value, imprint, imprint_len);
+	state->value_len = imprint_len;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+/* Returns non-zero if there are links left to process. */
+static int ChainState_hasNext(const ChainState *state) {
+	return state->pos < KSI_HashChainLinkList_length(state->chain);
+}
+
+/* Updates the level and algorithm for the next link and prepares the input of the step. */
+static int ChainState_prepare(KSI_CTX *ctx, ChainState *state) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_HashChainLink *link = NULL;
+	const unsigned char *sibling = NULL;
+	size_t sibling_len = 0;
+
+	res = KSI_HashChainLinkList_elementAt(state->chain, state->pos, &link);
+	if (res != KSI_OK || link == NULL) {
+		KSI_pushError(ctx, res != KSI_OK ? res : (res = KSI_INVALID_STATE), NULL);
+		goto cleanup;
+	}
+
+	if (!state->isCalendar) {
+		KSI_uint64_t levelCorrection = KSI_Integer_getUInt64(link->levelCorrection);
+		if (levelCorrection > 0xff || state->level + levelCorrection + 1 > 0xff)
+			KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, "Aggregation chain level out of range.");
+		state->level += (int)levelCorrection + 1;
+	} else {
+		/* Update the hash algo id when we encounter a left link. */
+		if (link->isLeft) {
+			res = KSI_DataHash_extract(link->imprint, &state->algo_id, NULL, NULL);
+			if (res != KSI_OK) {
+				KSI_pushError(ctx, res, NULL);
+				goto cleanup;
+			}
+		}
+	}
+
+	if (state->level > 0xff) {
+		KSI_pushError(ctx, res = KSI_INVALID_FORMAT, "Aggregation chain length exceeds 0xff.");
+		goto cleanup;
+	}
+
+	res = getChainLinkData(ctx, link, &state->metaBuf, &sibling, &sibling_len);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	state->chr_level = (unsigned char) state->level;
+
+	/* The current value is on the left side for left links. */
+	state->input[link->isLeft ? 0 : 1].data = state->value;
+	state->input[link->isLeft ? 0 : 1].data_length = state->value_len;
+	state->input[link->isLeft ? 1 : 0].data = sibling;
+	state->input[link->isLeft ? 1 : 0].data_length = sibling_len;
+	state->input[2].data = &state->chr_level;
+	state->input[2].data_length = 1;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+/* Stores the result of the prepared step and moves to the next link. */
+static void ChainState_apply(ChainState *state, const unsigned char *imprint, size_t imprint_len) {
+	memcpy(state->value, imprint, imprint_len);
+	state->value_len = imprint_len;
+	state->pos++;
+}
+
+static int ChainState_finish(KSI_CTX *ctx, ChainState *state, int *endLevel, KSI_DataHash **outputHash) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_DataHash *hsh = NULL;
+	char logMsg[0xff];
+
+	res = KSI_DataHash_fromImprint(ctx, state->value, state->value_len, &hsh);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	sprintf(logMsg, "Finished %s hash chain aggregation with output hash.", state->isCalendar ? "calendar": "aggregation");
+	KSI_LOG_logDataHash(ctx, KSI_LOG_DEBUG, logMsg, hsh);
+
+	if (endLevel != NULL) *endLevel = state->level;
+	if (outputHash != NULL) *outputHash = hsh;
+	hsh = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_DataHash_free(hsh);
+
+	return res;
+}
+
+static int aggregateChain(KSI_CTX *ctx, KSI_LIST(KSI_HashChainLink) *chain, const KSI_DataHash *inputHash, int startLevel, KSI_HashAlgorithm aggr_algo_id, int isCalendar, int *endLevel, KSI_DataHash **outputHash) {
+	int res = KSI_UNKNOWN_ERROR;
+	ChainState state;
+	unsigned char next[KSI_MAX_IMPRINT_LEN];
+	size_t next_len = 0;
+
+	state.metaBuf = NULL;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || chain == NULL || inputHash == NULL || outputHash == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	res = ChainState_init(ctx, &state, chain, inputHash, startLevel, aggr_algo_id, isCalendar);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
 	/* Loop over all the links in the chain. */
-	for (i = 0; i < KSI_HashChainLinkList_length(chain); i++) {
-		res = KSI_HashChainLinkList_elementAt(chain, i, &link);
-		if (res != KSI_OK || link == NULL) {
-			KSI_pushError(ctx, res != KSI_OK ? res : (res = KSI_INVALID_STATE), NULL);
+	while (ChainState_hasNext(&state)) {
+		res = ChainState_prepare(ctx, &state);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
 			goto cleanup;
 		}
 
-		if (!isCalendar) {
-			KSI_uint64_t levelCorrection = KSI_Integer_getUInt64(link->levelCorrection);
-			if (levelCorrection > 0xff || level + levelCorrection + 1 > 0xff)
-				KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, "Aggregation chain level out of range.");
-			level += (int)levelCorrection + 1;
-		} else {
-			/* Update the hash algo id when we encounter a left link. */
-			if (link->isLeft) {
-				KSI_HashAlgorithm tmp;
-				res = KSI_DataHash_extract(link->imprint, &tmp, NULL, NULL);
-				if (res != KSI_OK) {
-					KSI_pushError(ctx, res, NULL);
-					goto cleanup;
-				}
-				/* Update hasher if algo id has changed. */
-				if (tmp != algo_id) {
-					algo_id = tmp;
-					if (hsh != NULL) {
-						if (hsr == NULL) {
-							res = KSI_INVALID_STATE;
-						} else {
-							res = hsr->closeExisting(hsr, hsh);
-						}
-						if (res != KSI_OK) {
-							KSI_pushError(ctx, res, NULL);
-							goto cleanup;
-						}
-						KSI_DataHasher_free(hsr);
-						res = KSI_DataHasher_open(ctx, algo_id, &hsr);
-						if (res != KSI_OK) {
-							KSI_pushError(ctx, res, NULL);
-							goto cleanup;
-						}
-					}
-				}
-			}
+		res = KSI_calculateImprint(ctx, state.algo_id, state.input, 3, next, &next_len);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
 		}
 
-		/* Create or reset the hasher. */
-		if (hsr == NULL) {
-			res = KSI_DataHasher_open(ctx, algo_id, &hsr);
-		} else {
-			res = KSI_DataHasher_reset(hsr);
-		}
+		ChainState_apply(&state, next, next_len);
+	}
+
+	res = ChainState_finish(ctx, &state, endLevel, outputHash);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	ChainState_clean(&state);
+
+	return res;
+}
+
+int KSI_HashChain_aggregateBatch(KSI_CTX *ctx, KSI_HashChainAggregation *items, size_t count) {
+	int res = KSI_UNKNOWN_ERROR;
+	ChainState *states = NULL;
+	KSI_HashInput *input = NULL;
+	unsigned char *imprint = NULL;
+	size_t *imprint_len = NULL;
+	size_t *lane = NULL;
+	size_t initialized = 0;
+	size_t active;
+	size_t lanes;
+	size_t i, j;
+	KSI_HashAlgorithm algo_id;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || (items == NULL && count > 0)) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	if (count == 0) {
+		res = KSI_OK;
+		goto cleanup;
+	}
+
+	for (i = 0; i < count; i++) {
+		items[i].outputHash = NULL;
+	}
+
+	states = KSI_calloc(count, sizeof(ChainState));
+	input = KSI_calloc(count * 3, sizeof(KSI_HashInput));
+	imprint = KSI_malloc(count * KSI_MAX_IMPRINT_LEN);
+	imprint_len = KSI_calloc(count, sizeof(size_t));
+	lane = KSI_calloc(count, sizeof(size_t));
+	if (states == NULL || input == NULL || imprint == NULL || imprint_len == NULL || lane == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < count; i++) {
+		res = ChainState_init(ctx, &states[i], items[i].chain, items[i].inputHash,
+				items[i].isCalendar ? 0xff : items[i].startLevel, items[i].isCalendar ? KSI_HASHALG_INVALID : items[i].algo_id, items[i].isCalendar);
 		if (res != KSI_OK) {
 			KSI_pushError(ctx, res, NULL);
 			goto cleanup;
 		}
+		initialized++;
+	}
 
-		if (link->isLeft) {
-			res = addNvlImprint(hsh, inputHash, hsr);
+	/* Each round performs the next step of every unfinished chain. The steps
+	 * are independent, so the ones with the same algorithm are hashed together. */
+	do {
+		active = 0;
+		for (i = 0; i < count; i++) {
+			if (!ChainState_hasNext(&states[i])) continue;
+
+			res = ChainState_prepare(ctx, &states[i]);
 			if (res != KSI_OK) {
 				KSI_pushError(ctx, res, NULL);
 				goto cleanup;
 			}
+			lane[active++] = i;
+		}
 
-			res = addChainImprint(ctx, hsr, link);
-			if (res != KSI_OK) {
-				KSI_pushError(ctx, res, NULL);
-				goto cleanup;
+		while (active > 0) {
+			/* Collect the steps using the algorithm of the first pending step. */
+			algo_id = states[lane[0]].algo_id;
+			lanes = 0;
+			for (i = 0; i < active; i++) {
+				if (states[lane[i]].algo_id != algo_id) continue;
+				memcpy(&input[lanes * 3], states[lane[i]].input, 3 * sizeof(KSI_HashInput));
+				lanes++;
 			}
-		} else {
-			res = addChainImprint(ctx, hsr, link);
+
+			res = KSI_calculateImprintBatch(ctx, algo_id, input, 3, lanes, imprint, imprint_len);
 			if (res != KSI_OK) {
 				KSI_pushError(ctx, res, NULL);
 				goto cleanup;
 			}
 
-			res = addNvlImprint(hsh, inputHash, hsr);
-			if (res != KSI_OK) {
-				KSI_pushError(ctx, res, NULL);
-				goto cleanup;
+			/* Apply the results and keep the steps with other algorithms for the next pass. */
+			lanes = 0;
+			for (i = 0, j = 0; i < active; i++) {
+				if (states[lane[i]].algo_id == algo_id) {
+					ChainState_apply(&states[lane[i]], imprint + lanes * KSI_MAX_IMPRINT_LEN, imprint_len[lanes]);
+					lanes++;
+				} else {
+					lane[j++] = lane[i];
+				}
 			}
+			active = j;
 		}
 
-
-		if (level > 0xff) {
-			KSI_pushError(ctx, res = KSI_INVALID_FORMAT, "Aggregation chain length exceeds 0xff.");
-			goto cleanup;
+		for (i = 0; i < count; i++) {
+			if (ChainState_hasNext(&states[i])) break;
 		}
+	} while (i < count);
 
-		chr_level = (char) level;
-		KSI_DataHasher_add(hsr, &chr_level, 1);
-
-		if (hsh != NULL) {
-			if (hsr == NULL) {
-				res = KSI_INVALID_STATE;
-			} else {
-				res = hsr->closeExisting(hsr, hsh);
-			}
-		} else {
-			res = KSI_DataHasher_close(hsr, &hsh);
-		}
+	for (i = 0; i < count; i++) {
+		res = ChainState_finish(ctx, &states[i], &items[i].endLevel, &items[i].outputHash);
 		if (res != KSI_OK) {
 			KSI_pushError(ctx, res, NULL);
 			goto cleanup;
 		}
 	}
 
-	sprintf(logMsg, "Finished %s hash chain aggregation with output hash.", isCalendar ? "calendar": "aggregation");
-	KSI_LOG_logDataHash(ctx, KSI_LOG_DEBUG, logMsg, hsh);
-
-	if (endLevel != NULL) *endLevel = level;
-	if (outputHash != NULL) *outputHash = hsh;
-	hsh = NULL;
-
-
 	res = KSI_OK;
 
 cleanup:
 
-	KSI_DataHasher_free(hsr);
-	KSI_DataHash_free(hsh);
+	if (res != KSI_OK && items != NULL && count > 0) {
+		for (i = 0; i < count; i++) {
+			KSI_DataHash_free(items[i].outputHash);
+			items[i].outputHash = NULL;
+		}
+	}
+
+	for (i = 0; i < initialized; i++) {
+		ChainState_clean(&states[i]);
+	}
+
+	KSI_free(states);
+	KSI_free(input);
+	KSI_free(imprint);
+	KSI_free(imprint_len);
+	KSI_free(lane);
 
 	return res;
 }
@@ -461,6 +639,77 @@ cleanup:
 	return res;
 }
 
+int KSI_CalendarHashChain_aggregateBatch(KSI_CTX *ctx, KSI_CalendarHashChain **chains, size_t count) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_HashChainAggregation *items = NULL;
+	size_t *index = NULL;
+	size_t pending = 0;
+	size_t i, j;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || (chains == NULL && count > 0)) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (chains[i] == NULL) {
+			KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+			goto cleanup;
+		}
+		if (chains[i]->outputHash == NULL) pending++;
+	}
+
+	if (pending == 0) {
+		res = KSI_OK;
+		goto cleanup;
+	}
+
+	items = KSI_calloc(pending, sizeof(KSI_HashChainAggregation));
+	index = KSI_calloc(pending, sizeof(size_t));
+	if (items == NULL || index == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0, j = 0; i < count; i++) {
+		if (chains[i]->outputHash != NULL) continue;
+		items[j].chain = chains[i]->hashChain;
+		items[j].inputHash = chains[i]->inputHash;
+		items[j].isCalendar = 1;
+		index[j] = i;
+		j++;
+	}
+
+	res = KSI_HashChain_aggregateBatch(ctx, items, pending);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	for (j = 0; j < pending; j++) {
+		/* The same chain may be listed more than once. */
+		if (chains[index[j]]->outputHash == NULL) {
+			chains[index[j]]->outputHash = items[j].outputHash;
+			items[j].outputHash = NULL;
+		}
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (items != NULL) {
+		for (j = 0; j < pending; j++) {
+			KSI_DataHash_free(items[j].outputHash);
+		}
+	}
+	KSI_free(items);
+	KSI_free(index);
+
+	return res;
+}
+
 int KSI_CalendarHashChain_calculateAggregationTime(const KSI_CalendarHashChain *chain, time_t *aggrTime) {
 	int res = KSI_UNKNOWN_ERROR;
 
@@ -1232,6 +1481,146 @@ cleanup:
 	return res;
 }
 
+/* Calculates the level of the root node of an aggregation hash chain without hashing. */
+static int getAggregationChainEndLevel(KSI_CTX *ctx, const KSI_AggregationHashChain *aggr, int startLevel, int *endLevel) {
+	int res = KSI_UNKNOWN_ERROR;
+	int level = startLevel;
+	size_t i;
+
+	for (i = 0; i < KSI_HashChainLinkList_length(aggr->chain); i++) {
+		KSI_HashChainLink *link = NULL;
+		KSI_uint64_t levelCorrection;
+
+		res = KSI_HashChainLinkList_elementAt(aggr->chain, i, &link);
+		if (res != KSI_OK || link == NULL) {
+			KSI_pushError(ctx, res != KSI_OK ? res : (res = KSI_INVALID_STATE), NULL);
+			goto cleanup;
+		}
+
+		levelCorrection = KSI_Integer_getUInt64(link->levelCorrection);
+		if (levelCorrection > 0xff || level + levelCorrection + 1 > 0xff) {
+			KSI_pushError(ctx, res = KSI_INVALID_FORMAT, "Aggregation chain level out of range.");
+			goto cleanup;
+		}
+		level += (int)levelCorrection + 1;
+	}
+
+	*endLevel = level;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_AggregationHashChainList_aggregateBatch(KSI_CTX *ctx, KSI_AggregationHashChainList **lists, size_t count) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_HashChainAggregation *items = NULL;
+	KSI_AggregationHashChain **chains = NULL;
+	size_t total = 0;
+	size_t pending = 0;
+	size_t i, j;
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || (lists == NULL && count > 0)) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (lists[i] == NULL) {
+			KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+			goto cleanup;
+		}
+		total += KSI_AggregationHashChainList_length(lists[i]);
+	}
+
+	if (total == 0) {
+		res = KSI_OK;
+		goto cleanup;
+	}
+
+	items = KSI_calloc(total, sizeof(KSI_HashChainAggregation));
+	chains = KSI_calloc(total, sizeof(KSI_AggregationHashChain *));
+	if (items == NULL || chains == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	/* The chains of a signature are aggregated from their own input hashes, so only the
+	 * start levels depend on the previous chains and those are known without hashing. */
+	for (i = 0; i < count; i++) {
+		int level = 0;
+
+		for (j = 0; j < KSI_AggregationHashChainList_length(lists[i]); j++) {
+			KSI_AggregationHashChain *aggr = NULL;
+
+			res = KSI_AggregationHashChainList_elementAt(lists[i], j, &aggr);
+			if (res != KSI_OK || aggr == NULL) {
+				KSI_pushError(ctx, res != KSI_OK ? res : (res = KSI_INVALID_STATE), NULL);
+				goto cleanup;
+			}
+
+			if (aggr->aggrHashId == NULL || aggr->chain == NULL || aggr->inputHash == NULL) {
+				KSI_pushError(ctx, res = KSI_INVALID_STATE, NULL);
+				goto cleanup;
+			}
+
+			if (aggr->outputHash == NULL || aggr->inputLevel != level) {
+				items[pending].chain = aggr->chain;
+				items[pending].inputHash = aggr->inputHash;
+				items[pending].startLevel = level;
+				items[pending].algo_id = (KSI_HashAlgorithm)KSI_Integer_getUInt64(aggr->aggrHashId);
+				chains[pending] = aggr;
+				pending++;
+			}
+
+			res = getAggregationChainEndLevel(ctx, aggr, level, &level);
+			if (res != KSI_OK) {
+				KSI_pushError(ctx, res, NULL);
+				goto cleanup;
+			}
+		}
+	}
+
+	if (pending == 0) {
+		res = KSI_OK;
+		goto cleanup;
+	}
+
+	res = KSI_HashChain_aggregateBatch(ctx, items, pending);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	for (j = 0; j < pending; j++) {
+		/* The same chain may be listed more than once. */
+		if (chains[j]->outputHash == NULL || chains[j]->inputLevel != items[j].startLevel) {
+			KSI_DataHash_free(chains[j]->outputHash);
+			chains[j]->outputHash = items[j].outputHash;
+			chains[j]->outputLevel = items[j].endLevel;
+			chains[j]->inputLevel = items[j].startLevel;
+			items[j].outputHash = NULL;
+		}
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (items != NULL) {
+		for (j = 0; j < pending; j++) {
+			KSI_DataHash_free(items[j].outputHash);
+		}
+	}
+	KSI_free(items);
+	KSI_free(chains);
+
+	return res;
+}
+
 void KSI_AggregationHashChain_free(KSI_AggregationHashChain *aggr) {
 	if (aggr != NULL && --aggr->ref == 0) {
 		KSI_Integer_free(aggr->aggrHashId);
@@ -77,6 +77,39 @@ extern "C" {
 	 */
 	int KSI_HashChain_aggregateCalendar(KSI_CTX *, KSI_LIST(KSI_HashChainLink) *chain, const KSI_DataHash *inputHash, KSI_DataHash **outputHash);
 
+	/**
+	 * A single hash chain for #KSI_HashChain_aggregateBatch.
+	 */
+	typedef struct KSI_HashChainAggregation_st {
+		/** Hash chain (list of hash chain links). */
+		KSI_LIST(KSI_HashChainLink) *chain;
+		/** Input hash value. */
+		const KSI_DataHash *inputHash;
+		/** Non-zero for a calendar hash chain. */
+		int isCalendar;
+		/** The initial level of an aggregation hash chain, ignored for calendar chains. */
+		int startLevel;
+		/** Hash algorithm of an aggregation hash chain, ignored for calendar chains. */
+		KSI_HashAlgorithm algo_id;
+		/** Output: the end level of the chain. */
+		int endLevel;
+		/** Output: the output hash; the caller is responsible for freeing it. */
+		KSI_DataHash *outputHash;
+	} KSI_HashChainAggregation;
+
+	/**
+	 * Aggregates \c count independent hash chains. The result is the same as calling
+	 * #KSI_HashChain_aggregate or #KSI_HashChain_aggregateCalendar for each chain, but the
+	 * corresponding steps of the chains are hashed together with #KSI_calculateImprintBatch,
+	 * which is faster when verifying many signatures at once.
+	 * \param[in]		ctx			KSI context.
+	 * \param[in,out]	items		Array of chains; \c endLevel and \c outputHash are set on success.
+	 * \param[in]		count		Number of elements in \c items.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code). On
+	 * failure no output hashes are returned.
+	 */
+	int KSI_HashChain_aggregateBatch(KSI_CTX *ctx, KSI_HashChainAggregation *items, size_t count);
+
 	/**
 	 * Free the resources of a #KSI_HashChainLink
 	 * \param[in]	t		Pointer to #KSI_HashChainLink
@@ -195,6 +228,18 @@ extern "C" {
 	void KSI_CalendarHashChain_free(KSI_CalendarHashChain *t);
 	int KSI_CalendarHashChain_new(KSI_CTX *ctx, KSI_CalendarHashChain **t);
 	int KSI_CalendarHashChain_aggregate(KSI_CalendarHashChain *chain, KSI_DataHash **hsh);
+
+	/**
+	 * Calculates and caches the output hashes of the calendar hash chains with
+	 * #KSI_HashChain_aggregateBatch. A following #KSI_CalendarHashChain_aggregate
+	 * call on any of the chains returns the cached value. Chains that already have
+	 * the output hash calculated are skipped.
+	 * \param[in]	ctx			KSI context.
+	 * \param[in]	chains		Array of calendar hash chains.
+	 * \param[in]	count		Number of elements in \c chains.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_CalendarHashChain_aggregateBatch(KSI_CTX *ctx, KSI_CalendarHashChain **chains, size_t count);
 	int KSI_CalendarHashChain_calculateAggregationTime(const KSI_CalendarHashChain *chain, time_t *aggrTime);
 	int KSI_CalendarHashChain_getPublicationTime(const KSI_CalendarHashChain *t, KSI_Integer **publicationTime);
 	int KSI_CalendarHashChain_getAggregationTime(const KSI_CalendarHashChain *t, KSI_Integer **aggregationTime);
@@ -300,6 +345,20 @@ extern "C" {
 	 */
 	int KSI_AggregationHashChainList_aggregate(KSI_AggregationHashChainList *chainList, KSI_CTX *ctx, int level, KSI_DataHash **outputHash);
 
+	/**
+	 * Calculates and caches the output hashes of all the aggregation hash chains in
+	 * the lists with #KSI_HashChain_aggregateBatch. Each list holds the aggregation
+	 * hash chains of one signature, and its first chain starts at level 0. A later
+	 * #KSI_AggregationHashChain_aggregate call on any of the chains, with the same
+	 * start level, returns the cached value. Chains that already have the output hash
+	 * calculated are skipped.
+	 * \param[in]	ctx			KSI context.
+	 * \param[in]	lists		Array of aggregation hash chain lists.
+	 * \param[in]	count		Number of elements in \c lists.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_AggregationHashChainList_aggregateBatch(KSI_CTX *ctx, KSI_AggregationHashChainList **lists, size_t count);
+
 
 /**
  * @}
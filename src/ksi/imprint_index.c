@@ -0,0 +1,70 @@
+/*
+ * Copyright 2013-2016 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#include <string.h>
+
+#include "internal.h"
+#include "imprint_index.h"
+
+int KSI_Imprint_compare(const unsigned char *a, size_t a_len, const unsigned char *b, size_t b_len) {
+	int cmp = memcmp(a, b, a_len < b_len ? a_len : b_len);
+	if (cmp != 0) return cmp;
+	return a_len < b_len ? -1 : (a_len > b_len ? 1 : 0);
+}
+
+int KSI_Imprint_lowerBound(const void *data, size_t count, KSI_ImprintIndexGetter get, const unsigned char *imprint, size_t imprint_len, size_t *pos, int *found) {
+	int res = KSI_UNKNOWN_ERROR;
+	const unsigned char *cur = NULL;
+	size_t cur_len = 0;
+	size_t lo = 0;
+	size_t hi = count;
+
+	if (get == NULL || imprint == NULL || pos == NULL || found == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		res = get(data, mid, &cur, &cur_len);
+		if (res != KSI_OK) goto cleanup;
+
+		if (KSI_Imprint_compare(cur, cur_len, imprint, imprint_len) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	*found = 0;
+	if (lo < count) {
+		res = get(data, lo, &cur, &cur_len);
+		if (res != KSI_OK) goto cleanup;
+
+		*found = KSI_Imprint_compare(cur, cur_len, imprint, imprint_len) == 0;
+	}
+	*pos = lo;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
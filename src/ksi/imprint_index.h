@@ -0,0 +1,62 @@
+/*
+ * Copyright 2013-2016 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#ifndef IMPRINT_INDEX_H_
+#define IMPRINT_INDEX_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * Returns the imprint number \c i of a sorted index.
+	 * \param[in]	data		Index given to #KSI_Imprint_lowerBound.
+	 * \param[in]	i			Position in the index.
+	 * \param[out]	imprint		Pointer to the receiving pointer of the imprint.
+	 * \param[out]	imprint_len	Pointer to the receiving length of the imprint.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	typedef int (*KSI_ImprintIndexGetter)(const void *data, size_t i, const unsigned char **imprint, size_t *imprint_len);
+
+	/**
+	 * Compares two imprints byte by byte; a prefix is less than the longer imprint.
+	 * \return negative, zero or positive, if \c a is less than, equal to or greater than \c b.
+	 */
+	int KSI_Imprint_compare(const unsigned char *a, size_t a_len, const unsigned char *b, size_t b_len);
+
+	/**
+	 * Finds the first position of a sorted index whose imprint is not less than \c imprint.
+	 * \param[in]	data		Index passed to \c get.
+	 * \param[in]	count		Number of imprints in the index.
+	 * \param[in]	get			Accessor of the imprints.
+	 * \param[in]	imprint		Imprint to look for.
+	 * \param[in]	imprint_len	Length of the imprint.
+	 * \param[out]	pos			Pointer to the receiving position; \c count if all the imprints are less.
+	 * \param[out]	found		Set to non-zero if the imprint at \c pos is equal to \c imprint.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise the error code of \c get).
+	 */
+	int KSI_Imprint_lowerBound(const void *data, size_t count, KSI_ImprintIndexGetter get, const unsigned char *imprint, size_t imprint_len, size_t *pos, int *found);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IMPRINT_INDEX_H_ */
@@ -283,6 +283,9 @@ struct KSI_ERR_st {
 	/** Filename of the error. */
 	char fileName[1024];
 
+	/** Filename of the error when pushed in compact mode (#KSI_OPT_COMPACT_ERRORS), \c NULL otherwise. */
+	const char *fileNameRef;
+
 	/** Line number where the error was logded. */
 	unsigned int lineNr;
 
@@ -296,4 +299,7 @@ struct KSI_ERR_st {
 	KSI_CTX *ctx;
 };
 
+/* Filename of the error regardless of the mode it was pushed in. */
+#define KSI_ERR_getFileName(err) ((err)->fileNameRef != NULL ? (err)->fileNameRef : (err)->fileName)
+
 #endif
@@ -27,6 +27,10 @@
 
 #ifndef _WIN32
 #  include "sys/socket.h"
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
 #  define socket_error errno
 #  define socketTimedOut EWOULDBLOCK
 #else
@@ -34,6 +38,7 @@
 #  define socketTimedOut WSAETIMEDOUT
 #  include <winsock2.h>
 #  include <ws2tcpip.h>
+#  include <windows.h>
 #endif
 
 int KSI_IO_readSocket(int fd, void *buf, size_t size, size_t *readCount) {
@@ -113,3 +118,98 @@ cleanup:
 	return res;
 
 }
+
+int KSI_IO_mapFile(const char *fileName, const unsigned char **data, size_t *size) {
+	int res = KSI_UNKNOWN_ERROR;
+	void *ptr = NULL;
+	size_t len = 0;
+#ifdef _WIN32
+	HANDLE file = INVALID_HANDLE_VALUE;
+	HANDLE mapping = NULL;
+	LARGE_INTEGER fileSize;
+#else
+	int fd = -1;
+	struct stat st;
+#endif
+
+	if (fileName == NULL || data == NULL || size == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+#ifdef _WIN32
+	file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &fileSize)) {
+		res = KSI_IO_ERROR;
+		goto cleanup;
+	}
+
+	if ((unsigned long long)fileSize.QuadPart > (size_t)-1) {
+		res = KSI_BUFFER_OVERFLOW;
+		goto cleanup;
+	}
+	len = (size_t)fileSize.QuadPart;
+
+	if (len > 0) {
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			res = KSI_IO_ERROR;
+			goto cleanup;
+		}
+
+		ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (ptr == NULL) {
+			res = KSI_IO_ERROR;
+			goto cleanup;
+		}
+	}
+#else
+	fd = open(fileName, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		res = KSI_IO_ERROR;
+		goto cleanup;
+	}
+
+	if ((unsigned long long)st.st_size > (size_t)-1) {
+		res = KSI_BUFFER_OVERFLOW;
+		goto cleanup;
+	}
+	len = (size_t)st.st_size;
+
+	if (len > 0) {
+		ptr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (ptr == MAP_FAILED) {
+			ptr = NULL;
+			res = KSI_IO_ERROR;
+			goto cleanup;
+		}
+	}
+#endif
+
+	*data = ptr;
+	*size = len;
+
+	res = KSI_OK;
+
+cleanup:
+
+#ifdef _WIN32
+	/* The view keeps the file open. */
+	if (mapping != NULL) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+	if (fd >= 0) close(fd);
+#endif
+
+	return res;
+}
+
+void KSI_IO_unmapFile(const unsigned char *data, size_t size) {
+	if (data == NULL) return;
+#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(data);
+#else
+	munmap((void *)data, size);
+#endif
+}
@@ -48,6 +48,24 @@ extern "C" {
 	 */
 	int KSI_IO_readFile(FILE *f, void *buf, size_t size, size_t *count);
 
+	/**
+	 * Maps the whole file read-only into memory. The mapping must be released
+	 * with #KSI_IO_unmapFile.
+	 * \param[in]	fileName	Path to the file.
+	 * \param[out]	data		Pointer to the receiving pointer of the mapped data.
+	 * \param[out]	size		Size of the mapped data.
+	 *
+	 * \return The method will return KSI_OK when no error occurred.
+	 */
+	int KSI_IO_mapFile(const char *fileName, const unsigned char **data, size_t *size);
+
+	/**
+	 * Releases a mapping created by #KSI_IO_mapFile.
+	 * \param[in]	data		Pointer to the mapped data.
+	 * \param[in]	size		Size of the mapped data.
+	 */
+	void KSI_IO_unmapFile(const unsigned char *data, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
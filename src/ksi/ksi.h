@@ -28,6 +28,7 @@
 #include "hash.h"
 #include "publicationsfile.h"
 #include "log.h"
+#include "metrics.h"
 #include "signature.h"
 #include "verification.h"
 #include "policy.h"
@@ -331,6 +332,28 @@ typedef enum KSI_Option_en {
 	 */
 	KSI_OPT_EXT_HMAC_ALGORITHM,
 
+	/**
+	 * Description:	Time in seconds after which the publications file received by
+	 * 				#KSI_receivePublicationsFile has expired. An expired file is
+	 * 				replaced only by #KSI_CTX_refreshPublicationsFile, the receiving
+	 * 				of the file never downloads it again.
+	 * Type:		size_t.
+	 * Range:		0 (expires at once, default) .. SIZE_MAX.
+	 */
+	KSI_OPT_PUBFILE_TTL,
+
+	/**
+	 * Description:	Compact error stack. When enabled, #KSI_ERR_push stores a pointer to
+	 * 				the file name instead of a copy and copies only the used part of the
+	 * 				message; the error text is put together only when the stack is
+	 * 				printed. Intended for contexts with a high rate of expected failures.
+	 * 				The file names passed to #KSI_ERR_push (\c __FILE__ for #KSI_pushError)
+	 * 				must remain valid until the errors are cleared.
+	 * Type:		size_t.
+	 * Range:		0 (disabled, default) or 1.
+	 */
+	KSI_OPT_COMPACT_ERRORS,
+
 	__KSI_NUMBER_OF_OPTIONS,
 } KSI_Option;
 
@@ -496,6 +519,30 @@ int KSI_sendPublicationRequest(KSI_CTX *ctx, const unsigned char *request, size_
  */
 int KSI_receivePublicationsFile(KSI_CTX *ctx, KSI_PublicationsFile **pubFile);
 
+/**
+ * Downloads a new publications file with \c worker, if the file received by \c ctx has
+ * expired (see #KSI_CTX_setPublicationsFileTTL), and replaces the file of \c ctx with it.
+ * The new file replaces the old one only if it passes the verification of \c worker.
+ * Nothing is done if \c ctx has not received a file yet or the file was set with
+ * #KSI_CTX_setPublicationsFile.
+ *
+ * To keep the download and the verification off the threads that verify signatures,
+ * call this function from a maintenance thread with its own \c worker context. The
+ * new file is then handed over to \c ctx and the next #KSI_receivePublicationsFile on
+ * \c ctx swaps it in without a network request. The file in use is never modified,
+ * holders of the old file keep their reference.
+ *
+ * \param[in]		ctx			KSI context whose publications file is refreshed.
+ * \param[in]		worker		KSI context used for the download and the verification, or
+ * 								\c NULL to use \c ctx.
+ *
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The \c worker context must use the same publications file URL, truststore and
+ * certificate constraints as \c ctx. Apart from this function, \c ctx is used only by
+ * the thread that owns it; \c ctx may not be freed while another thread refreshes it.
+ */
+int KSI_CTX_refreshPublicationsFile(KSI_CTX *ctx, KSI_CTX *worker);
+
 /**
  * Verify the PKI signature of the publications file using the context.
  * \param[in]		ctx			KSI context.
@@ -550,6 +597,23 @@ int KSI_verifyDataHash(KSI_CTX *ctx, KSI_Signature *sig, const KSI_DataHash *hsh
  */
 int KSI_createSignature(KSI_CTX *ctx, KSI_DataHash *dataHash, KSI_Signature **sig);
 
+/**
+ * Create KSI signatures for a batch of data hashes with a single aggregation request.
+ * The hashes are aggregated locally into a hash tree, only the root hash of the tree
+ * is sent to the aggregator and the local aggregation hash chain of each hash is
+ * prepended to the signature of the root.
+ * \param[in]		ctx				KSI context.
+ * \param[in]		hashes			Array of data hashes to be signed.
+ * \param[in]		hashes_count	Number of elements in \c hashes.
+ * \param[out]		sigs			Array of \c hashes_count pointers receiving the signatures
+ * 								in the order of \c hashes.
+ *
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note On failure all elements of \c sigs are set to \c NULL.
+ * \see #KSI_createSignature, #KSI_BlockSigner_new, #KSI_Signature_free
+ */
+int KSI_createSignatures(KSI_CTX *ctx, KSI_DataHash **hashes, size_t hashes_count, KSI_Signature **sigs);
+
 /**
  * Extend the signature to the earliest available publication.
  * Verify the extended signature with the provided policy and context.
@@ -640,6 +704,8 @@ int KSI_CTX_setOption(KSI_CTX *ctx, KSI_Option opt, void *param);
 
 #define KSI_CTX_setAggregatorHmacAlgorithm(ctx, alg_id) KSI_CTX_setOption(ctx, KSI_OPT_AGGR_HMAC_ALGORITHM, (void*)(alg_id))
 #define KSI_CTX_setExtenderHmacAlgorithm(ctx, alg_id) KSI_CTX_setOption(ctx, KSI_OPT_EXT_HMAC_ALGORITHM, (void*)(alg_id))
+#define KSI_CTX_setPublicationsFileTTL(ctx, seconds) KSI_CTX_setOption(ctx, KSI_OPT_PUBFILE_TTL, (void*)(size_t)(seconds))
+#define KSI_CTX_setCompactErrors(ctx, enable) KSI_CTX_setOption(ctx, KSI_OPT_COMPACT_ERRORS, (void*)(size_t)((enable) ? 1 : 0))
 
 /**
  * Deprecated. Defined for backwards compatibility.
@@ -674,6 +740,21 @@ int KSI_CTX_setConnectionTimeoutSeconds(KSI_CTX *ctx, int timeout);
  */
 int KSI_CTX_setPublicationsFile(KSI_CTX *ctx, KSI_PublicationsFile *var);
 
+/**
+ * Sets the directory where #KSI_receivePublicationsFile keeps a verified copy of the
+ * publications file. While the copy is younger than the TTL (see #KSI_CTX_setPublicationsFileTTL),
+ * new contexts use it without downloading the file again; older copies are
+ * revalidated with a conditional request (\c If-None-Match, \c If-Modified-Since) when
+ * the transport supports it. A copy is used only if it verifies with the truststore and
+ * the constraints of the context.
+ * \param[in]	ctx		KSI context.
+ * \param[in]	dir		Path to an existing directory or \c NULL to disable the cache.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The cache files are named after the URL set with #KSI_CTX_setPublicationUrl;
+ * the cache is not used with a custom network provider.
+ */
+int KSI_CTX_setPublicationsFileCacheDir(KSI_CTX *ctx, const char *dir);
+
 /**
  * Setter for the PKI truststore.
  * \param[in]	ctx		KSI context.
@@ -29,6 +29,8 @@ struct listImpl_st {
 	void **arr;
 	size_t arr_size;
 	size_t arr_len;
+	/* Incremented on every change of the list. */
+	size_t gen;
 };
 
 struct KSI_List_st {
@@ -84,6 +86,7 @@ static int appendElement(KSI_List *list, void* obj) {
 	}
 
 	pImpl->arr[pImpl->arr_len++] = obj;
+	pImpl->gen++;
 
 	res = KSI_OK;
 
@@ -168,6 +171,7 @@ static int replaceElementAt(KSI_List *list, size_t pos, void *o) {
 		list->obj_free(pImpl->arr[pos]);
 	}
 	pImpl->arr[pos] = o;
+	pImpl->gen++;
 
 	res = KSI_OK;
 
@@ -281,6 +285,7 @@ static int removeElement(KSI_List *list, size_t pos, void **o) {
 	}
 
 	pImpl->arr_len--;
+	pImpl->gen++;
 
 	res = KSI_OK;
 
@@ -339,6 +344,7 @@ int KSI_List_new(void (*obj_free)(void *), KSI_List **list) {
 	impl->arr = NULL;
 	impl->arr_len = 0;
 	impl->arr_size = 0;
+	impl->gen = 0;
 
 	tmp->pImpl = impl;
 	impl = NULL;
@@ -506,6 +512,10 @@ cleanup:
 	return res;
 }
 
+size_t KSI_List_getGeneration(KSI_List *list) {
+	return list == NULL || list->pImpl == NULL ? 0 : ((struct listImpl_st *) list->pImpl)->gen;
+}
+
 int KSI_List_sort(KSI_List *list, int (*cmp)(const void **a, const void **b)) {
 	int res = KSI_UNKNOWN_ERROR;
 	struct listImpl_st *pImpl;
@@ -523,6 +533,7 @@ int KSI_List_sort(KSI_List *list, int (*cmp)(const void **a, const void **b)) {
 	}
 
 	qsort(pImpl->arr, pImpl->arr_len, sizeof(void *), (int(*)(const void *, const void *))cmp);
+	pImpl->gen++;
 
 	res = KSI_OK;
 
@@ -162,6 +162,11 @@ int KSI_List_replaceAt(KSI_List *list, size_t pos, void *o);
 int KSI_List_elementAt(KSI_List *list, size_t pos, void **o);
 size_t KSI_List_length(KSI_List *list);
 int KSI_List_sort(KSI_List *list, int (*)(const void **, const void **));
+/**
+ * Returns a counter that changes whenever an element is added, removed or replaced, or
+ * the list is sorted. Used to check whether a lookup index built for the list is still valid.
+ */
+size_t KSI_List_getGeneration(KSI_List *list);
 int KSI_List_foldl(KSI_List *list, void *foldCtx, int (*fn)(void *el, void *foldCtx));
 
 /**
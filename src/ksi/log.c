@@ -36,21 +36,47 @@ static const char *level2str(int level) {
 	}
 }
 
+#ifndef va_copy
+#  define va_copy(dst, src) ((dst) = (src))
+#endif
+
+/* Most log messages fit into this buffer, longer ones are formatted on the heap. */
+#define KSI_LOG_STACK_MSG_SIZE 1024
+#define KSI_LOG_MAX_MSG_SIZE (0xffff + 1024)
+
+#define isLogEnabled(ctx, level) ((ctx)->loggerCB != NULL && (level) <= (ctx)->logLevel)
+
 static int writeLog(KSI_CTX *ctx, int logLevel, char *format, va_list va) {
 	int res = KSI_UNKNOWN_ERROR;
-	char msg[0xffff + 1024];
+	char buf[KSI_LOG_STACK_MSG_SIZE];
+	char *msg = buf;
+	size_t len;
+	va_list vaCopy;
 
 	if (ctx == NULL || format == NULL) {
 		res = KSI_INVALID_ARGUMENT;
 		goto cleanup;
 	}
-	if (ctx->loggerCB == NULL || ctx->logLevel < logLevel) {
+	if (!isLogEnabled(ctx, logLevel)) {
 		/* Do not perform logging. */
 		res = KSI_OK;
 		goto cleanup;
 	}
 
-	KSI_vsnprintf(msg, sizeof(msg), format, va);
+	va_copy(vaCopy, va);
+	len = KSI_vsnprintf(buf, sizeof(buf), format, vaCopy);
+	va_end(vaCopy);
+
+	if (len == sizeof(buf) - 1) {
+		/* The message may have been truncated. */
+		msg = KSI_malloc(KSI_LOG_MAX_MSG_SIZE);
+		if (msg == NULL) {
+			res = KSI_OUT_OF_MEMORY;
+			goto cleanup;
+		}
+		KSI_vsnprintf(msg, KSI_LOG_MAX_MSG_SIZE, format, va);
+	}
+
 	res = ctx->loggerCB(ctx->loggerCtx, logLevel, msg);
 	if (res != KSI_OK) goto cleanup;
 
@@ -58,6 +84,8 @@ static int writeLog(KSI_CTX *ctx, int logLevel, char *format, va_list va) {
 
 cleanup:
 
+	if (msg != buf) KSI_free(msg);
+
 	return res;
 }
 
@@ -86,11 +114,14 @@ KSI_LOG_FN(notice, NOTICE);
 KSI_LOG_FN(warn, WARN);
 KSI_LOG_FN(error, ERROR);
 
+int KSI_LOG_isEnabled(KSI_CTX *ctx, int level) {
+	return ctx != NULL && isLogEnabled(ctx, level);
+}
+
 int KSI_LOG_logBlob(KSI_CTX *ctx, int level, const char *prefix, const unsigned char *data, size_t data_len) {
+	static const char hex[] = "0123456789abcdef";
 	int res = KSI_UNKNOWN_ERROR;
 	char *logStr = NULL;
-	size_t logStr_size = 0;
-	size_t logStr_len = 0;
 	size_t i;
 
 	if (ctx == NULL || (data == NULL && data_len != 0) || (data != NULL && data_len == 0)) {
@@ -98,25 +129,22 @@ int KSI_LOG_logBlob(KSI_CTX *ctx, int level, const char *prefix, const unsigned
 		goto cleanup;
 	}
 
-	if (level > ctx->logLevel) goto cleanup;
-
-	logStr_size = data_len * 2 + 1;
+	if (!isLogEnabled(ctx, level)) {
+		res = KSI_OK;
+		goto cleanup;
+	}
 
-	logStr = KSI_calloc(logStr_size, 1);
+	logStr = KSI_malloc(data_len * 2 + 1);
 	if (logStr == NULL) {
 		res = KSI_OUT_OF_MEMORY;
 		goto cleanup;
 	}
 
 	for (i = 0; i < data_len; i++) {
-		size_t written;
-		written = KSI_snprintf(logStr + logStr_len, logStr_size - logStr_len, "%02x", data[i]);
-		if (written == 0 || (size_t) written > logStr_size - logStr_len) {
-			res = KSI_BUFFER_OVERFLOW;
-			goto cleanup;
-		}
-		logStr_len += (unsigned)written;
+		logStr[2 * i] = hex[data[i] >> 4];
+		logStr[2 * i + 1] = hex[data[i] & 0x0f];
 	}
+	logStr[2 * data_len] = '\0';
 
 	res = KSI_LOG_log(ctx, level, "%s (len = %lld): %s", prefix, (long long)data_len, logStr);
 	if (res != KSI_OK) goto cleanup;
@@ -132,15 +160,26 @@ cleanup:
 
 int KSI_LOG_logTlv(KSI_CTX *ctx, int level, const char *prefix, const KSI_TLV *tlv) {
 	int res = KSI_UNKNOWN_ERROR;
-	char serialized[0x1ffff];
+	char *serialized = NULL;
 
-	if (level > ctx->logLevel) {
+	if (ctx == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	if (!isLogEnabled(ctx, level)) {
 		res = KSI_OK;
 		goto cleanup;
 	}
 
 	if (tlv != NULL) {
-		KSI_TLV_toString(tlv, serialized, sizeof(serialized));
+		serialized = KSI_malloc(KSI_LOG_MAX_MSG_SIZE);
+		if (serialized == NULL) {
+			res = KSI_OUT_OF_MEMORY;
+			goto cleanup;
+		}
+
+		KSI_TLV_toString(tlv, serialized, KSI_LOG_MAX_MSG_SIZE);
 		res = KSI_LOG_log(ctx, level, "%s:\n%s", prefix, serialized);
 	} else {
 		res = KSI_LOG_log(ctx, level, "%s:\n%s", prefix, "(null)");
@@ -148,10 +187,117 @@ int KSI_LOG_logTlv(KSI_CTX *ctx, int level, const char *prefix, const KSI_TLV *t
 
 cleanup:
 
-	if (res != KSI_OK) {
+	if (res != KSI_OK && ctx != NULL) {
 		KSI_LOG_log(ctx, level, "%s: Unable to log tlv value - %s", prefix, KSI_getErrorString(res));
 	}
 
+	KSI_free(serialized);
+
+	return res;
+}
+
+/**
+ * Returns non-zero if the value has to be quoted in a key=value pair.
+ */
+static int fieldNeedsQuotes(const char *value) {
+	if (*value == '\0') return 1;
+	for (; *value != '\0'; value++) {
+		if (*value == ' ' || *value == '"' || *value == '=' || *value == '\\' || (unsigned char)*value < 0x20 || *value == 0x7f) return 1;
+	}
+	return 0;
+}
+
+int KSI_LOG_logFields(KSI_CTX *ctx, int level, const char *event, const KSI_LogField *fields, size_t fields_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	char buf[KSI_LOG_STACK_MSG_SIZE];
+	char *msg = buf;
+	size_t msg_size = sizeof(buf);
+	size_t len = 0;
+	size_t i;
+	const char *p;
+
+	if (ctx == NULL || event == NULL || (fields == NULL && fields_len != 0)) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	if (!isLogEnabled(ctx, level)) {
+		res = KSI_OK;
+		goto cleanup;
+	}
+
+	/* Worst case every value character is escaped as \xHH and quoted. */
+	len = strlen(event) + 1;
+	for (i = 0; i < fields_len; i++) {
+		if (fields[i].key == NULL) {
+			res = KSI_INVALID_ARGUMENT;
+			goto cleanup;
+		}
+		len += strlen(fields[i].key) + 4;
+		if (fields[i].value != NULL) len += 4 * strlen(fields[i].value);
+		else len += 6;
+	}
+
+	if (len > msg_size) {
+		msg_size = len;
+		msg = KSI_malloc(msg_size);
+		if (msg == NULL) {
+			res = KSI_OUT_OF_MEMORY;
+			goto cleanup;
+		}
+	}
+
+	len = strlen(event);
+	memcpy(msg, event, len);
+
+	for (i = 0; i < fields_len; i++) {
+		p = fields[i].value != NULL ? fields[i].value : "(null)";
+
+		msg[len++] = ' ';
+		memcpy(msg + len, fields[i].key, strlen(fields[i].key));
+		len += strlen(fields[i].key);
+		msg[len++] = '=';
+
+		if (fieldNeedsQuotes(p)) {
+			msg[len++] = '"';
+			for (; *p != '\0'; p++) {
+				if (*p == '"' || *p == '\\') {
+					msg[len++] = '\\';
+					msg[len++] = *p;
+				} else if (*p == '\n') {
+					msg[len++] = '\\';
+					msg[len++] = 'n';
+				} else if (*p == '\r') {
+					msg[len++] = '\\';
+					msg[len++] = 'r';
+				} else if (*p == '\t') {
+					msg[len++] = '\\';
+					msg[len++] = 't';
+				} else if ((unsigned char)*p < 0x20 || *p == 0x7f) {
+					/* No control characters reach the log, so values can not forge records. */
+					KSI_snprintf(msg + len, 5, "\\x%02x", (unsigned char)*p);
+					len += 4;
+				} else {
+					msg[len++] = *p;
+				}
+			}
+			msg[len++] = '"';
+		} else {
+			memcpy(msg + len, p, strlen(p));
+			len += strlen(p);
+		}
+	}
+	msg[len] = '\0';
+
+	res = ctx->loggerCB(ctx->loggerCtx, level, msg);
+	if (res != KSI_OK) goto cleanup;
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (msg != buf) KSI_free(msg);
+
 	return res;
 }
 
@@ -160,7 +306,7 @@ int KSI_LOG_logDataHash(KSI_CTX *ctx, int level, const char *prefix, const KSI_D
 	const unsigned char *imprint = NULL;
 	size_t imprint_len = 0;
 
-	if (level > ctx->logLevel) {
+	if (!isLogEnabled(ctx, level)) {
 		res = KSI_OK;
 		goto cleanup;
 	}
@@ -192,7 +338,7 @@ int KSI_LOG_logCtxError(KSI_CTX *ctx, int level) {
 
 	if(ctx == NULL) goto cleanup;
 
-	if (level > ctx->logLevel) {
+	if (!isLogEnabled(ctx, level)) {
 		res = KSI_OK;
 		goto cleanup;
 	}
@@ -205,7 +351,7 @@ int KSI_LOG_logCtxError(KSI_CTX *ctx, int level) {
 	/* List all errors, starting from the most general. */
 	for (i = 0; i < ctx->errors_count && i < ctx->errors_size; i++) {
 		err = ctx->errors + ((ctx->errors_count - i - 1) % ctx->errors_size);
-		KSI_LOG_log(ctx, level, "  %3u) %s:%u - (%d/%ld) %s", ctx->errors_count - i, err->fileName, err->lineNr,err->statusCode, err->extErrorCode, err->message);
+		KSI_LOG_log(ctx, level, "  %3u) %s:%u - (%d/%ld) %s", ctx->errors_count - i, KSI_ERR_getFileName(err), err->lineNr,err->statusCode, err->extErrorCode, *err->message != '\0' ? err->message : KSI_getErrorString(err->statusCode));
 	}
 
 	/* If there where more errors than buffers for the errors, indicate the fact */
@@ -241,3 +387,171 @@ int KSI_LOG_StreamLogger(void *logCtx, int logLevel, const char *message) {
 	return KSI_OK;
 }
 
+
+struct KSI_LogRingBuffer_st {
+	KSI_CTX *ctx;
+
+	/** Circular storage for the records, one byte is always left free. */
+	unsigned char *data;
+	size_t data_size;
+
+	/** Offset of the oldest record, moved only by the draining thread. */
+	volatile size_t head;
+	/** Offset after the newest record, moved only by the logging thread. */
+	volatile size_t tail;
+
+	/** Number of messages that did not fit, changed only by the logging thread. */
+	volatile size_t dropped;
+
+	/** Buffer for passing a single message to the drain callback. */
+	char *scratch;
+};
+
+/* Every record is a header followed by the message bytes without the terminating zero. */
+typedef struct {
+	int level;
+	size_t len;
+} LogRecordHeader;
+
+static void ringWrite(KSI_LogRingBuffer *rb, size_t pos, const void *src, size_t len) {
+	size_t first;
+
+	pos %= rb->data_size;
+	first = rb->data_size - pos < len ? rb->data_size - pos : len;
+
+	memcpy(rb->data + pos, src, first);
+	memcpy(rb->data, (const unsigned char *)src + first, len - first);
+}
+
+static void ringRead(const KSI_LogRingBuffer *rb, size_t pos, void *dst, size_t len) {
+	size_t first;
+
+	pos %= rb->data_size;
+	first = rb->data_size - pos < len ? rb->data_size - pos : len;
+
+	memcpy(dst, rb->data + pos, first);
+	memcpy((unsigned char *)dst + first, rb->data, len - first);
+}
+
+int KSI_LogRingBuffer_new(KSI_CTX *ctx, size_t size, KSI_LogRingBuffer **rb) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_LogRingBuffer *tmp = NULL;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || size <= sizeof(LogRecordHeader) || rb == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	tmp = KSI_new(KSI_LogRingBuffer);
+	if (tmp == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	tmp->ctx = ctx;
+	tmp->data_size = size;
+	tmp->head = 0;
+	tmp->tail = 0;
+	tmp->dropped = 0;
+	tmp->data = NULL;
+	tmp->scratch = NULL;
+
+	tmp->data = KSI_malloc(size);
+	tmp->scratch = KSI_malloc(size - sizeof(LogRecordHeader) + 1);
+	if (tmp->data == NULL || tmp->scratch == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	*rb = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_LogRingBuffer_free(tmp);
+
+	return res;
+}
+
+void KSI_LogRingBuffer_free(KSI_LogRingBuffer *rb) {
+	if (rb != NULL) {
+		KSI_free(rb->data);
+		KSI_free(rb->scratch);
+		KSI_free(rb);
+	}
+}
+
+int KSI_LOG_RingBufferLogger(void *logCtx, int logLevel, const char *message) {
+	KSI_LogRingBuffer *rb = (KSI_LogRingBuffer *) logCtx;
+	LogRecordHeader hdr;
+	size_t head;
+	size_t tail;
+	size_t used;
+
+	if (rb == NULL || message == NULL) return KSI_INVALID_ARGUMENT;
+
+	hdr.level = logLevel;
+	hdr.len = strlen(message);
+
+	/* The drainer may only free more space meanwhile. */
+	head = KSI_Atomic_loadSize(&rb->head);
+	tail = rb->tail;
+	used = (tail + rb->data_size - head) % rb->data_size;
+
+	if (sizeof(hdr) + hdr.len > rb->data_size - 1 - used) {
+		/* Never block or overwrite unread messages, just count the loss. */
+		KSI_Atomic_storeSize(&rb->dropped, rb->dropped + 1);
+		return KSI_OK;
+	}
+
+	ringWrite(rb, tail, &hdr, sizeof(hdr));
+	ringWrite(rb, tail + sizeof(hdr), message, hdr.len);
+
+	/* Publish the record only after it has been written. */
+	KSI_Atomic_storeSize(&rb->tail, (tail + sizeof(hdr) + hdr.len) % rb->data_size);
+
+	return KSI_OK;
+}
+
+int KSI_LogRingBuffer_drain(KSI_LogRingBuffer *rb, KSI_LoggerCallback cb, void *cbCtx, size_t *count) {
+	int res = KSI_UNKNOWN_ERROR;
+	LogRecordHeader hdr;
+	size_t drained = 0;
+	size_t head;
+
+	if (rb == NULL || cb == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	head = rb->head;
+	while (head != KSI_Atomic_loadSize(&rb->tail)) {
+		ringRead(rb, head, &hdr, sizeof(hdr));
+		ringRead(rb, head + sizeof(hdr), rb->scratch, hdr.len);
+		rb->scratch[hdr.len] = '\0';
+
+		/* Hand the space back to the logger before the possibly slow callback. */
+		head = (head + sizeof(hdr) + hdr.len) % rb->data_size;
+		KSI_Atomic_storeSize(&rb->head, head);
+		drained++;
+
+		res = cb(cbCtx, hdr.level, rb->scratch);
+		if (res != KSI_OK) goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (count != NULL) *count = drained;
+
+	return res;
+}
+
+size_t KSI_LogRingBuffer_getDropped(const KSI_LogRingBuffer *rb) {
+	return rb != NULL ? KSI_Atomic_loadSize(&rb->dropped) : 0;
+}
@@ -55,6 +55,30 @@ extern "C" {
 		KSI_LOG_DEBUG = 0x05,
 	};
 
+	/**
+	 * A key/value pair for #KSI_LOG_logFields.
+	 */
+	typedef struct KSI_LogField_st {
+		/** Field name. */
+		const char *key;
+		/** Field value, may be \c NULL. */
+		const char *value;
+	} KSI_LogField;
+
+	/**
+	 * Ring buffer for collecting log messages, see #KSI_LOG_RingBufferLogger.
+	 */
+	typedef struct KSI_LogRingBuffer_st KSI_LogRingBuffer;
+
+	/**
+	 * Checks if a message with the given log level would reach the logger callback. Callers
+	 * can use it to skip preparing expensive log arguments.
+	 * \param[in]	ctx			KSI context.
+	 * \param[in]	level		Log level.
+	 * \return Non-zero if the message would be logged, 0 otherwise.
+	 */
+	int KSI_LOG_isEnabled(KSI_CTX *ctx, int level);
+
 	/**
 	 * Logging for debug level. Events generated to aid in debugging, application flow and detailed service troubleshooting.
 	 * \param[in]	ctx			KSI context.
@@ -136,6 +160,21 @@ extern "C" {
 	 */
 	int KSI_LOG_logDataHash(KSI_CTX *ctx, int level, const char *prefix, const KSI_DataHash *hsh);
 
+	/**
+	 * Logs a structured message as \c event followed by <tt>key=value</tt> pairs separated
+	 * by spaces. Values containing spaces, quotes, '=' or control characters are quoted.
+	 * Within quotes, quotes and backslashes are escaped with a backslash, newline, carriage
+	 * return and tab as \c \\n, \c \\r and \c \\t and other control characters as \c \\xHH.
+	 * Nothing is formatted when the level is disabled.
+	 * \param[in]	ctx			KSI context.
+	 * \param[in]	level		Log level.
+	 * \param[in]	event		Event name.
+	 * \param[in]	fields		Array of fields.
+	 * \param[in]	fields_len	Number of fields.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_LOG_logFields(KSI_CTX *ctx, int level, const char *event, const KSI_LogField *fields, size_t fields_len);
+
 	/**
 	 * A helper function for logging KSI context error trace.
 	 * \param[in]	ctx			KSI context.
@@ -156,6 +195,58 @@ extern "C" {
 	 */
 	int KSI_LOG_StreamLogger(void *logCtx, int logLevel, const char *message);
 
+	/**
+	 * Creates a ring buffer for log messages. The buffer is used as the logger context
+	 * of #KSI_LOG_RingBufferLogger and is emptied with #KSI_LogRingBuffer_drain, so the
+	 * formatted messages can be written out later, e.g. after a batch of requests. The buffer
+	 * does not lock: it has a single producer, the thread that uses the KSI context, and a
+	 * single consumer, which may be another thread. Logging never waits for the drainer.
+	 * The buffer may be the logger context of only one KSI context at a time, and only one
+	 * thread at a time may drain it.
+	 * \param[in]	ctx			KSI context.
+	 * \param[in]	size		Size of the buffer in bytes.
+	 * \param[out]	rb			Pointer to the receiving pointer.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_LogRingBuffer_new(KSI_CTX *ctx, size_t size, KSI_LogRingBuffer **rb);
+
+	/**
+	 * Frees the ring buffer and any messages not drained.
+	 * \param[in]	rb			Ring buffer.
+	 */
+	void KSI_LogRingBuffer_free(KSI_LogRingBuffer *rb);
+
+	/**
+	 * A logging call-back to be used with #KSI_CTX_setLoggerCallback, where \c logCtx is
+	 * a #KSI_LogRingBuffer. The message is copied into the buffer; if it does not fit, it
+	 * is dropped and counted (see #KSI_LogRingBuffer_getDropped).
+	 * \param[in]	logCtx		Ring buffer.
+	 * \param[in]	logLevel	Log level.
+	 * \param[in]	message		Formatted log message.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_LOG_RingBufferLogger(void *logCtx, int logLevel, const char *message);
+
+	/**
+	 * Passes the buffered messages to \c cb in the order they were logged and removes
+	 * them from the buffer. Draining stops at the first error returned by \c cb. May be called
+	 * from another thread than the one logging into the buffer, but not from several threads
+	 * at once. Messages logged while draining may or may not be passed to \c cb.
+	 * \param[in]	rb			Ring buffer.
+	 * \param[in]	cb			Callback, e.g. #KSI_LOG_StreamLogger.
+	 * \param[in]	cbCtx		Context for the callback.
+	 * \param[out]	count		Number of messages drained, may be \c NULL.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_LogRingBuffer_drain(KSI_LogRingBuffer *rb, KSI_LoggerCallback cb, void *cbCtx, size_t *count);
+
+	/**
+	 * Returns the number of messages dropped because the buffer was full. May be called
+	 * from any thread.
+	 * \param[in]	rb			Ring buffer.
+	 */
+	size_t KSI_LogRingBuffer_getDropped(const KSI_LogRingBuffer *rb);
+
 /**
  * @}
  */
@@ -0,0 +1,460 @@
+/*
+ * Copyright 2013-2015 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include "internal.h"
+#include "ctx_impl.h"
+#include "metrics_impl.h"
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/time.h>
+#endif
+
+/* Bucket bounds in microseconds, from 1 ms to 10 s. */
+static const KSI_uint64_t bucketBounds[KSI_METRICS_HISTOGRAM_BUCKETS] = {
+	1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+	1000000, 2500000, 5000000, 10000000
+};
+
+static const char *endpointNames[KSI_METRICS_ENDPOINT_COUNT] = {
+	"aggregator", "extender", "publications_file"
+};
+
+KSI_uint64_t KSI_Metrics_now(void) {
+#ifdef _WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER now;
+
+	if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+
+	return (KSI_uint64_t)(now.QuadPart / freq.QuadPart) * 1000000 +
+			(KSI_uint64_t)(now.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) return 0;
+
+	return (KSI_uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+	struct timeval tv;
+
+	if (gettimeofday(&tv, NULL) != 0) return 0;
+
+	return (KSI_uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+static void Histogram_observe(KSI_MetricsHistogram *h, KSI_uint64_t value) {
+	size_t i;
+
+	for (i = 0; i < KSI_METRICS_HISTOGRAM_BUCKETS && value > bucketBounds[i]; i++);
+
+	h->bucket[i]++;
+	h->count++;
+	h->sum_us += value;
+}
+
+static KSI_EndpointMetrics *getEndpoint(KSI_CTX *ctx, int endpoint) {
+	if (ctx == NULL || endpoint < 0 || endpoint >= KSI_METRICS_ENDPOINT_COUNT) return NULL;
+	return &ctx->metrics.endpoint[endpoint];
+}
+
+static void EndpointMetrics_addError(KSI_EndpointMetrics *m, int res) {
+	size_t i;
+
+	m->errors++;
+
+	for (i = 0; i < m->errorCodes_len; i++) {
+		if (m->errorCodes[i].code == res) {
+			m->errorCodes[i].count++;
+			return;
+		}
+	}
+
+	if (m->errorCodes_len < KSI_METRICS_ERROR_CODES) {
+		m->errorCodes[m->errorCodes_len].code = res;
+		m->errorCodes[m->errorCodes_len].count = 1;
+		m->errorCodes_len++;
+	} else {
+		m->errorsOther++;
+	}
+}
+
+void KSI_Metrics_recordRequest(KSI_CTX *ctx, int endpoint, int res, size_t bytesOut, size_t bytesIn,
+		KSI_uint64_t connect, KSI_uint64_t firstByte, KSI_uint64_t total) {
+	KSI_EndpointMetrics *m = getEndpoint(ctx, endpoint);
+
+	if (m == NULL) return;
+
+	m->requests++;
+	m->bytesOut += bytesOut;
+	m->bytesIn += bytesIn;
+
+	if (res != KSI_OK) EndpointMetrics_addError(m, res);
+
+	if (connect != KSI_METRICS_TIME_UNKNOWN) Histogram_observe(&m->connect, connect);
+	if (firstByte != KSI_METRICS_TIME_UNKNOWN) Histogram_observe(&m->firstByte, firstByte);
+	Histogram_observe(&m->total, total);
+}
+
+void KSI_Metrics_recordError(KSI_CTX *ctx, int endpoint, int res) {
+	KSI_EndpointMetrics *m = getEndpoint(ctx, endpoint);
+
+	if (m == NULL || res == KSI_OK) return;
+
+	EndpointMetrics_addError(m, res);
+}
+
+void KSI_Metrics_recordHmac(KSI_CTX *ctx, int endpoint, KSI_uint64_t duration) {
+	KSI_EndpointMetrics *m = getEndpoint(ctx, endpoint);
+
+	if (m == NULL) return;
+
+	Histogram_observe(&m->hmac, duration);
+}
+
+KSI_uint64_t KSI_Metrics_getBucketBound(size_t i) {
+	return i < KSI_METRICS_HISTOGRAM_BUCKETS ? bucketBounds[i] : 0;
+}
+
+const char *KSI_Metrics_getEndpointName(KSI_MetricsEndpoint endpoint) {
+	if ((int)endpoint < 0 || endpoint >= KSI_METRICS_ENDPOINT_COUNT) return NULL;
+	return endpointNames[endpoint];
+}
+
+int KSI_CTX_getMetrics(KSI_CTX *ctx, KSI_MetricsSnapshot *snapshot) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || snapshot == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	memcpy(snapshot, &ctx->metrics, sizeof(*snapshot));
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_CTX_resetMetrics(KSI_CTX *ctx) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	memset(&ctx->metrics, 0, sizeof(ctx->metrics));
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_CTX_setVerificationTraceCallback(KSI_CTX *ctx, KSI_VerificationTraceCallback cb, void *traceCtx) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	ctx->verificationTraceCB = cb;
+	ctx->verificationTraceCtx = traceCtx;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+static KSI_PolicyStats *findPolicyStats(KSI_CTX *ctx, const char *name, int create) {
+	size_t i;
+
+	for (i = 0; i < ctx->policyStats_count; i++) {
+		if (!strncmp(ctx->policyStats[i].policyName, name, sizeof(ctx->policyStats[i].policyName) - 1)) {
+			return &ctx->policyStats[i];
+		}
+	}
+
+	if (!create || ctx->policyStats_count >= KSI_POLICY_STATS_SIZE) return NULL;
+
+	memset(&ctx->policyStats[i], 0, sizeof(ctx->policyStats[i]));
+	KSI_strncpy(ctx->policyStats[i].policyName, name, sizeof(ctx->policyStats[i].policyName));
+	ctx->policyStats_count++;
+
+	return &ctx->policyStats[i];
+}
+
+int KSI_CTX_getPolicyStats(KSI_CTX *ctx, const char *policyName, KSI_PolicyStats *stats) {
+	int res = KSI_UNKNOWN_ERROR;
+	const KSI_PolicyStats *found = NULL;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || policyName == NULL || stats == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	found = findPolicyStats(ctx, policyName, 0);
+	if (found != NULL) {
+		*stats = *found;
+	} else {
+		memset(stats, 0, sizeof(*stats));
+		KSI_strncpy(stats->policyName, policyName, sizeof(stats->policyName));
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_CTX_resetPolicyStats(KSI_CTX *ctx) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	memset(ctx->policyStats, 0, sizeof(ctx->policyStats));
+	ctx->policyStats_count = 0;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+KSI_uint64_t KSI_VerificationTrace_begin(KSI_CTX *ctx) {
+	KSI_uint64_t now;
+
+	if (ctx == NULL || ctx->verificationTraceCB == NULL) return 0;
+
+	/* Zero is reserved for "not traced". */
+	now = KSI_Metrics_now();
+	return now != 0 ? now : 1;
+}
+
+static KSI_uint64_t reportTraceEvent(KSI_CTX *ctx, KSI_VerificationTraceType type, const char *name, KSI_uint64_t begin,
+		int status, int resultCode, int cached) {
+	KSI_VerificationTraceEvent event;
+
+	event.type = type;
+	event.name = name;
+	event.begin_us = begin;
+	event.end_us = KSI_Metrics_now();
+	if (event.end_us < begin) event.end_us = begin;
+	event.status = status;
+	event.resultCode = resultCode;
+	event.cached = cached;
+
+	if (ctx->verificationTraceCB != NULL) {
+		ctx->verificationTraceCB(ctx->verificationTraceCtx, &event);
+	}
+
+	return event.end_us - begin;
+}
+
+void KSI_VerificationTrace_end(KSI_CTX *ctx, KSI_VerificationTraceType type, const char *name, KSI_uint64_t begin,
+		int status, int resultCode, int cached, KSI_VerificationTraceTotals *totals) {
+	KSI_uint64_t duration;
+
+	if (ctx == NULL || begin == 0) return;
+
+	duration = reportTraceEvent(ctx, type, name, begin, status, resultCode, cached);
+
+	if (totals == NULL) return;
+
+	if (type == KSI_TRACE_RULE) {
+		totals->rules++;
+		totals->rules_us += duration;
+	} else {
+		totals->fetches++;
+		totals->fetch_us += duration;
+	}
+}
+
+void KSI_VerificationTrace_endPolicy(KSI_CTX *ctx, const char *name, KSI_uint64_t begin, int status, int resultCode,
+		KSI_VerificationTraceTotals *totals) {
+	KSI_uint64_t duration;
+	KSI_PolicyStats *stats = NULL;
+
+	if (ctx == NULL || begin == 0) return;
+
+	duration = reportTraceEvent(ctx, KSI_TRACE_POLICY, name, begin, status, resultCode, 0);
+
+	stats = findPolicyStats(ctx, name != NULL ? name : "", 1);
+	if (stats != NULL) {
+		stats->verifications++;
+		if (status != KSI_OK) {
+			stats->errors++;
+		} else if (resultCode >= 0 && resultCode < 3) {
+			stats->results[resultCode]++;
+		}
+		stats->total_us += duration;
+		if (duration > stats->max_us) stats->max_us = duration;
+		if (totals != NULL) {
+			stats->rules += totals->rules;
+			stats->rules_us += totals->rules_us;
+			stats->fetches += totals->fetches;
+			stats->fetch_us += totals->fetch_us;
+		}
+	}
+
+	if (totals != NULL) memset(totals, 0, sizeof(*totals));
+}
+
+typedef struct {
+	char *buf;
+	size_t size;
+	size_t len;
+	int overflow;
+} TextBuffer;
+
+static void TextBuffer_append(TextBuffer *tb, const char *format, ...) {
+	va_list va;
+	size_t written;
+
+	if (tb->overflow) return;
+
+	va_start(va, format);
+	written = KSI_vsnprintf(tb->buf + tb->len, tb->size - tb->len, format, va);
+	va_end(va);
+
+	/* A completely filled buffer is treated as truncated output. */
+	if (written + 1 >= tb->size - tb->len) {
+		tb->overflow = 1;
+		return;
+	}
+	tb->len += written;
+}
+
+static void appendMicros(TextBuffer *tb, KSI_uint64_t us) {
+	TextBuffer_append(tb, "%llu.%06llu", (unsigned long long)(us / 1000000), (unsigned long long)(us % 1000000));
+}
+
+static void appendCounter(TextBuffer *tb, const KSI_MetricsSnapshot *snapshot, const char *name, const char *help, size_t offset) {
+	size_t i;
+
+	TextBuffer_append(tb, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+	for (i = 0; i < KSI_METRICS_ENDPOINT_COUNT; i++) {
+		const KSI_uint64_t *value = (const KSI_uint64_t *)((const char *)&snapshot->endpoint[i] + offset);
+		TextBuffer_append(tb, "%s{endpoint=\"%s\"} %llu\n", name, endpointNames[i], (unsigned long long)*value);
+	}
+}
+
+static void appendHistogram(TextBuffer *tb, const KSI_MetricsSnapshot *snapshot, const char *name, const char *help, size_t offset) {
+	size_t i;
+	size_t j;
+
+	TextBuffer_append(tb, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+	for (i = 0; i < KSI_METRICS_ENDPOINT_COUNT; i++) {
+		const KSI_MetricsHistogram *h = (const KSI_MetricsHistogram *)((const char *)&snapshot->endpoint[i] + offset);
+		KSI_uint64_t cumulative = 0;
+
+		for (j = 0; j < KSI_METRICS_HISTOGRAM_BUCKETS; j++) {
+			cumulative += h->bucket[j];
+			TextBuffer_append(tb, "%s_bucket{endpoint=\"%s\",le=\"", name, endpointNames[i]);
+			appendMicros(tb, bucketBounds[j]);
+			TextBuffer_append(tb, "\"} %llu\n", (unsigned long long)cumulative);
+		}
+		TextBuffer_append(tb, "%s_bucket{endpoint=\"%s\",le=\"+Inf\"} %llu\n", name, endpointNames[i], (unsigned long long)h->count);
+		TextBuffer_append(tb, "%s_sum{endpoint=\"%s\"} ", name, endpointNames[i]);
+		appendMicros(tb, h->sum_us);
+		TextBuffer_append(tb, "\n%s_count{endpoint=\"%s\"} %llu\n", name, endpointNames[i], (unsigned long long)h->count);
+	}
+}
+
+int KSI_MetricsSnapshot_toPrometheus(const KSI_MetricsSnapshot *snapshot, char *buf, size_t buf_size, size_t *len) {
+	int res = KSI_UNKNOWN_ERROR;
+	TextBuffer tb;
+	size_t i;
+	size_t j;
+
+	if (snapshot == NULL || buf == NULL || buf_size == 0) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	tb.buf = buf;
+	tb.size = buf_size;
+	tb.len = 0;
+	tb.overflow = 0;
+	buf[0] = '\0';
+
+	appendCounter(&tb, snapshot, "ksi_requests_total", "Number of requests performed.", offsetof(KSI_EndpointMetrics, requests));
+
+	TextBuffer_append(&tb, "# HELP ksi_errors_total Number of failed requests by status code.\n# TYPE ksi_errors_total counter\n");
+	for (i = 0; i < KSI_METRICS_ENDPOINT_COUNT; i++) {
+		const KSI_EndpointMetrics *m = &snapshot->endpoint[i];
+		for (j = 0; j < m->errorCodes_len && j < KSI_METRICS_ERROR_CODES; j++) {
+			TextBuffer_append(&tb, "ksi_errors_total{endpoint=\"%s\",code=\"0x%x\"} %llu\n", endpointNames[i], m->errorCodes[j].code, (unsigned long long)m->errorCodes[j].count);
+		}
+		if (m->errorsOther > 0) {
+			TextBuffer_append(&tb, "ksi_errors_total{endpoint=\"%s\",code=\"other\"} %llu\n", endpointNames[i], (unsigned long long)m->errorsOther);
+		}
+	}
+
+	appendCounter(&tb, snapshot, "ksi_sent_bytes_total", "Number of bytes sent.", offsetof(KSI_EndpointMetrics, bytesOut));
+	appendCounter(&tb, snapshot, "ksi_received_bytes_total", "Number of bytes received.", offsetof(KSI_EndpointMetrics, bytesIn));
+
+	appendHistogram(&tb, snapshot, "ksi_connect_duration_seconds", "Time to establish the connection.", offsetof(KSI_EndpointMetrics, connect));
+	appendHistogram(&tb, snapshot, "ksi_first_byte_duration_seconds", "Time to the first byte of the response.", offsetof(KSI_EndpointMetrics, firstByte));
+	appendHistogram(&tb, snapshot, "ksi_request_duration_seconds", "Total time of the request.", offsetof(KSI_EndpointMetrics, total));
+	appendHistogram(&tb, snapshot, "ksi_hmac_verification_duration_seconds", "Time of the response HMAC verification.", offsetof(KSI_EndpointMetrics, hmac));
+
+	if (tb.overflow) {
+		res = KSI_BUFFER_OVERFLOW;
+		goto cleanup;
+	}
+
+	if (len != NULL) *len = tb.len;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
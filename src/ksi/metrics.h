@@ -0,0 +1,251 @@
+/*
+ * Copyright 2013-2015 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#ifndef KSI_METRICS_H_
+#define KSI_METRICS_H_
+
+#include "types_base.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * \addtogroup metrics Metrics
+	 * Every KSI context keeps counters and latency histograms of the requests sent to
+	 * the aggregator, the extender and the publications file endpoint. The values can be
+	 * read with #KSI_CTX_getMetrics and exported with #KSI_MetricsSnapshot_toPrometheus.
+	 * @{
+	 */
+
+	/**
+	 * Service endpoints for which the metrics are collected.
+	 */
+	typedef enum KSI_MetricsEndpoint_en {
+		KSI_METRICS_AGGREGATOR = 0,
+		KSI_METRICS_EXTENDER,
+		KSI_METRICS_PUBLICATIONS_FILE,
+		/** Number of endpoints, not a valid value. */
+		KSI_METRICS_ENDPOINT_COUNT
+	} KSI_MetricsEndpoint;
+
+	/** Number of finite histogram buckets, see #KSI_Metrics_getBucketBound. */
+	#define KSI_METRICS_HISTOGRAM_BUCKETS 13
+
+	/** Number of distinct error codes counted per endpoint. */
+	#define KSI_METRICS_ERROR_CODES 16
+
+	/**
+	 * Latency histogram.
+	 */
+	typedef struct KSI_MetricsHistogram_st {
+		/** Number of observations per bucket, the last one is for values above all bounds. */
+		KSI_uint64_t bucket[KSI_METRICS_HISTOGRAM_BUCKETS + 1];
+		/** Number of observations. */
+		KSI_uint64_t count;
+		/** Sum of the observations in microseconds. */
+		KSI_uint64_t sum_us;
+	} KSI_MetricsHistogram;
+
+	/**
+	 * Number of failures with a single status code.
+	 */
+	typedef struct KSI_MetricsErrorCount_st {
+		/** Status code (see #KSI_StatusCode). */
+		int code;
+		/** Number of failures. */
+		KSI_uint64_t count;
+	} KSI_MetricsErrorCount;
+
+	/**
+	 * Metrics of a single endpoint.
+	 */
+	typedef struct KSI_EndpointMetrics_st {
+		/** Number of requests performed. */
+		KSI_uint64_t requests;
+		/** Number of failed requests, including the ones with an invalid response. */
+		KSI_uint64_t errors;
+		/** Failures by status code, the first \c errorCodes_len entries are used. */
+		KSI_MetricsErrorCount errorCodes[KSI_METRICS_ERROR_CODES];
+		size_t errorCodes_len;
+		/** Failures with a status code that did not fit into \c errorCodes. */
+		KSI_uint64_t errorsOther;
+		/** Number of bytes sent. */
+		KSI_uint64_t bytesOut;
+		/** Number of bytes received. */
+		KSI_uint64_t bytesIn;
+		/** Time to establish the connection, if reported by the transport. */
+		KSI_MetricsHistogram connect;
+		/** Time to the first byte of the response, if reported by the transport. */
+		KSI_MetricsHistogram firstByte;
+		/** Total time of the request. */
+		KSI_MetricsHistogram total;
+		/** Time of the response HMAC verification. */
+		KSI_MetricsHistogram hmac;
+	} KSI_EndpointMetrics;
+
+	/**
+	 * Copy of the metrics of a KSI context.
+	 */
+	typedef struct KSI_MetricsSnapshot_st {
+		KSI_EndpointMetrics endpoint[KSI_METRICS_ENDPOINT_COUNT];
+	} KSI_MetricsSnapshot;
+
+	/**
+	 * Kinds of verification trace events.
+	 */
+	typedef enum KSI_VerificationTraceType_en {
+		/** A single verification rule. */
+		KSI_TRACE_RULE = 1,
+		/** Extending the signature calendar hash chain with a network request. */
+		KSI_TRACE_FETCH_CALENDAR_CHAIN,
+		/** Receiving the publications file. */
+		KSI_TRACE_FETCH_PUBLICATIONS_FILE,
+		/** A single policy of a fallback chain. */
+		KSI_TRACE_POLICY
+	} KSI_VerificationTraceType;
+
+	/**
+	 * A completed step of a signature verification.
+	 */
+	typedef struct KSI_VerificationTraceEvent_st {
+		/** Kind of the step. */
+		KSI_VerificationTraceType type;
+		/** Rule or policy name, \c NULL for network fetches. */
+		const char *name;
+		/** Monotonic time stamps of the beginning and the end of the step in microseconds. */
+		KSI_uint64_t begin_us;
+		KSI_uint64_t end_us;
+		/** Status code of the step (see #KSI_StatusCode). */
+		int status;
+		/** Verification result code of a rule or policy (see #KSI_VerificationResultCode), -1 for fetches. */
+		int resultCode;
+		/** Non-zero if the rule result was reused from an earlier policy of the fallback chain. */
+		int cached;
+	} KSI_VerificationTraceEvent;
+
+	/**
+	 * Verification trace callback. The event is valid only during the call. Fetch events
+	 * are reported before the event of the rule that caused the fetch.
+	 * \param[in]	traceCtx	Context set with #KSI_CTX_setVerificationTraceCallback.
+	 * \param[in]	event		Completed step.
+	 */
+	typedef void (*KSI_VerificationTraceCallback)(void *traceCtx, const KSI_VerificationTraceEvent *event);
+
+	/** Number of policies for which the statistics are kept. */
+	#define KSI_POLICY_STATS_SIZE 16
+
+	/**
+	 * Aggregated statistics of a verification policy.
+	 */
+	typedef struct KSI_PolicyStats_st {
+		/** Policy name, truncated if needed. */
+		char policyName[64];
+		/** Number of times the policy was verified. */
+		KSI_uint64_t verifications;
+		/** Number of results by #KSI_VerificationResultCode. */
+		KSI_uint64_t results[3];
+		/** Number of verifications stopped by an internal error. */
+		KSI_uint64_t errors;
+		/** Total and longest time of the policy verification. */
+		KSI_uint64_t total_us;
+		KSI_uint64_t max_us;
+		/** Number and total time of the rules verified, including the fetches they caused. */
+		KSI_uint64_t rules;
+		KSI_uint64_t rules_us;
+		/** Number and total time of the network fetches. */
+		KSI_uint64_t fetches;
+		KSI_uint64_t fetch_us;
+	} KSI_PolicyStats;
+
+	/**
+	 * Returns the upper bound of the histogram bucket \c i in microseconds.
+	 * \param[in]	i			Bucket index less than #KSI_METRICS_HISTOGRAM_BUCKETS.
+	 * \return Upper bound of the bucket or 0 if the index is out of range.
+	 */
+	KSI_uint64_t KSI_Metrics_getBucketBound(size_t i);
+
+	/**
+	 * Returns the name of the endpoint as used in the exported metrics.
+	 * \param[in]	endpoint	Endpoint.
+	 * \return Name of the endpoint or \c NULL if the endpoint is not valid.
+	 */
+	const char *KSI_Metrics_getEndpointName(KSI_MetricsEndpoint endpoint);
+
+	/**
+	 * Copies the current metrics of the context into \c snapshot.
+	 * \param[in]	ctx			KSI context.
+	 * \param[out]	snapshot	Receiving structure.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_CTX_getMetrics(KSI_CTX *ctx, KSI_MetricsSnapshot *snapshot);
+
+	/**
+	 * Resets all the metrics of the context.
+	 * \param[in]	ctx			KSI context.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_CTX_resetMetrics(KSI_CTX *ctx);
+
+	/**
+	 * Enables timing of the signature verification steps. While a callback is set, every
+	 * verification rule, network fetch and policy is timed, reported to \c cb and added to
+	 * the policy statistics (see #KSI_CTX_getPolicyStats). Passing \c NULL disables tracing.
+	 * \param[in]	ctx			KSI context.
+	 * \param[in]	cb			Trace callback, may be \c NULL.
+	 * \param[in]	traceCtx	Context for the callback.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_CTX_setVerificationTraceCallback(KSI_CTX *ctx, KSI_VerificationTraceCallback cb, void *traceCtx);
+
+	/**
+	 * Returns the statistics of the policy collected while tracing was enabled. The statistics
+	 * of the first #KSI_POLICY_STATS_SIZE distinct policy names are kept.
+	 * \param[in]	ctx			KSI context.
+	 * \param[in]	policyName	Name of the policy.
+	 * \param[out]	stats		Receiving structure, zeroed if the policy has no statistics.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_CTX_getPolicyStats(KSI_CTX *ctx, const char *policyName, KSI_PolicyStats *stats);
+
+	/**
+	 * Clears the policy statistics.
+	 * \param[in]	ctx			KSI context.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_CTX_resetPolicyStats(KSI_CTX *ctx);
+
+	/**
+	 * Formats the snapshot in the Prometheus text exposition format.
+	 * \param[in]	snapshot	Metrics snapshot.
+	 * \param[out]	buf			Output buffer.
+	 * \param[in]	buf_size	Size of the output buffer.
+	 * \param[out]	len			Length of the output without the terminating zero, may be \c NULL.
+	 * \return #KSI_OK on success or #KSI_BUFFER_OVERFLOW if the output does not fit into the buffer.
+	 */
+	int KSI_MetricsSnapshot_toPrometheus(const KSI_MetricsSnapshot *snapshot, char *buf, size_t buf_size, size_t *len);
+
+/**
+ * @}
+ */
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KSI_METRICS_H_ */
@@ -0,0 +1,89 @@
+/*
+ * Copyright 2013-2015 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#ifndef METRICS_IMPL_H_
+#define METRICS_IMPL_H_
+
+#include "internal.h"
+#include "metrics.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/** Value of a duration that was not measured. */
+	#define KSI_METRICS_TIME_UNKNOWN ((KSI_uint64_t)-1)
+
+	/**
+	 * Returns a monotonic time stamp in microseconds.
+	 */
+	KSI_uint64_t KSI_Metrics_now(void);
+
+	/**
+	 * Records a performed request. The \c connect and \c firstByte durations may be
+	 * #KSI_METRICS_TIME_UNKNOWN. Requests that are not bound to an endpoint (\c endpoint
+	 * is negative) are ignored.
+	 */
+	void KSI_Metrics_recordRequest(KSI_CTX *ctx, int endpoint, int res, size_t bytesOut, size_t bytesIn,
+			KSI_uint64_t connect, KSI_uint64_t firstByte, KSI_uint64_t total);
+
+	/**
+	 * Records a failure after the request was performed, e.g. an invalid response.
+	 */
+	void KSI_Metrics_recordError(KSI_CTX *ctx, int endpoint, int res);
+
+	/**
+	 * Records the duration of a response HMAC verification.
+	 */
+	void KSI_Metrics_recordHmac(KSI_CTX *ctx, int endpoint, KSI_uint64_t duration);
+
+	/**
+	 * Time spent in the steps of a single policy verification.
+	 */
+	typedef struct KSI_VerificationTraceTotals_st {
+		KSI_uint64_t rules;
+		KSI_uint64_t rules_us;
+		KSI_uint64_t fetches;
+		KSI_uint64_t fetch_us;
+	} KSI_VerificationTraceTotals;
+
+	/**
+	 * Returns the start time of a traced step or 0 if tracing is disabled.
+	 */
+	KSI_uint64_t KSI_VerificationTrace_begin(KSI_CTX *ctx);
+
+	/**
+	 * Reports a traced step started with #KSI_VerificationTrace_begin and adds its
+	 * duration to \c totals (may be \c NULL). Does nothing if \c begin is 0.
+	 */
+	void KSI_VerificationTrace_end(KSI_CTX *ctx, KSI_VerificationTraceType type, const char *name, KSI_uint64_t begin,
+			int status, int resultCode, int cached, KSI_VerificationTraceTotals *totals);
+
+	/**
+	 * Reports a traced policy and adds it to the policy statistics together with the
+	 * step \c totals, which are cleared afterwards. Does nothing if \c begin is 0.
+	 */
+	void KSI_VerificationTrace_endPolicy(KSI_CTX *ctx, const char *name, KSI_uint64_t begin, int status, int resultCode,
+			KSI_VerificationTraceTotals *totals);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* METRICS_IMPL_H_ */
@@ -339,6 +339,14 @@ int KSI_RequestHandle_new(KSI_CTX *ctx, const unsigned char *request, size_t req
 	memset(tmp->err.errm, 0, sizeof(tmp->err.errm));
 	tmp->err.res = KSI_UNKNOWN_ERROR;
 	tmp->status = NULL;
+	tmp->ifNoneMatch = NULL;
+	tmp->ifModifiedSince = NULL;
+	tmp->etag = NULL;
+	tmp->lastModified = NULL;
+	tmp->metricsEndpoint = -1;
+	tmp->performStart = 0;
+	tmp->connectTime = KSI_METRICS_TIME_UNKNOWN;
+	tmp->firstByteTime = KSI_METRICS_TIME_UNKNOWN;
 
 	tmp->client = NULL;
 
@@ -388,6 +396,10 @@ void KSI_RequestHandle_free(KSI_RequestHandle *handle) {
 		}
 		KSI_free(handle->request);
 		KSI_free(handle->response);
+		KSI_free(handle->ifNoneMatch);
+		KSI_free(handle->ifModifiedSince);
+		KSI_free(handle->etag);
+		KSI_free(handle->lastModified);
 		KSI_free(handle);
 	}
 }
@@ -418,6 +430,8 @@ int KSI_NetworkClient_sendSignRequest(KSI_NetworkClient *provider, KSI_Aggregati
 		goto cleanup;
 	}
 
+	tmp->metricsEndpoint = KSI_METRICS_AGGREGATOR;
+
 	*handle = tmp;
 	tmp = NULL;
 	res = KSI_OK;
@@ -457,6 +471,8 @@ int KSI_NetworkClient_sendExtendRequest(KSI_NetworkClient *provider, KSI_ExtendR
 		goto cleanup;
 	}
 
+	tmp->metricsEndpoint = KSI_METRICS_EXTENDER;
+
 	*handle = tmp;
 	tmp = NULL;
 	res = KSI_OK;
@@ -496,6 +512,8 @@ int KSI_NetworkClient_sendPublicationsFileRequest(KSI_NetworkClient *provider, K
 		goto cleanup;
 	}
 
+	tmp->metricsEndpoint = KSI_METRICS_PUBLICATIONS_FILE;
+
 	*handle = tmp;
 	tmp = NULL;
 	res = KSI_OK;
@@ -634,7 +652,16 @@ int KSI_RequestHandle_perform(KSI_RequestHandle *handle) {
 	}
 
 
+	handle->performStart = KSI_Metrics_now();
+	handle->connectTime = KSI_METRICS_TIME_UNKNOWN;
+	handle->firstByteTime = KSI_METRICS_TIME_UNKNOWN;
+
 	res = handle->readResponse(handle);
+
+	KSI_Metrics_recordRequest(handle->ctx, handle->metricsEndpoint, res, handle->request_length,
+			res == KSI_OK ? handle->response_length : 0, handle->connectTime, handle->firstByteTime,
+			KSI_Metrics_now() - handle->performStart);
+
 	if (res != KSI_OK) {
 		KSI_pushError(handle->ctx, res, NULL);
 		goto cleanup;
@@ -649,6 +676,14 @@ cleanup:
 	return res;
 }
 
+void KSI_RequestHandle_markConnected(KSI_RequestHandle *handle) {
+	if (handle != NULL) handle->connectTime = KSI_Metrics_now() - handle->performStart;
+}
+
+void KSI_RequestHandle_markFirstByte(KSI_RequestHandle *handle) {
+	if (handle != NULL) handle->firstByteTime = KSI_Metrics_now() - handle->performStart;
+}
+
 int KSI_RequestHandle_getResponseStatus(const KSI_RequestHandle *handle, const KSI_RequestHandleStatus **err) {
 	int res = KSI_UNKNOWN_ERROR;
 	if (handle == NULL) {
@@ -666,6 +701,69 @@ cleanup:
 }
 
 
+static int setOptionalStringParam(char **param, const char *val) {
+	if (val == NULL) {
+		KSI_free(*param);
+		*param = NULL;
+		return KSI_OK;
+	}
+	return setStringParam(param, val);
+}
+
+int KSI_RequestHandle_setCacheValidators(KSI_RequestHandle *handle, const char *etag, const char *lastModified) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	if (handle == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_ERR_clearErrors(handle->ctx);
+
+	res = setOptionalStringParam(&handle->ifNoneMatch, etag);
+	if (res != KSI_OK) {
+		KSI_pushError(handle->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = setOptionalStringParam(&handle->ifModifiedSince, lastModified);
+	if (res != KSI_OK) {
+		KSI_pushError(handle->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_RequestHandle_getCacheValidators(const KSI_RequestHandle *handle, const char **etag, const char **lastModified) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	if (handle == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_ERR_clearErrors(handle->ctx);
+
+	if (etag == NULL || lastModified == NULL) {
+		KSI_pushError(handle->ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	*etag = handle->etag;
+	*lastModified = handle->lastModified;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
 int KSI_RequestHandle_getResponse(const KSI_RequestHandle *handle, const unsigned char **response, size_t *response_len) {
 	int res = KSI_UNKNOWN_ERROR;
 
@@ -691,11 +789,12 @@ cleanup:
 	return res;
 }
 
-static int pdu_verify_hmac(KSI_CTX *ctx, const KSI_DataHash *hmac, const char *key, KSI_HashAlgorithm conf_alg,
+static int pdu_verify_hmac(KSI_CTX *ctx, int endpoint, const KSI_DataHash *hmac, const char *key, KSI_HashAlgorithm conf_alg,
 		int (*calculateHmac)(const void*, int, const char*, KSI_DataHash**) ,void *PDU){
 	int res;
 	KSI_DataHash *actualHmac = NULL;
 	KSI_HashAlgorithm algo_id;
+	KSI_uint64_t start = KSI_Metrics_now();
 
 	KSI_ERR_clearErrors(ctx);
 
@@ -739,6 +838,8 @@ cleanup:
 
 	KSI_DataHash_free(actualHmac);
 
+	KSI_Metrics_recordHmac(ctx, endpoint, KSI_Metrics_now() - start);
+
 	return res;
 }
 
@@ -835,7 +936,7 @@ int KSI_RequestHandle_getExtendResponse(const KSI_RequestHandle *handle, KSI_Ext
 		goto cleanup;
 	}
 
-	res = pdu_verify_hmac(handle->ctx, respHmac, handle->client->extender->ksi_pass,
+	res = pdu_verify_hmac(handle->ctx, handle->metricsEndpoint, respHmac, handle->client->extender->ksi_pass,
 			(KSI_HashAlgorithm)handle->ctx->options[KSI_OPT_EXT_HMAC_ALGORITHM],
 			(int (*)(const void*, int, const char*, KSI_DataHash**))KSI_ExtendPdu_calculateHmac,
 			(void*)pdu);
@@ -891,6 +992,8 @@ int KSI_RequestHandle_getExtendResponse(const KSI_RequestHandle *handle, KSI_Ext
 
 cleanup:
 
+	if (handle != NULL) KSI_Metrics_recordError(handle->ctx, handle->metricsEndpoint, res);
+
 	KSI_ExtendResp_free(tmp);
 	KSI_Config_free(config);
 
@@ -982,7 +1085,7 @@ int KSI_RequestHandle_getAggregationResponse(const KSI_RequestHandle *handle, KS
 		goto cleanup;
 	}
 
-	res = pdu_verify_hmac(handle->ctx, respHmac, handle->client->aggregator->ksi_pass,
+	res = pdu_verify_hmac(handle->ctx, handle->metricsEndpoint, respHmac, handle->client->aggregator->ksi_pass,
 			(KSI_HashAlgorithm)handle->ctx->options[KSI_OPT_AGGR_HMAC_ALGORITHM],
 			(int (*)(const void*, int, const char*, KSI_DataHash**))KSI_AggregationPdu_calculateHmac,
 			(void*)pdu);
@@ -1038,6 +1141,8 @@ int KSI_RequestHandle_getAggregationResponse(const KSI_RequestHandle *handle, KS
 
 cleanup:
 
+	if (handle != NULL) KSI_Metrics_recordError(handle->ctx, handle->metricsEndpoint, res);
+
 	KSI_AggregationResp_free(tmp);
 	KSI_Config_free(config);
 	KSI_DataHash_free(actualHmac);
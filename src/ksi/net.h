@@ -255,6 +255,30 @@ extern "C" {
 	 */
 	int KSI_RequestHandle_getResponseStatus(const KSI_RequestHandle *handle, const KSI_RequestHandleStatus **err);
 
+	/**
+	 * Sets the validators of a cached copy of the requested resource. The HTTP client sends
+	 * them as \c If-None-Match and \c If-Modified-Since headers; if the resource has not
+	 * changed, the server answers with status code 304 and an empty response. Transports
+	 * without conditional requests ignore the validators.
+	 * \param[in]		handle			Network handle.
+	 * \param[in]		etag			Entity tag of the cached copy, may be \c NULL.
+	 * \param[in]		lastModified	Modification date of the cached copy, may be \c NULL.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 * \note The validators must be set before calling #KSI_RequestHandle_perform.
+	 */
+	int KSI_RequestHandle_setCacheValidators(KSI_RequestHandle *handle, const char *etag, const char *lastModified);
+
+	/**
+	 * Getter for the \c ETag and \c Last-Modified values of the response. The output values
+	 * are \c NULL if the server did not send them or the transport does not report them.
+	 * \param[in]		handle			Network handle.
+	 * \param[out]		etag			Pointer to the receiving entity tag pointer.
+	 * \param[out]		lastModified	Pointer to the receiving modification date pointer.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 * \note The output pointers are only valid as long as the handle itself is valid.
+	 */
+	int KSI_RequestHandle_getCacheValidators(const KSI_RequestHandle *handle, const char **etag, const char **lastModified);
+
 	/**
 	 * Setter for the implementation specific networking context.
 	 * \param[in]		client			Network client.
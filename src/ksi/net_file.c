@@ -81,6 +81,7 @@ static int readResponse(KSI_RequestHandle *handle) {
 		res = KSI_IO_ERROR;
 		goto cleanup;
 	}
+	KSI_RequestHandle_markConnected(handle);
 
 	buffer = KSI_calloc(TLV_BUFFER_SIZE, sizeof(unsigned char));
 	if (buffer == NULL) {
@@ -346,6 +347,7 @@ static int publicationFileReceive(KSI_RequestHandle *handle) {
 		res = KSI_IO_ERROR;
 		goto cleanup;
 	}
+	KSI_RequestHandle_markConnected(handle);
 
 	/* Find size of the file */
 	res = fseek(f, 0, SEEK_END);
@@ -22,6 +22,7 @@
 #if KSI_NET_HTTP_IMPL==KSI_IMPL_CURL
 
 #include <curl/curl.h>
+#include <ctype.h>
 #include <string.h>
 
 #include "net_http_impl.h"
@@ -35,6 +36,8 @@ typedef struct CurlNetHandleCtx_st {
 	unsigned char *raw;
 	size_t len;
 	struct curl_slist *httpHeaders;
+	/** Have the validators of the handle been added to #httpHeaders. */
+	bool conditional;
 	char curlErr[CURL_ERROR_SIZE];
 } CurlNetHandleCtx;
 
@@ -93,7 +96,7 @@ static int CurlNetHandleCtx_new(KSI_CTX *ctx, CurlNetHandleCtx **handleCtx) {
 	tmp->raw = NULL;
 	tmp->curlErr[0] = '\0';
 	tmp->httpHeaders = NULL;
-
+	tmp->conditional = false;
 
 	*handleCtx = tmp;
 	tmp = NULL;
@@ -137,6 +140,90 @@ cleanup:
 	return bytesCount;
 }
 
+/* Stores the value of the header line, if the header name matches. */
+static int storeHeaderValue(const char *line, size_t line_len, const char *name, char **value) {
+	size_t name_len = strlen(name);
+	size_t i;
+	char *tmp = NULL;
+
+	if (line_len <= name_len || line[name_len] != ':') return KSI_OK;
+	for (i = 0; i < name_len; i++) {
+		if (tolower((unsigned char)line[i]) != tolower((unsigned char)name[i])) return KSI_OK;
+	}
+
+	line += name_len + 1;
+	line_len -= name_len + 1;
+
+	/* Strip the surrounding whitespace and the line terminator. */
+	while (line_len > 0 && (*line == ' ' || *line == '\t')) {
+		line++;
+		line_len--;
+	}
+	while (line_len > 0 && isspace((unsigned char)line[line_len - 1])) line_len--;
+
+	tmp = KSI_malloc(line_len + 1);
+	if (tmp == NULL) return KSI_OUT_OF_MEMORY;
+
+	memcpy(tmp, line, line_len);
+	tmp[line_len] = '\0';
+
+	KSI_free(*value);
+	*value = tmp;
+
+	return KSI_OK;
+}
+
+static size_t receiveHeaderFromLibCurl(void *ptr, size_t size, size_t nmemb, void *stream) {
+	KSI_RequestHandle *handle = (KSI_RequestHandle *) stream;
+	size_t len = size * nmemb;
+
+	if (storeHeaderValue(ptr, len, "ETag", &handle->etag) != KSI_OK) return 0;
+	if (storeHeaderValue(ptr, len, "Last-Modified", &handle->lastModified) != KSI_OK) return 0;
+
+	return len;
+}
+
+static int appendHeader(CurlNetHandleCtx *implCtx, const char *name, const char *value) {
+	char header[1024];
+	struct curl_slist *tmp = NULL;
+
+	if (value == NULL) return KSI_OK;
+
+	KSI_snprintf(header, sizeof(header), "%s: %s", name, value);
+
+	tmp = curl_slist_append(implCtx->httpHeaders, header);
+	if (tmp == NULL) return KSI_OUT_OF_MEMORY;
+
+	implCtx->httpHeaders = tmp;
+
+	return KSI_OK;
+}
+
+/* Turns the request into a conditional one, if the handle has validators of a cached copy. */
+static int addConditionalHeaders(KSI_RequestHandle *handle, CurlNetHandleCtx *implCtx) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	if (implCtx->conditional || (handle->ifNoneMatch == NULL && handle->ifModifiedSince == NULL)) {
+		res = KSI_OK;
+		goto cleanup;
+	}
+
+	res = appendHeader(implCtx, "If-None-Match", handle->ifNoneMatch);
+	if (res != KSI_OK) goto cleanup;
+
+	res = appendHeader(implCtx, "If-Modified-Since", handle->ifModifiedSince);
+	if (res != KSI_OK) goto cleanup;
+
+	curl_easy_setopt(implCtx->curl, CURLOPT_HTTPHEADER, implCtx->httpHeaders);
+	implCtx->conditional = true;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
 static int updateStatus(KSI_RequestHandle *handle) {
 	int res = KSI_UNKNOWN_ERROR;
 	CurlNetHandleCtx *impl = NULL;
@@ -173,6 +260,7 @@ static int curlReceive(KSI_RequestHandle *handle) {
 	int res = KSI_UNKNOWN_ERROR;
 	CurlNetHandleCtx *implCtx = NULL;
 	long httpCode;
+	double elapsed = 0;
 
 	if (handle == NULL || handle->client == NULL || handle->implCtx == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -182,11 +270,30 @@ static int curlReceive(KSI_RequestHandle *handle) {
 
 	implCtx = handle->implCtx;
 
+	res = addConditionalHeaders(handle, implCtx);
+	if (res != KSI_OK) {
+		KSI_pushError(handle->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	/* Forget the validators of a previous response. */
+	KSI_free(handle->etag);
+	handle->etag = NULL;
+	KSI_free(handle->lastModified);
+	handle->lastModified = NULL;
+
 	KSI_LOG_debug(handle->ctx, "Sending request.");
 
 	res = curl_easy_perform(implCtx->curl);
 	KSI_LOG_debug(handle->ctx, "Received %llu bytes.", (unsigned long long)implCtx->len);
 
+	if (curl_easy_getinfo(implCtx->curl, CURLINFO_CONNECT_TIME, &elapsed) == CURLE_OK && elapsed > 0) {
+		handle->connectTime = (KSI_uint64_t)(elapsed * 1000000);
+	}
+	if (curl_easy_getinfo(implCtx->curl, CURLINFO_STARTTRANSFER_TIME, &elapsed) == CURLE_OK && elapsed > 0) {
+		handle->firstByteTime = (KSI_uint64_t)(elapsed * 1000000);
+	}
+
 	if (curl_easy_getinfo(implCtx->curl, CURLINFO_HTTP_CODE, &httpCode) == CURLE_OK) {
 		updateStatus(handle);
 		KSI_LOG_debug(handle->ctx, "Received HTTP error code %d. Curl error '%s'.", httpCode, implCtx->curlErr);
@@ -269,6 +376,8 @@ static int sendRequest(KSI_NetworkClient *client, KSI_RequestHandle *handle, cha
 	}
 
 	curl_easy_setopt(implCtx->curl, CURLOPT_WRITEDATA, implCtx);
+	curl_easy_setopt(implCtx->curl, CURLOPT_HEADERFUNCTION, receiveHeaderFromLibCurl);
+	curl_easy_setopt(implCtx->curl, CURLOPT_HEADERDATA, handle);
 
 	curl_easy_setopt(implCtx->curl, CURLOPT_CONNECTTIMEOUT, http->connectionTimeoutSeconds);
 	curl_easy_setopt(implCtx->curl, CURLOPT_TIMEOUT, http->readTimeoutSeconds);
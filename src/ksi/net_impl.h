@@ -22,6 +22,7 @@
 
 #include "net.h"
 #include "internal.h"
+#include "metrics_impl.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -106,8 +107,36 @@ extern "C" {
 		/** Function to retrieve the status of the last perform call. Will return #KSI_REQUEST_PENDING if
 		 * the request has not been performed. */
 		int (*status)(KSI_RequestHandle *);
+
+		/** Validators of a cached copy sent with a conditional request, may be NULL. */
+		char *ifNoneMatch;
+		char *ifModifiedSince;
+
+		/** Validators received with the response, NULL if not present. */
+		char *etag;
+		char *lastModified;
+
+		/** Endpoint the request is accounted to (#KSI_MetricsEndpoint), negative if none. */
+		int metricsEndpoint;
+
+		/** Start of the last perform call (see #KSI_Metrics_now). */
+		KSI_uint64_t performStart;
+
+		/** Connection and first byte durations of the last perform call, if known to the transport. */
+		KSI_uint64_t connectTime;
+		KSI_uint64_t firstByteTime;
 	};
 
+	/**
+	 * Marks the connection as established, to be called by the transport from \c readResponse.
+	 */
+	void KSI_RequestHandle_markConnected(KSI_RequestHandle *handle);
+
+	/**
+	 * Marks the first byte of the response as received, to be called by the transport from \c readResponse.
+	 */
+	void KSI_RequestHandle_markFirstByte(KSI_RequestHandle *handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -79,8 +79,12 @@ static int readResponse(KSI_RequestHandle *handle) {
 	struct sockaddr_in serv_addr;
 	struct hostent *server = NULL;
 	size_t count;
-	unsigned char buffer[0xffff + 4];
-	KSI_FTLV ftlv;
+	bool firstRead = true;
+	KSI_FTLV_Reader *reader = NULL;
+	unsigned char *window = NULL;
+	size_t window_len = 0;
+	unsigned char *tlv = NULL;
+	size_t tlv_len = 0;
 #ifdef _WIN32
 	DWORD transferTimeout = 0;
 #else
@@ -137,6 +141,8 @@ static int readResponse(KSI_RequestHandle *handle) {
 		goto cleanup;
 	}
 
+	KSI_RequestHandle_markConnected(handle);
+
 	KSI_LOG_logBlob(handle->ctx, KSI_LOG_DEBUG, "Sending request", handle->request, handle->request_length);
 	count = 0;
 	while (count < handle->request_length) {
@@ -158,24 +164,42 @@ static int readResponse(KSI_RequestHandle *handle) {
 		count += c;
 	}
 
-	res = KSI_FTLV_socketRead(sockfd, buffer, sizeof(buffer), &count, &ftlv);
-	if (res != KSI_OK || count == 0) {
-		KSI_pushError(handle->ctx, res = KSI_INVALID_ARGUMENT, "Unable to read TLV from socket.");
+	res = KSI_FTLV_Reader_new(&reader);
+	if (res != KSI_OK) {
+		KSI_pushError(handle->ctx, res, NULL);
 		goto cleanup;
 	}
 
-	if(count > UINT_MAX){
-		KSI_pushError(handle->ctx, res = KSI_BUFFER_OVERFLOW, "Too much data read from socket.");
-		goto cleanup;
-	}
+	/* Read the response directly into its final buffer. */
+	while (tlv == NULL) {
+		res = KSI_FTLV_Reader_getWindow(reader, &window, &window_len);
+		if (res != KSI_OK) {
+			KSI_pushError(handle->ctx, res, NULL);
+			goto cleanup;
+		}
 
-	handle->response = KSI_malloc(count);
-	if (handle->response == NULL) {
-		KSI_pushError(handle->ctx, res = KSI_OUT_OF_MEMORY, NULL);
-		goto cleanup;
+		res = KSI_IO_readSocket(sockfd, window, window_len, &count);
+		if (res != KSI_OK) {
+			KSI_pushError(handle->ctx, res = KSI_INVALID_ARGUMENT, "Unable to read TLV from socket.");
+			goto cleanup;
+		}
+
+		/* The first read is the two byte TLV header. */
+		if (firstRead) {
+			KSI_RequestHandle_markFirstByte(handle);
+			firstRead = false;
+		}
+
+		res = KSI_FTLV_Reader_advance(reader, count, &tlv, &tlv_len);
+		if (res != KSI_OK) {
+			KSI_pushError(handle->ctx, res, NULL);
+			goto cleanup;
+		}
 	}
-	memcpy(handle->response, buffer, count);
-	handle->response_length = count;
+
+	handle->response = tlv;
+	handle->response_length = tlv_len;
+	tlv = NULL;
 
 	handle->completed = true;
 
@@ -184,6 +208,8 @@ static int readResponse(KSI_RequestHandle *handle) {
 cleanup:
 
 	if (sockfd >= 0) close(sockfd);
+	KSI_FTLV_Reader_free(reader);
+	KSI_free(tlv);
 
 	return res;
 }
@@ -61,6 +61,29 @@ extern "C" {
 	 */
 	int KSI_PKITruststore_new(KSI_CTX *ctx, int setDefaults, KSI_PKITruststore **store);
 
+	/**
+	 * Creates a truststore for \c ctx that uses the trusted certificates of \c from
+	 * without loading them again. This way many contexts can share a single
+	 * truststore. Lookups added later to the new truststore are not visible in
+	 * \c from. Whether lookups added later to \c from are visible in the new
+	 * truststore depends on the implementation:
+	 * - OpenSSL: not visible, the store is copied before it is modified;
+	 * - CryptoAPI: visible, as the new truststore refers to the certificate
+	 *   store collection of \c from.
+	 *
+	 * \note Only truststores created by this function share their certificates,
+	 * #KSI_PKITruststore_new always loads them for its own context. The truststores
+	 * sharing certificates may be used and freed in different threads, but \c from
+	 * may not be modified while this function runs.
+	 * \param[in]	ctx				KSI context.
+	 * \param[in]	from			Truststore whose certificates are shared.
+	 * \param[out]	store			Pointer to the receiving pointer.
+	 *
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an
+	 * error code).
+	 */
+	int KSI_PKITruststore_newShared(KSI_CTX *ctx, const KSI_PKITruststore *from, KSI_PKITruststore **store);
+
 	/**
 	 * Destructor for the PKI Truststore object.
 	 * \param[in]	store			PKI Truststore object.
@@ -214,6 +214,43 @@ cleanup:
 	return res;
 }
 
+int KSI_PKITruststore_newShared(KSI_CTX *ctx, const KSI_PKITruststore *from, KSI_PKITruststore **trust) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_PKITruststore *tmp = NULL;
+	char buf[1024];
+
+	KSI_ERR_clearErrors(ctx);
+	if (ctx == NULL || from == NULL || trust == NULL){
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	res = KSI_PKITruststore_new(ctx, 0, &tmp);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	/* The collection only references the stores of the other truststore, the
+	 * certificates are not copied. */
+	if (!CertAddStoreToCollection(tmp->collectionStore, from->collectionStore, 0, 0)) {
+		KSI_LOG_debug(ctx, "%s", getMSError(GetLastError(), buf, sizeof(buf)));
+		KSI_pushError(ctx, res = KSI_CRYPTO_FAILURE, NULL);
+		goto cleanup;
+	}
+
+	*trust = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_PKITruststore_free(tmp);
+
+	return res;
+}
+
 void KSI_PKICertificate_free(KSI_PKICertificate *cert) {
 	if (cert != NULL) {
 		if (cert->x509 != NULL) CertFreeCertificateContext(cert->x509);
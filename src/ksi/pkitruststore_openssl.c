@@ -33,7 +33,11 @@
 #include "ctx_impl.h"
 #include "compatibility.h"
 #include "crc32.h"
+#include "thread.h"
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+#  define X509_STORE_CTX_get0_chain X509_STORE_CTX_get_chain
+#endif
 
 static const char *defaultCaFile =
 #ifdef OPENSSL_CA_FILE
@@ -52,9 +56,56 @@ static const char *defaultCaDir =
 
 static int KSI_PKITruststore_global_initCount = 0;
 
+/** Number of successful signature verifications remembered per truststore. */
+#define KSI_PKI_VERIFY_CACHE_SIZE 64
+
+#define VERIFY_CACHE_DIGEST_LEN 32
+
+typedef struct {
+	/* Digests of the signed data, the signature and the certificate. */
+	unsigned char key[3 * VERIFY_CACHE_DIGEST_LEN];
+	/* Signature algorithm OID for raw signatures, empty for PKCS#7. */
+	char algoOid[64];
+	/* Earliest expiry time of the certificate chain, 0 if the result does not depend on time. */
+	time_t expires;
+	int used;
+} VerifyCacheEntry;
+
+typedef struct {
+	VerifyCacheEntry entries[KSI_PKI_VERIFY_CACHE_SIZE];
+	size_t next;
+} VerifyCache;
+
+typedef struct StoreLookup_st StoreLookup;
+
+struct StoreLookup_st {
+	/* Non-zero for a hash directory, zero for a PEM file. */
+	int isDir;
+	char *path;
+	StoreLookup *next;
+};
+
+/**
+ * A certificate store that may be used by several truststores (and thus
+ * several contexts, possibly in different threads). The lookups are remembered,
+ * so a truststore can get a private copy of the store before it is modified.
+ */
+typedef struct {
+	X509_STORE *store;
+	/* Guards the reference count and, before OpenSSL 1.1, the use of the store. */
+	KSI_Mutex *lock;
+	/* Number of truststores using the store. */
+	size_t ref;
+	/* Non-zero if the system default paths are loaded. */
+	int defaults;
+	/* Lookups added after the defaults, in the order they were added. */
+	StoreLookup *lookups;
+} SharedStore;
+
 struct KSI_PKITruststore_st {
 	KSI_CTX *ctx;
-	X509_STORE *store;
+	SharedStore *shared;
+	VerifyCache *verifyCache;
 };
 
 struct KSI_PKICertificate_st {
@@ -106,52 +157,200 @@ static int KSI_MD2hashAlg(EVP_MD *hash_alg) {
 	return -1;
 }
 
-void KSI_PKITruststore_free(KSI_PKITruststore *trust) {
-	if (trust != NULL) {
-		if (trust->store != NULL) X509_STORE_free(trust->store);
-		KSI_free(trust);
+/* Adds one reference (delta > 0) or removes one and returns the new count. */
+static size_t sharedStore_addRef(SharedStore *shared, int delta) {
+	size_t ref;
+
+	/* The lock is missing only if the construction failed. */
+	if (shared->lock != NULL) KSI_Mutex_lock(shared->lock);
+	if (delta > 0) {
+		shared->ref++;
+	} else if (delta < 0) {
+		shared->ref--;
 	}
+	ref = shared->ref;
+	if (shared->lock != NULL) KSI_Mutex_unlock(shared->lock);
+
+	return ref;
 }
 
-int KSI_PKITruststore_addLookupFile(const KSI_PKITruststore *trust, const char *path) {
-	int res;
+static void sharedStore_free(SharedStore *shared) {
+	StoreLookup *lookup = NULL;
+
+	if (shared != NULL && sharedStore_addRef(shared, -1) == 0) {
+		while (shared->lookups != NULL) {
+			lookup = shared->lookups;
+			shared->lookups = lookup->next;
+			KSI_free(lookup->path);
+			KSI_free(lookup);
+		}
+		if (shared->store != NULL) X509_STORE_free(shared->store);
+		KSI_Mutex_free(shared->lock);
+		KSI_free(shared);
+	}
+}
+
+static int sharedStore_addLookup(SharedStore *shared, int isDir, const char *path, int remember) {
+	int res = KSI_UNKNOWN_ERROR;
 	X509_LOOKUP *lookup = NULL;
+	StoreLookup *entry = NULL;
+	StoreLookup **last = NULL;
 
-	if (trust == NULL) {
-		res = KSI_INVALID_ARGUMENT;
+	lookup = X509_STORE_add_lookup(shared->store, isDir ? X509_LOOKUP_hash_dir() : X509_LOOKUP_file());
+	if (lookup == NULL) {
+		res = KSI_OUT_OF_MEMORY;
 		goto cleanup;
 	}
 
-	KSI_ERR_clearErrors(trust->ctx);
+	if (isDir) {
+		if (!X509_LOOKUP_add_dir(lookup, path, X509_FILETYPE_PEM)) {
+			res = KSI_INVALID_FORMAT;
+			goto cleanup;
+		}
+	} else {
+		if (!X509_LOOKUP_load_file(lookup, path, X509_FILETYPE_PEM)) {
+			res = KSI_INVALID_FORMAT;
+			goto cleanup;
+		}
+	}
 
-	if (path == NULL) {
-		KSI_pushError(trust->ctx, res = KSI_INVALID_ARGUMENT, NULL);
+	if (remember) {
+		entry = KSI_new(StoreLookup);
+		if (entry == NULL) {
+			res = KSI_OUT_OF_MEMORY;
+			goto cleanup;
+		}
+		entry->isDir = isDir;
+		entry->next = NULL;
+		entry->path = NULL;
+
+		res = KSI_strdup(path, &entry->path);
+		if (res != KSI_OK) goto cleanup;
+
+		last = &shared->lookups;
+		while (*last != NULL) last = &(*last)->next;
+		*last = entry;
+		entry = NULL;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (entry != NULL) {
+		KSI_free(entry->path);
+		KSI_free(entry);
+	}
+
+	return res;
+}
+
+static int sharedStore_new(int setDefaults, SharedStore **shared) {
+	int res = KSI_UNKNOWN_ERROR;
+	SharedStore *tmp = NULL;
+
+	tmp = KSI_new(SharedStore);
+	if (tmp == NULL) {
+		res = KSI_OUT_OF_MEMORY;
 		goto cleanup;
 	}
 
+	tmp->store = NULL;
+	tmp->lock = NULL;
+	tmp->ref = 1;
+	tmp->defaults = setDefaults;
+	tmp->lookups = NULL;
 
-	lookup = X509_STORE_add_lookup(trust->store, X509_LOOKUP_file());
-	if (lookup == NULL) {
-		KSI_pushError(trust->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+	res = KSI_Mutex_new(&tmp->lock);
+	if (res != KSI_OK) goto cleanup;
+
+	tmp->store = X509_STORE_new();
+	if (tmp->store == NULL) {
+		res = KSI_OUT_OF_MEMORY;
 		goto cleanup;
 	}
 
+	if (setDefaults) {
+		/* Set system default paths. */
+		if (!X509_STORE_set_default_paths(tmp->store)) {
+			res = KSI_CRYPTO_FAILURE;
+			goto cleanup;
+		}
 
-	if (!X509_LOOKUP_load_file(lookup, path, X509_FILETYPE_PEM)) {
-		KSI_pushError(trust->ctx, res = KSI_INVALID_FORMAT, "Unable to add PKI Truststore lookup file.");
+		/* Set lookup file for trusted CA certificates if specified. */
+		if (defaultCaFile != NULL) {
+			res = sharedStore_addLookup(tmp, 0, defaultCaFile, 0);
+			if (res != KSI_OK) goto cleanup;
+		}
+
+		/* Set lookup directory for trusted CA certificates if specified. */
+		if (defaultCaDir != NULL) {
+			res = sharedStore_addLookup(tmp, 1, defaultCaDir, 0);
+			if (res != KSI_OK) goto cleanup;
+		}
+	}
+
+	*shared = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	sharedStore_free(tmp);
+
+	return res;
+}
+
+/**
+ * Makes sure the truststore is the only user of its store, so it can be
+ * modified without affecting other truststores. The X509_STORE can not be
+ * duplicated, so the copy is rebuilt from the remembered lookups.
+ */
+static int makePrivateStore(KSI_PKITruststore *trust) {
+	int res = KSI_UNKNOWN_ERROR;
+	SharedStore *tmp = NULL;
+	const StoreLookup *lookup = NULL;
+
+	/* The remembered lookups are changed only by the last user of the store. */
+	if (sharedStore_addRef(trust->shared, 0) == 1) {
+		res = KSI_OK;
 		goto cleanup;
 	}
 
+	KSI_LOG_debug(trust->ctx, "Copying shared PKI Truststore before modification.");
+
+	res = sharedStore_new(trust->shared->defaults, &tmp);
+	if (res != KSI_OK) goto cleanup;
+
+	for (lookup = trust->shared->lookups; lookup != NULL; lookup = lookup->next) {
+		res = sharedStore_addLookup(tmp, lookup->isDir, lookup->path, 1);
+		if (res != KSI_OK) goto cleanup;
+	}
+
+	sharedStore_free(trust->shared);
+	trust->shared = tmp;
+	tmp = NULL;
+
 	res = KSI_OK;
 
 cleanup:
 
+	sharedStore_free(tmp);
+
 	return res;
 }
 
-int KSI_PKITruststore_addLookupDir(const KSI_PKITruststore *trust, const char *path) {
-	int res = KSI_INVALID_ARGUMENT;
-	X509_LOOKUP *lookup = NULL;
+void KSI_PKITruststore_free(KSI_PKITruststore *trust) {
+	if (trust != NULL) {
+		sharedStore_free(trust->shared);
+		KSI_free(trust->verifyCache);
+		KSI_free(trust);
+	}
+}
+
+static int addLookup(const KSI_PKITruststore *trust, int isDir, const char *path) {
+	int res = KSI_UNKNOWN_ERROR;
 
 	if (trust == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -165,14 +364,22 @@ int KSI_PKITruststore_addLookupDir(const KSI_PKITruststore *trust, const char *p
 		goto cleanup;
 	}
 
-	lookup = X509_STORE_add_lookup(trust->store, X509_LOOKUP_hash_dir());
-	if (lookup == NULL) {
-		KSI_pushError(trust->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+	/* The store is shared by reference, the truststore object itself is not
+	 * shared, so detaching it from the other users is not visible outside. */
+	res = makePrivateStore((KSI_PKITruststore *)trust);
+	if (res != KSI_OK) {
+		KSI_pushError(trust->ctx, res, NULL);
 		goto cleanup;
 	}
 
-	if (!X509_LOOKUP_add_dir(lookup, path, X509_FILETYPE_PEM)) {
-		KSI_pushError(trust->ctx, res = KSI_INVALID_FORMAT, "Unable to add PKI Truststore lookup directory.");
+	/* The cached results were obtained with the previous set of trust anchors. A
+	 * failed lookup may still have added some of the certificates, so the cache
+	 * is cleared before the store is modified. */
+	if (trust->verifyCache != NULL) memset(trust->verifyCache, 0, sizeof(VerifyCache));
+
+	res = sharedStore_addLookup(trust->shared, isDir, path, 1);
+	if (res != KSI_OK) {
+		KSI_pushError(trust->ctx, res, isDir ? "Unable to add PKI Truststore lookup directory." : "Unable to add PKI Truststore lookup file.");
 		goto cleanup;
 	}
 
@@ -183,21 +390,22 @@ cleanup:
 	return res;
 }
 
+int KSI_PKITruststore_addLookupFile(const KSI_PKITruststore *trust, const char *path) {
+	return addLookup(trust, 0, path);
+}
+
+int KSI_PKITruststore_addLookupDir(const KSI_PKITruststore *trust, const char *path) {
+	return addLookup(trust, 1, path);
+}
+
 int KSI_PKITruststore_registerGlobals(KSI_CTX *ctx) {
 	return KSI_CTX_registerGlobals(ctx, openSslGlobal_init, openSslGlobal_cleanup);
 }
 
-int KSI_PKITruststore_new(KSI_CTX *ctx, int setDefaults, KSI_PKITruststore **trust) {
+static int newTruststore(KSI_CTX *ctx, int setDefaults, SharedStore *shared, KSI_PKITruststore **trust) {
 	KSI_PKITruststore *tmp = NULL;
 	int res;
 
-	KSI_ERR_clearErrors(ctx);
-
-	if (ctx == NULL || trust == NULL) {
-		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
-		goto cleanup;
-	}
-
 	res = KSI_PKITruststore_registerGlobals(ctx);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
@@ -211,38 +419,24 @@ int KSI_PKITruststore_new(KSI_CTX *ctx, int setDefaults, KSI_PKITruststore **tru
 	}
 
 	tmp->ctx = ctx;
-	tmp->store = NULL;
+	tmp->shared = NULL;
+	tmp->verifyCache = NULL;
 
-	tmp->store = X509_STORE_new();
-	if (tmp->store == NULL) {
+	tmp->verifyCache = KSI_calloc(1, sizeof(VerifyCache));
+	if (tmp->verifyCache == NULL) {
 		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
 		goto cleanup;
 	}
 
-	if (setDefaults) {
-		/* Set system default paths. */
-		if (!X509_STORE_set_default_paths(tmp->store)) {
-			KSI_pushError(ctx, res = KSI_CRYPTO_FAILURE, "Unable to set PKI Truststore default paths.");
+	if (shared != NULL) {
+		sharedStore_addRef(shared, 1);
+		tmp->shared = shared;
+	} else {
+		res = sharedStore_new(setDefaults, &tmp->shared);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, setDefaults ? "Unable to set PKI Truststore default paths." : NULL);
 			goto cleanup;
 		}
-
-		/* Set lookup file for trusted CA certificates if specified. */
-		if (defaultCaFile != NULL) {
-			res = KSI_PKITruststore_addLookupFile(tmp, defaultCaFile);
-			if (res != KSI_OK) {
-				KSI_pushError(ctx, res, NULL);
-				goto cleanup;
-			}
-		}
-
-		/* Set lookup directory for trusted CA certificates if specified. */
-		if (defaultCaDir != NULL) {
-			res = KSI_PKITruststore_addLookupDir(tmp, defaultCaDir);
-			if (res != KSI_OK) {
-				KSI_pushError(ctx, res, NULL);
-				goto cleanup;
-			}
-		}
 	}
 
 	*trust = tmp;
@@ -257,6 +451,52 @@ cleanup:
 	return res;
 }
 
+int KSI_PKITruststore_new(KSI_CTX *ctx, int setDefaults, KSI_PKITruststore **trust) {
+	int res;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || trust == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	res = newTruststore(ctx, setDefaults, NULL, trust);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_PKITruststore_newShared(KSI_CTX *ctx, const KSI_PKITruststore *from, KSI_PKITruststore **trust) {
+	int res;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || from == NULL || trust == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	res = newTruststore(ctx, 0, from->shared, trust);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
 void KSI_PKICertificate_free(KSI_PKICertificate *cert) {
 	if (cert != NULL) {
 		if (cert->x509 != NULL) X509_free(cert->x509);
@@ -591,6 +831,96 @@ cleanup:
 	return res;
 }
 
+/**
+ * Calculates the verification cache key. The entry does not expire unless
+ * \c expires is set by the caller. Returns zero if the key could not be
+ * calculated, in which case the cache is not used.
+ */
+static int verifyCache_makeKey(const unsigned char *data, size_t data_len, const unsigned char *sig, size_t sig_len, X509 *cert, const char *algoOid, VerifyCacheEntry *entry) {
+	unsigned md_len = 0;
+
+	memset(entry, 0, sizeof(VerifyCacheEntry));
+
+	if (algoOid != NULL) {
+		if (strlen(algoOid) >= sizeof(entry->algoOid)) return 0;
+		KSI_strncpy(entry->algoOid, algoOid, sizeof(entry->algoOid));
+	}
+
+	if (!EVP_Digest(data, data_len, entry->key, &md_len, EVP_sha256(), NULL) || md_len != VERIFY_CACHE_DIGEST_LEN) return 0;
+	if (!EVP_Digest(sig, sig_len, entry->key + VERIFY_CACHE_DIGEST_LEN, &md_len, EVP_sha256(), NULL) || md_len != VERIFY_CACHE_DIGEST_LEN) return 0;
+	if (!X509_digest(cert, EVP_sha256(), entry->key + 2 * VERIFY_CACHE_DIGEST_LEN, &md_len) || md_len != VERIFY_CACHE_DIGEST_LEN) return 0;
+
+	entry->used = 1;
+
+	return 1;
+}
+
+/**
+ * Calculates the cache key of a PKCS#7 signature over \c data.
+ */
+static int verifyCache_makePkcs7Key(const unsigned char *data, size_t data_len, const KSI_PKISignature *signature, VerifyCacheEntry *entry) {
+	int ok = 0;
+	STACK_OF(X509) *certs = NULL;
+	unsigned char *der = NULL;
+	unsigned char *tmp = NULL;
+	int der_len;
+
+	certs = PKCS7_get0_signers(signature->pkcs7, NULL, 0);
+	if (certs == NULL || sk_X509_num(certs) != 1) goto cleanup;
+
+	der_len = i2d_PKCS7(signature->pkcs7, NULL);
+	if (der_len <= 0) goto cleanup;
+
+	der = KSI_malloc((size_t)der_len);
+	if (der == NULL) goto cleanup;
+
+	tmp = der;
+	i2d_PKCS7(signature->pkcs7, &tmp);
+
+	ok = verifyCache_makeKey(data, data_len, der, (size_t)der_len, sk_X509_value(certs, 0), NULL, entry);
+
+cleanup:
+
+	if (certs != NULL) sk_X509_free(certs);
+	KSI_free(der);
+	ERR_clear_error();
+
+	return ok;
+}
+
+/**
+ * Returns non-zero if a successful verification matching \c key is cached and
+ * has not expired.
+ */
+static int verifyCache_find(const VerifyCache *cache, const VerifyCacheEntry *key) {
+	size_t i;
+	time_t now;
+
+	if (cache == NULL) return 0;
+
+	now = time(NULL);
+	for (i = 0; i < KSI_PKI_VERIFY_CACHE_SIZE; i++) {
+		const VerifyCacheEntry *entry = &cache->entries[i];
+		if (entry->used && (entry->expires == 0 || now <= entry->expires)
+				&& !memcmp(entry->key, key->key, sizeof(entry->key))
+				&& !strcmp(entry->algoOid, key->algoOid)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Remembers a successful verification, replacing the oldest entry when full.
+ */
+static void verifyCache_add(VerifyCache *cache, const VerifyCacheEntry *key) {
+	if (cache == NULL) return;
+
+	cache->entries[cache->next] = *key;
+	cache->next = (cache->next + 1) % KSI_PKI_VERIFY_CACHE_SIZE;
+}
+
 static char* ksi_pki_certificate_getString_by_oid(const KSI_PKICertificate *cert, int type, const char *OID, char *buf, size_t buf_len) {
 	char *ret = NULL;
 	ASN1_OBJECT *oid = NULL;
@@ -716,11 +1046,38 @@ cleanup:
 	return res;
 }
 
-static int KSI_PKITruststore_verifySignatureCertificate(const KSI_PKITruststore *pki, const KSI_PKISignature *signature) {
+/**
+ * Returns the earliest expiry time of the certificates in \c chain, or 0 if it
+ * can not be determined.
+ */
+static time_t getChainExpiry(STACK_OF(X509) *chain) {
+	time_t expires = 0;
+	time_t notAfter;
+	int i;
+
+	if (chain == NULL || sk_X509_num(chain) <= 0) return 0;
+
+	for (i = 0; i < sk_X509_num(chain); i++) {
+		notAfter = ASN1_GetTimeT(X509_get_notAfter(sk_X509_value(chain, i)));
+		if (notAfter == 0) return 0;
+		if (expires == 0 || notAfter < expires) expires = notAfter;
+	}
+
+	return expires;
+}
+
+/**
+ * Verifies the signing certificate against the truststore. If \c expires is not
+ * \c NULL, it receives the time the verified chain stops being valid (0 if unknown).
+ */
+static int KSI_PKITruststore_verifySignatureCertificate(const KSI_PKITruststore *pki, const KSI_PKISignature *signature, time_t *expires) {
 	int res;
 	X509 *cert = NULL;
 	X509_STORE_CTX *storeCtx = NULL;
 	KSI_PKICertificate *ksi_pki_cert = NULL;
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+	int locked = 0;
+#endif
 
 	if (pki == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -750,7 +1107,14 @@ static int KSI_PKITruststore_verifySignatureCertificate(const KSI_PKITruststore
 		goto cleanup;
 	}
 
-	if (!X509_STORE_CTX_init(storeCtx, pki->store, cert,
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+	/* Before 1.1 the store has no lock of its own, but the lookups fill its
+	 * certificate cache during the verification. */
+	KSI_Mutex_lock(pki->shared->lock);
+	locked = 1;
+#endif
+
+	if (!X509_STORE_CTX_init(storeCtx, pki->shared->store, cert,
 			signature->pkcs7->d.sign->cert)) {
 		KSI_pushError(pki->ctx, res = KSI_OUT_OF_MEMORY, NULL);
 		goto cleanup;
@@ -771,12 +1135,19 @@ static int KSI_PKITruststore_verifySignatureCertificate(const KSI_PKITruststore
 
 	KSI_LOG_debug(pki->ctx, "PKI signature certificate verified.");
 
+	/* The chain is validated against the current time, so the result holds until
+	 * the first certificate of the chain expires. */
+	if (expires != NULL) *expires = getChainExpiry(X509_STORE_CTX_get0_chain(storeCtx));
+
 	res = KSI_OK;
 
 cleanup:
 
 	KSI_PKICertificate_free(ksi_pki_cert);
 	if (storeCtx != NULL) X509_STORE_CTX_free(storeCtx);
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+	if (locked) KSI_Mutex_unlock(pki->shared->lock);
+#endif
 
 	return res;
 }
@@ -871,6 +1242,8 @@ cleanup:
 static int pki_truststore_verifySignature(const KSI_PKITruststore *pki, const unsigned char *data, size_t data_len, const KSI_PKISignature *signature) {
 	int res;
 	BIO *bio = NULL;
+	VerifyCacheEntry cacheKey;
+	int cacheable = 0;
 
 	if (pki == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -892,6 +1265,13 @@ static int pki_truststore_verifySignature(const KSI_PKITruststore *pki, const un
 		goto cleanup;
 	}
 
+	cacheable = verifyCache_makePkcs7Key(data, data_len, signature, &cacheKey);
+	if (cacheable && verifyCache_find(pki->verifyCache, &cacheKey)) {
+		KSI_LOG_debug(pki->ctx, "Signature and certificate verified earlier.");
+		res = KSI_OK;
+		goto cleanup;
+	}
+
 	bio = BIO_new_mem_buf((void *)data, (int)data_len);
 	if (bio == NULL) {
 		KSI_pushError(pki->ctx, res = KSI_OUT_OF_MEMORY, NULL);
@@ -914,12 +1294,15 @@ static int pki_truststore_verifySignature(const KSI_PKITruststore *pki, const un
 
 	KSI_LOG_debug(pki->ctx, "Signature verified.");
 
-	res = KSI_PKITruststore_verifySignatureCertificate(pki, signature);
+	res = KSI_PKITruststore_verifySignatureCertificate(pki, signature, &cacheKey.expires);
 	if (res != KSI_OK) {
 		KSI_pushError(pki->ctx, res, NULL);
 		goto cleanup;
 	}
 
+	/* Without an expiry time the entry would never expire. */
+	if (cacheable && cacheKey.expires != 0) verifyCache_add(pki->verifyCache, &cacheKey);
+
 	res = KSI_OK;
 
 cleanup:
@@ -957,64 +1340,7 @@ cleanup:
 }
 
 int KSI_PKITruststore_verifySignature(KSI_PKITruststore *pki, const unsigned char *data, size_t data_len, const KSI_PKISignature *signature) {
-	int res;
-	BIO *bio = NULL;
-
-	if (pki == NULL) {
-		res = KSI_INVALID_ARGUMENT;
-		goto cleanup;
-	}
-
-	KSI_ERR_clearErrors(pki->ctx);
-
-	if (data == NULL || signature == NULL) {
-		KSI_pushError(pki->ctx, res = KSI_INVALID_ARGUMENT, NULL);
-		goto cleanup;
-	}
-
-
-	KSI_LOG_debug(pki->ctx, "Starting to verify publications file signature.");
-
-	if (data_len > INT_MAX) {
-		KSI_pushError(pki->ctx, res = KSI_INVALID_ARGUMENT, "Data too long (more than MAX_INT).");
-		goto cleanup;
-	}
-
-	bio = BIO_new_mem_buf((void *)data, (int)data_len);
-	if (bio == NULL) {
-		KSI_pushError(pki->ctx, res = KSI_OUT_OF_MEMORY, NULL);
-		goto cleanup;
-	}
-
-	res = PKCS7_verify(signature->pkcs7, NULL, NULL, bio, NULL, PKCS7_NOVERIFY);
-	if (res < 0) {
-		KSI_pushError(pki->ctx, res = KSI_CRYPTO_FAILURE, "Unable to verify signature.");
-		goto cleanup;
-	}
-	if (res != 1) {
-		char msg[1024];
-		char buf[1024];
-		ERR_error_string_n(res, buf, sizeof(buf));
-		KSI_snprintf(msg, sizeof(msg), "PKI Signature not verified: %s", buf);
-		KSI_pushError(pki->ctx, res = KSI_INVALID_PKI_SIGNATURE, msg);
-		goto cleanup;
-	}
-
-	KSI_LOG_debug(pki->ctx, "Signature verified.");
-
-	res = KSI_PKITruststore_verifySignatureCertificate(pki, signature);
-	if (res != KSI_OK) {
-		KSI_pushError(pki->ctx, res, NULL);
-		goto cleanup;
-	}
-
-	res = KSI_OK;
-
-cleanup:
-
-	BIO_free(bio);
-
-	return res;
+	return pki_truststore_verifySignature(pki, data, data_len, signature);
 }
 
 int KSI_PKITruststore_verifyRawSignature(KSI_CTX *ctx, const unsigned char *data, size_t data_len, const char *algoOid, const unsigned char *signature, size_t signature_len, const KSI_PKICertificate *certificate) {
@@ -1024,6 +1350,9 @@ int KSI_PKITruststore_verifyRawSignature(KSI_CTX *ctx, const unsigned char *data
 	X509 *x509 = NULL;
 	const EVP_MD *evp_md;
 	EVP_PKEY *pubKey = NULL;
+	VerifyCache *cache = NULL;
+	VerifyCacheEntry cacheKey;
+	int cacheable = 0;
 
 	/* Needs to be initialized before jumping to cleanup. */
 	EVP_MD_CTX_init(&md_ctx);
@@ -1044,6 +1373,18 @@ int KSI_PKITruststore_verifyRawSignature(KSI_CTX *ctx, const unsigned char *data
 
 	x509 = certificate->x509;
 
+	/* The cache is kept by the truststore of the context, if there is one. */
+	if (ctx->pkiTruststore != NULL) {
+		cache = ctx->pkiTruststore->verifyCache;
+		/* The certificate validity period is not checked here, so the result does not expire. */
+		cacheable = verifyCache_makeKey(data, data_len, signature, signature_len, x509, algoOid, &cacheKey);
+		if (cacheable && verifyCache_find(cache, &cacheKey)) {
+			KSI_LOG_debug(ctx, "PKI signature verified earlier.");
+			res = KSI_OK;
+			goto cleanup;
+		}
+	}
+
 	algorithm = OBJ_txt2obj(algoOid, 1);
 
 	if (algorithm == NULL) {
@@ -1091,6 +1432,8 @@ int KSI_PKITruststore_verifyRawSignature(KSI_CTX *ctx, const unsigned char *data
 
 	KSI_LOG_debug(certificate->ctx, "PKI signature verified successfully.");
 
+	if (cacheable) verifyCache_add(cache, &cacheKey);
+
 	res = KSI_OK;
 
 cleanup:
@@ -81,6 +81,111 @@ cleanup:
 	return res;
 }
 
+/* Rules that depend only on the signature and the document hash. Their results
+ * do not change between the policies of a fallback chain. */
+static const Verifier memoisableRules[] = {
+	KSI_VerificationRule_AggregationChainInputHashVerification,
+	KSI_VerificationRule_AggregationChainMetaDataVerification,
+	KSI_VerificationRule_AggregationHashChainConsistency,
+	KSI_VerificationRule_AggregationHashChainTimeConsistency,
+	KSI_VerificationRule_AggregationHashChainIndexConsistency,
+	KSI_VerificationRule_CalendarHashChainInputHashVerification,
+	KSI_VerificationRule_CalendarHashChainAggregationTime,
+	KSI_VerificationRule_CalendarHashChainRegistrationTime,
+	KSI_VerificationRule_CalendarHashChainExistence,
+	KSI_VerificationRule_CalendarHashChainDoesNotExist,
+	KSI_VerificationRule_CalendarAuthenticationRecordExistence,
+	KSI_VerificationRule_CalendarAuthenticationRecordDoesNotExist,
+	KSI_VerificationRule_CalendarAuthenticationRecordAggregationHash,
+	KSI_VerificationRule_CalendarAuthenticationRecordAggregationTime,
+	KSI_VerificationRule_SignaturePublicationRecordExistence,
+	KSI_VerificationRule_SignaturePublicationRecordPublicationHash,
+	KSI_VerificationRule_SignaturePublicationRecordPublicationTime,
+	KSI_VerificationRule_SignatureDoesNotContainPublication,
+	KSI_VerificationRule_DocumentHashDoesNotExist,
+	KSI_VerificationRule_DocumentHashExistence,
+	KSI_VerificationRule_DocumentHashVerification,
+	NULL
+};
+
+static int isMemoisableRule(Verifier rule) {
+	size_t i;
+
+	for (i = 0; memoisableRules[i] != NULL; i++) {
+		if (memoisableRules[i] == rule) return 1;
+	}
+
+	return 0;
+}
+
+static const RuleResultMemo *RuleResultMemo_find(const VerificationTempData *tempData, Verifier rule) {
+	size_t i;
+
+	for (i = 0; i < tempData->ruleMemo_count; i++) {
+		if (tempData->ruleMemo[i].rule == rule) return &tempData->ruleMemo[i];
+	}
+
+	return NULL;
+}
+
+/* Applies the result of a single rule the same way the rule itself would have. */
+static void RuleVerificationResult_merge(KSI_RuleVerificationResult *result, const KSI_RuleVerificationResult *ruleResult) {
+	result->resultCode = ruleResult->resultCode;
+	result->errorCode = ruleResult->errorCode;
+	result->ruleName = ruleResult->ruleName;
+	/* As VERIFICATION_START, a step performed again is not successful unless the rule says so. */
+	result->stepsPerformed |= ruleResult->stepsPerformed;
+	result->stepsSuccessful &= ~ruleResult->stepsPerformed;
+	result->stepsSuccessful |= ruleResult->stepsSuccessful;
+	result->stepsFailed |= ruleResult->stepsFailed;
+}
+
+static int Rule_verifyBasic(Verifier rule, KSI_VerificationContext *context, KSI_RuleVerificationResult *result) {
+	int res = KSI_UNKNOWN_ERROR;
+	VerificationTempData *tempData = context->tempData;
+	const RuleResultMemo *memo = NULL;
+	KSI_RuleVerificationResult ruleResult;
+	KSI_uint64_t traceBegin = KSI_VerificationTrace_begin(context->ctx);
+	int cached = 0;
+
+	if (tempData == NULL || !isMemoisableRule(rule)) {
+		res = rule(context, result);
+		goto cleanup;
+	}
+
+	memo = RuleResultMemo_find(tempData, rule);
+	if (memo != NULL) {
+		KSI_LOG_debug(context->ctx, "Reusing result of %s.", memo->result.ruleName);
+		RuleVerificationResult_merge(result, &memo->result);
+		res = memo->res;
+		cached = 1;
+		goto cleanup;
+	}
+
+	ruleResult = *result;
+	ruleResult.stepsPerformed = KSI_VERIFY_NONE;
+	ruleResult.stepsSuccessful = KSI_VERIFY_NONE;
+	ruleResult.stepsFailed = KSI_VERIFY_NONE;
+
+	res = rule(context, &ruleResult);
+	RuleVerificationResult_merge(result, &ruleResult);
+
+	/* Internal errors are not remembered, they stop the verification anyway. */
+	if (res == KSI_OK && tempData->ruleMemo_count < KSI_RULE_MEMO_SIZE) {
+		RuleResultMemo *tmp = &tempData->ruleMemo[tempData->ruleMemo_count++];
+		tmp->rule = rule;
+		tmp->res = res;
+		tmp->result = ruleResult;
+	}
+
+cleanup:
+
+	KSI_VerificationTrace_end(context->ctx, KSI_TRACE_RULE, result->ruleName, traceBegin, res, result->resultCode, cached,
+			tempData != NULL ? &tempData->traceTotals : NULL);
+
+	return res;
+}
+
 static int Rule_verify(const KSI_Rule *rule, KSI_VerificationContext *context, KSI_PolicyVerificationResult *policyResult) {
 	int res = KSI_UNKNOWN_ERROR;
 	const KSI_Rule *currentRule = NULL;
@@ -96,7 +201,7 @@ static int Rule_verify(const KSI_Rule *rule, KSI_VerificationContext *context, K
 		policyResult->finalResult.errorCode = KSI_VER_ERR_GEN_2;
 		switch (currentRule->type) {
 			case KSI_RULE_TYPE_BASIC:
-				res = ((Verifier)(currentRule->rule))(context, &policyResult->finalResult);
+				res = Rule_verifyBasic((Verifier)(currentRule->rule), context, &policyResult->finalResult);
 				KSI_LOG_debug(context->ctx, "Rule result: 0x%x 0x%x 0x%x %s %s",
 							  res,
 							  policyResult->finalResult.resultCode,
@@ -573,6 +678,38 @@ cleanup:
 	return res;
 }
 
+static void PolicyVerificationResult_reset(KSI_PolicyVerificationResult *result) {
+	result->resultCode = KSI_VER_RES_NA;
+	result->finalResult.resultCode = KSI_VER_RES_NA;
+	result->finalResult.errorCode = KSI_VER_ERR_GEN_2;
+	result->finalResult.ruleName = NULL;
+	result->finalResult.policyName = NULL;
+	result->finalResult.stepsPerformed = KSI_VERIFY_NONE;
+	result->finalResult.stepsFailed = KSI_VERIFY_NONE;
+	result->finalResult.stepsSuccessful = KSI_VERIFY_NONE;
+}
+
+/* Remembers the signature as the last failed one until the verification succeeds. */
+static void LastFailedSignature_begin(KSI_CTX *ctx, KSI_Signature *sig) {
+	KSI_Signature_free(ctx->lastFailedSignature);
+	ctx->lastFailedSignature = KSI_Signature_ref(sig);
+	if (ctx->lastFailedSignature != NULL) {
+		KSI_PolicyVerificationResult_free(ctx->lastFailedSignature->policyVerificationResult);
+		ctx->lastFailedSignature->policyVerificationResult = NULL;
+	}
+}
+
+static void LastFailedSignature_end(KSI_CTX *ctx, KSI_PolicyVerificationResult *result) {
+	if (result->finalResult.resultCode != KSI_VER_RES_OK) {
+		if (ctx->lastFailedSignature != NULL) {
+			ctx->lastFailedSignature->policyVerificationResult = KSI_PolicyVerificationResult_ref(result);
+		}
+	} else {
+		KSI_Signature_free(ctx->lastFailedSignature);
+		ctx->lastFailedSignature = NULL;
+	}
+}
+
 static int PolicyVerificationResult_addLatestPolicyResult(KSI_PolicyVerificationResult *result) {
 	int res = KSI_UNKNOWN_ERROR;
 	KSI_RuleVerificationResult *tmp = NULL;
@@ -650,6 +787,7 @@ int KSI_SignatureVerifier_verify(const KSI_Policy *policy, KSI_VerificationConte
 	tempData.aggregationOutputHash = NULL;
 	tempData.calendarChain = NULL;
 	tempData.publicationsFile = NULL;
+	tempData.ruleMemo_count = 0;
 
 	if (policy == NULL || context == NULL || context->ctx == NULL || result == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -662,12 +800,7 @@ int KSI_SignatureVerifier_verify(const KSI_Policy *policy, KSI_VerificationConte
 	ctx = context->ctx;
 	KSI_ERR_clearErrors(ctx);
 
-	KSI_Signature_free(ctx->lastFailedSignature);
-	ctx->lastFailedSignature = KSI_Signature_ref(context->signature);
-	if (ctx->lastFailedSignature != NULL) {
-		KSI_PolicyVerificationResult_free(ctx->lastFailedSignature->policyVerificationResult);
-		ctx->lastFailedSignature->policyVerificationResult = NULL;
-	}
+	LastFailedSignature_begin(ctx, context->signature);
 
 	res = PolicyVerificationResult_create(&tmp);
 	if (res != KSI_OK) {
@@ -675,17 +808,15 @@ int KSI_SignatureVerifier_verify(const KSI_Policy *policy, KSI_VerificationConte
 		goto cleanup;
 	}
 
-	tmp->resultCode = KSI_VER_RES_NA;
-	tmp->finalResult.resultCode = KSI_VER_RES_NA;
-	tmp->finalResult.errorCode = KSI_VER_ERR_GEN_2;
-	tmp->finalResult.stepsPerformed = KSI_VERIFY_NONE;
-	tmp->finalResult.stepsFailed = KSI_VERIFY_NONE;
-	tmp->finalResult.stepsSuccessful = KSI_VERIFY_NONE;
+	PolicyVerificationResult_reset(tmp);
 
 	currentPolicy = policy;
 	while (currentPolicy != NULL) {
+		KSI_uint64_t traceBegin = KSI_VerificationTrace_begin(ctx);
+
 		tmp->finalResult.policyName = currentPolicy->policyName;
 		res = Policy_verifySignature(currentPolicy, context, tmp);
+		KSI_VerificationTrace_endPolicy(ctx, currentPolicy->policyName, traceBegin, res, tmp->finalResult.resultCode, &tempData.traceTotals);
 		if (res != KSI_OK) {
 			/* Stop verifying the policy whenever there is an internal error (invalid arguments, out of memory, etc). */
 			KSI_pushError(ctx, res, NULL);
@@ -701,7 +832,10 @@ int KSI_SignatureVerifier_verify(const KSI_Policy *policy, KSI_VerificationConte
 		if (tmp->finalResult.resultCode != KSI_VER_RES_OK) {
 			currentPolicy = currentPolicy->fallbackPolicy;
 			if (currentPolicy != NULL) {
-				VerificationTempData_clear(context->tempData);
+				/* The extended calendar chain depends on the policy, the rest of the
+				 * temporary data is derived from the signature and is kept. */
+				KSI_CalendarHashChain_free(tempData.calendarChain);
+				tempData.calendarChain = NULL;
 				KSI_LOG_debug(ctx, "Verifying fallback policy.");
 			}
 		} else {
@@ -709,20 +843,429 @@ int KSI_SignatureVerifier_verify(const KSI_Policy *policy, KSI_VerificationConte
 		}
 	}
 
-	if (tmp->finalResult.resultCode != KSI_VER_RES_OK) {
-		if (ctx->lastFailedSignature != NULL) {
-			ctx->lastFailedSignature->policyVerificationResult = KSI_PolicyVerificationResult_ref(tmp);
-		}
+	LastFailedSignature_end(ctx, tmp);
+
+	*result = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	VerificationTempData_clear(&tempData);
+	if (context != NULL) {
+		context->tempData = NULL;
+	}
+
+	KSI_PolicyVerificationResult_free(tmp);
+	return res;
+}
+
+/****************************
+ * COMPILED POLICIES
+ ****************************/
+
+/* Number of compiled rules for a single element of a rule list. */
+static size_t countCompiledRules(const KSI_Rule *rule);
+
+static size_t countCompiledRuleList(const KSI_Rule *rules) {
+	size_t count = 0;
+
+	while (rules->rule != NULL) {
+		count += countCompiledRules(rules);
+		rules++;
+	}
+
+	return count;
+}
+
+static size_t countCompiledRules(const KSI_Rule *rule) {
+	size_t count;
+
+	if (rule->type == KSI_RULE_TYPE_BASIC) return 1;
+
+	count = countCompiledRuleList((const KSI_Rule *)rule->rule);
+	/* An empty composite rule is compiled into a placeholder. */
+	return count > 0 ? count : 1;
+}
+
+/* A rule list being compiled, the parents form the path from the policy root. */
+typedef struct CompileFrame_st CompileFrame;
+struct CompileFrame_st {
+	const KSI_Rule *rules;
+	/* Index of the first compiled rule of the list. */
+	size_t start;
+	const CompileFrame *parent;
+	/* Position of the list in the parent list. */
+	size_t parentPos;
+};
+
+static size_t resultIndex(KSI_VerificationResultCode code) {
+	switch (code) {
+		case KSI_VER_RES_OK: return 0;
+		case KSI_VER_RES_FAIL: return 2;
+		default: return 1;
+	}
+}
+
+static size_t firstCompiledRule(const CompileFrame *frame, size_t pos) {
+	size_t index = frame->start;
+	size_t i;
+
+	for (i = 0; i < pos; i++) {
+		index += countCompiledRules(&frame->rules[i]);
+	}
+
+	return index;
+}
+
+/* Index of the rule verified after the rule at \c pos has finished with \c code.
+ * Mirrors the short-circuit logic of #Rule_verify. */
+static size_t nextCompiledRule(const CompileFrame *frame, size_t pos, KSI_VerificationResultCode code) {
+	KSI_RuleType type = frame->rules[pos].type;
+	int listDone;
+
+	if (code == KSI_VER_RES_FAIL) {
+		listDone = 1;
+	} else if (code == KSI_VER_RES_OK) {
+		listDone = (type == KSI_RULE_TYPE_COMPOSITE_OR);
 	} else {
-		KSI_Signature_free(ctx->lastFailedSignature);
-		ctx->lastFailedSignature = NULL;
+		listDone = (type == KSI_RULE_TYPE_BASIC || type == KSI_RULE_TYPE_COMPOSITE_AND);
+	}
+
+	if (!listDone && frame->rules[pos + 1].rule != NULL) {
+		return firstCompiledRule(frame, pos + 1);
 	}
 
+	/* The result of the list is the result of its last verified rule. */
+	if (frame->parent == NULL) return KSI_COMPILED_RULE_END;
+	return nextCompiledRule(frame->parent, frame->parentPos, code);
+}
+
+static void compileRuleList(CompiledRule *compiled, const CompileFrame *frame) {
+	size_t pos;
+
+	for (pos = 0; frame->rules[pos].rule != NULL; pos++) {
+		const KSI_Rule *rule = &frame->rules[pos];
+		size_t index = firstCompiledRule(frame, pos);
+
+		if (rule->type != KSI_RULE_TYPE_BASIC && ((const KSI_Rule *)rule->rule)->rule != NULL) {
+			CompileFrame child;
+
+			child.rules = (const KSI_Rule *)rule->rule;
+			child.start = index;
+			child.parent = frame;
+			child.parentPos = pos;
+
+			compileRuleList(compiled, &child);
+		} else {
+			compiled[index].rule = (rule->type == KSI_RULE_TYPE_BASIC) ? (Verifier)rule->rule : NULL;
+			compiled[index].next[resultIndex(KSI_VER_RES_OK)] = nextCompiledRule(frame, pos, KSI_VER_RES_OK);
+			compiled[index].next[resultIndex(KSI_VER_RES_NA)] = nextCompiledRule(frame, pos, KSI_VER_RES_NA);
+			compiled[index].next[resultIndex(KSI_VER_RES_FAIL)] = nextCompiledRule(frame, pos, KSI_VER_RES_FAIL);
+		}
+	}
+}
+
+/* Creates a result whose rule and policy results are stored in the same memory
+ * block, so filling it does not allocate. The lists do not own the elements. */
+static int PolicyVerificationResult_createPreallocated(size_t rules_len, size_t policies_len, KSI_PolicyVerificationResult **result) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_PolicyVerificationResult *tmp = NULL;
+	KSI_RuleVerificationResult *buf = NULL;
+	KSI_RuleVerificationResult *el = NULL;
+	size_t i;
+
+	tmp = KSI_malloc(sizeof(KSI_PolicyVerificationResult) + (rules_len + policies_len) * sizeof(KSI_RuleVerificationResult));
+	if (tmp == NULL) {
+		res = KSI_OUT_OF_MEMORY;
+		goto cleanup;
+	}
+
+	tmp->ref = 1;
+	tmp->ruleResults = NULL;
+	tmp->policyResults = NULL;
+
+	res = KSI_List_new(NULL, (KSI_List **)&tmp->ruleResults);
+	if (res != KSI_OK) goto cleanup;
+
+	res = KSI_List_new(NULL, (KSI_List **)&tmp->policyResults);
+	if (res != KSI_OK) goto cleanup;
+
+	/* Reserve the capacity of the lists. */
+	buf = (KSI_RuleVerificationResult *)(tmp + 1);
+	for (i = 0; i < rules_len; i++) {
+		res = KSI_RuleVerificationResultList_append(tmp->ruleResults, &buf[i]);
+		if (res != KSI_OK) goto cleanup;
+	}
+	for (i = 0; i < policies_len; i++) {
+		res = KSI_RuleVerificationResultList_append(tmp->policyResults, &buf[rules_len + i]);
+		if (res != KSI_OK) goto cleanup;
+	}
+	while (KSI_RuleVerificationResultList_length(tmp->ruleResults) > 0) {
+		res = KSI_RuleVerificationResultList_remove(tmp->ruleResults, KSI_RuleVerificationResultList_length(tmp->ruleResults) - 1, &el);
+		if (res != KSI_OK) goto cleanup;
+	}
+	while (KSI_RuleVerificationResultList_length(tmp->policyResults) > 0) {
+		res = KSI_RuleVerificationResultList_remove(tmp->policyResults, KSI_RuleVerificationResultList_length(tmp->policyResults) - 1, &el);
+		if (res != KSI_OK) goto cleanup;
+	}
+
+	PolicyVerificationResult_reset(tmp);
+
 	*result = tmp;
 	tmp = NULL;
 
 	res = KSI_OK;
 
+cleanup:
+
+	KSI_PolicyVerificationResult_free(tmp);
+
+	return res;
+}
+
+int KSI_Policy_compile(KSI_CTX *ctx, const KSI_Policy *policy, KSI_CompiledPolicy **compiled) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_CompiledPolicy *tmp = NULL;
+	const KSI_Policy *current = NULL;
+	size_t i;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || policy == NULL || compiled == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	tmp = KSI_new(KSI_CompiledPolicy);
+	if (tmp == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	tmp->ctx = ctx;
+	tmp->rules = NULL;
+	tmp->rules_len = 0;
+	tmp->policyStart = NULL;
+	tmp->policyNames = NULL;
+	tmp->policies_len = 0;
+	tmp->result = NULL;
+
+	for (current = policy; current != NULL; current = current->fallbackPolicy) {
+		const KSI_Policy *prev = NULL;
+
+		if (current->rules == NULL) {
+			KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, "Policy without rules.");
+			goto cleanup;
+		}
+
+		/* The interpreter would loop forever, refuse to compile such a chain. */
+		for (prev = policy; prev != current->fallbackPolicy && prev != current; prev = prev->fallbackPolicy);
+		if (prev == current->fallbackPolicy) {
+			KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, "Fallback policies form a cycle.");
+			goto cleanup;
+		}
+
+		tmp->rules_len += countCompiledRuleList(current->rules);
+		tmp->policies_len++;
+	}
+
+	tmp->rules = KSI_calloc(tmp->rules_len > 0 ? tmp->rules_len : 1, sizeof(CompiledRule));
+	tmp->policyStart = KSI_calloc(tmp->policies_len, sizeof(size_t));
+	tmp->policyNames = KSI_calloc(tmp->policies_len, sizeof(const char *));
+	if (tmp->rules == NULL || tmp->policyStart == NULL || tmp->policyNames == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	tmp->rules_len = 0;
+	for (current = policy, i = 0; current != NULL; current = current->fallbackPolicy, i++) {
+		CompileFrame root;
+		size_t count = countCompiledRuleList(current->rules);
+
+		root.rules = current->rules;
+		root.start = tmp->rules_len;
+		root.parent = NULL;
+		root.parentPos = 0;
+
+		compileRuleList(tmp->rules, &root);
+
+		tmp->policyStart[i] = count > 0 ? tmp->rules_len : KSI_COMPILED_RULE_END;
+		tmp->policyNames[i] = current->policyName;
+		tmp->rules_len += count;
+	}
+
+	res = PolicyVerificationResult_createPreallocated(tmp->rules_len, tmp->policies_len, &tmp->result);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	*compiled = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_CompiledPolicy_free(tmp);
+
+	return res;
+}
+
+static int CompiledPolicy_addResult(KSI_RuleVerificationResultList *list, KSI_RuleVerificationResult *buf, size_t buf_len, const KSI_RuleVerificationResult *value) {
+	size_t len = KSI_RuleVerificationResultList_length(list);
+
+	if (len >= buf_len) return KSI_INVALID_STATE;
+
+	buf[len] = *value;
+	return KSI_RuleVerificationResultList_append(list, &buf[len]);
+}
+
+/* Prepares the result buffer for the next verification. */
+static int CompiledPolicy_prepareResult(KSI_CompiledPolicy *compiled) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_PolicyVerificationResult *tmp = NULL;
+	KSI_RuleVerificationResult *el = NULL;
+
+	if (compiled->result->ref > 1) {
+		/* The previous result is still in use, it may not be overwritten. */
+		res = PolicyVerificationResult_createPreallocated(compiled->rules_len, compiled->policies_len, &tmp);
+		if (res != KSI_OK) goto cleanup;
+
+		KSI_PolicyVerificationResult_free(compiled->result);
+		compiled->result = tmp;
+		tmp = NULL;
+	} else {
+		while (KSI_RuleVerificationResultList_length(compiled->result->ruleResults) > 0) {
+			res = KSI_RuleVerificationResultList_remove(compiled->result->ruleResults, KSI_RuleVerificationResultList_length(compiled->result->ruleResults) - 1, &el);
+			if (res != KSI_OK) goto cleanup;
+		}
+		while (KSI_RuleVerificationResultList_length(compiled->result->policyResults) > 0) {
+			res = KSI_RuleVerificationResultList_remove(compiled->result->policyResults, KSI_RuleVerificationResultList_length(compiled->result->policyResults) - 1, &el);
+			if (res != KSI_OK) goto cleanup;
+		}
+		PolicyVerificationResult_reset(compiled->result);
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_PolicyVerificationResult_free(tmp);
+
+	return res;
+}
+
+static int CompiledPolicy_verifyRules(const KSI_CompiledPolicy *compiled, size_t index, KSI_VerificationContext *context, KSI_PolicyVerificationResult *policyResult) {
+	int res = KSI_OK;
+	KSI_RuleVerificationResult *buf = (KSI_RuleVerificationResult *)(policyResult + 1);
+
+	while (index != KSI_COMPILED_RULE_END) {
+		const CompiledRule *rule = &compiled->rules[index];
+
+		policyResult->finalResult.resultCode = KSI_VER_RES_NA;
+		policyResult->finalResult.errorCode = KSI_VER_ERR_GEN_2;
+		if (rule->rule != NULL) {
+			res = Rule_verifyBasic(rule->rule, context, &policyResult->finalResult);
+			KSI_LOG_debug(context->ctx, "Rule result: 0x%x 0x%x 0x%x %s %s",
+						  res,
+						  policyResult->finalResult.resultCode,
+						  policyResult->finalResult.errorCode,
+						  policyResult->finalResult.ruleName,
+						  policyResult->finalResult.policyName);
+		}
+
+		/* Duplicate the value for ease of use. */
+		policyResult->resultCode = policyResult->finalResult.resultCode;
+
+		if (rule->rule != NULL && !(res == KSI_OK && policyResult->resultCode == KSI_VER_RES_NA)) {
+			if (!isDuplicateRuleResult(policyResult->ruleResults, &policyResult->finalResult)) {
+				int tmp = CompiledPolicy_addResult(policyResult->ruleResults, buf, compiled->rules_len, &policyResult->finalResult);
+				if (res == KSI_OK) res = tmp;
+			}
+		}
+
+		if (res != KSI_OK) break;
+
+		index = rule->next[resultIndex(policyResult->resultCode)];
+	}
+
+	return res;
+}
+
+int KSI_CompiledPolicy_verify(KSI_CompiledPolicy *compiled, KSI_VerificationContext *context, KSI_PolicyVerificationResult **result) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_CTX *ctx = NULL;
+	KSI_PolicyVerificationResult *tmp = NULL;
+	VerificationTempData tempData;
+	size_t i;
+
+	memset(&tempData, 0, sizeof(tempData));
+	tempData.aggregationOutputHash = NULL;
+	tempData.calendarChain = NULL;
+	tempData.publicationsFile = NULL;
+	tempData.ruleMemo_count = 0;
+
+	if (compiled == NULL || context == NULL || context->ctx == NULL || result == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	context->tempData = &tempData;
+
+	ctx = context->ctx;
+	KSI_ERR_clearErrors(ctx);
+
+	LastFailedSignature_begin(ctx, context->signature);
+
+	res = CompiledPolicy_prepareResult(compiled);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+	tmp = compiled->result;
+
+	for (i = 0; i < compiled->policies_len; i++) {
+		KSI_uint64_t traceBegin = KSI_VerificationTrace_begin(ctx);
+
+		tmp->finalResult.policyName = compiled->policyNames[i];
+		res = CompiledPolicy_verifyRules(compiled, compiled->policyStart[i], context, tmp);
+		KSI_VerificationTrace_endPolicy(ctx, compiled->policyNames[i], traceBegin, res, tmp->finalResult.resultCode, &tempData.traceTotals);
+		KSI_LOG_debug(ctx, "Policy result: 0x%x 0x%x 0x%x %s %s",
+					  res,
+					  tmp->finalResult.resultCode,
+					  tmp->finalResult.errorCode,
+					  tmp->finalResult.ruleName,
+					  tmp->finalResult.policyName);
+		if (res != KSI_OK) {
+			/* Stop verifying the policy whenever there is an internal error (invalid arguments, out of memory, etc). */
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = CompiledPolicy_addResult(tmp->policyResults, (KSI_RuleVerificationResult *)(tmp + 1) + compiled->rules_len, compiled->policies_len, &tmp->finalResult);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+
+		if (tmp->finalResult.resultCode == KSI_VER_RES_OK) break;
+
+		if (i + 1 < compiled->policies_len) {
+			KSI_CalendarHashChain_free(tempData.calendarChain);
+			tempData.calendarChain = NULL;
+			KSI_LOG_debug(ctx, "Verifying fallback policy.");
+		}
+	}
+
+	LastFailedSignature_end(ctx, tmp);
+
+	*result = KSI_PolicyVerificationResult_ref(tmp);
+
+	res = KSI_OK;
+
 cleanup:
 
 	VerificationTempData_clear(&tempData);
@@ -730,10 +1273,19 @@ cleanup:
 		context->tempData = NULL;
 	}
 
-	KSI_PolicyVerificationResult_free(tmp);
 	return res;
 }
 
+void KSI_CompiledPolicy_free(KSI_CompiledPolicy *compiled) {
+	if (compiled != NULL) {
+		KSI_free(compiled->rules);
+		KSI_free(compiled->policyStart);
+		KSI_free(compiled->policyNames);
+		KSI_PolicyVerificationResult_free(compiled->result);
+		KSI_free(compiled);
+	}
+}
+
 void KSI_Policy_free(KSI_Policy *policy) {
 	KSI_free(policy);
 }
@@ -756,6 +1308,8 @@ static void VerificationTempData_clear(VerificationTempData *tmp) {
 
 		KSI_PublicationsFile_free(tmp->publicationsFile);
 		tmp->publicationsFile = NULL;
+
+		tmp->ruleMemo_count = 0;
 	}
 }
 
@@ -246,6 +246,40 @@ extern "C" {
 	 */
 	int KSI_SignatureVerifier_verify(const KSI_Policy *policy, KSI_VerificationContext *context, KSI_PolicyVerificationResult **result);
 
+	/**
+	 * Compiles \c policy together with its fallback policies. The composite rules are
+	 * resolved into a flat list of basic rules, each knowing the rule to be verified
+	 * next for every result code, and a buffer for the verification results is
+	 * allocated up front. The policies must not be modified or freed while the
+	 * compiled policy is in use.
+	 * \param[in]	ctx			KSI context.
+	 * \param[in]	policy		Policy to be compiled.
+	 * \param[out]	compiled	Pointer to the receiving pointer.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 * \see #KSI_CompiledPolicy_verify, #KSI_CompiledPolicy_free
+	 */
+	int KSI_Policy_compile(KSI_CTX *ctx, const KSI_Policy *policy, KSI_CompiledPolicy **compiled);
+
+	/**
+	 * Verifies a KSI signature (provided in \c context) according to a compiled policy.
+	 * The results are the same as with #KSI_SignatureVerifier_verify. The \c result object
+	 * is reused by the next verification with the same compiled policy, if the caller has
+	 * released it with #KSI_PolicyVerificationResult_free by then. Otherwise a new buffer
+	 * is allocated.
+	 * \param[in]	compiled	Compiled policy.
+	 * \param[in]	context		Context for verifying the policy.
+	 * \param[out]	result		List of verification results.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 * \see #KSI_Policy_compile, #KSI_PolicyVerificationResult_free
+	 */
+	int KSI_CompiledPolicy_verify(KSI_CompiledPolicy *compiled, KSI_VerificationContext *context, KSI_PolicyVerificationResult **result);
+
+	/**
+	 * Frees the compiled policy.
+	 * \param[in]	compiled	Compiled policy.
+	 */
+	void KSI_CompiledPolicy_free(KSI_CompiledPolicy *compiled);
+
 	/**
 	 * Frees a user created or cloned #KSI_Policy object. Predefined policies cannot be freed.
 	 * The function does not free any potential fallback policy objects which the user must free separately.
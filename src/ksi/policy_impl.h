@@ -23,6 +23,7 @@
 #include "internal.h"
 #include "policy.h"
 #include "list.h"
+#include "metrics_impl.h"
 
 #ifdef	__cplusplus
 extern "C" {
@@ -36,6 +37,51 @@ struct KSI_Policy_st {
 	const char *policyName;
 };
 
+/** Marks the end of a compiled policy. */
+#define KSI_COMPILED_RULE_END ((size_t)-1)
+
+/**
+ * A basic rule of a compiled policy. The composite rules are resolved at compile
+ * time into the indices of the rules to be verified next.
+ */
+typedef struct CompiledRule_st {
+	/** The verifier, \c NULL for an empty composite rule. */
+	Verifier rule;
+
+	/** Index of the next rule for #KSI_VER_RES_OK, #KSI_VER_RES_NA and #KSI_VER_RES_FAIL. */
+	size_t next[3];
+} CompiledRule;
+
+struct KSI_CompiledPolicy_st {
+	KSI_CTX *ctx;
+
+	/** Compiled rules of all the policies in the fallback chain. */
+	CompiledRule *rules;
+	size_t rules_len;
+
+	/** Index of the first rule and the name of each policy in the fallback chain. */
+	size_t *policyStart;
+	const char **policyNames;
+	size_t policies_len;
+
+	/** Result buffer reused by consecutive verifications. */
+	KSI_PolicyVerificationResult *result;
+};
+
+/** Maximum number of rule results remembered during a single verification. */
+#define KSI_RULE_MEMO_SIZE 32
+
+typedef struct RuleResultMemo_st {
+	/** The verified rule. */
+	Verifier rule;
+
+	/** Return value of the rule. */
+	int res;
+
+	/** Result of the rule, the step bitmaps contain only the steps of this rule. */
+	KSI_RuleVerificationResult result;
+} RuleResultMemo;
+
 typedef struct VerificationTempData_st {
 
 	/** Temporary extended signature calendar hash chain. */
@@ -46,6 +92,16 @@ typedef struct VerificationTempData_st {
 
 	/** Signature aggregation output hash (calendar chain input hash) */
 	KSI_DataHash *aggregationOutputHash;
+
+	/** Results of the rules that depend only on the signature and document hash,
+	 * shared by all the policies of the fallback chain. */
+	RuleResultMemo ruleMemo[KSI_RULE_MEMO_SIZE];
+
+	/** Number of used elements in \c ruleMemo. */
+	size_t ruleMemo_count;
+
+	/** Time spent in the rules and fetches of the current policy, when tracing is enabled. */
+	KSI_VerificationTraceTotals traceTotals;
 } VerificationTempData;
 
 
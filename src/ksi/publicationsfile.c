@@ -59,10 +59,365 @@ struct generator_st {
 	size_t offset;
 	size_t sig_offset;
 	bool hasSignature;
+	/* When set, the publication records are added to #index instead of being parsed. */
+	bool lazy;
+	const unsigned char *base;
+	KSI_PublicationTimeEntry *index;
+	size_t index_len;
+	size_t index_size;
 };
 
 KSI_IMPLEMENT_REF(KSI_PublicationsFile);
 
+static int timeEntry_cmp(const void *a, const void *b) {
+	const KSI_PublicationTimeEntry *ea = a;
+	const KSI_PublicationTimeEntry *eb = b;
+
+	if (ea->time != eb->time) return ea->time < eb->time ? -1 : 1;
+	if (ea->pos != eb->pos) return ea->pos < eb->pos ? -1 : 1;
+	return 0;
+}
+
+/**
+ * Builds the time index of the publication records. Records without a publication
+ * time can not be found by time and are left out.
+ */
+static int buildTimeIndex(KSI_CTX *ctx, KSI_LIST(KSI_PublicationRecord) *list, KSI_PublicationTimeEntry **index, size_t *index_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_PublicationTimeEntry *tmp = NULL;
+	size_t len;
+	size_t count = 0;
+	size_t i;
+
+	len = KSI_PublicationRecordList_length(list);
+	if (len > 0) {
+		tmp = KSI_calloc(len, sizeof(KSI_PublicationTimeEntry));
+		if (tmp == NULL) {
+			KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+			goto cleanup;
+		}
+
+		for (i = 0; i < len; i++) {
+			KSI_PublicationRecord *pr = NULL;
+
+			res = KSI_PublicationRecordList_elementAt(list, i, &pr);
+			if (res != KSI_OK || pr == NULL) {
+				KSI_pushError(ctx, res != KSI_OK ? res : (res = KSI_INVALID_STATE), NULL);
+				goto cleanup;
+			}
+
+			if (pr->publishedData == NULL || pr->publishedData->time == NULL) continue;
+
+			tmp[count].time = KSI_Integer_getUInt64(pr->publishedData->time);
+			tmp[count].pos = i;
+			tmp[count].rec = pr;
+			count++;
+		}
+
+		qsort(tmp, count, sizeof(KSI_PublicationTimeEntry), timeEntry_cmp);
+	}
+
+	*index = tmp;
+	*index_len = count;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
+}
+
+/**
+ * Returns the time index of the publications file. When the publications list
+ * has been changed after the index was built, a temporary index is built into
+ * \c tmp which must be freed by the caller.
+ */
+static int getTimeIndex(const KSI_PublicationsFile *pubFile, const KSI_PublicationTimeEntry **index, size_t *index_len, KSI_PublicationTimeEntry **tmp) {
+	int res = KSI_UNKNOWN_ERROR;
+
+	/* A lazily loaded file has no list until it is requested. */
+	if ((pubFile->lazy && pubFile->publications == NULL) ||
+			(pubFile->timeIndex != NULL && KSI_List_getGeneration((KSI_List *)pubFile->publications) == pubFile->timeIndex_gen)) {
+		*index = pubFile->timeIndex;
+		*index_len = pubFile->timeIndex_len;
+	} else {
+		res = buildTimeIndex(pubFile->ctx, pubFile->publications, tmp, index_len);
+		if (res != KSI_OK) goto cleanup;
+		*index = *tmp;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+static size_t certIdHash(const KSI_OctetString *id, size_t mask) {
+	const unsigned char *raw = NULL;
+	size_t raw_len = 0;
+
+	KSI_OctetString_extract(id, &raw, &raw_len);
+	return (size_t)KSI_crc32(raw, raw_len, 0) & mask;
+}
+
+static int buildCertIndex(KSI_CTX *ctx, KSI_LIST(KSI_CertificateRecord) *list, KSI_CertificateIdEntry **index, size_t *index_size) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_CertificateIdEntry *tmp = NULL;
+	size_t len;
+	size_t size = 0;
+	size_t i;
+
+	len = KSI_CertificateRecordList_length(list);
+	if (len > 0) {
+		/* Keep the load factor at or below one half. */
+		size = 4;
+		while (size < 2 * len) size <<= 1;
+
+		tmp = KSI_calloc(size, sizeof(KSI_CertificateIdEntry));
+		if (tmp == NULL) {
+			KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+			goto cleanup;
+		}
+
+		for (i = 0; i < len; i++) {
+			KSI_CertificateRecord *certRec = NULL;
+			KSI_OctetString *cId = NULL;
+			KSI_PKICertificate *cert = NULL;
+			size_t pos;
+
+			res = KSI_CertificateRecordList_elementAt(list, i, &certRec);
+			if (res != KSI_OK) {
+				KSI_pushError(ctx, res, NULL);
+				goto cleanup;
+			}
+
+			res = KSI_CertificateRecord_getCertId(certRec, &cId);
+			if (res != KSI_OK) {
+				KSI_pushError(ctx, res, NULL);
+				goto cleanup;
+			}
+
+			if (cId == NULL) continue;
+
+			res = KSI_CertificateRecord_getCert(certRec, &cert);
+			if (res != KSI_OK) {
+				KSI_pushError(ctx, res, NULL);
+				goto cleanup;
+			}
+
+			/* On duplicate ids the first record wins, as with a linear search. */
+			for (pos = certIdHash(cId, size - 1); tmp[pos].id != NULL; pos = (pos + 1) & (size - 1)) {
+				if (KSI_OctetString_equals(tmp[pos].id, cId)) break;
+			}
+
+			if (tmp[pos].id == NULL) {
+				tmp[pos].id = cId;
+				tmp[pos].cert = cert;
+			}
+		}
+	}
+
+	*index = tmp;
+	*index_size = size;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
+}
+
+/**
+ * Returns the position of the first entry with time not less than \c time.
+ */
+static size_t timeIndex_lowerBound(const KSI_PublicationTimeEntry *index, size_t index_len, KSI_uint64_t time) {
+	size_t lo = 0;
+	size_t hi = index_len;
+
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		if (index[mid].time < time) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	return lo;
+}
+
+/**
+ * Returns the record of the index entry. The records of lazily loaded files are
+ * decoded on first use and kept in the index. The object is logically constant,
+ * but modified without locking, see #KSI_PublicationsFile_mapFile.
+ */
+static int getEntryRecord(const KSI_PublicationsFile *pubFile, const KSI_PublicationTimeEntry *entry, KSI_PublicationRecord **rec) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_TLV *tlv = NULL;
+	KSI_PublicationRecord *tmp = NULL;
+
+	if (entry->rec == NULL && pubFile->lazy) {
+		/* The TLV refers to the raw file, the template copies the values. */
+		res = KSI_TLV_parseBlob2(pubFile->ctx, (unsigned char *)pubFile->raw + entry->offset, entry->len, 0, &tlv);
+		if (res != KSI_OK) {
+			KSI_pushError(pubFile->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = KSI_PublicationRecord_new(pubFile->ctx, &tmp);
+		if (res != KSI_OK) {
+			KSI_pushError(pubFile->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = KSI_TlvTemplate_extract(pubFile->ctx, tmp, tlv, KSI_TLV_TEMPLATE(KSI_PublicationRecord));
+		if (res != KSI_OK) {
+			KSI_pushError(pubFile->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		((KSI_PublicationTimeEntry *)entry)->rec = tmp;
+		tmp = NULL;
+	}
+
+	*rec = entry->rec;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_PublicationRecord_free(tmp);
+	KSI_TLV_free(tlv);
+
+	return res;
+}
+
+static bool entryImprintEquals(const KSI_PublicationsFile *pubFile, const KSI_PublicationTimeEntry *entry, const KSI_DataHash *imprint) {
+	const unsigned char *raw = NULL;
+	size_t raw_len = 0;
+
+	if (entry->rec != NULL) {
+		return KSI_DataHash_equals(entry->rec->publishedData->imprint, imprint);
+	}
+
+	/* Compare the encoded imprint without decoding the record. */
+	if (KSI_DataHash_getImprint(imprint, &raw, &raw_len) != KSI_OK) return false;
+
+	return raw_len == entry->imprint_len && !memcmp(pubFile->raw + entry->imprintOffset, raw, raw_len);
+}
+
+/**
+ * Adds the publication record at the generator position to the index. Only the
+ * publication time and the location of the imprint are extracted.
+ */
+static int indexPublicationRecord(struct generator_st *gen, const KSI_FTLV *ftlv) {
+	int res = KSI_UNKNOWN_ERROR;
+	const unsigned char *ptr = gen->ptr + ftlv->hdr_len;
+	size_t len = ftlv->dat_len;
+	const unsigned char *pubData = NULL;
+	size_t pubData_len = 0;
+	KSI_PublicationTimeEntry *entry = NULL;
+	KSI_FTLV sub;
+	bool hasTime = false;
+	bool hasImprint = false;
+	size_t i;
+
+	if (gen->index_len == gen->index_size) {
+		size_t size = gen->index_size > 0 ? 2 * gen->index_size : 64;
+		KSI_PublicationTimeEntry *tmp = NULL;
+
+		tmp = KSI_calloc(size, sizeof(KSI_PublicationTimeEntry));
+		if (tmp == NULL) {
+			KSI_pushError(gen->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+			goto cleanup;
+		}
+
+		if (gen->index_len > 0) memcpy(tmp, gen->index, gen->index_len * sizeof(KSI_PublicationTimeEntry));
+
+		KSI_free(gen->index);
+		gen->index = tmp;
+		gen->index_size = size;
+	}
+
+	entry = &gen->index[gen->index_len];
+	memset(entry, 0, sizeof(KSI_PublicationTimeEntry));
+
+	/* Find the published data. */
+	while (len > 0) {
+		res = KSI_FTLV_memRead(ptr, len, &sub);
+		if (res != KSI_OK) {
+			KSI_pushError(gen->ctx, res = KSI_INVALID_FORMAT, "Unable to read publication record.");
+			goto cleanup;
+		}
+
+		if (sub.tag == 0x10) {
+			pubData = ptr + sub.hdr_len;
+			pubData_len = sub.dat_len;
+		}
+
+		ptr += sub.hdr_len + sub.dat_len;
+		len -= sub.hdr_len + sub.dat_len;
+	}
+
+	if (pubData == NULL) {
+		KSI_pushError(gen->ctx, res = KSI_INVALID_FORMAT, "Publication record without published data.");
+		goto cleanup;
+	}
+
+	while (pubData_len > 0) {
+		res = KSI_FTLV_memRead(pubData, pubData_len, &sub);
+		if (res != KSI_OK) {
+			KSI_pushError(gen->ctx, res = KSI_INVALID_FORMAT, "Unable to read published data.");
+			goto cleanup;
+		}
+
+		if (sub.tag == 0x02) {
+			if (sub.dat_len > 8) {
+				KSI_pushError(gen->ctx, res = KSI_INVALID_FORMAT, "Publication time too large.");
+				goto cleanup;
+			}
+
+			entry->time = 0;
+			for (i = 0; i < sub.dat_len; i++) {
+				entry->time = (entry->time << 8) | pubData[sub.hdr_len + i];
+			}
+			hasTime = true;
+		} else if (sub.tag == 0x04) {
+			entry->imprintOffset = (size_t)(pubData + sub.hdr_len - gen->base);
+			entry->imprint_len = sub.dat_len;
+			hasImprint = true;
+		}
+
+		pubData += sub.hdr_len + sub.dat_len;
+		pubData_len -= sub.hdr_len + sub.dat_len;
+	}
+
+	if (!hasTime || !hasImprint) {
+		KSI_pushError(gen->ctx, res = KSI_INVALID_FORMAT, "Published data without publication time or imprint.");
+		goto cleanup;
+	}
+
+	entry->pos = gen->index_len;
+	entry->offset = (size_t)(gen->ptr - gen->base);
+	entry->len = ftlv->hdr_len + ftlv->dat_len;
+	entry->rec = NULL;
+
+	gen->index_len++;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
 static int generateNextTlv(struct generator_st *gen, KSI_TLV **tlv) {
 	int res = KSI_UNKNOWN_ERROR;
 	unsigned char *buf = NULL;
@@ -81,7 +436,7 @@ static int generateNextTlv(struct generator_st *gen, KSI_TLV **tlv) {
 	}
 
 	/* Try to parse only when there is something left to parse. */
-	if (gen->len > 0) {
+	while (gen->len > 0) {
 		memset(&ftlv, 0, sizeof(ftlv));
 		res = KSI_FTLV_memRead(gen->ptr, gen->len, &ftlv);
 		if (res != KSI_OK) {
@@ -91,6 +446,32 @@ static int generateNextTlv(struct generator_st *gen, KSI_TLV **tlv) {
 
 		consumed = ftlv.hdr_len + ftlv.dat_len;
 
+		/* Make sure the buffer is not overflowing. */
+		if (consumed > UINT_MAX){
+			KSI_pushError(gen->ctx, res = KSI_INVALID_FORMAT, "Input too large.");
+			goto cleanup;
+		}
+
+		if (consumed > 0 && gen->hasSignature) {
+			/* The signature must be the last element. */
+			KSI_pushError(gen->ctx, res = KSI_INVALID_FORMAT, "The signature must be the last element.");
+			goto cleanup;
+		}
+
+		if (gen->lazy && ftlv.tag == 0x0703) {
+			res = indexPublicationRecord(gen, &ftlv);
+			if (res != KSI_OK) {
+				KSI_pushError(gen->ctx, res, NULL);
+				goto cleanup;
+			}
+
+			gen->ptr += consumed;
+			gen->len -= consumed;
+			gen->offset += consumed;
+			consumed = 0;
+			continue;
+		}
+
 		buf = KSI_malloc(consumed);
 		if (buf == NULL) {
 			KSI_pushError(gen->ctx, res = KSI_OUT_OF_MEMORY, NULL);
@@ -102,19 +483,7 @@ static int generateNextTlv(struct generator_st *gen, KSI_TLV **tlv) {
 		gen->ptr += consumed;
 		gen->len -= consumed;
 
-		/* Make sure the buffer is not overflowing. */
-		if (consumed > UINT_MAX){
-			KSI_pushError(gen->ctx, res = KSI_INVALID_FORMAT, "Input too large.");
-			goto cleanup;
-		}
-
 		if (consumed > 0) {
-			if (gen->hasSignature) {
-				/* The signature must be the last element. */
-				KSI_pushError(gen->ctx, res = KSI_INVALID_FORMAT, "The signature must be the last element.");
-				goto cleanup;
-			}
-
 			res = KSI_TLV_parseBlob2(gen->ctx, buf, (unsigned)consumed, 1, &gen->tlv);
 			if (res != KSI_OK) {
 				KSI_pushError(gen->ctx, res, NULL);
@@ -129,6 +498,7 @@ static int generateNextTlv(struct generator_st *gen, KSI_TLV **tlv) {
 			}
 		}
 
+		break;
 	}
 
 	gen->offset += consumed;
@@ -165,6 +535,14 @@ int KSI_PublicationsFile_new(KSI_CTX *ctx, KSI_PublicationsFile **t) {
 	tmp->publications = NULL;
 	tmp->signature = NULL;
 	tmp->certConstraints = NULL;
+	tmp->timeIndex = NULL;
+	tmp->timeIndex_len = 0;
+	tmp->timeIndex_gen = 0;
+	tmp->certIndex = NULL;
+	tmp->certIndex_size = 0;
+	tmp->certIndex_gen = 0;
+	tmp->mapped = false;
+	tmp->lazy = false;
 	*t = tmp;
 	tmp = NULL;
 	res = KSI_OK;
@@ -173,20 +551,16 @@ cleanup:
 	return res;
 }
 
-int KSI_PublicationsFile_parse(KSI_CTX *ctx, const void *raw, size_t raw_len, KSI_PublicationsFile **pubFile) {
+/**
+ * Parses the publications file without storing \c raw in it. With \c lazy set the
+ * publication records are only indexed and must be decoded from the same buffer.
+ */
+static int parsePublicationsFile(KSI_CTX *ctx, const unsigned char *raw, size_t raw_len, bool lazy, KSI_PublicationsFile **pubFile) {
 	int res;
 	KSI_PublicationsFile *tmp = NULL;
-	struct generator_st gen = {ctx, raw, raw_len, NULL, 0, 0, false};
-	unsigned char *tmpRaw = NULL;
+	struct generator_st gen = {ctx, raw, raw_len, NULL, 0, 0, false, lazy, raw, NULL, 0, 0};
 	const size_t hdrLen = strlen(PUB_FILE_HEADER_ID);
 
-	KSI_ERR_clearErrors(ctx);
-
-	if (ctx == NULL || raw == NULL || raw_len == 0 || pubFile == NULL) {
-		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
-		goto cleanup;
-	}
-
 	/* Check the header. */
 	if (gen.len < hdrLen || memcmp(gen.ptr, PUB_FILE_HEADER_ID, hdrLen)) {
 		KSI_pushError(ctx, res = KSI_INVALID_FORMAT, "Unrecognized header.");
@@ -213,8 +587,65 @@ int KSI_PublicationsFile_parse(KSI_CTX *ctx, const void *raw, size_t raw_len, KS
 		goto cleanup;
 	}
 
-	tmp->signedDataLength += gen.sig_offset;
-
+	tmp->signedDataLength += gen.sig_offset;
+
+	/* Index the publications by time for the lookup functions. */
+	if (lazy) {
+		if (gen.index_len > 0) qsort(gen.index, gen.index_len, sizeof(KSI_PublicationTimeEntry), timeEntry_cmp);
+
+		tmp->timeIndex = gen.index;
+		tmp->timeIndex_len = gen.index_len;
+		tmp->lazy = true;
+		gen.index = NULL;
+	} else {
+		res = buildTimeIndex(ctx, tmp->publications, &tmp->timeIndex, &tmp->timeIndex_len);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+		tmp->timeIndex_gen = KSI_List_getGeneration((KSI_List *)tmp->publications);
+	}
+
+	/* Index the certificates by id for #KSI_PublicationsFile_getPKICertificateById. */
+	res = buildCertIndex(ctx, tmp->certificates, &tmp->certIndex, &tmp->certIndex_size);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+	tmp->certIndex_gen = KSI_List_getGeneration((KSI_List *)tmp->certificates);
+
+	*pubFile = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(gen.index);
+	KSI_TLV_free(gen.tlv);
+	KSI_PublicationsFile_free(tmp);
+
+	return res;
+}
+
+int KSI_PublicationsFile_parse(KSI_CTX *ctx, const void *raw, size_t raw_len, KSI_PublicationsFile **pubFile) {
+	int res;
+	KSI_PublicationsFile *tmp = NULL;
+	unsigned char *tmpRaw = NULL;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || raw == NULL || raw_len == 0 || pubFile == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	res = parsePublicationsFile(ctx, raw, raw_len, false, &tmp);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
 	/* Copy the raw value */
 	tmpRaw = KSI_malloc(raw_len);
 	if (tmpRaw == NULL) {
@@ -236,7 +667,6 @@ cleanup:
 
 
 	KSI_free(tmpRaw);
-	KSI_TLV_free(gen.tlv);
 	KSI_PublicationsFile_free(tmp);
 
 	return res;
@@ -371,6 +801,73 @@ cleanup:
 	return res;
 }
 
+int KSI_PublicationsFile_mapFile(KSI_CTX *ctx, const char *fileName, KSI_PublicationsFile **pubFile) {
+	int res;
+	KSI_PublicationsFile *tmp = NULL;
+	const unsigned char *raw = NULL;
+	size_t raw_len = 0;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || fileName == NULL || pubFile == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_IO_mapFile(fileName, &raw, &raw_len);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, "Unable to map publications file.");
+		goto cleanup;
+	}
+
+	res = parsePublicationsFile(ctx, raw, raw_len, true, &tmp);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	tmp->raw = (unsigned char *)raw;
+	tmp->raw_len = raw_len;
+	tmp->mapped = true;
+	raw = NULL;
+
+	*pubFile = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_IO_unmapFile(raw, raw_len);
+	KSI_PublicationsFile_free(tmp);
+
+	return res;
+}
+
+/* Releases the raw file and any records decoded from it. */
+static void freeRaw(KSI_PublicationsFile *pubFile) {
+	if (pubFile->mapped) {
+		KSI_IO_unmapFile(pubFile->raw, pubFile->raw_len);
+	} else {
+		KSI_free(pubFile->raw);
+	}
+	pubFile->raw = NULL;
+	pubFile->raw_len = 0;
+	pubFile->mapped = false;
+}
+
+static void freeLazyRecords(KSI_PublicationsFile *pubFile) {
+	size_t i;
+
+	if (!pubFile->lazy) return;
+
+	for (i = 0; i < pubFile->timeIndex_len; i++) {
+		KSI_PublicationRecord_free(pubFile->timeIndex[i].rec);
+		pubFile->timeIndex[i].rec = NULL;
+	}
+	pubFile->lazy = false;
+}
+
 static int publicationsFileTLV_getSignatureTLVLength(KSI_TLV *pubFileTlv, size_t *len) {
 	int res;
 	KSI_TLVList *list = NULL;
@@ -483,7 +980,7 @@ int KSI_PublicationsFile_serialize(KSI_CTX *ctx, KSI_PublicationsFile *pubFile,
 
 	memcpy(tmp + sizeof(PUB_FILE_HEADER_ID) - 1, buf, buf_len);
 
-	if (pubFile->raw != NULL) KSI_free(pubFile->raw);
+	freeRaw(pubFile);
 	pubFile->raw = tmp;
 	pubFile->raw_len = tmp_len;
 	pubFile->signedDataLength = tmp_len - sig_len;
@@ -515,7 +1012,10 @@ void KSI_PublicationsFile_free(KSI_PublicationsFile *t) {
 		KSI_CertificateRecordList_free(t->certificates);
 		KSI_PublicationRecordList_free(t->publications);
 		KSI_PKISignature_free(t->signature);
-		KSI_free(t->raw);
+		freeLazyRecords(t);
+		freeRaw(t);
+		KSI_free(t->timeIndex);
+		KSI_free(t->certIndex);
 		if(t->ctx->freeCertConstraintsArray != NULL) {
 			t->ctx->freeCertConstraintsArray(t->certConstraints);
 		}
@@ -525,16 +1025,105 @@ void KSI_PublicationsFile_free(KSI_PublicationsFile *t) {
 
 KSI_IMPLEMENT_GETTER(KSI_PublicationsFile, KSI_PublicationsHeader*, header, Header);
 KSI_IMPLEMENT_GETTER(KSI_PublicationsFile, KSI_LIST(KSI_CertificateRecord)*, certificates, Certificates);
-KSI_IMPLEMENT_GETTER(KSI_PublicationsFile, KSI_LIST(KSI_PublicationRecord)*, publications, Publications);
 KSI_IMPLEMENT_GETTER(KSI_PublicationsFile, KSI_PKISignature *, signature, Signature);
 KSI_IMPLEMENT_GETTER(KSI_PublicationsFile, size_t, signedDataLength, SignedDataLength);
 KSI_IMPLEMENT_GETTER(KSI_PublicationsFile, KSI_CertConstraint*, certConstraints, CertConstraints);
 
 KSI_IMPLEMENT_SETTER(KSI_PublicationsFile, KSI_PublicationsHeader*, header, Header);
-KSI_IMPLEMENT_SETTER(KSI_PublicationsFile, KSI_LIST(KSI_CertificateRecord)*, certificates, Certificates);
-KSI_IMPLEMENT_SETTER(KSI_PublicationsFile, KSI_LIST(KSI_PublicationRecord)*, publications, Publications);
 KSI_IMPLEMENT_SETTER(KSI_PublicationsFile, KSI_PKISignature *, signature, Signature);
 
+int KSI_PublicationsFile_setCertificates(KSI_PublicationsFile *o, KSI_LIST(KSI_CertificateRecord) *certificates) {
+	if (o == NULL) return KSI_INVALID_ARGUMENT;
+
+	/* The index refers to the records of the old list. */
+	KSI_free(o->certIndex);
+	o->certIndex = NULL;
+	o->certIndex_size = 0;
+	o->certIndex_gen = 0;
+
+	o->certificates = certificates;
+
+	return KSI_OK;
+}
+
+int KSI_PublicationsFile_getPublications(const KSI_PublicationsFile *o, KSI_LIST(KSI_PublicationRecord) **publications) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_LIST(KSI_PublicationRecord) *list = NULL;
+	const KSI_PublicationTimeEntry **order = NULL;
+	size_t i;
+
+	if (o == NULL || publications == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	/* Decode the records of a lazily loaded file in the file order. Not thread-safe,
+	 * see #KSI_PublicationsFile_mapFile. */
+	if (o->lazy && o->publications == NULL && o->timeIndex_len > 0) {
+		order = KSI_calloc(o->timeIndex_len, sizeof(KSI_PublicationTimeEntry *));
+		if (order == NULL) {
+			KSI_pushError(o->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+			goto cleanup;
+		}
+
+		for (i = 0; i < o->timeIndex_len; i++) {
+			order[o->timeIndex[i].pos] = &o->timeIndex[i];
+		}
+
+		res = KSI_PublicationRecordList_new(&list);
+		if (res != KSI_OK) {
+			KSI_pushError(o->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		for (i = 0; i < o->timeIndex_len; i++) {
+			KSI_PublicationRecord *rec = NULL;
+
+			res = getEntryRecord(o, order[i], &rec);
+			if (res != KSI_OK) {
+				KSI_pushError(o->ctx, res, NULL);
+				goto cleanup;
+			}
+
+			res = KSI_PublicationRecordList_append(list, KSI_PublicationRecord_ref(rec));
+			if (res != KSI_OK) {
+				KSI_PublicationRecord_free(rec);
+				KSI_pushError(o->ctx, res, NULL);
+				goto cleanup;
+			}
+		}
+
+		((KSI_PublicationsFile *)o)->publications = list;
+		((KSI_PublicationsFile *)o)->timeIndex_gen = KSI_List_getGeneration((KSI_List *)list);
+		list = NULL;
+	}
+
+	*publications = o->publications;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_PublicationRecordList_free(list);
+	KSI_free((void *)order);
+
+	return res;
+}
+
+int KSI_PublicationsFile_setPublications(KSI_PublicationsFile *o, KSI_LIST(KSI_PublicationRecord) *publications) {
+	if (o == NULL) return KSI_INVALID_ARGUMENT;
+
+	/* The index refers to the records of the old list. */
+	freeLazyRecords(o);
+	KSI_free(o->timeIndex);
+	o->timeIndex = NULL;
+	o->timeIndex_len = 0;
+
+	o->publications = publications;
+
+	return KSI_OK;
+}
+
 int KSI_PublicationsFile_getPKICertificateById(const KSI_PublicationsFile *pubFile, const KSI_OctetString *id, KSI_PKICertificate **cert) {
 	int res;
 	size_t i;
@@ -552,7 +1141,22 @@ int KSI_PublicationsFile_getPKICertificateById(const KSI_PublicationsFile *pubFi
 		goto cleanup;
 	}
 
+	if (pubFile->certIndex != NULL && KSI_List_getGeneration((KSI_List *)pubFile->certificates) == pubFile->certIndex_gen) {
+		size_t mask = pubFile->certIndex_size - 1;
+		size_t pos;
+
+		for (pos = certIdHash(id, mask); pubFile->certIndex[pos].id != NULL; pos = (pos + 1) & mask) {
+			if (KSI_OctetString_equals(pubFile->certIndex[pos].id, id)) {
+				*cert = pubFile->certIndex[pos].cert;
+				break;
+			}
+		}
+
+		res = KSI_OK;
+		goto cleanup;
+	}
 
+	/* The list has been changed after parsing. */
 	for (i = 0; i < KSI_CertificateRecordList_length(pubFile->certificates); i++) {
 		KSI_OctetString *cId = NULL;
 
@@ -590,8 +1194,11 @@ cleanup:
 
 int KSI_PublicationsFile_getPublicationDataByTime(const KSI_PublicationsFile *trust, const KSI_Integer *pubTime, KSI_PublicationRecord **pubRec) {
 	int res;
-	size_t i;
+	const KSI_PublicationTimeEntry *index = NULL;
+	size_t index_len = 0;
+	KSI_PublicationTimeEntry *tmpIndex = NULL;
 	KSI_PublicationRecord *result = NULL;
+	size_t i;
 
 	if (trust == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -605,36 +1212,20 @@ int KSI_PublicationsFile_getPublicationDataByTime(const KSI_PublicationsFile *tr
 		goto cleanup;
 	}
 
-	for (i = 0; i < KSI_PublicationRecordList_length(trust->publications); i++) {
-		KSI_PublicationRecord *pr = NULL;
-		KSI_PublicationData *pd = NULL;
-		KSI_Integer *tm = NULL;
-
-		res = KSI_PublicationRecordList_elementAt(trust->publications, i, &pr);
-		if (res != KSI_OK) {
-			KSI_pushError(trust->ctx, res, NULL);
-			goto cleanup;
-		}
-
-		res = KSI_PublicationRecord_getPublishedData(pr, &pd);
-		if (res != KSI_OK) {
-			KSI_pushError(trust->ctx, res, NULL);
-			goto cleanup;
-		}
+	res = getTimeIndex(trust, &index, &index_len, &tmpIndex);
+	if (res != KSI_OK) {
+		KSI_pushError(trust->ctx, res, NULL);
+		goto cleanup;
+	}
 
-		res = KSI_PublicationData_getTime(pd, &tm);
+	/* The first record with the given time in file order. */
+	i = timeIndex_lowerBound(index, index_len, KSI_Integer_getUInt64(pubTime));
+	if (i < index_len && index[i].time == KSI_Integer_getUInt64(pubTime)) {
+		res = getEntryRecord(trust, &index[i], &result);
 		if (res != KSI_OK) {
 			KSI_pushError(trust->ctx, res, NULL);
 			goto cleanup;
 		}
-
-		if (KSI_Integer_equals(pubTime, tm)) {
-			result = pr;
-			break;
-		}
-
-		KSI_nofree(tm);
-		KSI_nofree(pd);
 	}
 
 	*pubRec = result;
@@ -644,6 +1235,7 @@ int KSI_PublicationsFile_getPublicationDataByTime(const KSI_PublicationsFile *tr
 cleanup:
 
 	KSI_nofree(result);
+	KSI_free(tmpIndex);
 
 	return res;
 }
@@ -741,9 +1333,11 @@ cleanup:
  */
 int KSI_PublicationsFile_getNearestPublication(const KSI_PublicationsFile *trust, const KSI_Integer *pubTime, KSI_PublicationRecord **pubRec) {
 	int res;
-	size_t i;
+	const KSI_PublicationTimeEntry *index = NULL;
+	size_t index_len = 0;
+	KSI_PublicationTimeEntry *tmpIndex = NULL;
 	KSI_PublicationRecord *result = NULL;
-	KSI_Integer *result_tm = NULL;
+	size_t i;
 
 	if (trust == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -757,41 +1351,22 @@ int KSI_PublicationsFile_getNearestPublication(const KSI_PublicationsFile *trust
 		goto cleanup;
 	}
 
+	res = getTimeIndex(trust, &index, &index_len, &tmpIndex);
+	if (res != KSI_OK) {
+		KSI_pushError(trust->ctx, res, NULL);
+		goto cleanup;
+	}
 
-	for (i = 0; i < KSI_PublicationRecordList_length(trust->publications); i++) {
-		KSI_PublicationRecord *pr = NULL;
-		KSI_PublicationData *pd = NULL;
-		KSI_Integer *tm = NULL;
-
-		res = KSI_PublicationRecordList_elementAt(trust->publications, i, &pr);
-		if (res != KSI_OK) {
-			KSI_pushError(trust->ctx, res, NULL);
-			goto cleanup;
-		}
-
-		res = KSI_PublicationRecord_getPublishedData(pr, &pd);
-		if (res != KSI_OK) {
-			KSI_pushError(trust->ctx, res, NULL);
-			goto cleanup;
-		}
+	/* The earliest publication not before the given time; the last one of equal records. */
+	i = timeIndex_lowerBound(index, index_len, KSI_Integer_getUInt64(pubTime));
+	if (i < index_len) {
+		while (i + 1 < index_len && index[i + 1].time == index[i].time) i++;
 
-		res = KSI_PublicationData_getTime(pd, &tm);
+		res = getEntryRecord(trust, &index[i], &result);
 		if (res != KSI_OK) {
 			KSI_pushError(trust->ctx, res, NULL);
 			goto cleanup;
 		}
-
-		/* Check if current publication time is after given time. */
-		if (KSI_Integer_compare(pubTime, tm) <= 0) {
-			/* Check if current publication time is before the earliest so far. */
-			if (result_tm == NULL || KSI_Integer_compare(result_tm, tm) >= 0) {
-				result = pr;
-				result_tm = tm;
-			}
-		}
-
-		KSI_nofree(tm);
-		KSI_nofree(pd);
 	}
 
 	*pubRec = KSI_PublicationRecord_ref(result);
@@ -801,16 +1376,17 @@ int KSI_PublicationsFile_getNearestPublication(const KSI_PublicationsFile *trust
 cleanup:
 
 	KSI_nofree(result);
-	KSI_nofree(result_tm);
+	KSI_free(tmpIndex);
 
 	return res;
 }
 
 int KSI_PublicationsFile_getLatestPublication(const KSI_PublicationsFile *trust, const KSI_Integer *pubTime, KSI_PublicationRecord **pubRec) {
 	int res;
-	size_t i;
+	const KSI_PublicationTimeEntry *index = NULL;
+	size_t index_len = 0;
+	KSI_PublicationTimeEntry *tmpIndex = NULL;
 	KSI_PublicationRecord *result = NULL;
-	KSI_Integer *result_tm = NULL;
 
 	if (trust == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -824,41 +1400,19 @@ int KSI_PublicationsFile_getLatestPublication(const KSI_PublicationsFile *trust,
 		goto cleanup;
 	}
 
+	res = getTimeIndex(trust, &index, &index_len, &tmpIndex);
+	if (res != KSI_OK) {
+		KSI_pushError(trust->ctx, res, NULL);
+		goto cleanup;
+	}
 
-	for (i = 0; i < KSI_PublicationRecordList_length(trust->publications); i++) {
-		KSI_PublicationRecord *pr = NULL;
-		KSI_PublicationData *pd = NULL;
-		KSI_Integer *tm = NULL;
-
-		res = KSI_PublicationRecordList_elementAt(trust->publications, i, &pr);
-		if (res != KSI_OK) {
-			KSI_pushError(trust->ctx, res, NULL);
-			goto cleanup;
-		}
-
-		res = KSI_PublicationRecord_getPublishedData(pr, &pd);
-		if (res != KSI_OK) {
-			KSI_pushError(trust->ctx, res, NULL);
-			goto cleanup;
-		}
-
-		res = KSI_PublicationData_getTime(pd, &tm);
+	/* The last entry is the latest publication. */
+	if (index_len > 0 && (pubTime == NULL || index[index_len - 1].time >= KSI_Integer_getUInt64(pubTime))) {
+		res = getEntryRecord(trust, &index[index_len - 1], &result);
 		if (res != KSI_OK) {
 			KSI_pushError(trust->ctx, res, NULL);
 			goto cleanup;
 		}
-
-		/* Check if current publication time is after given time. */
-		if (pubTime == NULL || KSI_Integer_compare(pubTime, tm) <= 0) {
-			/* Check if current publication time is after the latest so far. */
-			if (result_tm == NULL || KSI_Integer_compare(result_tm, tm) <= 0) {
-				result = pr;
-				result_tm = tm;
-			}
-		}
-
-		KSI_nofree(tm);
-		KSI_nofree(pd);
 	}
 
 	*pubRec = result;
@@ -868,13 +1422,16 @@ int KSI_PublicationsFile_getLatestPublication(const KSI_PublicationsFile *trust,
 cleanup:
 
 	KSI_nofree(result);
-	KSI_nofree(result_tm);
+	KSI_free(tmpIndex);
 
 	return res;
 }
 
 static int findPublication(const KSI_PublicationsFile *trust, const KSI_Integer *time, const KSI_DataHash *imprint, KSI_PublicationRecord **outRec) {
 	int res;
+	const KSI_PublicationTimeEntry *index = NULL;
+	size_t index_len = 0;
+	KSI_PublicationTimeEntry *tmpIndex = NULL;
 	size_t i;
 
 	if (trust == NULL) {
@@ -889,33 +1446,35 @@ static int findPublication(const KSI_PublicationsFile *trust, const KSI_Integer
 		goto cleanup;
 	}
 
-	for (i = 0; i < KSI_PublicationRecordList_length(trust->publications); i++) {
+	res = getTimeIndex(trust, &index, &index_len, &tmpIndex);
+	if (res != KSI_OK) {
+		KSI_pushError(trust->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	for (i = timeIndex_lowerBound(index, index_len, KSI_Integer_getUInt64(time)); i < index_len && index[i].time == KSI_Integer_getUInt64(time); i++) {
 		KSI_PublicationRecord *pr = NULL;
 
-		res = KSI_PublicationRecordList_elementAt(trust->publications, i, &pr);
-		if (res != KSI_OK || pr == NULL) {
-			KSI_pushError(trust->ctx, res != KSI_OK ? res : (res = KSI_INVALID_STATE), NULL);
-			goto cleanup;
+		if (imprint != NULL && !entryImprintEquals(trust, &index[i], imprint)) {
+			continue;
 		}
 
-		if (pr->publishedData == NULL) {
-			KSI_pushError(trust->ctx, res = KSI_INVALID_STATE, NULL);
+		res = getEntryRecord(trust, &index[i], &pr);
+		if (res != KSI_OK) {
+			KSI_pushError(trust->ctx, res, NULL);
 			goto cleanup;
 		}
 
-		if (KSI_Integer_equals(pr->publishedData->time, time)) {
-			if (imprint != NULL && !KSI_DataHash_equals(pr->publishedData->imprint, imprint)) {
-				continue;
-			}
-			*outRec = KSI_PublicationRecord_ref(pr);
-			break;
-		}
+		*outRec = KSI_PublicationRecord_ref(pr);
+		break;
 	}
 
 	res = KSI_OK;
 
 cleanup:
 
+	KSI_free(tmpIndex);
+
 	return res;
 }
 
@@ -999,26 +1558,52 @@ cleanup:
 	return res;
 }
 
-int KSI_PublicationData_fromBase32(KSI_CTX *ctx, const char *publication, KSI_PublicationData **published_data) {
+static bool pubStrCache_find(KSI_CTX *ctx, const char *publication, KSI_Integer **pubTime, KSI_DataHash **pubHash) {
+	size_t i;
+
+	for (i = 0; i < KSI_PUBSTR_CACHE_SIZE; i++) {
+		KSI_PublicationStringCacheEntry *entry = &ctx->pubStrCache[i];
+
+		if (entry->pubStr != NULL && !strcmp(entry->pubStr, publication)) {
+			/* The values are immutable and thus can be shared. */
+			*pubTime = KSI_Integer_ref(entry->time);
+			*pubHash = KSI_DataHash_ref(entry->imprint);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void pubStrCache_add(KSI_CTX *ctx, const char *publication, KSI_Integer *pubTime, KSI_DataHash *pubHash) {
+	KSI_PublicationStringCacheEntry *entry = &ctx->pubStrCache[ctx->pubStrCache_next];
+	char *tmp = NULL;
+
+	/* The cache is an optimization, skip it when out of memory. */
+	if (KSI_strdup(publication, &tmp) != KSI_OK) return;
+
+	KSI_free(entry->pubStr);
+	KSI_Integer_free(entry->time);
+	KSI_DataHash_free(entry->imprint);
+
+	entry->pubStr = tmp;
+	entry->time = KSI_Integer_ref(pubTime);
+	entry->imprint = KSI_DataHash_ref(pubHash);
+
+	ctx->pubStrCache_next = (ctx->pubStrCache_next + 1) % KSI_PUBSTR_CACHE_SIZE;
+}
+
+static int decodePublicationString(KSI_CTX *ctx, const char *publication, KSI_Integer **pubTime, KSI_DataHash **pubHash) {
 	int res = KSI_UNKNOWN_ERROR;
 	unsigned char *binary_publication = NULL;
 	size_t binary_publication_length;
-	KSI_PublicationData *tmp_published_data = NULL;
 	unsigned i;
 	unsigned long tmp_ulong;
 	KSI_uint64_t tmp_uint64;
 	KSI_HashAlgorithm algo_id;
 	size_t hash_size;
-	KSI_DataHash *pubHash = NULL;
-	KSI_Integer *pubTime = NULL;
-
-	KSI_ERR_clearErrors(ctx);
-
-	if (ctx == NULL || publication == NULL || published_data == NULL) {
-		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
-		goto cleanup;
-	}
-
+	KSI_DataHash *tmpHash = NULL;
+	KSI_Integer *tmpTime = NULL;
 
 	res = KSI_base32Decode(publication, &binary_publication, &binary_publication_length);
 	if (res != KSI_OK) {
@@ -1043,51 +1628,91 @@ int KSI_PublicationData_fromBase32(KSI_CTX *ctx, const char *publication, KSI_Pu
 		goto cleanup;
 	}
 
-	res = KSI_PublicationData_new(ctx, &tmp_published_data);
-	if (res != KSI_OK) {
-		KSI_pushError(ctx, res, NULL);
-		goto cleanup;
-	}
-
 	tmp_uint64 = 0;
 	for (i = 0; i < 8; ++i) {
 		tmp_uint64 <<= 8;
 		tmp_uint64 |= binary_publication[i];
 	}
 
-	res = KSI_Integer_new(ctx, tmp_uint64, &pubTime);
+	res = KSI_Integer_new(ctx, tmp_uint64, &tmpTime);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
 		goto cleanup;
 	}
 
-	res = KSI_PublicationData_setTime(tmp_published_data, pubTime);
+	algo_id = binary_publication[8];
+	if (!KSI_isHashAlgorithmSupported(algo_id)) {
+		KSI_pushError(ctx, res = KSI_UNAVAILABLE_HASH_ALGORITHM, NULL);
+		goto cleanup;
+	}
+
+	hash_size = KSI_getHashLength(algo_id);
+	if (binary_publication_length != 8 + 1 + hash_size + 4) {
+		KSI_pushError(ctx, res = KSI_INVALID_FORMAT, "Hash algorithm length mismatch.");
+		goto cleanup;
+	}
+
+	res = KSI_DataHash_fromImprint(ctx, binary_publication + 8, hash_size + 1, &tmpHash);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
 		goto cleanup;
 	}
 
-	pubTime = NULL;
+	*pubTime = tmpTime;
+	tmpTime = NULL;
 
+	*pubHash = tmpHash;
+	tmpHash = NULL;
 
-	algo_id = binary_publication[8];
-	if (!KSI_isHashAlgorithmSupported(algo_id)) {
-		KSI_pushError(ctx, res = KSI_UNAVAILABLE_HASH_ALGORITHM, NULL);
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_Integer_free(tmpTime);
+	KSI_DataHash_free(tmpHash);
+	KSI_free(binary_publication);
+
+	return res;
+}
+
+int KSI_PublicationData_fromBase32(KSI_CTX *ctx, const char *publication, KSI_PublicationData **published_data) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_PublicationData *tmp_published_data = NULL;
+	KSI_DataHash *pubHash = NULL;
+	KSI_Integer *pubTime = NULL;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || publication == NULL || published_data == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
 		goto cleanup;
 	}
 
-	hash_size = KSI_getHashLength(algo_id);
-	if (binary_publication_length != 8 + 1 + hash_size + 4) {
-		KSI_pushError(ctx, res = KSI_INVALID_FORMAT, "Hash algorithm length mismatch.");
+	/* The same publication string is usually used to verify many signatures. */
+	if (!pubStrCache_find(ctx, publication, &pubTime, &pubHash)) {
+		res = decodePublicationString(ctx, publication, &pubTime, &pubHash);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+
+		pubStrCache_add(ctx, publication, pubTime, pubHash);
+	}
+
+	res = KSI_PublicationData_new(ctx, &tmp_published_data);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
 		goto cleanup;
 	}
 
-	res = KSI_DataHash_fromImprint(ctx, binary_publication + 8, hash_size + 1, &pubHash);
+	res = KSI_PublicationData_setTime(tmp_published_data, pubTime);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
 		goto cleanup;
 	}
 
+	pubTime = NULL;
+
 	res = KSI_PublicationData_setImprint(tmp_published_data, pubHash);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
@@ -1104,7 +1729,6 @@ int KSI_PublicationData_fromBase32(KSI_CTX *ctx, const char *publication, KSI_Pu
 cleanup:
 	KSI_Integer_free(pubTime);
 	KSI_DataHash_free(pubHash);
-	KSI_free(binary_publication);
 	KSI_PublicationData_free(tmp_published_data);
 
 	return res;
@@ -70,6 +70,22 @@ extern "C" {
 	 */
 	int KSI_PublicationsFile_fromFile(KSI_CTX *ctx, const char *fileName, KSI_PublicationsFile **pubFile);
 
+	/**
+	 * Maps the publications file into memory instead of reading it. Only the publication times
+	 * and imprints are indexed when the file is loaded; the publication records are decoded when
+	 * a lookup function returns them. #KSI_PublicationsFile_getPublications decodes all the records.
+	 * \param[in]		ctx				KSI context.
+	 * \param[in]		fileName		File name of the publications file.
+	 * \param[out]		pubFile			Pointer to the receiving pointer.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 * \note The file must not be modified in place while the object exists; replacing it
+	 * with a new file (i.e. renaming) is safe.
+	 * \note As the records are decoded and stored in the object by the lookup functions
+	 * and #KSI_PublicationsFile_getPublications, a mapped publications file must not be
+	 * used by several threads at the same time, even if it is only read.
+	 */
+	int KSI_PublicationsFile_mapFile(KSI_CTX *ctx, const char *fileName, KSI_PublicationsFile **pubFile);
+
 	/**
 	 * This function serializes the publications file object into raw data.
 	 * \param[in]		ctx			KSI context.
@@ -327,6 +343,17 @@ extern "C" {
 	 */
 	int KSI_PublicationData_toBase32(const KSI_PublicationData *published_data, char **publication);
 
+	/**
+	 * Converts the published data of the publication record into a base-32 encoded null-terminated string.
+	 * \param[in]		pubRec				Pointer to the publication record.
+	 * \param[out]		pubStr				Pointer to the receiving pointer.
+	 *
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 * \note The output memory has to be freed by the caller using #KSI_free.
+	 * \see #KSI_PublicationData_toBase32
+	 */
+	int KSI_PublicationRecord_toBase32(const KSI_PublicationRecord *pubRec, char **pubStr);
+
 	/**
 	 * KSI_PublicationData
 	 */
@@ -24,6 +24,29 @@
 extern "C" {
 #endif
 
+	/**
+	 * Entry of the publication time index. The entries are sorted by time and
+	 * records with equal times keep their order in the publications file.
+	 */
+	typedef struct KSI_PublicationTimeEntry_st {
+		KSI_uint64_t time;
+		size_t pos;
+		KSI_PublicationRecord *rec;
+		/* Location of the record TLV and the imprint value in the raw file, set for lazily decoded files. */
+		size_t offset;
+		size_t len;
+		size_t imprintOffset;
+		size_t imprint_len;
+	} KSI_PublicationTimeEntry;
+
+	/**
+	 * Slot of the certificate id hash table. Empty slots have \c id set to \c NULL.
+	 */
+	typedef struct KSI_CertificateIdEntry_st {
+		const KSI_OctetString *id;
+		KSI_PKICertificate *cert;
+	} KSI_CertificateIdEntry;
+
 	struct KSI_PublicationsFile_st {
 		KSI_CTX *ctx;
 		size_t ref;
@@ -35,6 +58,21 @@ extern "C" {
 		size_t signedDataLength;
 		KSI_PKISignature *signature;
 		KSI_CertConstraint *certConstraints;
+		/* Sorted view of #publications, built by #KSI_PublicationsFile_parse. */
+		KSI_PublicationTimeEntry *timeIndex;
+		size_t timeIndex_len;
+		/* Generation of #publications the index was built for, see #KSI_List_getGeneration. */
+		size_t timeIndex_gen;
+		/* Open addressing table of #certificates by id, built by #KSI_PublicationsFile_parse. */
+		KSI_CertificateIdEntry *certIndex;
+		size_t certIndex_size;
+		/* Generation of #certificates the index was built for. */
+		size_t certIndex_gen;
+		/* Set when #raw is a file mapping created by #KSI_PublicationsFile_mapFile. */
+		int mapped;
+		/* Set when the records are decoded from #raw on first use. The decoded records
+		 * are owned by #timeIndex and #publications is built only when requested. */
+		int lazy;
 	};
 
 	struct KSI_PublicationData_st {
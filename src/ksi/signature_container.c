@@ -0,0 +1,885 @@
+/*
+ * Copyright 2013-2016 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal.h"
+#include "fast_tlv.h"
+#include "io.h"
+#include "imprint_index.h"
+#include "signature_container.h"
+
+#define CONTAINER_MAGIC "KSISIGC1"
+#define CONTAINER_MAGIC_LEN 8
+#define CONTAINER_FOOTER_LEN 24
+
+#define CONTAINER_SIGNATURE_TAG 0x0800
+#define CONTAINER_RECORD_TAG 0x01
+
+/* Size of a component digest (SHA-256) used for deduplication. */
+#define COMPONENT_DIGEST_LEN 32
+
+typedef struct ContainerComponent_st {
+	/** Offset of the component TLV. */
+	size_t offset;
+	/** SHA-256 digest of the component TLV. */
+	unsigned char digest[COMPONENT_DIGEST_LEN];
+} ContainerComponent;
+
+typedef struct ContainerRecord_st {
+	/** Offset of the record TLV. */
+	size_t offset;
+	/** Document hash imprint. */
+	unsigned char imprint[KSI_MAX_IMPRINT_LEN];
+	size_t imprint_len;
+} ContainerRecord;
+
+struct KSI_SignatureContainerBuilder_st {
+	KSI_CTX *ctx;
+
+	/** Magic bytes followed by the components and records. */
+	unsigned char *body;
+	size_t body_len;
+	size_t body_size;
+
+	ContainerComponent *components;
+	size_t comp_count;
+	size_t comp_size;
+
+	/** Open addressing hash table of component numbers + 1 (0 for an empty slot). */
+	size_t *compTable;
+	size_t compTable_size;
+
+	ContainerRecord *records;
+	size_t rec_count;
+	size_t rec_size;
+};
+
+struct KSI_SignatureContainer_st {
+	KSI_CTX *ctx;
+
+	const unsigned char *raw;
+	size_t raw_len;
+	/** Set when #raw is a file mapping created by #KSI_SignatureContainer_mapFile. */
+	int mapped;
+
+	/** Offset of the index; the components and records must end before it. */
+	size_t index_off;
+	size_t comp_count;
+	size_t rec_count;
+
+	const unsigned char *compIndex;
+	const unsigned char *recIndex;
+	const unsigned char *hashIndex;
+};
+
+static void putUInt(unsigned char *buf, KSI_uint64_t val, size_t len) {
+	while (len-- > 0) {
+		buf[len] = (unsigned char)(val & 0xff);
+		val >>= 8;
+	}
+}
+
+static KSI_uint64_t getUInt(const unsigned char *buf, size_t len) {
+	KSI_uint64_t val = 0;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		val = (val << 8) | buf[i];
+	}
+
+	return val;
+}
+
+/* Makes room for at least \c need elements of size \c el_size. */
+static int ensureCapacity(void **arr, size_t *size, size_t el_size, size_t need) {
+	size_t newSize;
+	void *tmp = NULL;
+
+	if (need <= *size) return KSI_OK;
+
+	newSize = *size < 16 ? 16 : *size;
+	while (newSize < need) {
+		if (newSize > ((size_t)-1) / 2 / el_size) return KSI_OUT_OF_MEMORY;
+		newSize *= 2;
+	}
+
+	tmp = KSI_malloc(newSize * el_size);
+	if (tmp == NULL) return KSI_OUT_OF_MEMORY;
+
+	if (*arr != NULL) {
+		memcpy(tmp, *arr, *size * el_size);
+		KSI_free(*arr);
+	}
+
+	*arr = tmp;
+	*size = newSize;
+
+	return KSI_OK;
+}
+
+static size_t digestSlot(const unsigned char *digest, size_t tableSize) {
+	return (size_t)getUInt(digest, sizeof(KSI_uint64_t)) & (tableSize - 1);
+}
+
+/* Recreates the component hash table, so that it is at most half full. */
+static int rebuildTable(KSI_SignatureContainerBuilder *builder, size_t need) {
+	size_t size = 64;
+	size_t *table = NULL;
+	size_t i;
+
+	while (size < 2 * need) {
+		if (size > ((size_t)-1) / 2 / sizeof(size_t)) return KSI_OUT_OF_MEMORY;
+		size *= 2;
+	}
+
+	table = KSI_calloc(size, sizeof(size_t));
+	if (table == NULL) return KSI_OUT_OF_MEMORY;
+
+	for (i = 0; i < builder->comp_count; i++) {
+		size_t slot = digestSlot(builder->components[i].digest, size);
+		while (table[slot] != 0) slot = (slot + 1) & (size - 1);
+		table[slot] = i + 1;
+	}
+
+	KSI_free(builder->compTable);
+	builder->compTable = table;
+	builder->compTable_size = size;
+
+	return KSI_OK;
+}
+
+static size_t writeTlvHeader(unsigned char *buf, unsigned tag, size_t len) {
+	if (tag <= KSI_TLV_MASK_TLV8_TYPE && len <= 0xff) {
+		buf[0] = (unsigned char)tag;
+		buf[1] = (unsigned char)len;
+		return 2;
+	}
+
+	buf[0] = (unsigned char)(KSI_TLV_MASK_TLV16 | ((tag >> 8) & KSI_TLV_MASK_TLV8_TYPE));
+	buf[1] = (unsigned char)(tag & 0xff);
+	buf[2] = (unsigned char)((len >> 8) & 0xff);
+	buf[3] = (unsigned char)(len & 0xff);
+	return 4;
+}
+
+void KSI_SignatureContainerBuilder_free(KSI_SignatureContainerBuilder *builder) {
+	if (builder != NULL) {
+		KSI_free(builder->body);
+		KSI_free(builder->components);
+		KSI_free(builder->compTable);
+		KSI_free(builder->records);
+		KSI_free(builder);
+	}
+}
+
+int KSI_SignatureContainerBuilder_new(KSI_CTX *ctx, KSI_SignatureContainerBuilder **builder) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_SignatureContainerBuilder *tmp = NULL;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || builder == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	tmp = KSI_new(KSI_SignatureContainerBuilder);
+	if (tmp == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	tmp->ctx = ctx;
+	tmp->body = NULL;
+	tmp->body_len = 0;
+	tmp->body_size = 0;
+	tmp->components = NULL;
+	tmp->comp_count = 0;
+	tmp->comp_size = 0;
+	tmp->compTable = NULL;
+	tmp->compTable_size = 0;
+	tmp->records = NULL;
+	tmp->rec_count = 0;
+	tmp->rec_size = 0;
+
+	res = ensureCapacity((void **)&tmp->body, &tmp->body_size, 1, 0xffff);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	memcpy(tmp->body, CONTAINER_MAGIC, CONTAINER_MAGIC_LEN);
+	tmp->body_len = CONTAINER_MAGIC_LEN;
+
+	res = rebuildTable(tmp, 0);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	*builder = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_SignatureContainerBuilder_free(tmp);
+
+	return res;
+}
+
+/* Returns the number of the component, adding it to the container if it is not present yet. */
+static int addComponent(KSI_SignatureContainerBuilder *builder, const unsigned char *raw, size_t raw_len, size_t *id) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_HashInput input;
+	unsigned char imprint[KSI_MAX_IMPRINT_LEN];
+	size_t imprint_len = 0;
+	const unsigned char *digest = imprint + 1;
+	size_t slot;
+	size_t offset;
+
+	input.data = raw;
+	input.data_length = raw_len;
+
+	res = KSI_calculateImprint(builder->ctx, KSI_HASHALG_SHA2_256, &input, 1, imprint, &imprint_len);
+	if (res != KSI_OK) goto cleanup;
+
+	if (imprint_len != COMPONENT_DIGEST_LEN + 1) {
+		res = KSI_INVALID_STATE;
+		goto cleanup;
+	}
+
+	/* Look for an identical component. */
+	slot = digestSlot(digest, builder->compTable_size);
+	while (builder->compTable[slot] != 0) {
+		const ContainerComponent *comp = &builder->components[builder->compTable[slot] - 1];
+
+		if (!memcmp(comp->digest, digest, COMPONENT_DIGEST_LEN)) {
+			/* Compare the bytes as well; as the components are TLVs, equal headers imply equal lengths. */
+			if (builder->body_len - comp->offset >= raw_len && !memcmp(builder->body + comp->offset, raw, raw_len)) {
+				*id = builder->compTable[slot] - 1;
+				res = KSI_OK;
+				goto cleanup;
+			}
+		}
+
+		slot = (slot + 1) & (builder->compTable_size - 1);
+	}
+
+	if (builder->comp_count >= 0xffffffff) {
+		res = KSI_BUFFER_OVERFLOW;
+		goto cleanup;
+	}
+
+	res = ensureCapacity((void **)&builder->body, &builder->body_size, 1, builder->body_len + raw_len);
+	if (res != KSI_OK) goto cleanup;
+
+	res = ensureCapacity((void **)&builder->components, &builder->comp_size, sizeof(ContainerComponent), builder->comp_count + 1);
+	if (res != KSI_OK) goto cleanup;
+
+	offset = builder->body_len;
+	memcpy(builder->body + offset, raw, raw_len);
+	builder->body_len += raw_len;
+
+	builder->components[builder->comp_count].offset = offset;
+	memcpy(builder->components[builder->comp_count].digest, digest, COMPONENT_DIGEST_LEN);
+	builder->comp_count++;
+
+	if (2 * builder->comp_count > builder->compTable_size) {
+		res = rebuildTable(builder, builder->comp_count);
+		if (res != KSI_OK) goto cleanup;
+	} else {
+		builder->compTable[slot] = builder->comp_count;
+	}
+
+	*id = builder->comp_count - 1;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_SignatureContainerBuilder_add(KSI_SignatureContainerBuilder *builder, const KSI_Signature *sig) {
+	int res = KSI_UNKNOWN_ERROR;
+	unsigned char *raw = NULL;
+	size_t raw_len = 0;
+	KSI_FTLV top;
+	KSI_FTLV *children = NULL;
+	size_t children_count = 0;
+	size_t *ids = NULL;
+	KSI_DataHash *docHash = NULL;
+	const unsigned char *imprint = NULL;
+	size_t imprint_len = 0;
+	ContainerRecord *rec = NULL;
+	size_t payload_len;
+	size_t hdr_len;
+	size_t saved_body_len = 0;
+	size_t saved_comp_count = 0;
+	unsigned char hdr[4];
+	size_t i;
+
+	if (builder == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_ERR_clearErrors(builder->ctx);
+
+	saved_body_len = builder->body_len;
+	saved_comp_count = builder->comp_count;
+
+	if (sig == NULL) {
+		KSI_pushError(builder->ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	if (builder->rec_count >= 0xffffffff) {
+		KSI_pushError(builder->ctx, res = KSI_BUFFER_OVERFLOW, "Too many records in the signature container.");
+		goto cleanup;
+	}
+
+	res = KSI_Signature_getDocumentHash(sig, &docHash);
+	if (res != KSI_OK) {
+		KSI_pushError(builder->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_DataHash_getImprint(docHash, &imprint, &imprint_len);
+	if (res != KSI_OK) {
+		KSI_pushError(builder->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_Signature_serialize(sig, &raw, &raw_len);
+	if (res != KSI_OK) {
+		KSI_pushError(builder->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_FTLV_memRead(raw, raw_len, &top);
+	if (res != KSI_OK || top.tag != CONTAINER_SIGNATURE_TAG || top.hdr_len + top.dat_len != raw_len || top.dat_len == 0) {
+		KSI_pushError(builder->ctx, res = KSI_INVALID_FORMAT, "Unexpected signature encoding.");
+		goto cleanup;
+	}
+
+	/* Split the signature into the top-level components. */
+	res = KSI_FTLV_memReadN(raw + top.hdr_len, top.dat_len, NULL, 0, &children_count);
+	if (res != KSI_OK) {
+		KSI_pushError(builder->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	children = KSI_malloc(children_count * sizeof(KSI_FTLV));
+	ids = KSI_malloc(children_count * sizeof(size_t));
+	if (children == NULL || ids == NULL) {
+		KSI_pushError(builder->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_FTLV_memReadN(raw + top.hdr_len, top.dat_len, children, children_count, NULL);
+	if (res != KSI_OK) {
+		KSI_pushError(builder->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < children_count; i++) {
+		res = addComponent(builder, raw + top.hdr_len + children[i].off, children[i].hdr_len + children[i].dat_len, &ids[i]);
+		if (res != KSI_OK) {
+			KSI_pushError(builder->ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	/* Write the record. */
+	payload_len = 1 + imprint_len + 4 * children_count;
+	if (payload_len > 0xffff) {
+		KSI_pushError(builder->ctx, res = KSI_BUFFER_OVERFLOW, "Signature has too many components.");
+		goto cleanup;
+	}
+
+	res = ensureCapacity((void **)&builder->records, &builder->rec_size, sizeof(ContainerRecord), builder->rec_count + 1);
+	if (res != KSI_OK) {
+		KSI_pushError(builder->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	hdr_len = writeTlvHeader(hdr, CONTAINER_RECORD_TAG, payload_len);
+
+	res = ensureCapacity((void **)&builder->body, &builder->body_size, 1, builder->body_len + hdr_len + payload_len);
+	if (res != KSI_OK) {
+		KSI_pushError(builder->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	rec = &builder->records[builder->rec_count];
+	rec->offset = builder->body_len;
+	memcpy(rec->imprint, imprint, imprint_len);
+	rec->imprint_len = imprint_len;
+
+	memcpy(builder->body + builder->body_len, hdr, hdr_len);
+	builder->body_len += hdr_len;
+
+	builder->body[builder->body_len++] = (unsigned char)imprint_len;
+	memcpy(builder->body + builder->body_len, imprint, imprint_len);
+	builder->body_len += imprint_len;
+
+	for (i = 0; i < children_count; i++) {
+		putUInt(builder->body + builder->body_len, ids[i], 4);
+		builder->body_len += 4;
+	}
+
+	builder->rec_count++;
+
+	res = KSI_OK;
+
+cleanup:
+
+	/* Drop the components of a partially added signature. */
+	if (res != KSI_OK && builder != NULL && builder->comp_count != saved_comp_count) {
+		builder->body_len = saved_body_len;
+		builder->comp_count = saved_comp_count;
+		if (rebuildTable(builder, builder->comp_count) != KSI_OK) {
+			/* Without the table the components can not be looked up, forget them all. */
+			builder->body_len = CONTAINER_MAGIC_LEN;
+			builder->comp_count = 0;
+			builder->rec_count = 0;
+		}
+	}
+
+	KSI_nofree(docHash);
+	KSI_free(raw);
+	KSI_free(children);
+	KSI_free(ids);
+
+	return res;
+}
+
+typedef struct HashIndexEntry_st {
+	const ContainerRecord *rec;
+	size_t recNo;
+} HashIndexEntry;
+
+static int compareHashIndexEntry(const void *a, const void *b) {
+	const HashIndexEntry *l = a;
+	const HashIndexEntry *r = b;
+	int cmp = KSI_Imprint_compare(l->rec->imprint, l->rec->imprint_len, r->rec->imprint, r->rec->imprint_len);
+
+	if (cmp != 0) return cmp;
+	return l->recNo < r->recNo ? -1 : (l->recNo > r->recNo ? 1 : 0);
+}
+
+int KSI_SignatureContainerBuilder_serialize(const KSI_SignatureContainerBuilder *builder, unsigned char **raw, size_t *raw_len) {
+	int res = KSI_UNKNOWN_ERROR;
+	unsigned char *tmp = NULL;
+	size_t tmp_len;
+	HashIndexEntry *entries = NULL;
+	unsigned char *ptr = NULL;
+	size_t i;
+
+	if (builder == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_ERR_clearErrors(builder->ctx);
+
+	if (raw == NULL || raw_len == NULL) {
+		KSI_pushError(builder->ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	tmp_len = builder->body_len + 8 * builder->comp_count + 12 * builder->rec_count + CONTAINER_FOOTER_LEN;
+
+	tmp = KSI_malloc(tmp_len);
+	if (tmp == NULL) {
+		KSI_pushError(builder->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	if (builder->rec_count > 0) {
+		entries = KSI_malloc(builder->rec_count * sizeof(HashIndexEntry));
+		if (entries == NULL) {
+			KSI_pushError(builder->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+			goto cleanup;
+		}
+
+		for (i = 0; i < builder->rec_count; i++) {
+			entries[i].rec = &builder->records[i];
+			entries[i].recNo = i;
+		}
+
+		qsort(entries, builder->rec_count, sizeof(HashIndexEntry), compareHashIndexEntry);
+	}
+
+	memcpy(tmp, builder->body, builder->body_len);
+	ptr = tmp + builder->body_len;
+
+	for (i = 0; i < builder->comp_count; i++, ptr += 8) {
+		putUInt(ptr, builder->components[i].offset, 8);
+	}
+
+	for (i = 0; i < builder->rec_count; i++, ptr += 8) {
+		putUInt(ptr, builder->records[i].offset, 8);
+	}
+
+	for (i = 0; i < builder->rec_count; i++, ptr += 4) {
+		putUInt(ptr, entries[i].recNo, 4);
+	}
+
+	putUInt(ptr, builder->body_len, 8);
+	putUInt(ptr + 8, builder->comp_count, 8);
+	putUInt(ptr + 16, builder->rec_count, 8);
+
+	*raw = tmp;
+	*raw_len = tmp_len;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(entries);
+	KSI_free(tmp);
+
+	return res;
+}
+
+void KSI_SignatureContainer_free(KSI_SignatureContainer *container) {
+	if (container != NULL) {
+		if (container->mapped) {
+			KSI_IO_unmapFile(container->raw, container->raw_len);
+		} else {
+			KSI_free((unsigned char *)container->raw);
+		}
+		KSI_free(container);
+	}
+}
+
+/* Checks the footer and creates the container; takes the ownership of \c raw on success. */
+static int openContainer(KSI_CTX *ctx, const unsigned char *raw, size_t raw_len, int mapped, KSI_SignatureContainer **container) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_SignatureContainer *tmp = NULL;
+	const unsigned char *footer = NULL;
+	KSI_uint64_t index_off;
+	KSI_uint64_t comp_count;
+	KSI_uint64_t rec_count;
+
+	if (raw == NULL || raw_len < CONTAINER_MAGIC_LEN + CONTAINER_FOOTER_LEN || memcmp(raw, CONTAINER_MAGIC, CONTAINER_MAGIC_LEN)) {
+		KSI_pushError(ctx, res = KSI_INVALID_FORMAT, "Not a signature container.");
+		goto cleanup;
+	}
+
+	footer = raw + raw_len - CONTAINER_FOOTER_LEN;
+	index_off = getUInt(footer, 8);
+	comp_count = getUInt(footer + 8, 8);
+	rec_count = getUInt(footer + 16, 8);
+
+	/* The index must fill the space between the records and the footer. */
+	if (index_off < CONTAINER_MAGIC_LEN || index_off > raw_len - CONTAINER_FOOTER_LEN
+			|| comp_count > (raw_len - CONTAINER_FOOTER_LEN - index_off) / 8
+			|| rec_count > (raw_len - CONTAINER_FOOTER_LEN - index_off) / 12
+			|| index_off + 8 * comp_count + 12 * rec_count + CONTAINER_FOOTER_LEN != raw_len) {
+		KSI_pushError(ctx, res = KSI_INVALID_FORMAT, "Invalid signature container index.");
+		goto cleanup;
+	}
+
+	tmp = KSI_new(KSI_SignatureContainer);
+	if (tmp == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	tmp->ctx = ctx;
+	tmp->raw = raw;
+	tmp->raw_len = raw_len;
+	tmp->mapped = mapped;
+	tmp->index_off = (size_t)index_off;
+	tmp->comp_count = (size_t)comp_count;
+	tmp->rec_count = (size_t)rec_count;
+
+	tmp->compIndex = tmp->raw + tmp->index_off;
+	tmp->recIndex = tmp->compIndex + 8 * tmp->comp_count;
+	tmp->hashIndex = tmp->recIndex + 8 * tmp->rec_count;
+
+	*container = tmp;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_SignatureContainer_parse(KSI_CTX *ctx, const unsigned char *raw, size_t raw_len, KSI_SignatureContainer **container) {
+	int res = KSI_UNKNOWN_ERROR;
+	unsigned char *tmp = NULL;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || raw == NULL || container == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	tmp = KSI_malloc(raw_len > 0 ? raw_len : 1);
+	if (tmp == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+	memcpy(tmp, raw, raw_len);
+
+	res = openContainer(ctx, tmp, raw_len, 0, container);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
+}
+
+int KSI_SignatureContainer_mapFile(KSI_CTX *ctx, const char *fileName, KSI_SignatureContainer **container) {
+	int res = KSI_UNKNOWN_ERROR;
+	const unsigned char *raw = NULL;
+	size_t raw_len = 0;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || fileName == NULL || container == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_IO_mapFile(fileName, &raw, &raw_len);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, "Unable to map signature container file.");
+		goto cleanup;
+	}
+
+	res = openContainer(ctx, raw, raw_len, 1, container);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+	raw = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_IO_unmapFile(raw, raw_len);
+
+	return res;
+}
+
+size_t KSI_SignatureContainer_getCount(const KSI_SignatureContainer *container) {
+	return container != NULL ? container->rec_count : 0;
+}
+
+/* Locates the TLV at the offset read from the index entry. */
+static int readIndexedTlv(const KSI_SignatureContainer *container, const unsigned char *entry, KSI_FTLV *t, const unsigned char **ptr) {
+	KSI_uint64_t off = getUInt(entry, 8);
+	int res;
+
+	if (off < CONTAINER_MAGIC_LEN || off >= container->index_off) return KSI_INVALID_FORMAT;
+
+	res = KSI_FTLV_memRead(container->raw + off, container->index_off - (size_t)off, t);
+	if (res != KSI_OK) return KSI_INVALID_FORMAT;
+
+	*ptr = container->raw + off;
+
+	return KSI_OK;
+}
+
+static int readRecord(const KSI_SignatureContainer *container, size_t index, const unsigned char **imprint, size_t *imprint_len, const unsigned char **ids, size_t *ids_count) {
+	KSI_FTLV t;
+	const unsigned char *ptr = NULL;
+	const unsigned char *payload = NULL;
+	int res;
+
+	res = readIndexedTlv(container, container->recIndex + 8 * index, &t, &ptr);
+	if (res != KSI_OK) return res;
+
+	payload = ptr + t.hdr_len;
+	if (t.tag != CONTAINER_RECORD_TAG || t.dat_len < 1 || 1 + (size_t)payload[0] > t.dat_len || (t.dat_len - 1 - payload[0]) % 4 != 0) {
+		return KSI_INVALID_FORMAT;
+	}
+
+	*imprint = payload + 1;
+	*imprint_len = payload[0];
+	if (ids != NULL) *ids = payload + 1 + payload[0];
+	if (ids_count != NULL) *ids_count = (t.dat_len - 1 - payload[0]) / 4;
+
+	return KSI_OK;
+}
+
+int KSI_SignatureContainer_getSignatureWithPolicy(const KSI_SignatureContainer *container, size_t index, const KSI_Policy *policy, KSI_VerificationContext *context, KSI_Signature **sig) {
+	int res = KSI_UNKNOWN_ERROR;
+	const unsigned char *imprint = NULL;
+	size_t imprint_len = 0;
+	const unsigned char *ids = NULL;
+	size_t ids_count = 0;
+	const unsigned char *comp = NULL;
+	KSI_FTLV t;
+	unsigned char *buf = NULL;
+	size_t payload_len = 0;
+	size_t len;
+	size_t i;
+
+	if (container == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_ERR_clearErrors(container->ctx);
+
+	if (index >= container->rec_count || sig == NULL) {
+		KSI_pushError(container->ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	res = readRecord(container, index, &imprint, &imprint_len, &ids, &ids_count);
+	if (res != KSI_OK || ids_count == 0) {
+		KSI_pushError(container->ctx, res = KSI_INVALID_FORMAT, "Invalid signature container record.");
+		goto cleanup;
+	}
+
+	/* Calculate the size of the signature. */
+	for (i = 0; i < ids_count; i++) {
+		KSI_uint64_t id = getUInt(ids + 4 * i, 4);
+
+		if (id >= container->comp_count || readIndexedTlv(container, container->compIndex + 8 * id, &t, &comp) != KSI_OK) {
+			KSI_pushError(container->ctx, res = KSI_INVALID_FORMAT, "Invalid signature container component.");
+			goto cleanup;
+		}
+
+		payload_len += t.hdr_len + t.dat_len;
+		if (payload_len > 0xffff) {
+			KSI_pushError(container->ctx, res = KSI_INVALID_FORMAT, "Signature too large.");
+			goto cleanup;
+		}
+	}
+
+	buf = KSI_malloc(payload_len + 4);
+	if (buf == NULL) {
+		KSI_pushError(container->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	len = writeTlvHeader(buf, CONTAINER_SIGNATURE_TAG, payload_len);
+
+	for (i = 0; i < ids_count; i++) {
+		KSI_uint64_t id = getUInt(ids + 4 * i, 4);
+
+		/* Already validated above. */
+		readIndexedTlv(container, container->compIndex + 8 * id, &t, &comp);
+		memcpy(buf + len, comp, t.hdr_len + t.dat_len);
+		len += t.hdr_len + t.dat_len;
+	}
+
+	res = KSI_Signature_parseWithPolicy(container->ctx, buf, len, policy, context, sig);
+	if (res != KSI_OK) {
+		KSI_pushError(container->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(buf);
+
+	return res;
+}
+
+/* Returns the document hash of the record at position \c i of the hash index. */
+static int getHashIndexImprint(const void *data, size_t i, const unsigned char **imprint, size_t *imprint_len) {
+	const KSI_SignatureContainer *container = data;
+	size_t recNo = (size_t)getUInt(container->hashIndex + 4 * i, 4);
+
+	if (recNo >= container->rec_count) return KSI_INVALID_FORMAT;
+
+	return readRecord(container, recNo, imprint, imprint_len, NULL, NULL);
+}
+
+int KSI_SignatureContainer_indexOf(const KSI_SignatureContainer *container, const KSI_DataHash *hsh, size_t **pos) {
+	int res = KSI_UNKNOWN_ERROR;
+	const unsigned char *imprint = NULL;
+	size_t imprint_len = 0;
+	size_t *tmp = NULL;
+	size_t lo;
+	int found;
+
+	if (container == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_ERR_clearErrors(container->ctx);
+
+	if (hsh == NULL || pos == NULL) {
+		KSI_pushError(container->ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_DataHash_getImprint(hsh, &imprint, &imprint_len);
+	if (res != KSI_OK) {
+		KSI_pushError(container->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_Imprint_lowerBound(container, container->rec_count, getHashIndexImprint, imprint, imprint_len, &lo, &found);
+	if (res != KSI_OK) {
+		KSI_pushError(container->ctx, res = KSI_INVALID_FORMAT, "Invalid signature container index.");
+		goto cleanup;
+	}
+
+	*pos = NULL;
+
+	if (found) {
+		tmp = KSI_malloc(sizeof(size_t));
+		if (tmp == NULL) {
+			KSI_pushError(container->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+			goto cleanup;
+		}
+
+		*tmp = (size_t)getUInt(container->hashIndex + 4 * lo, 4);
+		*pos = tmp;
+		tmp = NULL;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
+}
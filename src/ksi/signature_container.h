@@ -0,0 +1,159 @@
+/*
+ * Copyright 2013-2016 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#ifndef SIGNATURE_CONTAINER_H_
+#define SIGNATURE_CONTAINER_H_
+
+#include "ksi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \addtogroup signaturecontainer Signature Container
+ * The signature container stores a sequence of signatures in a single binary blob. The
+ * top-level components of the signatures (aggregation hash chains, calendar hash chain,
+ * authentication records and the publication) are stored only once and each record
+ * refers to its components, so the signatures of the same aggregation round (e.g. from
+ * #KSI_BlockSigner) share their upper aggregation hash chains and calendar data.
+ *
+ * Layout of the container:
+ * - magic bytes \c "KSISIGC1";
+ * - the unique components as they appear in the signatures, encoded as TLV;
+ * - the records (TLV type 0x01), containing the length of the document hash imprint
+ *   (1 byte), the imprint and the 32-bit component numbers in the original order;
+ * - the index: 64-bit offsets of the components, 64-bit offsets of the records and
+ *   32-bit record numbers sorted by the document hash imprint;
+ * - footer: 64-bit offset of the index, the number of components and the number of records.
+ *
+ * All the integers are big-endian. The footer makes it possible to access a record by
+ * its number in constant time and by the document hash with a binary search.
+ * @{
+ */
+
+typedef struct KSI_SignatureContainer_st KSI_SignatureContainer;
+typedef struct KSI_SignatureContainerBuilder_st KSI_SignatureContainerBuilder;
+
+/**
+ * Creates a new builder for the signature container.
+ * \param[in]	ctx			KSI context.
+ * \param[out]	builder		Pointer to the receiving pointer.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \see #KSI_SignatureContainerBuilder_free
+ */
+int KSI_SignatureContainerBuilder_new(KSI_CTX *ctx, KSI_SignatureContainerBuilder **builder);
+
+/**
+ * Cleanup method for the #KSI_SignatureContainerBuilder.
+ * \param[in]	builder		Instance of the #KSI_SignatureContainerBuilder.
+ */
+void KSI_SignatureContainerBuilder_free(KSI_SignatureContainerBuilder *builder);
+
+/**
+ * Adds the signature as the next record of the container. The components already present
+ * in the container are not stored again.
+ * \param[in]	builder		Instance of the #KSI_SignatureContainerBuilder.
+ * \param[in]	sig			Signature to be added.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ */
+int KSI_SignatureContainerBuilder_add(KSI_SignatureContainerBuilder *builder, const KSI_Signature *sig);
+
+/**
+ * Serializes the container with the signatures added so far. The builder may be used to add
+ * more signatures afterwards.
+ * \param[in]	builder		Instance of the #KSI_SignatureContainerBuilder.
+ * \param[out]	raw			Pointer to the receiving pointer of the serialized container.
+ * \param[out]	raw_len		Length of the serialized container.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The output memory buffer belongs to the caller and needs to be freed using #KSI_free.
+ */
+int KSI_SignatureContainerBuilder_serialize(const KSI_SignatureContainerBuilder *builder, unsigned char **raw, size_t *raw_len);
+
+/**
+ * Parses the signature container. Only the footer and the index bounds are checked, the
+ * records are decoded when they are accessed.
+ * \param[in]	ctx			KSI context.
+ * \param[in]	raw			Serialized container.
+ * \param[in]	raw_len		Length of the serialized container.
+ * \param[out]	container	Pointer to the receiving pointer.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The raw buffer may be freed after this function finishes.
+ * \see #KSI_SignatureContainer_free
+ */
+int KSI_SignatureContainer_parse(KSI_CTX *ctx, const unsigned char *raw, size_t raw_len, KSI_SignatureContainer **container);
+
+/**
+ * Maps the signature container file into memory instead of reading it. The pages of the
+ * file are loaded by the operating system when the records are accessed.
+ * \param[in]	ctx			KSI context.
+ * \param[in]	fileName	Path to the container file.
+ * \param[out]	container	Pointer to the receiving pointer.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The file must not be modified while the container is in use.
+ * \see #KSI_SignatureContainer_free
+ */
+int KSI_SignatureContainer_mapFile(KSI_CTX *ctx, const char *fileName, KSI_SignatureContainer **container);
+
+/**
+ * Cleanup method for the #KSI_SignatureContainer.
+ * \param[in]	container	Instance of the #KSI_SignatureContainer.
+ */
+void KSI_SignatureContainer_free(KSI_SignatureContainer *container);
+
+/**
+ * Returns the number of records in the container.
+ * \param[in]	container	Instance of the #KSI_SignatureContainer.
+ */
+size_t KSI_SignatureContainer_getCount(const KSI_SignatureContainer *container);
+
+/**
+ * Decodes the record \c index of the container and verifies the signature with the provided
+ * policy and context.
+ * \param[in]	container	Instance of the #KSI_SignatureContainer.
+ * \param[in]	index		Record number.
+ * \param[in]	policy		Verification policy.
+ * \param[in]	context		Verification context.
+ * \param[out]	sig			Pointer to the receiving pointer.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ */
+int KSI_SignatureContainer_getSignatureWithPolicy(const KSI_SignatureContainer *container, size_t index, const KSI_Policy *policy, KSI_VerificationContext *context, KSI_Signature **sig);
+
+#define KSI_SignatureContainer_getSignature(container, index, sig) KSI_SignatureContainer_getSignatureWithPolicy(container, index, KSI_VERIFICATION_POLICY_INTERNAL, NULL, sig)
+
+/**
+ * Finds the first record signing the document hash.
+ * \param[in]	container	Instance of the #KSI_SignatureContainer.
+ * \param[in]	hsh			Document hash.
+ * \param[out]	pos			Pointer to the receiving pointer of the record number; set to \c NULL
+ * 							if there is no such record.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The record number belongs to the caller and needs to be freed using #KSI_free.
+ */
+int KSI_SignatureContainer_indexOf(const KSI_SignatureContainer *container, const KSI_DataHash *hsh, size_t **pos);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIGNATURE_CONTAINER_H_ */
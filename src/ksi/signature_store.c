@@ -0,0 +1,415 @@
+/*
+ * Copyright 2013-2016 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "internal.h"
+#include "fast_tlv.h"
+#include "io.h"
+#include "imprint_index.h"
+#include "signature_container.h"
+#include "signature_store.h"
+
+#define STORE_SIGNATURE_TAG 0x0800
+#define STORE_AGGR_CHAIN_TAG 0x0801
+#define STORE_RFC3161_TAG 0x0806
+#define STORE_CHAIN_INDEX_TAG 0x03
+#define STORE_INPUT_HASH_TAG 0x05
+
+typedef struct StoreHashEntry_st {
+	/** Document hash imprint inside the mapped file. */
+	const unsigned char *imprint;
+	size_t imprint_len;
+	size_t recNo;
+} StoreHashEntry;
+
+struct KSI_SignatureStore_st {
+	KSI_CTX *ctx;
+
+	/** Mapped file of concatenated signatures. */
+	const unsigned char *raw;
+	size_t raw_len;
+
+	/** Headers of the signatures, the offsets are relative to #raw. */
+	KSI_FTLV *index;
+	size_t count;
+
+	/** Document hashes sorted by the imprint; built by the first #KSI_SignatureStore_indexOf. */
+	StoreHashEntry *hashIndex;
+
+	/** Set instead of the fields above, if the file is a signature container. */
+	KSI_SignatureContainer *container;
+};
+
+static int compareHashEntry(const void *a, const void *b) {
+	const StoreHashEntry *l = a;
+	const StoreHashEntry *r = b;
+	int cmp = KSI_Imprint_compare(l->imprint, l->imprint_len, r->imprint, r->imprint_len);
+
+	if (cmp != 0) return cmp;
+	return l->recNo < r->recNo ? -1 : (l->recNo > r->recNo ? 1 : 0);
+}
+
+void KSI_SignatureStore_free(KSI_SignatureStore *store) {
+	if (store != NULL) {
+		KSI_IO_unmapFile(store->raw, store->raw_len);
+		KSI_free(store->index);
+		KSI_free(store->hashIndex);
+		KSI_SignatureContainer_free(store->container);
+		KSI_free(store);
+	}
+}
+
+/* Scans the headers of the concatenated signatures. */
+static int indexSignatures(KSI_SignatureStore *store) {
+	int res = KSI_UNKNOWN_ERROR;
+	size_t count = 0;
+	size_t i;
+
+	/* An empty file is an empty store. */
+	if (store->raw_len == 0) {
+		res = KSI_OK;
+		goto cleanup;
+	}
+
+	res = KSI_FTLV_memReadN(store->raw, store->raw_len, NULL, 0, &count);
+	if (res != KSI_OK) {
+		KSI_pushError(store->ctx, res = KSI_INVALID_FORMAT, "Unable to index the signature file.");
+		goto cleanup;
+	}
+
+	store->index = KSI_malloc(count * sizeof(KSI_FTLV));
+	if (store->index == NULL) {
+		KSI_pushError(store->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_FTLV_memReadN(store->raw, store->raw_len, store->index, count, NULL);
+	if (res != KSI_OK) {
+		KSI_pushError(store->ctx, res = KSI_INVALID_FORMAT, "Unable to index the signature file.");
+		goto cleanup;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (store->index[i].tag != STORE_SIGNATURE_TAG) {
+			KSI_pushError(store->ctx, res = KSI_INVALID_FORMAT, "Unexpected TLV in the signature file.");
+			goto cleanup;
+		}
+	}
+
+	store->count = count;
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+int KSI_SignatureStore_open(KSI_CTX *ctx, const char *fileName, KSI_SignatureStore **store) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_SignatureStore *tmp = NULL;
+	KSI_FTLV first;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || fileName == NULL || store == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	tmp = KSI_new(KSI_SignatureStore);
+	if (tmp == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	tmp->ctx = ctx;
+	tmp->raw = NULL;
+	tmp->raw_len = 0;
+	tmp->index = NULL;
+	tmp->count = 0;
+	tmp->hashIndex = NULL;
+	tmp->container = NULL;
+
+	res = KSI_IO_mapFile(fileName, &tmp->raw, &tmp->raw_len);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, "Unable to map signature file.");
+		goto cleanup;
+	}
+
+	/* A file not starting with a signature may only be a container. */
+	if (tmp->raw_len > 0 && (KSI_FTLV_memRead(tmp->raw, tmp->raw_len, &first) != KSI_OK || first.tag != STORE_SIGNATURE_TAG)) {
+		KSI_IO_unmapFile(tmp->raw, tmp->raw_len);
+		tmp->raw = NULL;
+		tmp->raw_len = 0;
+
+		res = KSI_SignatureContainer_mapFile(ctx, fileName, &tmp->container);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	} else {
+		res = indexSignatures(tmp);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	*store = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_SignatureStore_free(tmp);
+
+	return res;
+}
+
+size_t KSI_SignatureStore_getCount(const KSI_SignatureStore *store) {
+	if (store == NULL) return 0;
+	if (store->container != NULL) return KSI_SignatureContainer_getCount(store->container);
+	return store->count;
+}
+
+int KSI_SignatureStore_getSignatureWithPolicy(const KSI_SignatureStore *store, size_t index, const KSI_Policy *policy, KSI_VerificationContext *context, KSI_Signature **sig) {
+	int res = KSI_UNKNOWN_ERROR;
+	const KSI_FTLV *t = NULL;
+
+	if (store == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_ERR_clearErrors(store->ctx);
+
+	if (store->container != NULL) {
+		res = KSI_SignatureContainer_getSignatureWithPolicy(store->container, index, policy, context, sig);
+		if (res != KSI_OK) {
+			KSI_pushError(store->ctx, res, NULL);
+			goto cleanup;
+		}
+	} else {
+		if (index >= store->count || sig == NULL) {
+			KSI_pushError(store->ctx, res = KSI_INVALID_ARGUMENT, NULL);
+			goto cleanup;
+		}
+
+		t = &store->index[index];
+		res = KSI_Signature_parseWithPolicy(store->ctx, store->raw + t->off, t->hdr_len + t->dat_len, policy, context, sig);
+		if (res != KSI_OK) {
+			KSI_pushError(store->ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	return res;
+}
+
+/* Finds the chain index length and the input hash of an aggregation hash chain or RFC3161 record. */
+static int readChainInput(const unsigned char *buf, size_t len, size_t *indexLen, const unsigned char **imprint, size_t *imprint_len) {
+	KSI_FTLV t;
+	size_t off = 0;
+
+	*indexLen = 0;
+	*imprint = NULL;
+
+	while (off < len) {
+		if (KSI_FTLV_memRead(buf + off, len - off, &t) != KSI_OK) return KSI_INVALID_FORMAT;
+
+		if (t.tag == STORE_CHAIN_INDEX_TAG) {
+			++*indexLen;
+		} else if (t.tag == STORE_INPUT_HASH_TAG) {
+			*imprint = buf + off + t.hdr_len;
+			*imprint_len = t.dat_len;
+		}
+
+		off += t.hdr_len + t.dat_len;
+	}
+
+	if (*imprint == NULL || *imprint_len == 0 || *imprint_len > KSI_MAX_IMPRINT_LEN) return KSI_INVALID_FORMAT;
+
+	return KSI_OK;
+}
+
+/* Reads the document hash from the encoded signature without parsing it, see #KSI_Signature_getDocumentHash. */
+static int readDocumentImprint(const unsigned char *sig, const KSI_FTLV *sigTlv, const unsigned char **imprint, size_t *imprint_len) {
+	const unsigned char *payload = sig + sigTlv->hdr_len;
+	const unsigned char *chainImprint = NULL;
+	size_t chainImprint_len = 0;
+	size_t indexLen;
+	size_t bestLen = 0;
+	KSI_FTLV t;
+	size_t off = 0;
+	int res;
+
+	*imprint = NULL;
+
+	while (off < sigTlv->dat_len) {
+		if (KSI_FTLV_memRead(payload + off, sigTlv->dat_len - off, &t) != KSI_OK) return KSI_INVALID_FORMAT;
+
+		if (t.tag == STORE_RFC3161_TAG || t.tag == STORE_AGGR_CHAIN_TAG) {
+			res = readChainInput(payload + off + t.hdr_len, t.dat_len, &indexLen, &chainImprint, &chainImprint_len);
+			if (res != KSI_OK) return res;
+
+			/* The RFC3161 record precedes the aggregation hash chains. */
+			if (t.tag == STORE_RFC3161_TAG) {
+				*imprint = chainImprint;
+				*imprint_len = chainImprint_len;
+				return KSI_OK;
+			}
+
+			/* The lowest aggregation hash chain has the longest chain index. */
+			if (*imprint == NULL || indexLen > bestLen) {
+				*imprint = chainImprint;
+				*imprint_len = chainImprint_len;
+				bestLen = indexLen;
+			}
+		}
+
+		off += t.hdr_len + t.dat_len;
+	}
+
+	return *imprint != NULL ? KSI_OK : KSI_INVALID_FORMAT;
+}
+
+static int buildHashIndex(KSI_SignatureStore *store) {
+	int res = KSI_UNKNOWN_ERROR;
+	StoreHashEntry *tmp = NULL;
+	size_t i;
+
+	tmp = KSI_malloc((store->count > 0 ? store->count : 1) * sizeof(StoreHashEntry));
+	if (tmp == NULL) {
+		KSI_pushError(store->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < store->count; i++) {
+		res = readDocumentImprint(store->raw + store->index[i].off, &store->index[i], &tmp[i].imprint, &tmp[i].imprint_len);
+		if (res != KSI_OK) {
+			KSI_pushError(store->ctx, res, "Unable to read the document hash of the signature.");
+			goto cleanup;
+		}
+		tmp[i].recNo = i;
+	}
+
+	qsort(tmp, store->count, sizeof(StoreHashEntry), compareHashEntry);
+
+	store->hashIndex = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
+}
+
+static int getHashEntryImprint(const void *data, size_t i, const unsigned char **imprint, size_t *imprint_len) {
+	const StoreHashEntry *hashIndex = data;
+
+	*imprint = hashIndex[i].imprint;
+	*imprint_len = hashIndex[i].imprint_len;
+
+	return KSI_OK;
+}
+
+int KSI_SignatureStore_indexOf(KSI_SignatureStore *store, const KSI_DataHash *hsh, size_t **pos) {
+	int res = KSI_UNKNOWN_ERROR;
+	const unsigned char *imprint = NULL;
+	size_t imprint_len = 0;
+	size_t *tmp = NULL;
+	size_t lo;
+	int found;
+
+	if (store == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_ERR_clearErrors(store->ctx);
+
+	if (store->container != NULL) {
+		res = KSI_SignatureContainer_indexOf(store->container, hsh, pos);
+		if (res != KSI_OK) {
+			KSI_pushError(store->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = KSI_OK;
+		goto cleanup;
+	}
+
+	if (hsh == NULL || pos == NULL) {
+		KSI_pushError(store->ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_DataHash_getImprint(hsh, &imprint, &imprint_len);
+	if (res != KSI_OK) {
+		KSI_pushError(store->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	if (store->hashIndex == NULL) {
+		res = buildHashIndex(store);
+		if (res != KSI_OK) {
+			KSI_pushError(store->ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	res = KSI_Imprint_lowerBound(store->hashIndex, store->count, getHashEntryImprint, imprint, imprint_len, &lo, &found);
+	if (res != KSI_OK) {
+		KSI_pushError(store->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	*pos = NULL;
+
+	if (found) {
+		tmp = KSI_malloc(sizeof(size_t));
+		if (tmp == NULL) {
+			KSI_pushError(store->ctx, res = KSI_OUT_OF_MEMORY, NULL);
+			goto cleanup;
+		}
+
+		*tmp = store->hashIndex[lo].recNo;
+		*pos = tmp;
+		tmp = NULL;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
+}
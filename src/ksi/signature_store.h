@@ -0,0 +1,100 @@
+/*
+ * Copyright 2013-2016 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#ifndef SIGNATURE_STORE_H_
+#define SIGNATURE_STORE_H_
+
+#include "ksi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \addtogroup signaturestore Signature Store
+ * The signature store gives read-only access to a file of signatures without reading the
+ * whole file. The file is mapped into memory and may contain either concatenated
+ * signatures or a signature container (see #KSI_SignatureContainer). For concatenated
+ * signatures only the TLV headers are scanned when the store is opened; the signatures
+ * are parsed when they are accessed. To iterate over the store, call
+ * #KSI_SignatureStore_getSignature for the record numbers from 0 to
+ * #KSI_SignatureStore_getCount - 1.
+ * @{
+ */
+
+typedef struct KSI_SignatureStore_st KSI_SignatureStore;
+
+/**
+ * Maps the signature file into memory and indexes the signatures.
+ * \param[in]	ctx			KSI context.
+ * \param[in]	fileName	Path to the file.
+ * \param[out]	store		Pointer to the receiving pointer.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The file must not be modified while the store is in use.
+ * \see #KSI_SignatureStore_free
+ */
+int KSI_SignatureStore_open(KSI_CTX *ctx, const char *fileName, KSI_SignatureStore **store);
+
+/**
+ * Cleanup method for the #KSI_SignatureStore.
+ * \param[in]	store		Instance of the #KSI_SignatureStore.
+ */
+void KSI_SignatureStore_free(KSI_SignatureStore *store);
+
+/**
+ * Returns the number of signatures in the store.
+ * \param[in]	store		Instance of the #KSI_SignatureStore.
+ */
+size_t KSI_SignatureStore_getCount(const KSI_SignatureStore *store);
+
+/**
+ * Parses the signature \c index of the store and verifies it with the provided policy
+ * and context.
+ * \param[in]	store		Instance of the #KSI_SignatureStore.
+ * \param[in]	index		Record number.
+ * \param[in]	policy		Verification policy.
+ * \param[in]	context		Verification context.
+ * \param[out]	sig			Pointer to the receiving pointer.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ */
+int KSI_SignatureStore_getSignatureWithPolicy(const KSI_SignatureStore *store, size_t index, const KSI_Policy *policy, KSI_VerificationContext *context, KSI_Signature **sig);
+
+#define KSI_SignatureStore_getSignature(store, index, sig) KSI_SignatureStore_getSignatureWithPolicy(store, index, KSI_VERIFICATION_POLICY_INTERNAL, NULL, sig)
+
+/**
+ * Finds the first signature of the document hash. For concatenated signatures the document
+ * hashes are read from the encoded signatures and sorted on the first call.
+ * \param[in]	store		Instance of the #KSI_SignatureStore.
+ * \param[in]	hsh			Document hash.
+ * \param[out]	pos			Pointer to the receiving pointer of the record number; set to \c NULL
+ * 							if there is no such signature.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The record number belongs to the caller and needs to be freed using #KSI_free.
+ */
+int KSI_SignatureStore_indexOf(KSI_SignatureStore *store, const KSI_DataHash *hsh, size_t **pos);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIGNATURE_STORE_H_ */
@@ -0,0 +1,426 @@
+/*
+ * Copyright 2013-2016 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#include <string.h>
+
+#include "internal.h"
+#include "blocksigner.h"
+#include "signing_queue.h"
+#include "metrics_impl.h"
+#include "thread.h"
+
+typedef struct QueueItem_st {
+	/** Copy of the imprint, the hash object of the producer is not shared with the worker. */
+	unsigned char imprint[KSI_MAX_IMPRINT_LEN];
+	size_t imprint_len;
+	KSI_SigningQueueCallback fn;
+	void *c;
+} QueueItem;
+
+struct KSI_SigningQueue_st {
+	/** Context of the worker thread, never used by the producers. */
+	KSI_CTX *ctx;
+
+	/** Number of queued hashes that triggers the signing. */
+	size_t maxCount;
+	/** Time limit of a queued hash in microseconds. */
+	KSI_uint64_t maxDelay;
+
+	/** Protects the fields up to the batch, which is only accessed by the worker. */
+	KSI_Mutex *lock;
+	/** Broadcast when hashes are added, a batch is finished or the worker is stopped. */
+	KSI_Cond *changed;
+	KSI_Thread *worker;
+	int stop;
+
+	/** Hashes waiting to be signed. */
+	QueueItem *pending;
+	size_t pending_count;
+	/** Time the oldest pending hash was added, see #KSI_Metrics_now. */
+	KSI_uint64_t pending_since;
+
+	/** Number of hashes added and number of hashes whose callback has been called. */
+	size_t added;
+	size_t done;
+	/** The hashes added before this count are signed regardless of the limits. */
+	size_t flushUpTo;
+	/** Status of the last signed batch. */
+	int lastStatus;
+
+	/** Hashes being signed, swapped with \c pending at the start of signing. */
+	QueueItem *batch;
+	size_t batch_count;
+	/** Hashes and signatures of the batch created in the worker context. */
+	KSI_DataHash **batch_hsh;
+	KSI_Signature **batch_sig;
+	size_t batch_sigCount;
+};
+
+static void workerMain(void *arg);
+
+void KSI_SigningQueue_free(KSI_SigningQueue *queue) {
+	if (queue != NULL) {
+		if (queue->worker != NULL) {
+			KSI_Mutex_lock(queue->lock);
+			queue->stop = 1;
+			KSI_Cond_broadcast(queue->changed);
+			KSI_Mutex_unlock(queue->lock);
+
+			KSI_Thread_join(queue->worker);
+		}
+
+		KSI_Cond_free(queue->changed);
+		KSI_Mutex_free(queue->lock);
+		KSI_free(queue->pending);
+		KSI_free(queue->batch);
+		KSI_free(queue->batch_hsh);
+		KSI_free(queue->batch_sig);
+		KSI_free(queue);
+	}
+}
+
+int KSI_SigningQueue_new(KSI_CTX *ctx, size_t maxCount, unsigned maxDelay, KSI_SigningQueue **queue) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_SigningQueue *tmp = NULL;
+
+	KSI_ERR_clearErrors(ctx);
+
+	if (ctx == NULL || maxCount == 0 || queue == NULL) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, NULL);
+		goto cleanup;
+	}
+
+	if (maxCount > ((size_t)-1) / sizeof(QueueItem)) {
+		KSI_pushError(ctx, res = KSI_INVALID_ARGUMENT, "Signing queue size too large.");
+		goto cleanup;
+	}
+
+	tmp = KSI_new(KSI_SigningQueue);
+	if (tmp == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	tmp->ctx = ctx;
+	tmp->maxCount = maxCount;
+	tmp->maxDelay = (KSI_uint64_t)maxDelay * 1000;
+	tmp->lock = NULL;
+	tmp->changed = NULL;
+	tmp->worker = NULL;
+	tmp->stop = 0;
+	tmp->pending = NULL;
+	tmp->pending_count = 0;
+	tmp->pending_since = 0;
+	tmp->added = 0;
+	tmp->done = 0;
+	tmp->flushUpTo = 0;
+	tmp->lastStatus = KSI_OK;
+	tmp->batch = NULL;
+	tmp->batch_count = 0;
+	tmp->batch_hsh = NULL;
+	tmp->batch_sig = NULL;
+	tmp->batch_sigCount = 0;
+
+	tmp->pending = KSI_malloc(maxCount * sizeof(QueueItem));
+	tmp->batch = KSI_malloc(maxCount * sizeof(QueueItem));
+	tmp->batch_hsh = KSI_calloc(maxCount, sizeof(KSI_DataHash *));
+	tmp->batch_sig = KSI_calloc(maxCount, sizeof(KSI_Signature *));
+	if (tmp->pending == NULL || tmp->batch == NULL || tmp->batch_hsh == NULL || tmp->batch_sig == NULL) {
+		KSI_pushError(ctx, res = KSI_OUT_OF_MEMORY, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_Mutex_new(&tmp->lock);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_Cond_new(&tmp->changed);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
+	/* The worker may only look at the queue once the thread handle is stored. */
+	KSI_Mutex_lock(tmp->lock);
+	res = KSI_Thread_new(workerMain, tmp, &tmp->worker);
+	KSI_Mutex_unlock(tmp->lock);
+	if (res != KSI_OK) {
+		KSI_pushError(ctx, res, "Unable to start the signing queue thread.");
+		goto cleanup;
+	}
+
+	*queue = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_SigningQueue_free(tmp);
+
+	return res;
+}
+
+static int collectSignature(KSI_BlockSignerHandle *handle, KSI_Signature *sig, void *c) {
+	KSI_SigningQueue *queue = c;
+
+	/* The leafs are reported in the order they were added. */
+	if (queue->batch_sigCount >= queue->batch_count) return KSI_INVALID_STATE;
+	queue->batch_sig[queue->batch_sigCount++] = KSI_Signature_ref(sig);
+
+	return KSI_OK;
+}
+
+/* Runs in the worker thread without holding the lock. */
+static int signBatch(KSI_SigningQueue *queue) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_BlockSigner *signer = NULL;
+	QueueItem *item = NULL;
+	int cbRes;
+	int cbStatus = KSI_OK;
+	size_t i;
+
+	KSI_ERR_clearErrors(queue->ctx);
+
+	KSI_LOG_debug(queue->ctx, "Signing queue: signing a batch of %llu data hashes.", (unsigned long long)queue->batch_count);
+
+	queue->batch_sigCount = 0;
+
+	/* Every batch is masked with a new initial value. */
+	res = KSI_BlockSigner_newMasked(queue->ctx, KSI_getHashAlgorithmByName("default"), &signer);
+	if (res != KSI_OK) {
+		KSI_pushError(queue->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	for (i = 0; i < queue->batch_count; i++) {
+		res = KSI_DataHash_fromImprint(queue->ctx, queue->batch[i].imprint, queue->batch[i].imprint_len, &queue->batch_hsh[i]);
+		if (res != KSI_OK) {
+			KSI_pushError(queue->ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = KSI_BlockSigner_add(signer, queue->batch_hsh[i]);
+		if (res != KSI_OK) {
+			KSI_pushError(queue->ctx, res, NULL);
+			goto cleanup;
+		}
+	}
+
+	res = KSI_BlockSigner_closeAndSign(signer);
+	if (res != KSI_OK) {
+		KSI_pushError(queue->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_BlockSigner_getSignatures(signer, collectSignature, queue);
+	if (res != KSI_OK) {
+		KSI_pushError(queue->ctx, res, NULL);
+		goto cleanup;
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_BlockSigner_free(signer);
+
+	/* Everybody gets a result, the ones without a signature get the failure. */
+	for (i = 0; i < queue->batch_count; i++) {
+		item = &queue->batch[i];
+
+		if (queue->batch_hsh[i] != NULL) {
+			/* A failing callback must not keep the rest of the batch from their results. */
+			if (i < queue->batch_sigCount) {
+				cbRes = item->fn(queue->batch_hsh[i], KSI_OK, queue->batch_sig[i], item->c);
+			} else {
+				cbRes = item->fn(queue->batch_hsh[i], res != KSI_OK ? res : KSI_INVALID_STATE, NULL, item->c);
+			}
+		} else {
+			cbRes = item->fn(NULL, res != KSI_OK ? res : KSI_INVALID_STATE, NULL, item->c);
+		}
+
+		if (cbRes != KSI_OK && cbStatus == KSI_OK) cbStatus = cbRes;
+
+		KSI_Signature_free(queue->batch_sig[i]);
+		queue->batch_sig[i] = NULL;
+		KSI_DataHash_free(queue->batch_hsh[i]);
+		queue->batch_hsh[i] = NULL;
+	}
+	queue->batch_sigCount = 0;
+
+	return res != KSI_OK ? res : cbStatus;
+}
+
+static int isReady(const KSI_SigningQueue *queue, unsigned *timeout) {
+	KSI_uint64_t elapsed;
+
+	if (queue->pending_count >= queue->maxCount || queue->flushUpTo > queue->done) return 1;
+
+	elapsed = KSI_Metrics_now() - queue->pending_since;
+	if (elapsed >= queue->maxDelay) return 1;
+
+	/* Round up, so that the batch has expired when the timeout has passed. */
+	*timeout = (unsigned)((queue->maxDelay - elapsed + 999) / 1000);
+	return 0;
+}
+
+static void workerMain(void *arg) {
+	KSI_SigningQueue *queue = arg;
+	QueueItem *tmp = NULL;
+	unsigned timeout = 0;
+	int res;
+
+	KSI_Mutex_lock(queue->lock);
+
+	while (!queue->stop) {
+		if (queue->pending_count == 0) {
+			KSI_Cond_wait(queue->changed, queue->lock);
+			continue;
+		}
+
+		if (!isReady(queue, &timeout)) {
+			KSI_Cond_timedWait(queue->changed, queue->lock, timeout);
+			continue;
+		}
+
+		/* Take the pending hashes, the producers may keep adding while the batch is signed. */
+		tmp = queue->batch;
+		queue->batch = queue->pending;
+		queue->pending = tmp;
+		queue->batch_count = queue->pending_count;
+		queue->pending_count = 0;
+
+		KSI_Mutex_unlock(queue->lock);
+		res = signBatch(queue);
+		KSI_Mutex_lock(queue->lock);
+
+		queue->done += queue->batch_count;
+		queue->batch_count = 0;
+		queue->lastStatus = res;
+		KSI_Cond_broadcast(queue->changed);
+	}
+
+	KSI_Mutex_unlock(queue->lock);
+}
+
+int KSI_SigningQueue_add(KSI_SigningQueue *queue, KSI_DataHash *hsh, KSI_SigningQueueCallback fn, void *c) {
+	int res = KSI_UNKNOWN_ERROR;
+	QueueItem *item = NULL;
+	const unsigned char *imprint = NULL;
+	size_t imprint_len = 0;
+	int locked = 0;
+
+	if (queue == NULL || hsh == NULL || fn == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	res = KSI_DataHash_getImprint(hsh, &imprint, &imprint_len);
+	if (res != KSI_OK) goto cleanup;
+
+	if (imprint_len > KSI_MAX_IMPRINT_LEN) {
+		res = KSI_INVALID_FORMAT;
+		goto cleanup;
+	}
+
+	KSI_Mutex_lock(queue->lock);
+	locked = 1;
+
+	while (queue->pending_count >= queue->maxCount) {
+		/* The worker can not wait for itself, the callbacks may only add while there is room. */
+		if (KSI_Thread_isCurrent(queue->worker)) {
+			res = KSI_INVALID_STATE;
+			goto cleanup;
+		}
+		KSI_Cond_wait(queue->changed, queue->lock);
+	}
+
+	if (queue->pending_count == 0) {
+		queue->pending_since = KSI_Metrics_now();
+	}
+
+	item = &queue->pending[queue->pending_count++];
+	memcpy(item->imprint, imprint, imprint_len);
+	item->imprint_len = imprint_len;
+	item->fn = fn;
+	item->c = c;
+	queue->added++;
+
+	/* The worker waits without a time limit while the queue is empty. */
+	if (queue->pending_count == 1 || queue->pending_count >= queue->maxCount) {
+		KSI_Cond_broadcast(queue->changed);
+	}
+
+	res = KSI_OK;
+
+cleanup:
+
+	if (locked) KSI_Mutex_unlock(queue->lock);
+
+	return res;
+}
+
+int KSI_SigningQueue_flush(KSI_SigningQueue *queue) {
+	int res = KSI_UNKNOWN_ERROR;
+	size_t target;
+
+	if (queue == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	KSI_Mutex_lock(queue->lock);
+
+	target = queue->added;
+	res = KSI_OK;
+
+	if (queue->done < target) {
+		queue->flushUpTo = target;
+		KSI_Cond_broadcast(queue->changed);
+
+		/* From a callback the signing can only be requested. */
+		if (!KSI_Thread_isCurrent(queue->worker)) {
+			while (queue->done < target) {
+				KSI_Cond_wait(queue->changed, queue->lock);
+			}
+			res = queue->lastStatus;
+		}
+	}
+
+	KSI_Mutex_unlock(queue->lock);
+
+cleanup:
+
+	return res;
+}
+
+size_t KSI_SigningQueue_getPendingCount(const KSI_SigningQueue *queue) {
+	size_t count;
+
+	if (queue == NULL) return 0;
+
+	KSI_Mutex_lock(queue->lock);
+	count = queue->pending_count;
+	KSI_Mutex_unlock(queue->lock);
+
+	return count;
+}
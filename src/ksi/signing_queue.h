@@ -0,0 +1,120 @@
+/*
+ * Copyright 2013-2016 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#ifndef SIGNING_QUEUE_H_
+#define SIGNING_QUEUE_H_
+
+#include "ksi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \addtogroup signingqueue Signing Queue
+ * The signing queue collects data hashes from the producers and signs them in batches
+ * with a single aggregation request (see #KSI_BlockSigner). A batch is signed when
+ * the configured number of hashes is queued or the oldest queued hash has waited for
+ * the configured time, whichever comes first. The result of each hash is delivered to
+ * the callback given when the hash was added.
+ *
+ * The queue is thread-safe: #KSI_SigningQueue_add, #KSI_SigningQueue_flush and
+ * #KSI_SigningQueue_getPendingCount may be called from any number of threads. The
+ * batches are signed by a worker thread of the queue, which also enforces the time
+ * limit and calls the callbacks. The worker is the only user of the #KSI_CTX given
+ * to #KSI_SigningQueue_new, so the producers need contexts of their own and the
+ * errors of the queue functions are only reported by their return values.
+ * @{
+ */
+
+typedef struct KSI_SigningQueue_st KSI_SigningQueue;
+
+/**
+ * Callback function type for the results of #KSI_SigningQueue_add. The callback is called
+ * from the worker thread of the queue.
+ * \param[in]	hsh			Copy of the data hash that was added to the queue, created in the context
+ * 							of the queue; \c NULL if the copy could not be created.
+ * \param[in]	status		Status code of signing the batch containing \c hsh.
+ * \param[in]	sig			The signature of \c hsh or \c NULL if \c status is not #KSI_OK.
+ * \param[in]	c			User context given to #KSI_SigningQueue_add.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \note The hash and the signature are freed after the callback returns, use #KSI_DataHash_ref and
+ * #KSI_Signature_ref to keep them. The signatures of a batch share their components, use
+ * #KSI_Signature_clone to pass a signature to another thread.
+ */
+typedef int (*KSI_SigningQueueCallback)(KSI_DataHash *hsh, int status, KSI_Signature *sig, void *c);
+
+/**
+ * Creates a new signing queue and starts its worker thread.
+ * \param[in]	ctx			KSI context for signing the batches. It is used by the worker thread
+ * 							and may not be used by any other thread until the queue is freed.
+ * \param[in]	maxCount	Number of queued hashes that triggers signing of the batch (> 0).
+ * \param[in]	maxDelay	Maximum time in milliseconds a hash may wait in the queue.
+ * \param[out]	queue		Pointer to the receiving pointer.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ * \see #KSI_SigningQueue_free
+ */
+int KSI_SigningQueue_new(KSI_CTX *ctx, size_t maxCount, unsigned maxDelay, KSI_SigningQueue **queue);
+
+/**
+ * Cleanup method for the #KSI_SigningQueue. Waits for the batch being signed and stops the
+ * worker thread. The hashes still in the queue are dropped without calling their callbacks,
+ * use #KSI_SigningQueue_flush beforehand to sign them.
+ * \param[in]	queue		Instance of the #KSI_SigningQueue.
+ * \note The function may not be called from the callbacks nor while other threads use the queue.
+ */
+void KSI_SigningQueue_free(KSI_SigningQueue *queue);
+
+/**
+ * Adds a data hash to the queue. The signing itself is done by the worker thread, so the
+ * function only blocks while the queue is full. In the callbacks, adding to a full queue
+ * fails with #KSI_INVALID_STATE.
+ * \param[in]	queue		Instance of the #KSI_SigningQueue.
+ * \param[in]	hsh			Data hash to be signed; the queue copies its value and keeps no reference.
+ * \param[in]	fn			Callback receiving the signature.
+ * \param[in]	c			User context for the callback.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+ */
+int KSI_SigningQueue_add(KSI_SigningQueue *queue, KSI_DataHash *hsh, KSI_SigningQueueCallback fn, void *c);
+
+/**
+ * Signs the queued hashes regardless of the limits and waits until the callbacks of all
+ * the hashes added before the call have been called. In the callbacks the function only
+ * requests the signing and returns.
+ * \param[in]	queue		Instance of the #KSI_SigningQueue.
+ * \return status code (#KSI_OK, when operation succeeded, otherwise an error code). If the
+ * function waited for signing, the status of the last signed batch is returned.
+ */
+int KSI_SigningQueue_flush(KSI_SigningQueue *queue);
+
+/**
+ * Returns the number of hashes waiting in the queue, not counting the batch being signed.
+ * \param[in]	queue		Instance of the #KSI_SigningQueue.
+ */
+size_t KSI_SigningQueue_getPendingCount(const KSI_SigningQueue *queue);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIGNING_QUEUE_H_ */
@@ -0,0 +1,304 @@
+/*
+ * Copyright 2013-2016 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <process.h>
+#else
+#  include <pthread.h>
+#  include <sys/time.h>
+#endif
+
+#include "internal.h"
+#include "thread.h"
+
+struct KSI_Mutex_st {
+#ifdef _WIN32
+	CRITICAL_SECTION cs;
+#else
+	pthread_mutex_t mutex;
+#endif
+};
+
+int KSI_Mutex_new(KSI_Mutex **mutex) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_Mutex *tmp = NULL;
+
+	if (mutex == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	tmp = KSI_new(KSI_Mutex);
+	if (tmp == NULL) {
+		res = KSI_OUT_OF_MEMORY;
+		goto cleanup;
+	}
+
+#ifdef _WIN32
+	InitializeCriticalSection(&tmp->cs);
+#else
+	if (pthread_mutex_init(&tmp->mutex, NULL) != 0) {
+		res = KSI_UNKNOWN_ERROR;
+		goto cleanup;
+	}
+#endif
+
+	*mutex = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
+}
+
+void KSI_Mutex_free(KSI_Mutex *mutex) {
+	if (mutex != NULL) {
+#ifdef _WIN32
+		DeleteCriticalSection(&mutex->cs);
+#else
+		pthread_mutex_destroy(&mutex->mutex);
+#endif
+		KSI_free(mutex);
+	}
+}
+
+void KSI_Mutex_lock(KSI_Mutex *mutex) {
+#ifdef _WIN32
+	EnterCriticalSection(&mutex->cs);
+#else
+	pthread_mutex_lock(&mutex->mutex);
+#endif
+}
+
+void KSI_Mutex_unlock(KSI_Mutex *mutex) {
+#ifdef _WIN32
+	LeaveCriticalSection(&mutex->cs);
+#else
+	pthread_mutex_unlock(&mutex->mutex);
+#endif
+}
+
+struct KSI_Cond_st {
+#ifdef _WIN32
+	CONDITION_VARIABLE cv;
+#else
+	pthread_cond_t cond;
+#endif
+};
+
+int KSI_Cond_new(KSI_Cond **cond) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_Cond *tmp = NULL;
+
+	if (cond == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	tmp = KSI_new(KSI_Cond);
+	if (tmp == NULL) {
+		res = KSI_OUT_OF_MEMORY;
+		goto cleanup;
+	}
+
+#ifdef _WIN32
+	InitializeConditionVariable(&tmp->cv);
+#else
+	if (pthread_cond_init(&tmp->cond, NULL) != 0) {
+		res = KSI_UNKNOWN_ERROR;
+		goto cleanup;
+	}
+#endif
+
+	*cond = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
+}
+
+void KSI_Cond_free(KSI_Cond *cond) {
+	if (cond != NULL) {
+#ifndef _WIN32
+		pthread_cond_destroy(&cond->cond);
+#endif
+		KSI_free(cond);
+	}
+}
+
+void KSI_Cond_wait(KSI_Cond *cond, KSI_Mutex *mutex) {
+#ifdef _WIN32
+	SleepConditionVariableCS(&cond->cv, &mutex->cs, INFINITE);
+#else
+	pthread_cond_wait(&cond->cond, &mutex->mutex);
+#endif
+}
+
+void KSI_Cond_timedWait(KSI_Cond *cond, KSI_Mutex *mutex, unsigned ms) {
+#ifdef _WIN32
+	SleepConditionVariableCS(&cond->cv, &mutex->cs, ms);
+#else
+	struct timeval now;
+	struct timespec until;
+
+	/* The condition uses the real time clock, a clock change only causes an early or late wake-up. */
+	gettimeofday(&now, NULL);
+	until.tv_sec = now.tv_sec + ms / 1000;
+	until.tv_nsec = (long)now.tv_usec * 1000 + (long)(ms % 1000) * 1000000;
+	if (until.tv_nsec >= 1000000000) {
+		until.tv_sec++;
+		until.tv_nsec -= 1000000000;
+	}
+
+	pthread_cond_timedwait(&cond->cond, &mutex->mutex, &until);
+#endif
+}
+
+void KSI_Cond_broadcast(KSI_Cond *cond) {
+#ifdef _WIN32
+	WakeAllConditionVariable(&cond->cv);
+#else
+	pthread_cond_broadcast(&cond->cond);
+#endif
+}
+
+struct KSI_Thread_st {
+	KSI_ThreadFunc fn;
+	void *arg;
+#ifdef _WIN32
+	HANDLE handle;
+	unsigned id;
+#else
+	pthread_t thread;
+#endif
+};
+
+#ifdef _WIN32
+static unsigned __stdcall threadMain(void *arg) {
+	KSI_Thread *thread = arg;
+	thread->fn(thread->arg);
+	return 0;
+}
+#else
+static void *threadMain(void *arg) {
+	KSI_Thread *thread = arg;
+	thread->fn(thread->arg);
+	return NULL;
+}
+#endif
+
+int KSI_Thread_new(KSI_ThreadFunc fn, void *arg, KSI_Thread **thread) {
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_Thread *tmp = NULL;
+
+	if (fn == NULL || thread == NULL) {
+		res = KSI_INVALID_ARGUMENT;
+		goto cleanup;
+	}
+
+	tmp = KSI_new(KSI_Thread);
+	if (tmp == NULL) {
+		res = KSI_OUT_OF_MEMORY;
+		goto cleanup;
+	}
+
+	tmp->fn = fn;
+	tmp->arg = arg;
+
+#ifdef _WIN32
+	tmp->handle = (HANDLE)_beginthreadex(NULL, 0, threadMain, tmp, 0, &tmp->id);
+	if (tmp->handle == 0) {
+		res = KSI_UNKNOWN_ERROR;
+		goto cleanup;
+	}
+#else
+	if (pthread_create(&tmp->thread, NULL, threadMain, tmp) != 0) {
+		res = KSI_UNKNOWN_ERROR;
+		goto cleanup;
+	}
+#endif
+
+	*thread = tmp;
+	tmp = NULL;
+
+	res = KSI_OK;
+
+cleanup:
+
+	KSI_free(tmp);
+
+	return res;
+}
+
+void KSI_Thread_join(KSI_Thread *thread) {
+	if (thread != NULL) {
+#ifdef _WIN32
+		WaitForSingleObject(thread->handle, INFINITE);
+		CloseHandle(thread->handle);
+#else
+		pthread_join(thread->thread, NULL);
+#endif
+		KSI_free(thread);
+	}
+}
+
+int KSI_Thread_isCurrent(const KSI_Thread *thread) {
+	if (thread == NULL) return 0;
+#ifdef _WIN32
+	return GetCurrentThreadId() == thread->id;
+#else
+	return pthread_equal(pthread_self(), thread->thread);
+#endif
+}
+
+size_t KSI_Atomic_loadSize(const volatile size_t *ptr) {
+#if defined(_WIN32)
+	size_t val = *ptr;
+	MemoryBarrier();
+	return val;
+#elif defined(__ATOMIC_ACQUIRE)
+	return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#else
+	size_t val = *ptr;
+	__sync_synchronize();
+	return val;
+#endif
+}
+
+void KSI_Atomic_storeSize(volatile size_t *ptr, size_t val) {
+#if defined(_WIN32)
+	MemoryBarrier();
+	*ptr = val;
+#elif defined(__ATOMIC_RELEASE)
+	__atomic_store_n(ptr, val, __ATOMIC_RELEASE);
+#else
+	__sync_synchronize();
+	*ptr = val;
+#endif
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright 2013-2016 Guardtime, Inc.
+ *
+ * This file is part of the Guardtime client SDK.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES, CONDITIONS, OR OTHER LICENSES OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ * "Guardtime" and "KSI" are trademarks or registered trademarks of
+ * Guardtime, Inc., and no license to trademarks is granted; Guardtime
+ * reserves and retains all trademark rights.
+ */
+
+#ifndef THREAD_H_
+#define THREAD_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+	/**
+	 * The library does not share a #KSI_CTX between threads. The few objects that are
+	 * meant to be used from several threads, each with its own context, synchronize
+	 * through the primitives below: POSIX threads, or the Win32 API on Windows.
+	 */
+
+	typedef struct KSI_Mutex_st KSI_Mutex;
+
+	/**
+	 * Creates a non-recursive mutex.
+	 * \param[out]	mutex		Pointer to the receiving pointer.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_Mutex_new(KSI_Mutex **mutex);
+
+	/**
+	 * Cleanup method for the #KSI_Mutex. The mutex may not be locked.
+	 * \param[in]	mutex		Instance of the #KSI_Mutex.
+	 */
+	void KSI_Mutex_free(KSI_Mutex *mutex);
+
+	void KSI_Mutex_lock(KSI_Mutex *mutex);
+
+	void KSI_Mutex_unlock(KSI_Mutex *mutex);
+
+	typedef struct KSI_Cond_st KSI_Cond;
+
+	/**
+	 * Creates a condition variable.
+	 * \param[out]	cond		Pointer to the receiving pointer.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_Cond_new(KSI_Cond **cond);
+
+	/**
+	 * Cleanup method for the #KSI_Cond. No thread may be waiting on the condition.
+	 * \param[in]	cond		Instance of the #KSI_Cond.
+	 */
+	void KSI_Cond_free(KSI_Cond *cond);
+
+	/**
+	 * Unlocks the mutex, waits until the condition is signalled and locks the mutex again.
+	 * The wait may also end spuriously, so the caller must check its condition in a loop.
+	 * \param[in]	cond		Instance of the #KSI_Cond.
+	 * \param[in]	mutex		Mutex locked by the calling thread.
+	 */
+	void KSI_Cond_wait(KSI_Cond *cond, KSI_Mutex *mutex);
+
+	/**
+	 * Same as #KSI_Cond_wait, but waits for at most \c ms milliseconds.
+	 * \param[in]	cond		Instance of the #KSI_Cond.
+	 * \param[in]	mutex		Mutex locked by the calling thread.
+	 * \param[in]	ms			Time limit in milliseconds.
+	 */
+	void KSI_Cond_timedWait(KSI_Cond *cond, KSI_Mutex *mutex, unsigned ms);
+
+	/**
+	 * Wakes up all the threads waiting on the condition.
+	 * \param[in]	cond		Instance of the #KSI_Cond.
+	 */
+	void KSI_Cond_broadcast(KSI_Cond *cond);
+
+	typedef struct KSI_Thread_st KSI_Thread;
+
+	/**
+	 * Thread entry point.
+	 * \param[in]	arg			Argument given to #KSI_Thread_new.
+	 */
+	typedef void (*KSI_ThreadFunc)(void *arg);
+
+	/**
+	 * Starts a new thread running \c fn. The thread must be joined with #KSI_Thread_join.
+	 * \param[in]	fn			Thread entry point.
+	 * \param[in]	arg			Argument for \c fn.
+	 * \param[out]	thread		Pointer to the receiving pointer.
+	 * \return status code (#KSI_OK, when operation succeeded, otherwise an error code).
+	 */
+	int KSI_Thread_new(KSI_ThreadFunc fn, void *arg, KSI_Thread **thread);
+
+	/**
+	 * Waits for the thread to return and frees it.
+	 * \param[in]	thread		Instance of the #KSI_Thread.
+	 */
+	void KSI_Thread_join(KSI_Thread *thread);
+
+	/**
+	 * Checks if the function is called from the given thread.
+	 * \param[in]	thread		Instance of the #KSI_Thread.
+	 * \return Non-zero if \c thread is the calling thread, 0 otherwise.
+	 */
+	int KSI_Thread_isCurrent(const KSI_Thread *thread);
+
+	/**
+	 * Reads a value published by another thread with #KSI_Atomic_storeSize. Everything
+	 * the other thread wrote before storing the value is visible after this call.
+	 * \param[in]	ptr			Pointer to the value.
+	 * \return The value.
+	 */
+	size_t KSI_Atomic_loadSize(const volatile size_t *ptr);
+
+	/**
+	 * Publishes a value to other threads, see #KSI_Atomic_loadSize.
+	 * \param[in]	ptr			Pointer to the value.
+	 * \param[in]	val			New value.
+	 */
+	void KSI_Atomic_storeSize(volatile size_t *ptr, size_t val);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* THREAD_H_ */
@@ -36,7 +36,7 @@ KSI_IMPLEMENT_REF(KSI_TreeLeafHandle);
 
 KSI_IMPLEMENT_LIST(KSI_TreeLeafHandle, KSI_TreeLeafHandle_free);
 
-static int KSI_TreeNode_join(KSI_CTX *ctx, KSI_DataHasher *hsr, KSI_TreeNode *leftSibling, KSI_TreeNode *rightSibling, KSI_TreeNode **root);
+static int KSI_TreeNode_join(KSI_CTX *ctx, KSI_TreeBuilder *builder, KSI_TreeNode *leftSibling, KSI_TreeNode *rightSibling, KSI_TreeNode **root);
 
 void KSI_TreeNode_free(KSI_TreeNode *node) {
 	if (node != NULL ) {
@@ -114,46 +114,90 @@ cleanup:
 	return res;
 }
 
-static int joinHashes(KSI_CTX *ctx, KSI_DataHasher *hsr, const KSI_TreeNode *left, const KSI_TreeNode *right, int level, KSI_DataHash **root) {
+static int joinHashes(KSI_CTX *ctx, KSI_TreeBuilder *builder, const KSI_TreeNode *left, const KSI_TreeNode *right, int level, KSI_DataHash **root) {
 	int res = KSI_UNKNOWN_ERROR;
+	KSI_DataHasher *hsr = NULL;
 	KSI_DataHash *tmp = NULL;
+	KSI_HashInput input[3];
+	const unsigned char *leftImprint = NULL;
+	size_t leftImprint_len = 0;
+	const unsigned char *rightImprint = NULL;
+	size_t rightImprint_len = 0;
+	unsigned char imprint[KSI_MAX_IMPRINT_LEN];
+	size_t imprint_len = 0;
 	unsigned char l;
 
-	if (left == NULL || right == NULL || !KSI_IS_VALID_TREE_LEVEL(level) || root == NULL) {
+	if (builder == NULL || left == NULL || right == NULL || !KSI_IS_VALID_TREE_LEVEL(level) || root == NULL) {
 		res = KSI_INVALID_ARGUMENT;
 		goto cleanup;
 	}
 
 	l = (unsigned char) level;
 
-	res = KSI_DataHasher_reset(hsr);
-	if (res != KSI_OK) {
-		KSI_pushError(ctx, res, NULL);
-		goto cleanup;
-	}
+	/* Fast path: both children are hash values, hash them without the hasher. */
+	if (left->hash != NULL && right->hash != NULL) {
+		res = KSI_DataHash_getImprint(left->hash, &leftImprint, &leftImprint_len);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
 
-	res = KSI_DataHasher_addTreeNode(hsr, left);
-	if (res != KSI_OK) {
-		KSI_pushError(ctx, res, NULL);
-		goto cleanup;
-	}
+		res = KSI_DataHash_getImprint(right->hash, &rightImprint, &rightImprint_len);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
 
-	res = KSI_DataHasher_addTreeNode(hsr, right);
-	if (res != KSI_OK) {
-		KSI_pushError(ctx, res, NULL);
-		goto cleanup;
-	}
+		input[0].data = leftImprint;
+		input[0].data_length = leftImprint_len;
+		input[1].data = rightImprint;
+		input[1].data_length = rightImprint_len;
+		input[2].data = &l;
+		input[2].data_length = 1;
 
-	res = KSI_DataHasher_add(hsr, &l, 1);
-	if (res != KSI_OK) {
-		KSI_pushError(ctx, res, NULL);
-		goto cleanup;
-	}
+		res = KSI_calculateImprint(ctx, builder->algo, input, 3, imprint, &imprint_len);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
 
-	res = KSI_DataHasher_close(hsr, &tmp);
-	if (res != KSI_OK) {
-		KSI_pushError(ctx, res, NULL);
-		goto cleanup;
+		res = KSI_DataHash_fromImprint(ctx, imprint, imprint_len, &tmp);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+	} else {
+		hsr = builder->hsr;
+
+		res = KSI_DataHasher_reset(hsr);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = KSI_DataHasher_addTreeNode(hsr, left);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = KSI_DataHasher_addTreeNode(hsr, right);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = KSI_DataHasher_add(hsr, &l, 1);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
+
+		res = KSI_DataHasher_close(hsr, &tmp);
+		if (res != KSI_OK) {
+			KSI_pushError(ctx, res, NULL);
+			goto cleanup;
+		}
 	}
 
 	*root = tmp;
@@ -168,7 +212,7 @@ cleanup:
 	return res;
 }
 
-static int KSI_TreeNode_join(KSI_CTX *ctx, KSI_DataHasher *hsr, KSI_TreeNode *leftSibling, KSI_TreeNode *rightSibling, KSI_TreeNode **root) {
+static int KSI_TreeNode_join(KSI_CTX *ctx, KSI_TreeBuilder *builder, KSI_TreeNode *leftSibling, KSI_TreeNode *rightSibling, KSI_TreeNode **root) {
 	int res = KSI_UNKNOWN_ERROR;
 	KSI_TreeNode *tmp = NULL;
 	int level;
@@ -195,7 +239,7 @@ static int KSI_TreeNode_join(KSI_CTX *ctx, KSI_DataHasher *hsr, KSI_TreeNode *le
 	}
 
 	/* Create the root hash value. */
-	res = joinHashes(ctx, hsr, leftSibling, rightSibling, level, &hsh);
+	res = joinHashes(ctx, builder, leftSibling, rightSibling, level, &hsh);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
 		goto cleanup;
@@ -329,7 +373,7 @@ static int insertNode(KSI_TreeBuilder *builder, KSI_TreeNode *node) {
 		builder->stack[node->level] = node;
 	} else {
 		/* The slot is taken - create a new node from the existing ones. */
-		res = KSI_TreeNode_join(builder->ctx, builder->hsr, pSlot, node, &root);
+		res = KSI_TreeNode_join(builder->ctx, builder, pSlot, node, &root);
 		if (res != KSI_OK) {
 			KSI_pushError(builder->ctx, res, NULL);
 			goto cleanup;
@@ -387,7 +431,7 @@ static int processAndInsertNode(KSI_TreeBuilder *builder, KSI_TreeNode *node) {
 		if (res != KSI_OK) goto cleanup;
 
 		if (tmp != NULL) {
-			res = KSI_TreeNode_join(builder->ctx, builder->hsr, localRoot == NULL ? node : localRoot, tmp, &localRoot);
+			res = KSI_TreeNode_join(builder->ctx, builder, localRoot == NULL ? node : localRoot, tmp, &localRoot);
 			if (res != KSI_OK) goto cleanup;
 		}
 	}
@@ -495,7 +539,7 @@ int KSI_TreeBuilder_close(KSI_TreeBuilder *builder) {
 			if (root == NULL) {
 				root = node;
 			} else {
-				res = KSI_TreeNode_join(builder->ctx, builder->hsr, node, root, &tmp);
+				res = KSI_TreeNode_join(builder->ctx, builder, node, root, &tmp);
 				if (res != KSI_OK) goto cleanup;
 
 				root = tmp;
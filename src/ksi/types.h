@@ -69,6 +69,9 @@ extern "C" {
 	/** Typedef for the verification policy. */
 	typedef struct KSI_Policy_st KSI_Policy;
 
+	/** Typedef for the compiled verification policy. */
+	typedef struct KSI_CompiledPolicy_st KSI_CompiledPolicy;
+
 	/** Typedef for the verification context. */
 	typedef struct KSI_VerificationContext_st KSI_VerificationContext;
 
@@ -65,10 +65,12 @@ static int extendingPermittedVerification(KSI_VerificationContext *info, KSI_Rul
 
 static int rfc3161_preSufHasher(KSI_CTX *ctx, const KSI_OctetString *prefix, const KSI_DataHash *hsh, const KSI_OctetString *suffix, int hsh_id, KSI_DataHash **out) {
 	int res = KSI_UNKNOWN_ERROR;
-	KSI_DataHasher *hsr = NULL;
 	KSI_DataHash *tmp = NULL;
 	const unsigned char *imprint = NULL;
 	size_t imprint_len = 0;
+	KSI_HashInput input[3];
+	unsigned char outImprint[KSI_MAX_IMPRINT_LEN];
+	size_t outImprint_len = 0;
 	const unsigned char *data = NULL;
 	size_t data_len = 0;
 
@@ -78,26 +80,14 @@ static int rfc3161_preSufHasher(KSI_CTX *ctx, const KSI_OctetString *prefix, con
 		goto cleanup;
 	}
 
-	/*Generate TST Info structure and get its hash*/
-	res = KSI_DataHasher_open(ctx, hsh_id, &hsr);
-	if (res != KSI_OK) {
-		KSI_pushError(ctx, res, NULL);
-		goto cleanup;
-	}
-
 	res = KSI_OctetString_extract(prefix, &data, &data_len);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
 		goto cleanup;
 	}
 
-	if (data != NULL) {
-		res = KSI_DataHasher_add(hsr, data, data_len);
-		if (res != KSI_OK) {
-			KSI_pushError(ctx, res, NULL);
-			goto cleanup;
-		}
-	}
+	input[0].data = data;
+	input[0].data_length = (data != NULL) ? data_len : 0;
 
 	res = KSI_DataHash_getImprint(hsh, &imprint, &imprint_len);
 	if (res != KSI_OK) {
@@ -105,29 +95,26 @@ static int rfc3161_preSufHasher(KSI_CTX *ctx, const KSI_OctetString *prefix, con
 		goto cleanup;
 	}
 
-	res = KSI_DataHasher_add(hsr, imprint + 1, imprint_len - 1);
+	input[1].data = imprint + 1;
+	input[1].data_length = imprint_len - 1;
+
+	res = KSI_OctetString_extract(suffix, &data, &data_len);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
 		goto cleanup;
 	}
 
-	res = KSI_OctetString_extract(suffix, &data, &data_len);
+	input[2].data = data;
+	input[2].data_length = (data != NULL) ? data_len : 0;
+
+	/*Generate TST Info structure and get its hash*/
+	res = KSI_calculateImprint(ctx, hsh_id, input, 3, outImprint, &outImprint_len);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
 		goto cleanup;
 	}
 
-	if (data != NULL) {
-		res = KSI_DataHasher_add(hsr, data, data_len);
-		if (res != KSI_OK) {
-			KSI_pushError(ctx, res, NULL);
-			goto cleanup;
-		}
-	}
-
-
-	/*Get hash and its imprint*/
-	res = KSI_DataHasher_close(hsr, &tmp);
+	res = KSI_DataHash_fromImprint(ctx, outImprint, outImprint_len, &tmp);
 	if (res != KSI_OK) {
 		KSI_pushError(ctx, res, NULL);
 		goto cleanup;
@@ -140,7 +127,6 @@ static int rfc3161_preSufHasher(KSI_CTX *ctx, const KSI_OctetString *prefix, con
 
 cleanup:
 
-	KSI_DataHasher_free(hsr);
 	KSI_DataHash_free(tmp);
 
 	return res;
@@ -614,6 +600,7 @@ int KSI_VerificationRule_AggregationHashChainConsistency(KSI_VerificationContext
 	KSI_CTX *ctx = NULL;
 	const KSI_Signature *sig = NULL;
 	VerificationTempData *tempData = NULL;
+	KSI_AggregationHashChainList *chainList = NULL;
 	const KSI_VerificationStep step = KSI_VERIFY_AGGRCHAIN_INTERNALLY;
 
 	if (result == NULL) {
@@ -641,6 +628,13 @@ int KSI_VerificationRule_AggregationHashChainConsistency(KSI_VerificationContext
 
 	KSI_LOG_info(ctx, "Verify aggregation hash chain consistency.");
 
+	/* The chains are aggregated from their own input hashes, so calculate them all at
+	 * once. The loop below uses the cached results; errors are reported by the loop. */
+	chainList = sig->aggregationChainList;
+	if (KSI_AggregationHashChainList_aggregateBatch(ctx, &chainList, 1) != KSI_OK) {
+		KSI_ERR_clearErrors(ctx);
+	}
+
 	/* Aggregate all the aggregation chains. */
 	for (i = 0; i < KSI_AggregationHashChainList_length(sig->aggregationChainList); i++) {
 		KSI_AggregationHashChain* aggregationChain = NULL;
@@ -1748,6 +1742,7 @@ int KSI_VerificationRule_ExtendedSignatureCalendarChainRootHash(KSI_Verification
 	const KSI_Signature *sig = NULL;
 	KSI_Integer *pubTime = NULL;
 	KSI_CalendarHashChain *extCalHashChain = NULL;
+	KSI_CalendarHashChain *calChains[2];
 	KSI_DataHash *rootHash = NULL;
 	KSI_DataHash *extRootHash = NULL;
 	const KSI_VerificationStep step = KSI_VERIFY_CALCHAIN_ONLINE;
@@ -1784,6 +1779,16 @@ int KSI_VerificationRule_ExtendedSignatureCalendarChainRootHash(KSI_Verification
 		goto cleanup;
 	}
 
+	/* Both chains are independent, calculate their output hashes together. */
+	calChains[0] = sig->calendarChain;
+	calChains[1] = extCalHashChain;
+	res = KSI_CalendarHashChain_aggregateBatch(ctx, calChains, 2);
+	if (res != KSI_OK) {
+		VERIFICATION_RESULT_ERR(KSI_VER_RES_NA, KSI_VER_ERR_GEN_2, KSI_VERIFY_NONE);
+		KSI_pushError(ctx, res, NULL);
+		goto cleanup;
+	}
+
 	res = KSI_CalendarHashChain_aggregate(sig->calendarChain, &rootHash);
 	if (res != KSI_OK) {
 		VERIFICATION_RESULT_ERR(KSI_VER_RES_NA, KSI_VER_ERR_GEN_2, KSI_VERIFY_NONE);
@@ -1863,6 +1868,7 @@ static int initExtendedCalendarHashChain(KSI_VerificationContext *info, KSI_Inte
 	VerificationTempData *tempData = NULL;
 	KSI_Integer *respReqId = NULL;
 	KSI_Integer *reqReqId = NULL;
+	KSI_uint64_t traceBegin = 0;
 
 	if (info == NULL || info->ctx == NULL || info->signature == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -1873,6 +1879,7 @@ static int initExtendedCalendarHashChain(KSI_VerificationContext *info, KSI_Inte
 	ctx = info->ctx;
 	sig = info->signature;
 	KSI_ERR_clearErrors(ctx);
+	traceBegin = KSI_VerificationTrace_begin(ctx);
 
 	tempData = info->tempData;
 	if (tempData == NULL) {
@@ -1975,6 +1982,9 @@ static int initExtendedCalendarHashChain(KSI_VerificationContext *info, KSI_Inte
 	res = KSI_OK;
 
 cleanup:
+	KSI_VerificationTrace_end(ctx, KSI_TRACE_FETCH_CALENDAR_CHAIN, NULL, traceBegin, res, -1, 0,
+			tempData != NULL ? &tempData->traceTotals : NULL);
+
 	KSI_Integer_free(startTime);
 	KSI_ExtendReq_free(req);
 	KSI_RequestHandle_free(handle);
@@ -2276,6 +2286,7 @@ static int initPublicationsFile(KSI_VerificationContext *info) {
 	int res = KSI_UNKNOWN_ERROR;
 	VerificationTempData *tempData = NULL;
 	KSI_PublicationsFile *tmp = NULL;
+	KSI_uint64_t traceBegin = 0;
 
 	if (info == NULL) {
 		res = KSI_INVALID_ARGUMENT;
@@ -2294,6 +2305,8 @@ static int initPublicationsFile(KSI_VerificationContext *info) {
 		} else {
 			bool verifyPubFile = (info->ctx->publicationsFile == NULL);
 
+			traceBegin = KSI_VerificationTrace_begin(info->ctx);
+
 			res = KSI_receivePublicationsFile(info->ctx, &tmp);
 			if (res != KSI_OK) goto cleanup;
 
@@ -2315,6 +2328,11 @@ static int initPublicationsFile(KSI_VerificationContext *info) {
 
 cleanup:
 
+	if (info != NULL) {
+		KSI_VerificationTrace_end(info->ctx, KSI_TRACE_FETCH_PUBLICATIONS_FILE, NULL, traceBegin, res, -1, 0,
+				tempData != NULL ? &tempData->traceTotals : NULL);
+	}
+
 	KSI_PublicationsFile_free(tmp);
 
 	return res;
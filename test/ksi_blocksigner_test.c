@@ -20,11 +20,14 @@
 #include <string.h>
 #include <ksi/ksi.h>
 #include <ksi/blocksigner.h>
+#include <ksi/signing_queue.h>
 
 #include "cutest/CuTest.h"
 #include "all_tests.h"
 #include "../src/ksi/ctx_impl.h"
 #include "../src/ksi/net_http_impl.h"
+#include "../src/ksi/hash_impl.h"
+#include "../src/ksi/metrics_impl.h"
 
 extern KSI_CTX *ctx;
 
@@ -33,6 +36,58 @@ extern KSI_CTX *ctx;
 
 static const char *input_data[] = { "test1", "test2", "test3", "test4", "test5", "test6", "test7", NULL };
 
+/* The masked responses are calculated with this initial value. */
+static const unsigned char maskingIv[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10,
+		0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20};
+
+static int fixedRandomBytes(KSI_CTX *ctx, unsigned char *buf, size_t len) {
+	if (len > sizeof(maskingIv)) return KSI_INVALID_ARGUMENT;
+	memcpy(buf, maskingIv, len);
+	return KSI_OK;
+}
+
+static int verifyInternally(KSI_Signature *sig) {
+	int res;
+	KSI_VerificationContext context;
+	KSI_PolicyVerificationResult *result = NULL;
+
+	res = KSI_VerificationContext_init(&context, ctx);
+	if (res != KSI_OK) return res;
+
+	context.signature = sig;
+
+	res = KSI_SignatureVerifier_verify(KSI_VERIFICATION_POLICY_INTERNAL, &context, &result);
+	if (res == KSI_OK && result->finalResult.resultCode != KSI_VER_RES_OK) res = KSI_VERIFICATION_FAILURE;
+
+	KSI_PolicyVerificationResult_free(result);
+
+	return res;
+}
+
+/* Returns non-zero if the serialized signature contains the imprint. */
+static int containsImprint(KSI_Signature *sig, const KSI_DataHash *hsh) {
+	unsigned char *raw = NULL;
+	size_t raw_len = 0;
+	const unsigned char *imprint = NULL;
+	size_t imprint_len = 0;
+	size_t i;
+	int found = 0;
+
+	if (KSI_Signature_serialize(sig, &raw, &raw_len) != KSI_OK) return 1;
+	if (KSI_DataHash_getImprint(hsh, &imprint, &imprint_len) != KSI_OK) {
+		KSI_free(raw);
+		return 1;
+	}
+
+	for (i = 0; !found && i + imprint_len <= raw_len; i++) {
+		found = !memcmp(raw + i, imprint, imprint_len);
+	}
+
+	KSI_free(raw);
+
+	return found;
+}
+
 
 static int createMetaData(const char *userId, KSI_MetaData **md) {
 	int res = KSI_UNKNOWN_ERROR;
@@ -263,6 +318,116 @@ static void testIdentityMedaData(CuTest *tc) {
 #undef TEST_AGGR_RESPONSE_FILE
 }
 
+struct leafSignatures_st {
+	CuTest *tc;
+	size_t count;
+	KSI_BlockSignerHandle **hndl;
+};
+
+static int compareLeafRaw(KSI_BlockSignerHandle *handle, const unsigned char *raw, size_t raw_len, void *c) {
+	struct leafSignatures_st *leafs = c;
+	KSI_Signature *sig = NULL;
+	unsigned char *exp = NULL;
+	size_t exp_len = 0;
+	int res;
+
+	CuAssert(leafs->tc, "Leaf handles in unexpected order.", handle == leafs->hndl[leafs->count]);
+
+	/* The bulk signatures must match the ones extracted one by one. */
+	res = KSI_BlockSignerHandle_getSignature(handle, &sig);
+	CuAssert(leafs->tc, "Unable to extract signature.", res == KSI_OK && sig != NULL);
+
+	res = KSI_Signature_serialize(sig, &exp, &exp_len);
+	CuAssert(leafs->tc, "Unable to serialize signature.", res == KSI_OK && exp != NULL);
+
+	CuAssert(leafs->tc, "Serialized leaf signature mismatch.", exp_len == raw_len && !memcmp(exp, raw, raw_len));
+
+	leafs->count++;
+
+	KSI_Signature_free(sig);
+	KSI_free(exp);
+
+	return KSI_OK;
+}
+
+static int verifyLeafSignature(KSI_BlockSignerHandle *handle, KSI_Signature *sig, void *c) {
+	struct leafSignatures_st *leafs = c;
+	unsigned char *raw = NULL;
+	size_t raw_len = 0;
+	int res;
+
+	res = KSI_verifySignature(ctx, sig);
+	CuAssert(leafs->tc, "Unable to verify the extracted signature.", res == KSI_OK);
+
+	res = KSI_Signature_serialize(sig, &raw, &raw_len);
+	CuAssert(leafs->tc, "Unable to serialize signature.", res == KSI_OK && raw != NULL);
+
+	compareLeafRaw(handle, raw, raw_len, c);
+
+	KSI_free(raw);
+
+	return KSI_OK;
+}
+
+static void testGetSignatures(CuTest *tc) {
+#define TEST_AGGR_RESPONSE_FILE  "resource/tlv/" TEST_RESOURCE_AGGR_VER "/test_meta_data_response.tlv"
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_BlockSigner *bs = NULL;
+	KSI_MetaData *md = NULL;
+	char data[] = "LAPTOP";
+	char *clientId[] = { "Alice", "Bob", "Claire", NULL };
+	size_t i;
+	KSI_DataHash *hsh = NULL;
+	KSI_BlockSignerHandle *hndl[] = {NULL, NULL, NULL};
+	struct leafSignatures_st leafs;
+
+	res = KSI_DataHash_create(ctx, data, strlen(data), KSI_HASHALG_SHA2_256, &hsh);
+	CuAssert(tc, "Unable to create data hash.", res == KSI_OK && hsh != NULL);
+
+	res = KSI_BlockSigner_new(ctx, KSI_HASHALG_SHA2_256, NULL, NULL, &bs);
+	CuAssert(tc, "Unable to create block signer instance.", res == KSI_OK && bs != NULL);
+
+	for (i = 0; clientId[i] != NULL; i++) {
+		res = createMetaData(clientId[i], &md);
+		CuAssert(tc, "Unable to create meta-data.", res == KSI_OK && md != NULL);
+
+		res = KSI_BlockSigner_addLeaf(bs, hsh, 0, md, &hndl[i]);
+		CuAssert(tc, "Unable to add leaf to the block signer.", res == KSI_OK && hndl[i] != NULL);
+
+		KSI_MetaData_free(md);
+		md = NULL;
+	}
+
+	res = KSI_BlockSigner_getSignatures(bs, verifyLeafSignature, NULL);
+	CuAssert(tc, "Signatures may not be extracted before closing the block signer.", res == KSI_INVALID_STATE);
+
+	res = KSI_CTX_setAggregator(ctx, getFullResourcePathUri(TEST_AGGR_RESPONSE_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set aggregator file URI.", res == KSI_OK);
+
+	res = KSI_BlockSigner_closeAndSign(bs);
+	CuAssert(tc, "Unable to close the blocksigner.", res == KSI_OK);
+
+	leafs.tc = tc;
+	leafs.count = 0;
+	leafs.hndl = hndl;
+
+	res = KSI_BlockSigner_writeSignatures(bs, compareLeafRaw, &leafs);
+	CuAssert(tc, "Unable to write leaf signatures.", res == KSI_OK && leafs.count == 3);
+
+	leafs.count = 0;
+
+	res = KSI_BlockSigner_getSignatures(bs, verifyLeafSignature, &leafs);
+	CuAssert(tc, "Unable to get leaf signatures.", res == KSI_OK && leafs.count == 3);
+
+	for (i = 0; clientId[i] != NULL; i++) {
+		KSI_BlockSignerHandle_free(hndl[i]);
+	}
+
+	KSI_DataHash_free(hsh);
+	KSI_BlockSigner_free(bs);
+#undef TEST_AGGR_RESPONSE_FILE
+}
+
 static void testSingle(CuTest *tc) {
 #define TEST_AGGR_RESPONSE_FILE  "resource/tlv/" TEST_RESOURCE_AGGR_VER "/ok-sig-2014-07-01.1-aggr_response.tlv"
 	int res = KSI_UNKNOWN_ERROR;
@@ -304,6 +469,312 @@ static void testSingle(CuTest *tc) {
 #undef TEST_AGGR_RESPONSE_FILE
 }
 
+static void testCreateSignatures(CuTest *tc) {
+#define TEST_AGGR_RESPONSE_FILE  "resource/tlv/" TEST_RESOURCE_AGGR_VER "/ok-sig-2014-07-01.1-aggr_response.tlv"
+#define TEST_AGGR_RESPONSE_MASKED_FILE  "resource/tlv/" TEST_RESOURCE_AGGR_VER "/ok-sig-2014-07-01.1-masked-aggr_response.tlv"
+#define TEST_AGGR_RESPONSE_2LEAF_FILE  "resource/tlv/" TEST_RESOURCE_AGGR_VER "/ok-sig-2014-07-01.1-masked-2leaf-aggr_response.tlv"
+	int res = KSI_UNKNOWN_ERROR;
+	size_t i;
+	KSI_DataHash *hsh[] = {NULL, NULL};
+	KSI_Signature *sigs[] = {NULL, NULL};
+	KSI_DataHash *docHash = NULL;
+	int (*randomBytes)(KSI_CTX *, unsigned char *, size_t) = ctx->randomBytes;
+
+	/* The batches are masked with a known initial value to match the responses. */
+	ctx->randomBytes = fixedRandomBytes;
+
+	res = KSITest_DataHash_fromStr(ctx, "0111a700b0c8066c47ecba05ed37bc14dcadb238552d86c659342d1d7e87b8772d", &hsh[0]);
+	CuAssert(tc, "Unable to create data hash.", res == KSI_OK && hsh[0] != NULL);
+
+	res = KSI_DataHash_create(ctx, input_data[0], strlen(input_data[0]), KSI_HASHALG_SHA2_256, &hsh[1]);
+	CuAssert(tc, "Unable to create data hash.", res == KSI_OK && hsh[1] != NULL);
+
+	res = KSI_createSignatures(ctx, hsh, 0, sigs);
+	CuAssert(tc, "Empty batch may not be signed.", res == KSI_INVALID_ARGUMENT);
+
+	res = KSI_createSignatures(ctx, NULL, 1, sigs);
+	CuAssert(tc, "Missing hashes may not be signed.", res == KSI_INVALID_ARGUMENT);
+
+	res = KSI_CTX_setAggregator(ctx, getFullResourcePathUri(TEST_AGGR_RESPONSE_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set aggregator file URI.", res == KSI_OK);
+
+	/* The response does not match the root of the two hashes. */
+	res = KSI_createSignatures(ctx, hsh, 2, sigs);
+	CuAssert(tc, "Batch signing must fail with mismatching response.", res != KSI_OK && sigs[0] == NULL && sigs[1] == NULL);
+
+	res = KSI_CTX_setAggregator(ctx, getFullResourcePathUri(TEST_AGGR_RESPONSE_MASKED_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set aggregator file URI.", res == KSI_OK);
+	ctx->netProvider->requestCount = 0;
+
+	res = KSI_createSignatures(ctx, hsh, 1, sigs);
+	CuAssert(tc, "Unable to sign a batch of a single hash.", res == KSI_OK && sigs[0] != NULL);
+
+	res = KSI_Signature_getDocumentHash(sigs[0], &docHash);
+	CuAssert(tc, "Unable to get document hash.", res == KSI_OK && KSI_DataHash_equals(docHash, hsh[0]));
+
+	/* The responses have no calendar chain, only the internal consistency can be verified. */
+	res = verifyInternally(sigs[0]);
+	CuAssert(tc, "Unable to verify the batch signature.", res == KSI_OK);
+
+	KSI_Signature_free(sigs[0]);
+	sigs[0] = NULL;
+	KSI_DataHash_free(hsh[1]);
+	hsh[1] = NULL;
+
+	/* The response of the 2-leaf batch has the masked root of the two hashes as the input. */
+	res = KSITest_DataHash_fromStr(ctx, "010101010101010101010101010101010101010101010101010101010101010101", &hsh[1]);
+	CuAssert(tc, "Unable to create data hash.", res == KSI_OK && hsh[1] != NULL);
+
+	res = KSI_CTX_setAggregator(ctx, getFullResourcePathUri(TEST_AGGR_RESPONSE_2LEAF_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set aggregator file URI.", res == KSI_OK);
+	ctx->netProvider->requestCount = 0;
+
+	res = KSI_createSignatures(ctx, hsh, 2, sigs);
+	CuAssert(tc, "Unable to sign a batch of two hashes.", res == KSI_OK && sigs[0] != NULL && sigs[1] != NULL);
+
+	for (i = 0; i < 2; i++) {
+		docHash = NULL;
+		res = KSI_Signature_getDocumentHash(sigs[i], &docHash);
+		CuAssert(tc, "Signature must have the document hash of its own leaf.", res == KSI_OK && KSI_DataHash_equals(docHash, hsh[i]));
+
+		res = verifyInternally(sigs[i]);
+		CuAssert(tc, "Unable to verify the batch signature.", res == KSI_OK);
+
+		CuAssert(tc, "Signature reveals the other hash of the batch.", !containsImprint(sigs[i], hsh[1 - i]));
+
+		KSI_Signature_free(sigs[i]);
+	}
+
+	ctx->randomBytes = randomBytes;
+
+	KSI_DataHash_free(hsh[0]);
+	KSI_DataHash_free(hsh[1]);
+#undef TEST_AGGR_RESPONSE_2LEAF_FILE
+#undef TEST_AGGR_RESPONSE_MASKED_FILE
+#undef TEST_AGGR_RESPONSE_FILE
+}
+
+/* The callbacks are called from the worker of the queue, the results are read after flushing it. */
+struct queueResults_st {
+	size_t count;
+	size_t signatures;
+	size_t outOfOrder;
+	int lastStatus;
+	KSI_DataHash *expected[2];
+};
+
+static int collectQueueResult(KSI_DataHash *hsh, int status, KSI_Signature *sig, void *c) {
+	struct queueResults_st *results = c;
+	KSI_DataHash *docHash = NULL;
+
+	if (results->count < sizeof(results->expected) / sizeof(results->expected[0])) {
+		if (results->expected[results->count] != NULL && !KSI_DataHash_equals(hsh, results->expected[results->count])) {
+			results->outOfOrder++;
+		}
+	}
+	results->count++;
+	results->lastStatus = status;
+
+	if (sig != NULL && KSI_Signature_getDocumentHash(sig, &docHash) == KSI_OK && KSI_DataHash_equals(docHash, hsh)) {
+		results->signatures++;
+	}
+
+	return KSI_OK;
+}
+
+static void testSigningQueue(CuTest *tc) {
+#define TEST_AGGR_RESPONSE_FILE  "resource/tlv/" TEST_RESOURCE_AGGR_VER "/ok-sig-2014-07-01.1-aggr_response.tlv"
+#define TEST_AGGR_RESPONSE_MASKED_FILE  "resource/tlv/" TEST_RESOURCE_AGGR_VER "/ok-sig-2014-07-01.1-masked-aggr_response.tlv"
+#define TEST_AGGR_RESPONSE_2LEAF_FILE  "resource/tlv/" TEST_RESOURCE_AGGR_VER "/ok-sig-2014-07-01.1-masked-2leaf-aggr_response.tlv"
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_SigningQueue *queue = NULL;
+	KSI_DataHash *hsh = NULL;
+	KSI_DataHash *other = NULL;
+	KSI_DataHash *sibling = NULL;
+	static struct queueResults_st results;
+	KSI_uint64_t start;
+	int (*randomBytes)(KSI_CTX *, unsigned char *, size_t) = ctx->randomBytes;
+
+	memset(&results, 0, sizeof(results));
+
+	/* The batches are masked with a known initial value to match the responses. */
+	ctx->randomBytes = fixedRandomBytes;
+
+	res = KSITest_DataHash_fromStr(ctx, "0111a700b0c8066c47ecba05ed37bc14dcadb238552d86c659342d1d7e87b8772d", &hsh);
+	CuAssert(tc, "Unable to create data hash.", res == KSI_OK && hsh != NULL);
+
+	res = KSI_DataHash_create(ctx, input_data[0], strlen(input_data[0]), KSI_HASHALG_SHA2_256, &other);
+	CuAssert(tc, "Unable to create data hash.", res == KSI_OK && other != NULL);
+
+	res = KSITest_DataHash_fromStr(ctx, "010101010101010101010101010101010101010101010101010101010101010101", &sibling);
+	CuAssert(tc, "Unable to create data hash.", res == KSI_OK && sibling != NULL);
+
+	res = KSI_SigningQueue_new(ctx, 0, 1000, &queue);
+	CuAssert(tc, "Signing queue of size 0 may not be created.", res == KSI_INVALID_ARGUMENT && queue == NULL);
+
+	/* The context belongs to the worker while the queue exists, it is configured beforehand. */
+	res = KSI_CTX_setAggregator(ctx, getFullResourcePathUri(TEST_AGGR_RESPONSE_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set aggregator file URI.", res == KSI_OK);
+
+	res = KSI_SigningQueue_new(ctx, 2, 60000, &queue);
+	CuAssert(tc, "Unable to create signing queue.", res == KSI_OK && queue != NULL);
+
+	/* Nothing is signed before either of the limits is reached. */
+	res = KSI_SigningQueue_add(queue, hsh, collectQueueResult, &results);
+	CuAssert(tc, "Unable to add hash to the queue.", res == KSI_OK && KSI_SigningQueue_getPendingCount(queue) == 1);
+
+	/* The size limit triggers the signing; the response does not match the root of the two hashes. */
+	res = KSI_SigningQueue_add(queue, other, collectQueueResult, &results);
+	CuAssert(tc, "Unable to add hash to the queue.", res == KSI_OK);
+
+	res = KSI_SigningQueue_flush(queue);
+	CuAssert(tc, "Signing the batch must fail with mismatching response.", res != KSI_OK);
+	CuAssert(tc, "All the callbacks must be notified of the failure.", results.count == 2 && results.signatures == 0 && results.lastStatus != KSI_OK);
+	CuAssert(tc, "Queue must be empty after signing.", KSI_SigningQueue_getPendingCount(queue) == 0);
+
+	KSI_SigningQueue_free(queue);
+	queue = NULL;
+
+	/* The size limit signs the batch, every callback gets the signature of its own hash in the order of adding. */
+	memset(&results, 0, sizeof(results));
+	results.expected[0] = hsh;
+	results.expected[1] = sibling;
+
+	res = KSI_CTX_setAggregator(ctx, getFullResourcePathUri(TEST_AGGR_RESPONSE_2LEAF_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set aggregator file URI.", res == KSI_OK);
+	ctx->netProvider->requestCount = 0;
+
+	res = KSI_SigningQueue_new(ctx, 2, 60000, &queue);
+	CuAssert(tc, "Unable to create signing queue.", res == KSI_OK && queue != NULL);
+
+	res = KSI_SigningQueue_add(queue, hsh, collectQueueResult, &results);
+	CuAssert(tc, "Unable to add hash to the queue.", res == KSI_OK);
+
+	res = KSI_SigningQueue_add(queue, sibling, collectQueueResult, &results);
+	CuAssert(tc, "Unable to add hash to the queue.", res == KSI_OK);
+
+	res = KSI_SigningQueue_flush(queue);
+	CuAssert(tc, "Unable to sign the batch.", res == KSI_OK);
+	CuAssert(tc, "Signatures not delivered.", results.count == 2 && results.signatures == 2 && results.lastStatus == KSI_OK);
+	CuAssert(tc, "Signatures delivered out of order.", results.outOfOrder == 0);
+
+	KSI_SigningQueue_free(queue);
+	queue = NULL;
+
+	/* The worker signs the hash when the time limit is reached. */
+	memset(&results, 0, sizeof(results));
+	results.expected[0] = hsh;
+
+	res = KSI_CTX_setAggregator(ctx, getFullResourcePathUri(TEST_AGGR_RESPONSE_MASKED_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set aggregator file URI.", res == KSI_OK);
+	ctx->netProvider->requestCount = 0;
+
+	res = KSI_SigningQueue_new(ctx, 10, 10, &queue);
+	CuAssert(tc, "Unable to create signing queue.", res == KSI_OK && queue != NULL);
+
+	res = KSI_SigningQueue_add(queue, hsh, collectQueueResult, &results);
+	CuAssert(tc, "Unable to add hash to the queue.", res == KSI_OK);
+
+	start = KSI_Metrics_now();
+	while (KSI_SigningQueue_getPendingCount(queue) != 0 && KSI_Metrics_now() - start < 5000000);
+	CuAssert(tc, "The worker did not take the batch after the time limit.", KSI_SigningQueue_getPendingCount(queue) == 0);
+
+	res = KSI_SigningQueue_flush(queue);
+	CuAssert(tc, "Unable to sign the queued hash.", res == KSI_OK);
+	CuAssert(tc, "Signature not delivered.", results.count == 1 && results.signatures == 1 && results.lastStatus == KSI_OK && results.outOfOrder == 0);
+
+	res = KSI_SigningQueue_flush(queue);
+	CuAssert(tc, "Flushing an empty queue must succeed.", res == KSI_OK && results.count == 1);
+
+	KSI_SigningQueue_free(queue);
+	queue = NULL;
+
+	ctx->randomBytes = randomBytes;
+
+	KSI_DataHash_free(hsh);
+	KSI_DataHash_free(other);
+	KSI_DataHash_free(sibling);
+#undef TEST_AGGR_RESPONSE_2LEAF_FILE
+#undef TEST_AGGR_RESPONSE_MASKED_FILE
+#undef TEST_AGGR_RESPONSE_FILE
+}
+
+#define QUEUE_PRODUCER_COUNT 4
+#define QUEUE_PRODUCER_HASHES 25
+
+struct queueProducer_st {
+	KSI_SigningQueue *queue;
+	KSI_DataHash *hsh;
+	struct queueResults_st *results;
+	size_t failures;
+};
+
+static void queueProducer(void *arg) {
+	struct queueProducer_st *producer = arg;
+	size_t i;
+
+	for (i = 0; i < QUEUE_PRODUCER_HASHES; i++) {
+		if (KSI_SigningQueue_add(producer->queue, producer->hsh, collectQueueResult, producer->results) != KSI_OK) {
+			producer->failures++;
+		}
+	}
+}
+
+static void testSigningQueueThreads(CuTest *tc) {
+#define TEST_AGGR_RESPONSE_FILE  "resource/tlv/" TEST_RESOURCE_AGGR_VER "/ok-sig-2014-07-01.1-aggr_response.tlv"
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_SigningQueue *queue = NULL;
+	static struct queueResults_st results;
+	struct queueProducer_st producer[QUEUE_PRODUCER_COUNT];
+	KSI_Thread *thread[QUEUE_PRODUCER_COUNT];
+	size_t i;
+
+	memset(&results, 0, sizeof(results));
+
+	/* None of the batches matches the response, but every hash must get exactly one result. */
+	res = KSI_CTX_setAggregator(ctx, getFullResourcePathUri(TEST_AGGR_RESPONSE_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set aggregator file URI.", res == KSI_OK);
+
+	for (i = 0; i < QUEUE_PRODUCER_COUNT; i++) {
+		producer[i].results = &results;
+		producer[i].failures = 0;
+		producer[i].hsh = NULL;
+		thread[i] = NULL;
+
+		res = KSI_DataHash_create(ctx, input_data[i], strlen(input_data[i]), KSI_HASHALG_SHA2_256, &producer[i].hsh);
+		CuAssert(tc, "Unable to create data hash.", res == KSI_OK && producer[i].hsh != NULL);
+	}
+
+	res = KSI_SigningQueue_new(ctx, 8, 1000, &queue);
+	CuAssert(tc, "Unable to create signing queue.", res == KSI_OK && queue != NULL);
+
+	for (i = 0; i < QUEUE_PRODUCER_COUNT; i++) {
+		producer[i].queue = queue;
+		res = KSI_Thread_new(queueProducer, &producer[i], &thread[i]);
+		CuAssert(tc, "Unable to start producer thread.", res == KSI_OK);
+	}
+
+	for (i = 0; i < QUEUE_PRODUCER_COUNT; i++) {
+		KSI_Thread_join(thread[i]);
+		CuAssert(tc, "Unable to add hash to the queue.", producer[i].failures == 0);
+	}
+
+	res = KSI_SigningQueue_flush(queue);
+	CuAssert(tc, "Signing must fail with mismatching response.", res != KSI_OK);
+	CuAssert(tc, "Every hash must get a result.", results.count == QUEUE_PRODUCER_COUNT * QUEUE_PRODUCER_HASHES && results.signatures == 0);
+	CuAssert(tc, "Queue must be empty after signing.", KSI_SigningQueue_getPendingCount(queue) == 0);
+
+	KSI_SigningQueue_free(queue);
+
+	for (i = 0; i < QUEUE_PRODUCER_COUNT; i++) {
+		KSI_DataHash_free(producer[i].hsh);
+	}
+#undef TEST_AGGR_RESPONSE_FILE
+}
+
+#undef QUEUE_PRODUCER_HASHES
+#undef QUEUE_PRODUCER_COUNT
+
 static void testReset(CuTest *tc) {
 #define TEST_AGGR_RESPONSE_FILE  "resource/tlv/" TEST_RESOURCE_AGGR_VER "/ok-sig-2014-07-01.1-aggr_response.tlv"
 	int res = KSI_UNKNOWN_ERROR;
@@ -415,6 +886,103 @@ static void testMaskingInput(CuTest *tc) {
 	KSI_DataHash_free(zero);
 }
 
+static void testMaskingPrevLeaf(CuTest *tc) {
+	static const unsigned char iv_data[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+	int res;
+	KSI_BlockSigner *bs = NULL;
+	KSI_OctetString *iv = NULL;
+	KSI_DataHash *zero = NULL;
+	KSI_DataHash *prev = NULL;
+	KSI_DataHash *held = NULL;
+	KSI_DataHash *first = NULL;
+	KSI_DataHash *mask = NULL;
+	KSI_DataHash *hsh = NULL;
+	KSI_DataHash *exp = NULL;
+	KSI_DataHasher *hsr = NULL;
+	unsigned char lvl = 1;
+	size_t i;
+
+	res = KSI_DataHash_createZero(ctx, KSI_HASHALG_SHA2_256, &zero);
+	CuAssert(tc, "Unable to create zero hash.", res == KSI_OK && zero != NULL);
+
+	res = KSI_OctetString_new(ctx, iv_data, sizeof(iv_data), &iv);
+	CuAssert(tc, "Unable to create initial vector.", res == KSI_OK && iv != NULL);
+
+	res = KSI_BlockSigner_new(ctx, KSI_HASHALG_SHA2_256, zero, iv, &bs);
+	CuAssert(tc, "Unable to create block signer instance with masking.", res == KSI_OK && bs != NULL);
+
+	res = KSI_DataHasher_open(ctx, KSI_HASHALG_SHA2_256, &hsr);
+	CuAssert(tc, "Unable to open hasher.", res == KSI_OK && hsr != NULL);
+
+	prev = KSI_DataHash_ref(zero);
+
+	for (i = 0; input_data[i] != NULL; i++) {
+		res = KSI_DataHash_create(ctx, input_data[i], strlen(input_data[i]), KSI_HASHALG_SHA2_256, &hsh);
+		CuAssert(tc, "Unable to create data hash.", res == KSI_OK && hsh != NULL);
+
+		/* Calculate the expected mask and leaf values. */
+		res = KSI_DataHasher_reset(hsr);
+		CuAssert(tc, "Unable to reset hasher.", res == KSI_OK);
+		res = KSI_DataHasher_addImprint(hsr, prev);
+		CuAssert(tc, "Unable to add previous leaf.", res == KSI_OK);
+		res = KSI_DataHasher_addOctetString(hsr, iv);
+		CuAssert(tc, "Unable to add initial vector.", res == KSI_OK);
+		res = KSI_DataHasher_close(hsr, &mask);
+		CuAssert(tc, "Unable to calculate mask.", res == KSI_OK && mask != NULL);
+
+		res = KSI_DataHasher_reset(hsr);
+		CuAssert(tc, "Unable to reset hasher.", res == KSI_OK);
+		res = KSI_DataHasher_addImprint(hsr, mask);
+		CuAssert(tc, "Unable to add mask.", res == KSI_OK);
+		res = KSI_DataHasher_addImprint(hsr, hsh);
+		CuAssert(tc, "Unable to add input hash.", res == KSI_OK);
+		res = KSI_DataHasher_add(hsr, &lvl, 1);
+		CuAssert(tc, "Unable to add level.", res == KSI_OK);
+		res = KSI_DataHasher_close(hsr, &exp);
+		CuAssert(tc, "Unable to calculate leaf value.", res == KSI_OK && exp != NULL);
+
+		KSI_DataHash_free(prev);
+		prev = NULL;
+
+		res = KSI_BlockSigner_add(bs, hsh);
+		CuAssert(tc, "Unable to add data hash to the block signer.", res == KSI_OK);
+
+		res = KSI_BlockSigner_getPrevLeaf(bs, &prev);
+		CuAssert(tc, "Unable to get previous leaf.", res == KSI_OK && prev != NULL);
+		CuAssert(tc, "Unexpected previous leaf value.", KSI_DataHash_equals(prev, exp));
+
+		/* Keep the first leaf value to make sure it is not modified when new leafs are added. */
+		if (held == NULL) {
+			const unsigned char *imprint = NULL;
+			size_t imprint_len = 0;
+
+			res = KSI_DataHash_getImprint(prev, &imprint, &imprint_len);
+			CuAssert(tc, "Unable to get previous leaf imprint.", res == KSI_OK && imprint != NULL);
+
+			res = KSI_DataHash_fromImprint(ctx, imprint, imprint_len, &first);
+			CuAssert(tc, "Unable to copy previous leaf.", res == KSI_OK && first != NULL);
+			held = KSI_DataHash_ref(prev);
+		}
+
+		KSI_DataHash_free(mask);
+		mask = NULL;
+		KSI_DataHash_free(exp);
+		exp = NULL;
+		KSI_DataHash_free(hsh);
+		hsh = NULL;
+	}
+
+	CuAssert(tc, "Held previous leaf value was modified.", KSI_DataHash_equals(held, first));
+
+	KSI_DataHash_free(first);
+	KSI_DataHash_free(held);
+	KSI_DataHash_free(prev);
+	KSI_DataHasher_free(hsr);
+	KSI_BlockSigner_free(bs);
+	KSI_OctetString_free(iv);
+	KSI_DataHash_free(zero);
+}
+
 static void preTest(void) {
 	ctx->netProvider->requestCount = 0;
 }
@@ -427,9 +995,14 @@ CuSuite* KSITest_Blocksigner_getSuite(void) {
 	SUITE_ADD_TEST(suite, testFreeBeforeClose);
 	SUITE_ADD_TEST(suite, testMedaData);
 	SUITE_ADD_TEST(suite, testIdentityMedaData);
+	SUITE_ADD_TEST(suite, testGetSignatures);
 	SUITE_ADD_TEST(suite, testSingle);
+	SUITE_ADD_TEST(suite, testCreateSignatures);
+	SUITE_ADD_TEST(suite, testSigningQueue);
+	SUITE_ADD_TEST(suite, testSigningQueueThreads);
 	SUITE_ADD_TEST(suite, testReset);
 	SUITE_ADD_TEST(suite, testMaskingInput);
+	SUITE_ADD_TEST(suite, testMaskingPrevLeaf);
 
 	return suite;
 }
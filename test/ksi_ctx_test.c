@@ -18,6 +18,7 @@
  */
 
 #include "cutest/CuTest.h"
+#include <stdio.h>
 #include <string.h>
 #include "all_tests.h"
 #include "../src/ksi/internal.h"
@@ -146,6 +147,65 @@ static void TestGetBaseError(CuTest *tc) {
 	KSI_CTX_free(ctx);
 }
 
+static void TestCompactErrors(CuTest *tc) {
+	int res;
+	KSI_CTX *ctx = NULL;
+	int line1;
+	int line2;
+	int line3;
+	char msg[32];
+	char expected_output[512];
+	char buf[512];
+	char *ret = NULL;
+
+	res = KSITest_CTX_clone(&ctx);
+	CuAssert(tc, "Unable to create KSI context.", res == KSI_OK && ctx != NULL);
+
+	res = KSI_CTX_setCompactErrors(ctx, 1);
+	CuAssert(tc, "Unable to enable compact errors.", res == KSI_OK);
+
+	KSI_pushError(ctx, KSI_INVALID_FORMAT, "Error: static."); line1 = __LINE__;
+
+	/* The message is copied, the buffer may be reused right after the push. */
+	KSI_snprintf(msg, sizeof(msg), "Error: dynamic %d.", 42);
+	KSI_pushError(ctx, KSI_INVALID_ARGUMENT, msg); line2 = __LINE__;
+	memset(msg, 'x', sizeof(msg) - 1);
+
+	/* Missing message is replaced with the status description when printed. */
+	KSI_pushError(ctx, KSI_OUT_OF_MEMORY, NULL); line3 = __LINE__;
+
+	KSI_snprintf(expected_output, sizeof(expected_output),
+		"KSI error trace:\n"
+		"    3) %s:%u - (%d/0) %s\n"
+		"    2) %s:%u - (%d/0) Error: dynamic 42.\n"
+		"    1) %s:%u - (%d/0) Error: static.\n",
+			__FILE__, line3, KSI_OUT_OF_MEMORY, KSI_getErrorString(KSI_OUT_OF_MEMORY),
+			__FILE__, line2, KSI_INVALID_ARGUMENT,
+			__FILE__, line1, KSI_INVALID_FORMAT);
+
+	ret = KSI_ERR_toString(ctx, buf, sizeof(buf));
+	CuAssert(tc, "Invalid output.", ret == buf && strcmp(buf, expected_output) == 0);
+
+	res = KSI_ERR_getBaseErrorMessage(ctx, buf, sizeof(buf), NULL, NULL);
+	CuAssert(tc, "Unable to get correct error data.", res == KSI_OK && strcmp(buf, "Error: static.") == 0);
+
+	/* Switching the mode back must not affect the errors pushed afterwards. */
+	KSI_ERR_clearErrors(ctx);
+	res = KSI_CTX_setCompactErrors(ctx, 0);
+	CuAssert(tc, "Unable to disable compact errors.", res == KSI_OK);
+
+	KSI_pushError(ctx, KSI_INVALID_FORMAT, "Error: full."); line1 = __LINE__;
+	KSI_snprintf(expected_output, sizeof(expected_output),
+		"KSI error trace:\n"
+		"    1) %s:%u - (%d/0) Error: full.\n",
+			__FILE__, line1, KSI_INVALID_FORMAT);
+
+	ret = KSI_ERR_toString(ctx, buf, sizeof(buf));
+	CuAssert(tc, "Invalid output.", ret == buf && strcmp(buf, expected_output) == 0);
+
+	KSI_CTX_free(ctx);
+}
+
 static void TestCtxOptions_pduVersion(CuTest *tc) {
 	int res;
 	KSI_CTX *ctx = NULL;
@@ -201,6 +261,209 @@ static void TestCtxOptions_hmacAlgorithm(CuTest *tc) {
 	KSI_CTX_free(ctx);
 }
 
+typedef struct {
+	int count;
+	int level;
+	char last[2048];
+} LogCollector;
+
+static int collectLog(void *logCtx, int level, const char *message) {
+	LogCollector *col = logCtx;
+	col->count++;
+	col->level = level;
+	KSI_strncpy(col->last, message, sizeof(col->last));
+	return KSI_OK;
+}
+
+static void TestLogLevelAndFields(CuTest *tc) {
+	int res;
+	KSI_CTX *ctx = NULL;
+	LogCollector col;
+	KSI_LogField fields[3];
+	unsigned char blob[] = {0x00, 0x1f, 0xa0, 0xff};
+	char longMsg[1500];
+
+	memset(&col, 0, sizeof(col));
+
+	res = KSITest_CTX_clone(&ctx);
+	CuAssert(tc, "Unable to create KSI context.", res == KSI_OK && ctx != NULL);
+
+	res = KSI_CTX_setLoggerCallback(ctx, collectLog, &col);
+	CuAssert(tc, "Unable to set logger callback.", res == KSI_OK);
+	res = KSI_CTX_setLogLevel(ctx, KSI_LOG_INFO);
+	CuAssert(tc, "Unable to set log level.", res == KSI_OK);
+
+	CuAssert(tc, "Info level should be enabled.", KSI_LOG_isEnabled(ctx, KSI_LOG_INFO));
+	CuAssert(tc, "Debug level should be disabled.", !KSI_LOG_isEnabled(ctx, KSI_LOG_DEBUG));
+
+	KSI_LOG_debug(ctx, "Not logged %d", 1);
+	KSI_LOG_logBlob(ctx, KSI_LOG_DEBUG, "Not logged", blob, sizeof(blob));
+	CuAssert(tc, "Disabled messages must not reach the callback.", col.count == 0);
+
+	KSI_LOG_logBlob(ctx, KSI_LOG_INFO, "Blob", blob, sizeof(blob));
+	CuAssert(tc, "Unexpected blob message.", col.count == 1 && col.level == KSI_LOG_INFO && !strcmp(col.last, "Blob (len = 4): 001fa0ff"));
+
+	memset(longMsg, 'x', sizeof(longMsg) - 1);
+	longMsg[sizeof(longMsg) - 1] = '\0';
+	KSI_LOG_info(ctx, "%s!", longMsg);
+	CuAssert(tc, "Long messages must not be truncated.", strlen(col.last) == sizeof(longMsg) && col.last[sizeof(longMsg) - 1] == '!');
+
+	fields[0].key = "endpoint";
+	fields[0].value = "tcp://localhost:3333";
+	fields[1].key = "note";
+	fields[1].value = "a \"quoted\" value";
+	fields[2].key = "missing";
+	fields[2].value = NULL;
+
+	res = KSI_LOG_logFields(ctx, KSI_LOG_INFO, "request", fields, 3);
+	CuAssert(tc, "Unable to log fields.", res == KSI_OK);
+	CuAssert(tc, "Unexpected structured message.", !strcmp(col.last, "request endpoint=tcp://localhost:3333 note=\"a \\\"quoted\\\" value\" missing=(null)"));
+
+	fields[0].key = "reason";
+	fields[0].value = "line\r\nforged=1\tx\033[0m\x7f";
+
+	res = KSI_LOG_logFields(ctx, KSI_LOG_INFO, "error", fields, 1);
+	CuAssert(tc, "Unable to log fields.", res == KSI_OK);
+	CuAssert(tc, "Control characters must be escaped.", !strcmp(col.last, "error reason=\"line\\r\\nforged=1\\tx\\x1b[0m\\x7f\""));
+
+	KSI_CTX_free(ctx);
+}
+
+static void TestLogRingBuffer(CuTest *tc) {
+	int res;
+	KSI_CTX *ctx = NULL;
+	KSI_LogRingBuffer *rb = NULL;
+	LogCollector col;
+	size_t count = 0;
+	char expected[32];
+	int i;
+
+	memset(&col, 0, sizeof(col));
+
+	res = KSITest_CTX_clone(&ctx);
+	CuAssert(tc, "Unable to create KSI context.", res == KSI_OK && ctx != NULL);
+
+	res = KSI_LogRingBuffer_new(ctx, 256, &rb);
+	CuAssert(tc, "Unable to create ring buffer.", res == KSI_OK && rb != NULL);
+
+	res = KSI_CTX_setLoggerCallback(ctx, KSI_LOG_RingBufferLogger, rb);
+	CuAssert(tc, "Unable to set logger callback.", res == KSI_OK);
+	res = KSI_CTX_setLogLevel(ctx, KSI_LOG_DEBUG);
+	CuAssert(tc, "Unable to set log level.", res == KSI_OK);
+
+	/* Fill the buffer past its end several times to exercise the wrap-around. */
+	for (i = 0; i < 50; i++) {
+		KSI_LOG_debug(ctx, "Message number %d.", i);
+		if (i % 3 == 2) {
+			res = KSI_LogRingBuffer_drain(rb, collectLog, &col, &count);
+			CuAssert(tc, "Unable to drain ring buffer.", res == KSI_OK && count == 3);
+			KSI_snprintf(expected, sizeof(expected), "Message number %d.", i);
+			CuAssert(tc, "Unexpected drained message.", !strcmp(col.last, expected));
+		}
+	}
+	res = KSI_LogRingBuffer_drain(rb, collectLog, &col, &count);
+	CuAssert(tc, "Unable to drain ring buffer.", res == KSI_OK && count == 2);
+	CuAssert(tc, "Unexpected last message.", col.count == 50 && col.level == KSI_LOG_DEBUG && !strcmp(col.last, "Message number 49."));
+	CuAssert(tc, "No messages should have been dropped.", KSI_LogRingBuffer_getDropped(rb) == 0);
+
+	for (i = 0; i < 50; i++) {
+		KSI_LOG_debug(ctx, "Message number %d.", i);
+	}
+	CuAssert(tc, "Messages should have been dropped.", KSI_LogRingBuffer_getDropped(rb) > 0);
+
+	res = KSI_LogRingBuffer_drain(rb, collectLog, &col, &count);
+	CuAssert(tc, "Unable to drain ring buffer.", res == KSI_OK && count + KSI_LogRingBuffer_getDropped(rb) == 50);
+	/* New messages are dropped when the buffer is full, the drained ones are the oldest. */
+	KSI_snprintf(expected, sizeof(expected), "Message number %d.", (int)count - 1);
+	CuAssert(tc, "Unexpected last message.", !strcmp(col.last, expected));
+
+	KSI_CTX_free(ctx);
+	KSI_LogRingBuffer_free(rb);
+}
+
+#define RING_PRODUCER_MESSAGES 5000
+
+typedef struct {
+	KSI_CTX *ctx;
+	volatile size_t done;
+} RingProducer;
+
+typedef struct {
+	size_t count;
+	int next;
+	int ordered;
+} OrderCollector;
+
+static void ringProducer(void *arg) {
+	RingProducer *producer = arg;
+	int i;
+
+	for (i = 0; i < RING_PRODUCER_MESSAGES; i++) {
+		KSI_LOG_debug(producer->ctx, "Message number %d.", i);
+	}
+	KSI_Atomic_storeSize(&producer->done, 1);
+}
+
+static int checkOrder(void *logCtx, int level, const char *message) {
+	OrderCollector *col = logCtx;
+	int n = -1;
+
+	if (level != KSI_LOG_DEBUG || sscanf(message, "Message number %d.", &n) != 1 || n < col->next) {
+		col->ordered = 0;
+	}
+	col->next = n + 1;
+	col->count++;
+
+	return KSI_OK;
+}
+
+static void TestLogRingBufferDrainThread(CuTest *tc) {
+	int res;
+	KSI_CTX *ctx = NULL;
+	KSI_LogRingBuffer *rb = NULL;
+	KSI_Thread *thread = NULL;
+	RingProducer producer;
+	OrderCollector col;
+
+	col.count = 0;
+	col.next = 0;
+	col.ordered = 1;
+
+	res = KSITest_CTX_clone(&ctx);
+	CuAssert(tc, "Unable to create KSI context.", res == KSI_OK && ctx != NULL);
+
+	/* Small enough for the logger to catch up with the drainer. */
+	res = KSI_LogRingBuffer_new(ctx, 200, &rb);
+	CuAssert(tc, "Unable to create ring buffer.", res == KSI_OK && rb != NULL);
+
+	res = KSI_CTX_setLoggerCallback(ctx, KSI_LOG_RingBufferLogger, rb);
+	CuAssert(tc, "Unable to set logger callback.", res == KSI_OK);
+	res = KSI_CTX_setLogLevel(ctx, KSI_LOG_DEBUG);
+	CuAssert(tc, "Unable to set log level.", res == KSI_OK);
+
+	producer.ctx = ctx;
+	producer.done = 0;
+
+	/* The context is used only by the producer, this thread only drains. */
+	res = KSI_Thread_new(ringProducer, &producer, &thread);
+	CuAssert(tc, "Unable to start logging thread.", res == KSI_OK && thread != NULL);
+
+	while (!KSI_Atomic_loadSize(&producer.done)) {
+		res = KSI_LogRingBuffer_drain(rb, checkOrder, &col, NULL);
+		CuAssert(tc, "Unable to drain ring buffer.", res == KSI_OK);
+	}
+	KSI_Thread_join(thread);
+
+	res = KSI_LogRingBuffer_drain(rb, checkOrder, &col, NULL);
+	CuAssert(tc, "Unable to drain ring buffer.", res == KSI_OK);
+
+	CuAssert(tc, "Messages drained out of order or damaged.", col.ordered);
+	CuAssert(tc, "Messages lost.", col.count > 0 && col.count + KSI_LogRingBuffer_getDropped(rb) == RING_PRODUCER_MESSAGES);
+
+	KSI_CTX_free(ctx);
+	KSI_LogRingBuffer_free(rb);
+}
+
 CuSuite* KSITest_CTX_getSuite(void)
 {
 	CuSuite* suite = CuSuiteNew();
@@ -209,8 +472,12 @@ CuSuite* KSITest_CTX_getSuite(void)
 	SUITE_ADD_TEST(suite, TestRegisterGlobals);
 	SUITE_ADD_TEST(suite, TestErrorsToString);
 	SUITE_ADD_TEST(suite, TestGetBaseError);
+	SUITE_ADD_TEST(suite, TestCompactErrors);
 	SUITE_ADD_TEST(suite, TestCtxOptions_pduVersion);
 	SUITE_ADD_TEST(suite, TestCtxOptions_hmacAlgorithm);
+	SUITE_ADD_TEST(suite, TestLogLevelAndFields);
+	SUITE_ADD_TEST(suite, TestLogRingBuffer);
+	SUITE_ADD_TEST(suite, TestLogRingBufferDrainThread);
 
 	return suite;
 }
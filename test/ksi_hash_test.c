@@ -476,6 +476,313 @@ static void test_free_without_close(CuTest *tc) {
 	KSI_DataHasher_free(hsr);
 }
 
+static void testCalculateImprint(CuTest *tc) {
+	int res;
+	KSI_HashInput input[5];
+	unsigned char imprint[KSI_MAX_IMPRINT_LEN];
+	size_t imprint_len = 0;
+	unsigned char expected[] = {KSI_HASHALG_SHA2_256, 0xc4, 0xbb, 0xcb, 0x1f, 0xbe, 0xc9, 0x9d, 0x65, 0xbf, 0x59, 0xd8, 0x5c, 0x8c, 0xb6, 0x2e, 0xe2, 0xdb, 0x96, 0x3f, 0x0f, 0xe1, 0x06, 0xf4, 0x83, 0xd9, 0xaf, 0xa7, 0x3b, 0xd4, 0xe3, 0x9a, 0x8a};
+	unsigned char expectedEmpty[] = {KSI_HASHALG_SHA2_256, 0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24, 0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55};
+
+	KSI_ERR_clearErrors(ctx);
+
+	input[0].data = "correct ";
+	input[0].data_length = 8;
+	input[1].data = NULL;
+	input[1].data_length = 0;
+	input[2].data = "horse ";
+	input[2].data_length = 6;
+	input[3].data = "battery ";
+	input[3].data_length = 8;
+	input[4].data = "staple";
+	input[4].data_length = 6;
+
+	res = KSI_calculateImprint(ctx, KSI_HASHALG_SHA2_256, input, 5, imprint, &imprint_len);
+	CuAssert(tc, "Unable to calculate imprint.", res == KSI_OK);
+	CuAssert(tc, "Imprint mismatch.", imprint_len == sizeof(expected) && !memcmp(imprint, expected, imprint_len));
+
+	res = KSI_calculateImprint(ctx, KSI_HASHALG_SHA2_256, NULL, 0, imprint, &imprint_len);
+	CuAssert(tc, "Unable to calculate imprint of empty input.", res == KSI_OK);
+	CuAssert(tc, "Empty input imprint mismatch.", imprint_len == sizeof(expectedEmpty) && !memcmp(imprint, expectedEmpty, imprint_len));
+
+	res = KSI_calculateImprint(ctx, KSI_HASHALG_INVALID, input, 5, imprint, &imprint_len);
+	CuAssert(tc, "Invalid algorithm must fail.", res == KSI_UNAVAILABLE_HASH_ALGORITHM);
+}
+
+/* All kernels, the lane kernel alone (also on CPUs with SHA-NI) and the portable code. */
+static const unsigned backendMasks[] = {KSI_HASH_BACKEND_MASK_ALL, 1u << KSI_HASH_BACKEND_AVX2, 0};
+
+static void testNativeHashKnownValues(CuTest *tc) {
+	struct {
+		KSI_HashAlgorithm algo_id;
+		const char *data;
+		const char *digest;
+	} vectors[] = {
+		{KSI_HASHALG_SHA2_256, "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+		{KSI_HASHALG_SHA2_256, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+		{KSI_HASHALG_SHA2_384, "abc", "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed8086072ba1e7cc2358baeca134c825a7"},
+		{KSI_HASHALG_SHA2_384, "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+				"09330c33f71147e83d192fc782cd1b4753111b173b3b05d22fa08086e3b0f712fcc7c71a557e2db966c3e9fa91746039"},
+		{KSI_HASHALG_SHA2_512, "abc", "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"},
+		{KSI_HASHALG_SHA2_512, "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+				"8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909"},
+		{KSI_HASHALG_INVALID, NULL, NULL}
+	};
+	size_t i, m;
+
+	for (m = 0; m < sizeof(backendMasks) / sizeof(backendMasks[0]); m++) {
+		KSI_setHashBackendMask(backendMasks[m]);
+
+		for (i = 0; vectors[i].digest != NULL; i++) {
+			int res;
+			KSI_DataHash *hsh = NULL;
+			const unsigned char *digest = NULL;
+			size_t digest_len = 0;
+			unsigned char expected[64];
+			size_t expected_len = 0;
+			char errm[0xff];
+
+			KSITest_decodeHexStr(vectors[i].digest, expected, sizeof(expected), &expected_len);
+
+			res = KSI_DataHash_create(ctx, vectors[i].data, strlen(vectors[i].data), vectors[i].algo_id, &hsh);
+			CuAssert(tc, "Unable to create data hash.", res == KSI_OK && hsh != NULL);
+
+			res = KSI_DataHash_extract(hsh, NULL, &digest, &digest_len);
+			CuAssert(tc, "Unable to extract digest.", res == KSI_OK && digest != NULL);
+
+			KSI_snprintf(errm, sizeof(errm), "Hash value mismatch for %s (%s), backend mask %x.", KSI_getHashAlgorithmName(vectors[i].algo_id),
+					KSI_getHashBackendName(KSI_getHashBackend(vectors[i].algo_id)), backendMasks[m]);
+			CuAssert(tc, errm, expected_len == digest_len && !memcmp(digest, expected, expected_len));
+
+			KSI_DataHash_free(hsh);
+		}
+	}
+
+	KSI_setHashBackendMask(KSI_HASH_BACKEND_MASK_ALL);
+}
+
+static void testNativeHashAllLengths(CuTest *tc) {
+	/* SHA-256 over the concatenated digests of every prefix of the test data (0..300 bytes),
+	 * calculated with an independent implementation. */
+	struct {
+		KSI_HashAlgorithm algo_id;
+		const char *digest;
+	} vectors[] = {
+		{KSI_HASHALG_SHA2_256, "78f25692e2f4dd74482ac3dcf4f505a7c278fa279588b764b99a497144bcd49c"},
+		{KSI_HASHALG_SHA2_384, "fc2fe00f1cf27f5ff93b72070bc0aa303a22f0ee4d7c2c2c6475da9b6761d94b"},
+		{KSI_HASHALG_SHA2_512, "13ec09c8eca7c2f1c407c31094ea949647bcea1f96277d8490485a76d98ca851"},
+		{KSI_HASHALG_INVALID, NULL}
+	};
+	unsigned char data[300];
+	size_t i, m, len;
+
+	for (i = 0; i < sizeof(data); i++) {
+		data[i] = (unsigned char)(i * 31 + 7);
+	}
+
+	for (m = 0; m < sizeof(backendMasks) / sizeof(backendMasks[0]); m++) {
+		KSI_setHashBackendMask(backendMasks[m]);
+
+		for (i = 0; vectors[i].digest != NULL; i++) {
+			int res;
+			KSI_DataHasher *hsr = NULL;
+			KSI_DataHasher *all = NULL;
+			KSI_DataHash *hsh = NULL;
+			const unsigned char *digest = NULL;
+			size_t digest_len = 0;
+			unsigned char expected[32];
+			size_t expected_len = 0;
+			char errm[0xff];
+
+			res = KSI_DataHasher_open(ctx, KSI_HASHALG_SHA2_256, &all);
+			CuAssert(tc, "Unable to open hasher.", res == KSI_OK && all != NULL);
+
+			res = KSI_DataHasher_open(ctx, vectors[i].algo_id, &hsr);
+			CuAssert(tc, "Unable to open hasher.", res == KSI_OK && hsr != NULL);
+
+			for (len = 0; len <= sizeof(data); len++) {
+				/* Feed the data in two uneven parts to exercise the block buffering. */
+				res = KSI_DataHasher_reset(hsr);
+				CuAssert(tc, "Unable to reset hasher.", res == KSI_OK);
+
+				res = KSI_DataHasher_add(hsr, data, len / 3);
+				CuAssert(tc, "Unable to add data.", res == KSI_OK);
+
+				res = KSI_DataHasher_add(hsr, data + len / 3, len - len / 3);
+				CuAssert(tc, "Unable to add data.", res == KSI_OK);
+
+				res = KSI_DataHasher_close(hsr, &hsh);
+				CuAssert(tc, "Unable to close hasher.", res == KSI_OK && hsh != NULL);
+
+				res = KSI_DataHash_extract(hsh, NULL, &digest, &digest_len);
+				CuAssert(tc, "Unable to extract digest.", res == KSI_OK && digest != NULL);
+
+				res = KSI_DataHasher_add(all, digest, digest_len);
+				CuAssert(tc, "Unable to add data.", res == KSI_OK);
+
+				KSI_DataHash_free(hsh);
+				hsh = NULL;
+			}
+
+			res = KSI_DataHasher_close(all, &hsh);
+			CuAssert(tc, "Unable to close hasher.", res == KSI_OK && hsh != NULL);
+
+			res = KSI_DataHash_extract(hsh, NULL, &digest, &digest_len);
+			CuAssert(tc, "Unable to extract digest.", res == KSI_OK && digest != NULL);
+
+			KSITest_decodeHexStr(vectors[i].digest, expected, sizeof(expected), &expected_len);
+
+			KSI_snprintf(errm, sizeof(errm), "Hash value mismatch for %s, backend mask %x.", KSI_getHashAlgorithmName(vectors[i].algo_id), backendMasks[m]);
+			CuAssert(tc, errm, expected_len == digest_len && !memcmp(digest, expected, expected_len));
+
+			KSI_DataHash_free(hsh);
+			KSI_DataHasher_free(hsr);
+			KSI_DataHasher_free(all);
+		}
+	}
+
+	KSI_setHashBackendMask(KSI_HASH_BACKEND_MASK_ALL);
+}
+
+static void testCalculateImprintBatch(CuTest *tc) {
+#define TEST_BATCH_COUNT 19
+	/* SHA-256 over the concatenated digests of the batch messages, calculated with an
+	 * independent implementation. */
+	struct {
+		KSI_HashAlgorithm algo_id;
+		const char *digest;
+	} vectors[] = {
+		{KSI_HASHALG_SHA2_256, "bd8329664c9d2e9d63ef8d2dd4ae3f8622e77a9ec1124f579a77357de9fe5f5b"},
+		{KSI_HASHALG_SHA2_512, "9c229d4f671885ec3c72625507cac0acdabedcddac6c8eade1e17d118e288a4a"},
+		{KSI_HASHALG_SHA1, "11c63e873a0c7b23d16f76e5b76ace068e2788e4073dac734a3213e44d369d3d"},
+		{KSI_HASHALG_INVALID, NULL}
+	};
+	unsigned char data[300];
+	KSI_HashInput input[TEST_BATCH_COUNT * 2];
+	unsigned char imprints[TEST_BATCH_COUNT * KSI_MAX_IMPRINT_LEN];
+	size_t lens[TEST_BATCH_COUNT];
+	size_t i, j, m;
+
+	for (i = 0; i < sizeof(data); i++) {
+		data[i] = (unsigned char)(i * 13 + 5);
+	}
+
+	/* Message lengths cross the one, two and multi-block boundaries of the lane kernel. */
+	for (i = 0; i < TEST_BATCH_COUNT; i++) {
+		input[2 * i].data = data;
+		input[2 * i].data_length = i * 16;
+		input[2 * i + 1].data = data + i;
+		input[2 * i + 1].data_length = (i % 3) * 7;
+	}
+
+	for (m = 0; m < sizeof(backendMasks) / sizeof(backendMasks[0]); m++) {
+		KSI_setHashBackendMask(backendMasks[m]);
+
+		for (i = 0; vectors[i].digest != NULL; i++) {
+			int res;
+			KSI_DataHasher *all = NULL;
+			KSI_DataHash *hsh = NULL;
+			const unsigned char *digest = NULL;
+			size_t digest_len = 0;
+			unsigned char expected[32];
+			size_t expected_len = 0;
+			char errm[0xff];
+
+			res = KSI_calculateImprintBatch(ctx, vectors[i].algo_id, input, 2, TEST_BATCH_COUNT, imprints, lens);
+			CuAssert(tc, "Unable to calculate imprints.", res == KSI_OK);
+
+			res = KSI_DataHasher_open(ctx, KSI_HASHALG_SHA2_256, &all);
+			CuAssert(tc, "Unable to open hasher.", res == KSI_OK && all != NULL);
+
+			for (j = 0; j < TEST_BATCH_COUNT; j++) {
+				CuAssert(tc, "Unexpected imprint length.", lens[j] == KSI_getHashLength(vectors[i].algo_id) + 1);
+				CuAssert(tc, "Unexpected imprint algorithm.", imprints[j * KSI_MAX_IMPRINT_LEN] == vectors[i].algo_id);
+
+				res = KSI_DataHasher_add(all, imprints + j * KSI_MAX_IMPRINT_LEN + 1, lens[j] - 1);
+				CuAssert(tc, "Unable to add data.", res == KSI_OK);
+			}
+
+			res = KSI_DataHasher_close(all, &hsh);
+			CuAssert(tc, "Unable to close hasher.", res == KSI_OK && hsh != NULL);
+
+			res = KSI_DataHash_extract(hsh, NULL, &digest, &digest_len);
+			CuAssert(tc, "Unable to extract digest.", res == KSI_OK && digest != NULL);
+
+			KSITest_decodeHexStr(vectors[i].digest, expected, sizeof(expected), &expected_len);
+
+			KSI_snprintf(errm, sizeof(errm), "Batch imprint mismatch for %s, backend mask %x.", KSI_getHashAlgorithmName(vectors[i].algo_id), backendMasks[m]);
+			CuAssert(tc, errm, expected_len == digest_len && !memcmp(digest, expected, expected_len));
+
+			KSI_DataHash_free(hsh);
+			KSI_DataHasher_free(all);
+		}
+	}
+
+	KSI_setHashBackendMask(KSI_HASH_BACKEND_MASK_ALL);
+#undef TEST_BATCH_COUNT
+}
+
+static void testHashState(CuTest *tc) {
+	struct {
+		KSI_HashAlgorithm algo_id;
+		const char *imprint;
+	} vectors[] = {
+		{KSI_HASHALG_SHA2_256, "01ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+		{KSI_HASHALG_SHA1, "00a9993e364706816aba3e25717850c26c9cd0d89d"},
+		{KSI_HASHALG_SHA1, "00a9993e364706816aba3e25717850c26c9cd0d89d"},
+		{KSI_HASHALG_SHA2_512, "05ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f"},
+		{KSI_HASHALG_INVALID, NULL}
+	};
+	KSI_HashState state;
+	unsigned char imprint[KSI_MAX_IMPRINT_LEN];
+	size_t imprint_len = 0;
+	size_t i;
+	int res;
+
+	res = KSI_HashState_init(ctx, &state, vectors[0].algo_id);
+	CuAssert(tc, "Unable to initialize hash state.", res == KSI_OK);
+
+	/* The same state is reused for different algorithms. */
+	for (i = 0; vectors[i].imprint != NULL; i++) {
+		unsigned char expected[KSI_MAX_IMPRINT_LEN];
+		size_t expected_len = 0;
+		char errm[0xff];
+
+		if (i > 0) {
+			res = KSI_HashState_reset(&state, vectors[i].algo_id);
+			CuAssert(tc, "Unable to reset hash state.", res == KSI_OK);
+		}
+
+		res = KSI_HashState_add(&state, "a", 1);
+		CuAssert(tc, "Unable to add data.", res == KSI_OK);
+
+		res = KSI_HashState_add(&state, "bc", 2);
+		CuAssert(tc, "Unable to add data.", res == KSI_OK);
+
+		res = KSI_HashState_close(&state, imprint, &imprint_len);
+		CuAssert(tc, "Unable to close hash state.", res == KSI_OK);
+
+		KSITest_decodeHexStr(vectors[i].imprint, expected, sizeof(expected), &expected_len);
+
+		KSI_snprintf(errm, sizeof(errm), "Imprint mismatch for %s.", KSI_getHashAlgorithmName(vectors[i].algo_id));
+		CuAssert(tc, errm, expected_len == imprint_len && !memcmp(imprint, expected, expected_len));
+	}
+
+	res = KSI_HashState_reset(&state, KSI_HASHALG_INVALID);
+	CuAssert(tc, "Invalid algorithm must fail.", res == KSI_UNAVAILABLE_HASH_ALGORITHM);
+
+	res = KSI_HashState_close(&state, imprint, &imprint_len);
+	CuAssert(tc, "Closing a state without an algorithm must fail.", res != KSI_OK);
+
+	KSI_HashState_clear(&state);
+}
+
+static void testHashBackend(CuTest *tc) {
+	CuAssert(tc, "Algorithm without built-in kernel must use the provider.", KSI_getHashBackend(KSI_HASHALG_SHA1) == KSI_HASH_BACKEND_PROVIDER);
+	CuAssert(tc, "Backend name missing.", KSI_getHashBackendName(KSI_getHashBackend(KSI_HASHALG_SHA2_256)) != NULL);
+	CuAssert(tc, "Unknown backend must not have a name.", KSI_getHashBackendName((KSI_HashBackend)-1) == NULL);
+}
+
 CuSuite* KSITest_Hash_getSuite(void) {
 	CuSuite* suite = CuSuiteNew();
 
@@ -493,6 +800,12 @@ CuSuite* KSITest_Hash_getSuite(void) {
 	SUITE_ADD_TEST(suite, testAllHashing);
 	SUITE_ADD_TEST(suite, testReset);
 	SUITE_ADD_TEST(suite, test_free_without_close);
+	SUITE_ADD_TEST(suite, testCalculateImprint);
+	SUITE_ADD_TEST(suite, testNativeHashKnownValues);
+	SUITE_ADD_TEST(suite, testNativeHashAllLengths);
+	SUITE_ADD_TEST(suite, testCalculateImprintBatch);
+	SUITE_ADD_TEST(suite, testHashState);
+	SUITE_ADD_TEST(suite, testHashBackend);
 
 	return suite;
 }
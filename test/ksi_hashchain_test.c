@@ -23,6 +23,8 @@
 #include <ksi/hashchain.h>
 
 #include "all_tests.h"
+#include "../src/ksi/signature_impl.h"
+#include "../src/ksi/hashchain_impl.h"
 
 extern KSI_CTX *ctx;
 
@@ -418,12 +420,191 @@ static void testAggrChain_LegacyId_invalidStringLength_verifyErrorResult(CuTest
 #undef TEST_SIGNATURE_FILE
 }
 
+static void testAggregateBatch(CuTest *tc) {
+#define TEST_BATCH_MAX_ITEMS 64
+	const char *files[] = {
+		"resource/tlv/ok-sig-2014-04-30.1.ksig",
+		"resource/tlv/ok-sig-2014-06-2.ksig",
+		"resource/tlv/ok-sig-2014-07-01.1.ksig",
+		"resource/tlv/ok-legacy-sig-2014-06.gtts.ksig",
+		"resource/tlv/cal_algo_switch.ksig",
+		"resource/tlv/ok-sig-metadata-with-padding.ksig",
+		NULL
+	};
+	KSI_Signature *sigs[6];
+	KSI_HashChainAggregation items[TEST_BATCH_MAX_ITEMS];
+	size_t count = 0;
+	size_t i, j;
+	int res;
+
+	memset(sigs, 0, sizeof(sigs));
+
+	for (i = 0; files[i] != NULL; i++) {
+		res = KSI_Signature_fromFile(ctx, getFullResourcePath(files[i]), &sigs[i]);
+		CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && sigs[i] != NULL);
+
+		for (j = 0; j < KSI_AggregationHashChainList_length(sigs[i]->aggregationChainList) && count < TEST_BATCH_MAX_ITEMS; j++) {
+			KSI_AggregationHashChain *aggr = NULL;
+			KSI_DataHash *inputHash = NULL;
+			KSI_Integer *algo = NULL;
+
+			res = KSI_AggregationHashChainList_elementAt(sigs[i]->aggregationChainList, j, &aggr);
+			CuAssert(tc, "Unable to get aggregation chain.", res == KSI_OK && aggr != NULL);
+
+			res = KSI_AggregationHashChain_getChain(aggr, &items[count].chain);
+			CuAssert(tc, "Unable to get hash chain links.", res == KSI_OK);
+
+			res = KSI_AggregationHashChain_getInputHash(aggr, &inputHash);
+			CuAssert(tc, "Unable to get input hash.", res == KSI_OK);
+
+			res = KSI_AggregationHashChain_getAggrHashId(aggr, &algo);
+			CuAssert(tc, "Unable to get aggregation algorithm.", res == KSI_OK);
+
+			items[count].inputHash = inputHash;
+			items[count].isCalendar = 0;
+			items[count].startLevel = (int)j;
+			items[count].algo_id = (KSI_HashAlgorithm)KSI_Integer_getUInt64(algo);
+			count++;
+		}
+
+		if (sigs[i]->calendarChain != NULL && count < TEST_BATCH_MAX_ITEMS) {
+			KSI_DataHash *inputHash = NULL;
+
+			res = KSI_CalendarHashChain_getHashChain(sigs[i]->calendarChain, &items[count].chain);
+			CuAssert(tc, "Unable to get calendar hash chain links.", res == KSI_OK);
+
+			res = KSI_CalendarHashChain_getInputHash(sigs[i]->calendarChain, &inputHash);
+			CuAssert(tc, "Unable to get calendar input hash.", res == KSI_OK);
+
+			items[count].inputHash = inputHash;
+			items[count].isCalendar = 1;
+			items[count].startLevel = 0;
+			items[count].algo_id = KSI_HASHALG_INVALID;
+			count++;
+		}
+	}
+
+	CuAssert(tc, "No chains to aggregate.", count > 8);
+
+	res = KSI_HashChain_aggregateBatch(ctx, items, count);
+	CuAssert(tc, "Unable to aggregate chains in batch.", res == KSI_OK);
+
+	for (i = 0; i < count; i++) {
+		KSI_DataHash *out = NULL;
+		int endLevel = 0;
+
+		if (items[i].isCalendar) {
+			res = KSI_HashChain_aggregateCalendar(ctx, items[i].chain, items[i].inputHash, &out);
+		} else {
+			res = KSI_HashChain_aggregate(ctx, items[i].chain, items[i].inputHash, items[i].startLevel, items[i].algo_id, &endLevel, &out);
+		}
+		CuAssert(tc, "Unable to aggregate chain.", res == KSI_OK && out != NULL);
+
+		CuAssert(tc, "Batch output hash mismatch.", KSI_DataHash_equals(out, items[i].outputHash));
+		CuAssert(tc, "Batch end level mismatch.", items[i].isCalendar || endLevel == items[i].endLevel);
+
+		KSI_DataHash_free(out);
+		KSI_DataHash_free(items[i].outputHash);
+	}
+
+	for (i = 0; i < sizeof(sigs) / sizeof(sigs[0]); i++) {
+		KSI_Signature_free(sigs[i]);
+	}
+#undef TEST_BATCH_MAX_ITEMS
+}
+
+static void testAggregationChainListBatch(CuTest *tc) {
+	const char *files[] = {
+		"resource/tlv/ok-sig-2014-04-30.1.ksig",
+		"resource/tlv/ok-sig-2014-06-2.ksig",
+		"resource/tlv/ok-legacy-sig-2014-06.gtts.ksig",
+		"resource/tlv/ok-sig-metadata-with-padding.ksig",
+		NULL
+	};
+	KSI_Signature *sigs[4];
+	KSI_AggregationHashChainList *lists[4];
+	size_t i, j;
+	int res;
+
+	memset(sigs, 0, sizeof(sigs));
+
+	for (i = 0; files[i] != NULL; i++) {
+		res = KSI_Signature_fromFile(ctx, getFullResourcePath(files[i]), &sigs[i]);
+		CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && sigs[i] != NULL);
+
+		lists[i] = sigs[i]->aggregationChainList;
+
+		/* Drop the output hashes cached by the verification while parsing. */
+		for (j = 0; j < KSI_AggregationHashChainList_length(lists[i]); j++) {
+			KSI_AggregationHashChain *aggr = NULL;
+
+			res = KSI_AggregationHashChainList_elementAt(lists[i], j, &aggr);
+			CuAssert(tc, "Unable to get aggregation chain.", res == KSI_OK && aggr != NULL);
+
+			KSI_DataHash_free(aggr->outputHash);
+			aggr->outputHash = NULL;
+		}
+	}
+
+	res = KSI_AggregationHashChainList_aggregateBatch(ctx, lists, i);
+	CuAssert(tc, "Unable to aggregate chain lists in batch.", res == KSI_OK);
+
+	for (i = 0; files[i] != NULL; i++) {
+		int level = 0;
+
+		for (j = 0; j < KSI_AggregationHashChainList_length(lists[i]); j++) {
+			KSI_AggregationHashChain *aggr = NULL;
+			KSI_LIST(KSI_HashChainLink) *chain = NULL;
+			KSI_DataHash *inputHash = NULL;
+			KSI_Integer *algo = NULL;
+			KSI_DataHash *expected = NULL;
+			KSI_DataHash *cached = NULL;
+			int expectedLevel = 0;
+			int cachedLevel = 0;
+
+			res = KSI_AggregationHashChainList_elementAt(lists[i], j, &aggr);
+			CuAssert(tc, "Unable to get aggregation chain.", res == KSI_OK && aggr != NULL);
+
+			res = KSI_AggregationHashChain_getChain(aggr, &chain);
+			CuAssert(tc, "Unable to get hash chain links.", res == KSI_OK);
+
+			res = KSI_AggregationHashChain_getInputHash(aggr, &inputHash);
+			CuAssert(tc, "Unable to get input hash.", res == KSI_OK);
+
+			res = KSI_AggregationHashChain_getAggrHashId(aggr, &algo);
+			CuAssert(tc, "Unable to get aggregation algorithm.", res == KSI_OK);
+
+			res = KSI_HashChain_aggregate(ctx, chain, inputHash, level, (KSI_HashAlgorithm)KSI_Integer_getUInt64(algo), &expectedLevel, &expected);
+			CuAssert(tc, "Unable to aggregate chain.", res == KSI_OK && expected != NULL);
+
+			CuAssert(tc, "Output hash not cached by the batch.", aggr->outputHash != NULL && aggr->inputLevel == level);
+
+			res = KSI_AggregationHashChain_aggregate(aggr, level, &cachedLevel, &cached);
+			CuAssert(tc, "Unable to get the aggregated chain output.", res == KSI_OK && cached != NULL);
+
+			CuAssert(tc, "Batch output hash mismatch.", KSI_DataHash_equals(expected, cached));
+			CuAssert(tc, "Batch end level mismatch.", expectedLevel == cachedLevel);
+
+			level = expectedLevel;
+
+			KSI_DataHash_free(expected);
+			KSI_DataHash_free(cached);
+		}
+	}
+
+	for (i = 0; i < sizeof(sigs) / sizeof(sigs[0]); i++) {
+		KSI_Signature_free(sigs[i]);
+	}
+}
+
 CuSuite* KSITest_HashChain_getSuite(void) {
 	CuSuite* suite = CuSuiteNew();
 
 	SUITE_ADD_TEST(suite, testCalChainBuild);
 	SUITE_ADD_TEST(suite, testAggrChainBuilt);
 	SUITE_ADD_TEST(suite, testAggrChainBuiltWithMetaData);
+	SUITE_ADD_TEST(suite, testAggregateBatch);
+	SUITE_ADD_TEST(suite, testAggregationChainListBatch);
 	SUITE_ADD_TEST(suite, testAggrChain_LegacyId_siblingContainsLegacyId_verifyErrorResult);
 	SUITE_ADD_TEST(suite, testAggrChain_LegacyId_invalidHeader_verifyErrorResult);
 	SUITE_ADD_TEST(suite, testAggrChain_LegacyId_invalidDataLength_verifyErrorResult);
@@ -1663,6 +1663,69 @@ static void testSigningWithLevel(CuTest* tc) {
 }
 
 
+static void testRequestMetrics(CuTest* tc) {
+#define TEST_AGGR_RESPONSE_FILE "resource/tlv/v2/ok-sig-2014-07-01.1-aggr_response.tlv"
+
+	int res;
+	KSI_DataHash *hsh = NULL;
+	KSI_Signature *sig = NULL;
+	KSI_MetricsSnapshot snapshot;
+	const KSI_EndpointMetrics *aggr = &snapshot.endpoint[KSI_METRICS_AGGREGATOR];
+	char text[0x8000];
+	size_t text_len = 0;
+	char expected[128];
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_CTX_resetMetrics(ctx);
+	CuAssert(tc, "Unable to reset metrics.", res == KSI_OK);
+
+	res = KSI_DataHash_fromImprint(ctx, mockImprint, sizeof(mockImprint), &hsh);
+	CuAssert(tc, "Unable to create data hash object from raw imprint", res == KSI_OK && hsh != NULL);
+
+	res = KSI_CTX_setAggregator(ctx, getFullResourcePathUri(TEST_AGGR_RESPONSE_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set aggregator file URI", res == KSI_OK);
+
+	res = KSI_createSignature(ctx, hsh, &sig);
+	CuAssert(tc, "Unable to sign the hash", res == KSI_OK && sig != NULL);
+
+	/* The second request fails on the HMAC algorithm check. */
+	res = KSI_CTX_setAggregator(ctx, getFullResourcePathUri(TEST_AGGR_RESPONSE_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set aggregator file URI", res == KSI_OK);
+	ctx->netProvider->requestCount = 0;
+	ctx->options[KSI_OPT_AGGR_HMAC_ALGORITHM] = KSI_HASHALG_SHA2_512;
+
+	res = KSI_createSignature(ctx, hsh, &sig);
+	CuAssert(tc, "Signing should fail with HMAC algorithm mismatch.", res == KSI_HMAC_ALGORITHM_MISMATCH);
+
+	res = KSI_CTX_getMetrics(ctx, &snapshot);
+	CuAssert(tc, "Unable to get metrics.", res == KSI_OK);
+
+	CuAssert(tc, "Unexpected number of aggregation requests.", aggr->requests == 2);
+	CuAssert(tc, "Unexpected number of errors.", aggr->errors == 1 && aggr->errorCodes_len == 1 &&
+			aggr->errorCodes[0].code == KSI_HMAC_ALGORITHM_MISMATCH && aggr->errorCodes[0].count == 1);
+	CuAssert(tc, "Bytes not counted.", aggr->bytesOut > 0 && aggr->bytesIn > 0);
+	CuAssert(tc, "Request durations not recorded.", aggr->total.count == 2 && aggr->connect.count == 2);
+	CuAssert(tc, "HMAC verification duration not recorded.", aggr->hmac.count == 2);
+	CuAssert(tc, "Extender should have no requests.", snapshot.endpoint[KSI_METRICS_EXTENDER].requests == 0);
+
+	res = KSI_MetricsSnapshot_toPrometheus(&snapshot, text, 16, NULL);
+	CuAssert(tc, "Small buffer should overflow.", res == KSI_BUFFER_OVERFLOW);
+
+	res = KSI_MetricsSnapshot_toPrometheus(&snapshot, text, sizeof(text), &text_len);
+	CuAssert(tc, "Unable to format metrics.", res == KSI_OK && text_len == strlen(text));
+	CuAssert(tc, "Request counter missing.", strstr(text, "ksi_requests_total{endpoint=\"aggregator\"} 2\n") != NULL);
+	KSI_snprintf(expected, sizeof(expected), "ksi_errors_total{endpoint=\"aggregator\",code=\"0x%x\"} 1\n", KSI_HMAC_ALGORITHM_MISMATCH);
+	CuAssert(tc, "Error counter missing.", strstr(text, expected) != NULL);
+	CuAssert(tc, "Histogram count missing.", strstr(text, "ksi_request_duration_seconds_count{endpoint=\"aggregator\"} 2\n") != NULL);
+	CuAssert(tc, "Histogram infinite bucket missing.", strstr(text, "ksi_request_duration_seconds_bucket{endpoint=\"aggregator\",le=\"+Inf\"} 2\n") != NULL);
+
+	KSI_DataHash_free(hsh);
+	KSI_Signature_free(sig);
+
+#undef TEST_AGGR_RESPONSE_FILE
+}
+
 CuSuite* KSITest_NetPduV2_getSuite(void) {
 	CuSuite* suite = CuSuiteNew();
 
@@ -1717,6 +1780,7 @@ CuSuite* KSITest_NetPduV2_getSuite(void) {
 	SUITE_ADD_TEST(suite, testAggregationResponseMultiplePayload);
 	SUITE_ADD_TEST(suite, testAggregationResponseWithResponseAndErrorPayload);
         SUITE_ADD_TEST(suite, testSigningWithLevel);
+	SUITE_ADD_TEST(suite, testRequestMetrics);
 
 	return suite;
 }
@@ -3212,6 +3212,202 @@ static void TestFallbackPolicy_CalendarBased_FAIL_KeyBased_NA(CuTest* tc) {
 #undef TEST_EXT_RESPONSE_FILE
 }
 
+static int countRuleLogger(void *logCtx, int level, const char *message) {
+	if (strstr(message, "Verify aggregation hash chain consistency.") != NULL) {
+		(*(int *)logCtx)++;
+	}
+	return KSI_OK;
+}
+
+static void TestFallbackPolicy_RulesVerifiedOnce(CuTest* tc) {
+#define TEST_SIGNATURE_FILE "resource/tlv/ok-sig-2014-04-30.1-no-cal-hashchain.ksig"
+#define TEST_EXT_RESPONSE_FILE "resource/tlv/" TEST_RESOURCE_EXT_VER "/ok-sig-2014-04-30.1-extend_response-input_hash_null.tlv"
+	int res;
+	KSI_Policy *policy = NULL;
+	KSI_VerificationContext context;
+	KSI_PolicyVerificationResult *result = NULL;
+	KSI_Signature *signature = NULL;
+	KSI_LoggerCallback loggerCB = ctx->loggerCB;
+	void *loggerCtx = ctx->loggerCtx;
+	int count = 0;
+	size_t i;
+	size_t policyCount;
+
+	KSI_LOG_debug(ctx, "%s", __FUNCTION__);
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_Policy_clone(ctx, KSI_VERIFICATION_POLICY_CALENDAR_BASED, &policy);
+	CuAssert(tc, "Policy cloning failed", res == KSI_OK);
+
+	res = KSI_Policy_setFallback(ctx, policy, KSI_VERIFICATION_POLICY_KEY_BASED);
+	CuAssert(tc, "Fallback policy setup failed", res == KSI_OK);
+
+	res = KSI_VerificationContext_init(&context, ctx);
+	CuAssert(tc, "Verification context creation failed", res == KSI_OK);
+
+	res = KSI_Signature_fromFile(ctx, getFullResourcePath(TEST_SIGNATURE_FILE), &signature);
+	CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && signature != NULL);
+	context.signature = signature;
+
+	res = KSI_CTX_setExtender(ctx, getFullResourcePathUri(TEST_EXT_RESPONSE_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set extender file URI.", res == KSI_OK);
+
+	KSI_CTX_setLoggerCallback(ctx, countRuleLogger, &count);
+	res = KSI_SignatureVerifier_verify(policy, &context, &result);
+	KSI_CTX_setLoggerCallback(ctx, loggerCB, loggerCtx);
+	CuAssert(tc, "Policy verification failed", res == KSI_OK && result != NULL);
+
+	policyCount = KSI_RuleVerificationResultList_length(result->policyResults);
+	CuAssert(tc, "Fallback policy was not verified.", policyCount == 2);
+	CuAssert(tc, "Aggregation hash chain should be verified only once.", count == 1);
+
+	/* The internal rules must be reported as successful for both policies. */
+	for (i = 0; i < policyCount; i++) {
+		KSI_RuleVerificationResult *policyResult = NULL;
+		res = KSI_RuleVerificationResultList_elementAt(result->policyResults, i, &policyResult);
+		CuAssert(tc, "Unable to get policy result.", res == KSI_OK && policyResult != NULL);
+		CuAssert(tc, "Unexpected verification property", SuccessfulProperty(policyResult, KSI_VERIFY_AGGRCHAIN_INTERNALLY));
+	}
+
+	KSI_PolicyVerificationResult_free(result);
+	KSI_Signature_free(signature);
+	KSI_VerificationContext_clean(&context);
+	KSI_Policy_free(policy);
+
+#undef TEST_SIGNATURE_FILE
+#undef TEST_EXT_RESPONSE_FILE
+}
+
+static int RuleResultsEqual(const KSI_RuleVerificationResult *a, const KSI_RuleVerificationResult *b) {
+	return a->resultCode == b->resultCode &&
+			a->errorCode == b->errorCode &&
+			((a->ruleName == NULL && b->ruleName == NULL) || (a->ruleName != NULL && b->ruleName != NULL && !strcmp(a->ruleName, b->ruleName))) &&
+			((a->policyName == NULL && b->policyName == NULL) || (a->policyName != NULL && b->policyName != NULL && !strcmp(a->policyName, b->policyName))) &&
+			a->stepsPerformed == b->stepsPerformed &&
+			a->stepsSuccessful == b->stepsSuccessful &&
+			a->stepsFailed == b->stepsFailed;
+}
+
+static int RuleResultListsEqual(KSI_RuleVerificationResultList *a, KSI_RuleVerificationResultList *b) {
+	size_t i;
+
+	if (KSI_RuleVerificationResultList_length(a) != KSI_RuleVerificationResultList_length(b)) return 0;
+
+	for (i = 0; i < KSI_RuleVerificationResultList_length(a); i++) {
+		KSI_RuleVerificationResult *x = NULL;
+		KSI_RuleVerificationResult *y = NULL;
+
+		if (KSI_RuleVerificationResultList_elementAt(a, i, &x) != KSI_OK) return 0;
+		if (KSI_RuleVerificationResultList_elementAt(b, i, &y) != KSI_OK) return 0;
+		if (!RuleResultsEqual(x, y)) return 0;
+	}
+
+	return 1;
+}
+
+static void TestCompiledPolicy_MatchesInterpreted(CuTest* tc) {
+#define TEST_EXT_RESPONSE_FILE "resource/tlv/" TEST_RESOURCE_EXT_VER "/ok-sig-2014-04-30.1-extend_response.tlv"
+	static const char *signatures[] = {
+		"resource/tlv/ok-sig-2014-04-30.1-extended.ksig",
+		"resource/tlv/ok-sig-2014-04-30.1-no-cal-hashchain.ksig",
+		"resource/tlv/ok-sig-2014-04-30.1-head.ksig",
+		"resource/tlv/ok-sig-2014-04-30.1.ksig",
+		"resource/tlv/cal_algo_switch.ksig",
+		"resource/tlv/nok-sig-2015-09-13_21-34-00.ksig",
+		NULL
+	};
+	int res;
+	KSI_Policy *chain = NULL;
+	const KSI_Policy *policies[7];
+	size_t p;
+	size_t i;
+
+	KSI_LOG_debug(ctx, "%s", __FUNCTION__);
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_Policy_clone(ctx, KSI_VERIFICATION_POLICY_CALENDAR_BASED, &chain);
+	CuAssert(tc, "Policy cloning failed", res == KSI_OK);
+
+	res = KSI_Policy_setFallback(ctx, chain, KSI_VERIFICATION_POLICY_KEY_BASED);
+	CuAssert(tc, "Fallback policy setup failed", res == KSI_OK);
+
+	policies[0] = KSI_VERIFICATION_POLICY_EMPTY;
+	policies[1] = KSI_VERIFICATION_POLICY_INTERNAL;
+	policies[2] = KSI_VERIFICATION_POLICY_CALENDAR_BASED;
+	policies[3] = KSI_VERIFICATION_POLICY_KEY_BASED;
+	policies[4] = KSI_VERIFICATION_POLICY_PUBLICATIONS_FILE_BASED;
+	policies[5] = KSI_VERIFICATION_POLICY_GENERAL;
+	policies[6] = chain;
+
+	for (p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+		KSI_CompiledPolicy *compiled = NULL;
+
+		res = KSI_Policy_compile(ctx, policies[p], &compiled);
+		CuAssert(tc, "Unable to compile policy.", res == KSI_OK && compiled != NULL);
+
+		for (i = 0; signatures[i] != NULL; i++) {
+			KSI_Signature *sig = NULL;
+			KSI_VerificationContext context;
+			KSI_PolicyVerificationResult *expected = NULL;
+			KSI_PolicyVerificationResult *actual = NULL;
+			KSI_PolicyVerificationResult *previous = NULL;
+
+			res = KSI_Signature_fromFile(ctx, getFullResourcePath(signatures[i]), &sig);
+			CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && sig != NULL);
+
+			res = KSI_VerificationContext_init(&context, ctx);
+			CuAssert(tc, "Verification context creation failed", res == KSI_OK);
+			context.signature = sig;
+
+			/* The extender response file is read once and matches only the first request. */
+			ctx->netProvider->requestCount = 0;
+			res = KSI_CTX_setExtender(ctx, getFullResourcePathUri(TEST_EXT_RESPONSE_FILE), TEST_USER, TEST_PASS);
+			CuAssert(tc, "Unable to set extender file URI.", res == KSI_OK);
+			res = KSI_SignatureVerifier_verify(policies[p], &context, &expected);
+			CuAssert(tc, "Policy verification failed", res == KSI_OK && expected != NULL);
+
+			ctx->netProvider->requestCount = 0;
+			res = KSI_CTX_setExtender(ctx, getFullResourcePathUri(TEST_EXT_RESPONSE_FILE), TEST_USER, TEST_PASS);
+			CuAssert(tc, "Unable to set extender file URI.", res == KSI_OK);
+			res = KSI_CompiledPolicy_verify(compiled, &context, &actual);
+			CuAssert(tc, "Compiled policy verification failed", res == KSI_OK && actual != NULL);
+
+			CuAssert(tc, "Result code mismatch.", expected->resultCode == actual->resultCode);
+			CuAssert(tc, "Final result mismatch.", RuleResultsEqual(&expected->finalResult, &actual->finalResult));
+			CuAssert(tc, "Rule results mismatch.", RuleResultListsEqual(expected->ruleResults, actual->ruleResults));
+			CuAssert(tc, "Policy results mismatch.", RuleResultListsEqual(expected->policyResults, actual->policyResults));
+
+			/* A released result buffer is reused. */
+			previous = actual;
+			KSI_PolicyVerificationResult_free(actual);
+			actual = NULL;
+			KSI_Signature_free(ctx->lastFailedSignature);
+			ctx->lastFailedSignature = NULL;
+
+			ctx->netProvider->requestCount = 0;
+			res = KSI_CTX_setExtender(ctx, getFullResourcePathUri(TEST_EXT_RESPONSE_FILE), TEST_USER, TEST_PASS);
+			CuAssert(tc, "Unable to set extender file URI.", res == KSI_OK);
+			res = KSI_CompiledPolicy_verify(compiled, &context, &actual);
+			CuAssert(tc, "Compiled policy verification failed", res == KSI_OK && actual != NULL);
+			CuAssert(tc, "Result buffer was not reused.", previous == actual);
+			CuAssert(tc, "Rule results mismatch after reuse.", RuleResultListsEqual(expected->ruleResults, actual->ruleResults));
+
+			KSI_PolicyVerificationResult_free(expected);
+			KSI_PolicyVerificationResult_free(actual);
+			KSI_VerificationContext_clean(&context);
+			KSI_Signature_free(sig);
+		}
+
+		KSI_CompiledPolicy_free(compiled);
+	}
+
+	KSI_Policy_free(chain);
+
+#undef TEST_EXT_RESPONSE_FILE
+}
+
 static void TestUserPublicationWithBadCalAuthRec(CuTest *tc) {
 #define TEST_SIGNATURE_FILE "resource/tlv/nok-sig-2015-09-13_21-34-00.ksig"
 #define TEST_EXT_RESPONSE_FILE "resource/tlv/" TEST_RESOURCE_EXT_VER "/nok-sig-2015-09-13_21-34-00-extend_responce.tlv"
@@ -3351,6 +3547,91 @@ static void TestBackgroundVerificationWithKeyBasedPolicy(CuTest* tc) {
 #undef TEST_SIGNATURE_FILE
 }
 
+typedef struct {
+	size_t count[KSI_TRACE_POLICY + 1];
+	size_t misordered;
+	const char *lastPolicy;
+} TraceCollector;
+
+static void collectTrace(void *traceCtx, const KSI_VerificationTraceEvent *event) {
+	TraceCollector *col = traceCtx;
+	if (event->type >= KSI_TRACE_RULE && event->type <= KSI_TRACE_POLICY) col->count[event->type]++;
+	if (event->end_us < event->begin_us) col->misordered++;
+	if (event->type == KSI_TRACE_POLICY) col->lastPolicy = event->name;
+}
+
+static void TestVerificationTrace(CuTest* tc) {
+#define TEST_SIGNATURE_FILE "resource/tlv/ok-sig-2014-04-30.1.ksig"
+#define TEST_EXT_RESPONSE_FILE "resource/tlv/" TEST_RESOURCE_EXT_VER "/ok-sig-2014-04-30.1-extend_response.tlv"
+	int res;
+	KSI_Signature *sig = NULL;
+	KSI_VerificationContext context;
+	KSI_PolicyVerificationResult *result = NULL;
+	static TraceCollector col;
+	KSI_PolicyStats stats;
+	const char *name = KSI_VERIFICATION_POLICY_CALENDAR_BASED->policyName;
+
+	KSI_LOG_debug(ctx, "%s", __FUNCTION__);
+
+	KSI_ERR_clearErrors(ctx);
+	memset(&col, 0, sizeof(col));
+
+	res = KSI_CTX_resetPolicyStats(ctx);
+	CuAssert(tc, "Unable to reset policy statistics.", res == KSI_OK);
+
+	res = KSI_Signature_fromFile(ctx, getFullResourcePath(TEST_SIGNATURE_FILE), &sig);
+	CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && sig != NULL);
+
+	res = KSI_CTX_setVerificationTraceCallback(ctx, collectTrace, &col);
+	CuAssert(tc, "Unable to set trace callback.", res == KSI_OK);
+
+	res = KSI_CTX_setExtender(ctx, getFullResourcePathUri(TEST_EXT_RESPONSE_FILE), TEST_USER, TEST_PASS);
+	CuAssert(tc, "Unable to set extender file URI.", res == KSI_OK);
+
+	res = KSI_VerificationContext_init(&context, ctx);
+	CuAssert(tc, "Verification context creation failed", res == KSI_OK);
+	context.signature = sig;
+
+	res = KSI_SignatureVerifier_verify(KSI_VERIFICATION_POLICY_CALENDAR_BASED, &context, &result);
+	CuAssert(tc, "Policy verification failed", res == KSI_OK && result != NULL);
+	CuAssert(tc, "Unexpected verification result", result->finalResult.resultCode == KSI_VER_RES_OK);
+
+	CuAssert(tc, "Rules not traced.", col.count[KSI_TRACE_RULE] > 0);
+	CuAssert(tc, "Extending not traced.", col.count[KSI_TRACE_FETCH_CALENDAR_CHAIN] == 1);
+	CuAssert(tc, "Policy not traced.", col.count[KSI_TRACE_POLICY] == 1 && col.lastPolicy != NULL && !strcmp(col.lastPolicy, name));
+	CuAssert(tc, "Event end before begin.", col.misordered == 0);
+
+	res = KSI_CTX_getPolicyStats(ctx, name, &stats);
+	CuAssert(tc, "Unable to get policy statistics.", res == KSI_OK);
+	CuAssert(tc, "Unexpected policy statistics.", stats.verifications == 1 && stats.results[KSI_VER_RES_OK] == 1 && stats.errors == 0);
+	CuAssert(tc, "Unexpected rule statistics.", stats.rules == col.count[KSI_TRACE_RULE] && stats.fetches == 1);
+	CuAssert(tc, "Inconsistent durations.", stats.total_us >= stats.rules_us && stats.rules_us >= stats.fetch_us && stats.max_us == stats.total_us);
+
+	/* Nothing is collected when tracing is disabled. */
+	KSI_PolicyVerificationResult_free(result);
+	result = NULL;
+	KSI_VerificationContext_clean(&context);
+
+	res = KSI_CTX_setVerificationTraceCallback(ctx, NULL, NULL);
+	CuAssert(tc, "Unable to disable tracing.", res == KSI_OK);
+
+	res = KSI_VerificationContext_init(&context, ctx);
+	CuAssert(tc, "Verification context creation failed", res == KSI_OK);
+	context.signature = sig;
+
+	res = KSI_SignatureVerifier_verify(KSI_VERIFICATION_POLICY_INTERNAL, &context, &result);
+	CuAssert(tc, "Policy verification failed", res == KSI_OK && result != NULL);
+
+	res = KSI_CTX_getPolicyStats(ctx, KSI_VERIFICATION_POLICY_INTERNAL->policyName, &stats);
+	CuAssert(tc, "Statistics collected without tracing.", res == KSI_OK && stats.verifications == 0);
+
+	KSI_PolicyVerificationResult_free(result);
+	KSI_VerificationContext_clean(&context);
+	KSI_Signature_free(sig);
+#undef TEST_SIGNATURE_FILE
+#undef TEST_EXT_RESPONSE_FILE
+}
+
 CuSuite* KSITest_Policy_getSuite(void) {
 	CuSuite* suite = CuSuiteNew();
 	suite->preTest = preTest;
@@ -3423,6 +3704,9 @@ CuSuite* KSITest_Policy_getSuite(void) {
 	SUITE_ADD_TEST(suite, TestPolicyCloning);
 	SUITE_ADD_TEST(suite, TestFallbackPolicy_CalendarBased_OK_KeyBased_NA);
 	SUITE_ADD_TEST(suite, TestFallbackPolicy_CalendarBased_FAIL_KeyBased_NA);
+	SUITE_ADD_TEST(suite, TestFallbackPolicy_RulesVerifiedOnce);
+	SUITE_ADD_TEST(suite, TestCompiledPolicy_MatchesInterpreted);
+	SUITE_ADD_TEST(suite, TestVerificationTrace);
 	SUITE_ADD_TEST(suite, TestUserPublicationWithBadCalAuthRec);
 	SUITE_ADD_TEST(suite, TestBackgroundVerificationWithUserPublicationBasedPolicy);
 	SUITE_ADD_TEST(suite, TestBackgroundVerificationWithKeyBasedPolicy);
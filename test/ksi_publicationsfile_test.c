@@ -17,11 +17,16 @@
  * reserves and retains all trademark rights.
  */
 
+#include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <ksi/publicationsfile.h>
 #include <ksi/pkitruststore.h>
+#include <ksi/base32.h>
 #include "all_tests.h"
 #include "../src/ksi/publicationsfile_impl.h"
+#include "../src/ksi/ctx_impl.h"
+#include "../src/ksi/net_impl.h"
 
 extern KSI_CTX *ctx;
 
@@ -69,6 +74,122 @@ static void testLoadPublicationsFileWithNoCerts(CuTest *tc) {
 	KSI_PublicationsFile_free(pubFile);
 }
 
+static void testGetPKICertificateById(CuTest *tc) {
+	int res;
+	KSI_PublicationsFile *pubFile = NULL;
+	KSI_LIST(KSI_CertificateRecord) *certList = NULL;
+	KSI_PKICertificate *cert = NULL;
+	unsigned char dummy[] = {0xca, 0xfe, 0xba, 0xbe};
+	KSI_OctetString *certId = NULL;
+	size_t i;
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_PublicationsFile_fromFile(ctx, getFullResourcePath(TEST_PUBLICATIONS_FILE), &pubFile);
+	CuAssert(tc, "Unable to read publications file", res == KSI_OK && pubFile != NULL);
+
+	res = KSI_PublicationsFile_getCertificates(pubFile, &certList);
+	CuAssert(tc, "Unable to get certificate list", res == KSI_OK && KSI_CertificateRecordList_length(certList) > 0);
+
+	for (i = 0; i < KSI_CertificateRecordList_length(certList); i++) {
+		KSI_CertificateRecord *certRec = NULL;
+		KSI_OctetString *recId = NULL;
+		KSI_PKICertificate *recCert = NULL;
+		const unsigned char *raw = NULL;
+		size_t raw_len = 0;
+
+		res = KSI_CertificateRecordList_elementAt(certList, i, &certRec);
+		CuAssert(tc, "Unable to get certificate record.", res == KSI_OK && certRec != NULL);
+
+		res = KSI_CertificateRecord_getCertId(certRec, &recId);
+		CuAssert(tc, "Unable to get certificate id.", res == KSI_OK && recId != NULL);
+
+		res = KSI_CertificateRecord_getCert(certRec, &recCert);
+		CuAssert(tc, "Unable to get certificate.", res == KSI_OK && recCert != NULL);
+
+		/* Search with a copy of the id, not the object stored in the record. */
+		res = KSI_OctetString_extract(recId, &raw, &raw_len);
+		CuAssert(tc, "Unable to extract certificate id.", res == KSI_OK);
+
+		res = KSI_OctetString_new(ctx, raw, raw_len, &certId);
+		CuAssert(tc, "Creating an octetstring failed", res == KSI_OK && certId != NULL);
+
+		cert = NULL;
+		res = KSI_PublicationsFile_getPKICertificateById(pubFile, certId, &cert);
+		CuAssert(tc, "Certificate not found by id.", res == KSI_OK && cert == recCert);
+
+		KSI_OctetString_free(certId);
+		certId = NULL;
+	}
+
+	res = KSI_OctetString_new(ctx, dummy, sizeof(dummy), &certId);
+	CuAssert(tc, "Creating an octetstring failed", res == KSI_OK && certId != NULL);
+
+	cert = NULL;
+	res = KSI_PublicationsFile_getPKICertificateById(pubFile, certId, &cert);
+	CuAssert(tc, "Searching for a non existend certificate failed", res == KSI_OK && cert == NULL);
+
+	KSI_OctetString_free(certId);
+	KSI_PublicationsFile_free(pubFile);
+}
+
+static void testGetPKICertificateByIdAfterInPlaceEdit(CuTest *tc) {
+	int res;
+	KSI_PublicationsFile *pubFile = NULL;
+	KSI_LIST(KSI_CertificateRecord) *certList = NULL;
+	KSI_CertificateRecord *certRec = NULL;
+	KSI_OctetString *oldId = NULL;
+	KSI_OctetString *newId = NULL;
+	KSI_PKICertificate *recCert = NULL;
+	KSI_PKICertificate *cert = NULL;
+	const unsigned char *raw = NULL;
+	size_t raw_len = 0;
+	unsigned char buf[0xff];
+	size_t len;
+
+	res = KSI_PublicationsFile_fromFile(ctx, getFullResourcePath(TEST_PUBLICATIONS_FILE), &pubFile);
+	CuAssert(tc, "Unable to read publications file", res == KSI_OK && pubFile != NULL);
+
+	res = KSI_PublicationsFile_getCertificates(pubFile, &certList);
+	CuAssert(tc, "Unable to get certificate list", res == KSI_OK && KSI_CertificateRecordList_length(certList) > 0);
+	len = KSI_CertificateRecordList_length(certList);
+
+	/* Take the first record out of the list and give it a new id. */
+	res = KSI_CertificateRecordList_remove(certList, 0, &certRec);
+	CuAssert(tc, "Unable to remove certificate record.", res == KSI_OK && certRec != NULL);
+
+	res = KSI_CertificateRecord_getCertId(certRec, &oldId);
+	CuAssert(tc, "Unable to get certificate id.", res == KSI_OK && oldId != NULL);
+
+	res = KSI_CertificateRecord_getCert(certRec, &recCert);
+	CuAssert(tc, "Unable to get certificate.", res == KSI_OK && recCert != NULL);
+
+	res = KSI_OctetString_extract(oldId, &raw, &raw_len);
+	CuAssert(tc, "Unable to extract certificate id.", res == KSI_OK && raw_len > 0 && raw_len <= sizeof(buf));
+
+	memcpy(buf, raw, raw_len);
+	buf[0] ^= 0xff;
+
+	res = KSI_OctetString_new(ctx, buf, raw_len, &newId);
+	CuAssert(tc, "Creating an octetstring failed", res == KSI_OK && newId != NULL);
+
+	res = KSI_CertificateRecord_setCertId(certRec, newId);
+	CuAssert(tc, "Unable to set certificate id.", res == KSI_OK);
+
+	/* Put it back; the list keeps its length. */
+	res = KSI_CertificateRecordList_append(certList, certRec);
+	CuAssert(tc, "Unable to append certificate record.", res == KSI_OK && KSI_CertificateRecordList_length(certList) == len);
+
+	res = KSI_PublicationsFile_getPKICertificateById(pubFile, oldId, &cert);
+	CuAssert(tc, "Certificate must not be found by the old id.", res == KSI_OK && cert == NULL);
+
+	res = KSI_PublicationsFile_getPKICertificateById(pubFile, newId, &cert);
+	CuAssert(tc, "Certificate not found by the new id.", res == KSI_OK && cert == recCert);
+
+	KSI_OctetString_free(oldId);
+	KSI_PublicationsFile_free(pubFile);
+}
+
 static void testLoadPublicationsFileContainsInvalidSignatureAndUnknownElement(CuTest *tc) {
 	int res;
 	KSI_PublicationsFile *pubFile = NULL;
@@ -286,6 +407,498 @@ static void testReceivePublicationsFileInvalidPki(CuTest *tc) {
 	KSI_CTX_free(ctx);
 }
 
+static void testReceivePublicationsFileTtl(CuTest *tc) {
+	int res;
+	KSI_PublicationsFile *pubFile = NULL;
+	KSI_PublicationsFile *first = NULL;
+	KSI_PublicationsFile *refreshed = NULL;
+	KSI_PKITruststore *pki = NULL;
+	KSI_CertConstraint arr[] = {
+			{KSI_CERT_EMAIL, "publications@guardtime.com"},
+			{NULL, NULL}
+	};
+	KSI_CTX *ctx = NULL;
+	KSI_CTX *worker = NULL;
+	time_t aged;
+
+	res = KSITest_CTX_clone(&ctx);
+	CuAssert(tc, "Unable to create new context.", res == KSI_OK && ctx != NULL);
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_CTX_setPublicationUrl(ctx, getFullResourcePathUri(TEST_PUBLICATIONS_FILE));
+	CuAssert(tc, "Unable to set pubfile URI.", res == KSI_OK);
+
+	res = KSI_PKITruststore_new(ctx, 0, &pki);
+	CuAssert(tc, "Unable to get PKI truststore from context.", res == KSI_OK && pki != NULL);
+
+	res = KSI_CTX_setPKITruststore(ctx, pki);
+	CuAssert(tc, "Unable to set new pki truststrore for ksi context.", res == KSI_OK);
+
+	res = KSI_PKITruststore_addLookupFile(pki, getFullResourcePath("resource/crt/mock.crt"));
+	CuAssert(tc, "Unable to read certificate", res == KSI_OK);
+
+	res = KSI_CTX_setDefaultPubFileCertConstraints(ctx, arr);
+	CuAssert(tc, "Unable to set OID 2.5.4.10", res == KSI_OK);
+
+	res = KSI_CTX_setPublicationsFileTTL(ctx, 3600);
+	CuAssert(tc, "Unable to set publications file TTL.", res == KSI_OK);
+
+	res = KSI_CTX_refreshPublicationsFile(ctx, NULL);
+	CuAssert(tc, "Nothing to refresh before the file is received.", res == KSI_OK && ctx->publicationsFile == NULL);
+
+	res = KSI_receivePublicationsFile(ctx, &first);
+	CuAssert(tc, "Unable to receive publications file.", res == KSI_OK && first != NULL);
+
+	/* Change the source to a file that does not verify. */
+	res = KSI_CTX_setPublicationUrl(ctx, getFullResourcePathUri(TEST_PUBLICATIONS_FILE_INVALID_PKI));
+	CuAssert(tc, "Unable to set pubfile URI.", res == KSI_OK);
+
+	res = KSI_CTX_refreshPublicationsFile(ctx, NULL);
+	CuAssert(tc, "The file should not be refreshed before it expires.", res == KSI_OK && ctx->publicationsFile == first);
+
+	/* Pretend the file was received two hours ago. */
+	aged = ctx->publicationsFileReceived - 7200;
+	ctx->publicationsFileReceived = aged;
+
+	res = KSI_receivePublicationsFile(ctx, &pubFile);
+	CuAssert(tc, "Receiving an expired file may not download it again.", res == KSI_OK && pubFile == first);
+	KSI_PublicationsFile_free(pubFile);
+	pubFile = NULL;
+
+	res = KSI_CTX_refreshPublicationsFile(ctx, NULL);
+	CuAssert(tc, "Refreshing with a file that does not verify must fail.", res != KSI_OK);
+	CuAssert(tc, "A file that fails verification must not replace the current one.", ctx->publicationsFile == first && ctx->publicationsFileReceived == aged);
+
+	/* Change the source back to a file that verifies. */
+	res = KSI_CTX_setPublicationUrl(ctx, getFullResourcePathUri(TEST_PUBLICATIONS_FILE));
+	CuAssert(tc, "Unable to set pubfile URI.", res == KSI_OK);
+
+	res = KSI_CTX_refreshPublicationsFile(ctx, NULL);
+	CuAssert(tc, "Unable to refresh publications file.", res == KSI_OK);
+	CuAssert(tc, "A file that verifies should replace the current one.", ctx->publicationsFile != NULL && ctx->publicationsFile != first);
+	CuAssert(tc, "The refreshed file should expire after the TTL.", ctx->publicationsFileReceived > aged + 3600);
+
+	res = KSI_receivePublicationsFile(ctx, &refreshed);
+	CuAssert(tc, "The refreshed file should be returned.", res == KSI_OK && refreshed == ctx->publicationsFile);
+
+	res = KSI_verifyPublicationsFile(ctx, refreshed);
+	CuAssert(tc, "Refreshed publications file should verify.", res == KSI_OK);
+
+	/* A worker context downloads the file and hands it over, the context swaps it in when receiving. */
+	res = KSITest_CTX_clone(&worker);
+	CuAssert(tc, "Unable to create new context.", res == KSI_OK && worker != NULL);
+
+	res = KSITest_setDefaultPubfileAndVerInfo(worker);
+	CuAssert(tc, "Unable to configure the worker context.", res == KSI_OK);
+
+	res = KSI_CTX_setPublicationUrl(worker, getFullResourcePathUri(TEST_PUBLICATIONS_FILE));
+	CuAssert(tc, "Unable to set pubfile URI.", res == KSI_OK);
+
+	res = KSI_CTX_setPublicationsFileTTL(worker, 3600);
+	CuAssert(tc, "Unable to set publications file TTL.", res == KSI_OK);
+
+	ctx->publicationsFileReceived = aged;
+
+	res = KSI_CTX_refreshPublicationsFile(ctx, worker);
+	CuAssert(tc, "Unable to refresh publications file with a worker context.", res == KSI_OK);
+	CuAssert(tc, "The worker may not replace the file of the context.", ctx->publicationsFile == refreshed && ctx->publicationsFilePending != NULL);
+
+	res = KSI_receivePublicationsFile(ctx, &pubFile);
+	CuAssert(tc, "The handed over file should be swapped in.", res == KSI_OK && pubFile != NULL && pubFile != refreshed && ctx->publicationsFile == pubFile);
+	CuAssert(tc, "The handed over file should be used once.", ctx->publicationsFilePending == NULL && ctx->publicationsFileReceived > aged + 3600);
+
+	res = KSI_verifyPublicationsFile(ctx, pubFile);
+	CuAssert(tc, "Handed over publications file should verify.", res == KSI_OK);
+	KSI_PublicationsFile_free(pubFile);
+	pubFile = NULL;
+
+	/* A file set by the user is never refreshed. */
+	res = KSI_CTX_setPublicationsFile(ctx, KSI_PublicationsFile_ref(first));
+	CuAssert(tc, "Unable to set publications file.", res == KSI_OK);
+	CuAssert(tc, "User provided file should not expire.", ctx->publicationsFileReceived == 0);
+
+	res = KSI_CTX_refreshPublicationsFile(ctx, worker);
+	CuAssert(tc, "User provided file should not be refreshed.", res == KSI_OK && ctx->publicationsFile == first && ctx->publicationsFilePending == NULL);
+
+	KSI_PublicationsFile_free(refreshed);
+	KSI_PublicationsFile_free(first);
+	KSI_CTX_free(worker);
+	KSI_CTX_free(ctx);
+}
+
+/* Builds the name of a publications file cache file: the first 16 bytes of the SHA-256 of the URL. */
+static int getPublicationsFileCachePath(const char *dir, const char *url, const char *ext, char *buf, size_t buf_len) {
+	KSI_DataHash *hsh = NULL;
+	const unsigned char *digest = NULL;
+	size_t digest_len = 0;
+	char key[33];
+	size_t i;
+	int res = -1;
+
+	if (KSI_DataHash_create(ctx, url, strlen(url), KSI_HASHALG_SHA2_256, &hsh) != KSI_OK) goto cleanup;
+	if (KSI_DataHash_extract(hsh, NULL, &digest, &digest_len) != KSI_OK || digest_len < 16) goto cleanup;
+
+	for (i = 0; i < 16; i++) {
+		KSI_snprintf(key + 2 * i, 3, "%02x", digest[i]);
+	}
+
+	KSI_snprintf(buf, buf_len, "%s/ksi-publications-%s.%s", dir, key, ext);
+	res = 0;
+
+cleanup:
+
+	KSI_DataHash_free(hsh);
+
+	return res;
+}
+
+static int writePublicationsFileCache(const char *dir, const char *url, time_t fetched) {
+	char path[1024];
+	static unsigned char buf[0x1ffff];
+	size_t len;
+	FILE *in = NULL;
+	FILE *out = NULL;
+	KSI_DataHash *hsh = NULL;
+	const unsigned char *digest = NULL;
+	size_t digest_len = 0;
+	char hex[65];
+	size_t i;
+	int res = -1;
+
+	in = fopen(getFullResourcePath(TEST_PUBLICATIONS_FILE), "rb");
+	if (in == NULL) goto cleanup;
+	len = fread(buf, 1, sizeof(buf), in);
+
+	if (KSI_DataHash_create(ctx, buf, len, KSI_HASHALG_SHA2_256, &hsh) != KSI_OK) goto cleanup;
+	if (KSI_DataHash_extract(hsh, NULL, &digest, &digest_len) != KSI_OK || digest_len != 32) goto cleanup;
+	for (i = 0; i < digest_len; i++) {
+		KSI_snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+	}
+
+	if (getPublicationsFileCachePath(dir, url, "bin", path, sizeof(path)) != 0) goto cleanup;
+	out = fopen(path, "wb");
+	if (out == NULL || fwrite(buf, 1, len, out) != len) goto cleanup;
+	fclose(out);
+
+	if (getPublicationsFileCachePath(dir, url, "meta", path, sizeof(path)) != 0) goto cleanup;
+	out = fopen(path, "w");
+	if (out == NULL || fprintf(out, "%ld\n\"test\"\n\n%s\n", (long)fetched, hex) < 0) goto cleanup;
+
+	res = 0;
+
+cleanup:
+
+	if (in != NULL) fclose(in);
+	if (out != NULL) fclose(out);
+	KSI_DataHash_free(hsh);
+
+	return res;
+}
+
+static void removePublicationsFileCache(const char *dir, const char *url) {
+	char path[1024];
+
+	if (getPublicationsFileCachePath(dir, url, "bin", path, sizeof(path)) == 0) remove(path);
+	if (getPublicationsFileCachePath(dir, url, "meta", path, sizeof(path)) == 0) remove(path);
+}
+
+static int newCacheTestCtx(const char *url, const char *dir, KSI_CTX **out) {
+	int res;
+	KSI_CTX *tmp = NULL;
+
+	res = KSITest_CTX_clone(&tmp);
+	if (res != KSI_OK) goto cleanup;
+
+	res = KSITest_setDefaultPubfileAndVerInfo(tmp);
+	if (res != KSI_OK) goto cleanup;
+
+	/* Make sure the file is not downloaded. */
+	res = KSI_CTX_setPublicationUrl(tmp, url);
+	if (res != KSI_OK) goto cleanup;
+
+	res = KSI_CTX_setPublicationsFileCacheDir(tmp, dir);
+	if (res != KSI_OK) goto cleanup;
+
+	res = KSI_CTX_setPublicationsFileTTL(tmp, 3600);
+	if (res != KSI_OK) goto cleanup;
+
+	*out = tmp;
+	tmp = NULL;
+
+cleanup:
+
+	KSI_CTX_free(tmp);
+
+	return res;
+}
+
+static void testReceivePublicationsFileFromCache(CuTest *tc) {
+	int res;
+	KSI_PublicationsFile *pubFile = NULL;
+	KSI_CTX *ctx = NULL;
+	const char *dir = ".";
+	char url[1024];
+	char otherUrl[1024];
+	KSI_CertConstraint otherConstraints[] = {
+			{KSI_CERT_EMAIL, "someone.else@guardtime.com"},
+			{NULL, NULL}
+	};
+	time_t now = time(NULL);
+
+	KSI_snprintf(url, sizeof(url), "%s", getFullResourcePathUri("resource/tlv/no-such-publications-file.tlv"));
+	KSI_snprintf(otherUrl, sizeof(otherUrl), "%s", getFullResourcePathUri("resource/tlv/no-such-publications-file-2.tlv"));
+
+	res = newCacheTestCtx(url, dir, &ctx);
+	CuAssert(tc, "Unable to create new context.", res == KSI_OK && ctx != NULL);
+
+	res = writePublicationsFileCache(dir, url, now - 60);
+	CuAssert(tc, "Unable to write publications file cache.", res == 0);
+
+	res = KSI_receivePublicationsFile(ctx, &pubFile);
+	CuAssert(tc, "Unable to load publications file from cache.", res == KSI_OK && pubFile != NULL);
+	CuAssert(tc, "The cached file should expire with the cached copy.", ctx->publicationsFileReceived == now - 60);
+
+	res = KSI_verifyPublicationsFile(ctx, pubFile);
+	CuAssert(tc, "Cached publications file should verify.", res == KSI_OK);
+
+	KSI_PublicationsFile_free(pubFile);
+	pubFile = NULL;
+	KSI_CTX_free(ctx);
+	ctx = NULL;
+
+	/* The copy of one URL is not used for another. */
+	res = newCacheTestCtx(otherUrl, dir, &ctx);
+	CuAssert(tc, "Unable to create new context.", res == KSI_OK && ctx != NULL);
+
+	res = KSI_receivePublicationsFile(ctx, &pubFile);
+	CuAssert(tc, "Cache of another URL should not be used.", res != KSI_OK && pubFile == NULL);
+
+	KSI_CTX_free(ctx);
+	ctx = NULL;
+
+	/* A copy that does not verify with the settings of the context is not used. */
+	res = newCacheTestCtx(url, dir, &ctx);
+	CuAssert(tc, "Unable to create new context.", res == KSI_OK && ctx != NULL);
+
+	res = KSI_CTX_setDefaultPubFileCertConstraints(ctx, otherConstraints);
+	CuAssert(tc, "Unable to set publications file constraints.", res == KSI_OK);
+
+	res = KSI_receivePublicationsFile(ctx, &pubFile);
+	CuAssert(tc, "Cache that does not verify should not be used.", res != KSI_OK && pubFile == NULL);
+
+	KSI_CTX_free(ctx);
+	ctx = NULL;
+
+	/* An expired copy must be revalidated. */
+	res = newCacheTestCtx(url, dir, &ctx);
+	CuAssert(tc, "Unable to create new context.", res == KSI_OK && ctx != NULL);
+
+	res = writePublicationsFileCache(dir, url, now - 7200);
+	CuAssert(tc, "Unable to write publications file cache.", res == 0);
+
+	res = KSI_receivePublicationsFile(ctx, &pubFile);
+	CuAssert(tc, "Expired cache should not be used without the server.", res != KSI_OK && pubFile == NULL);
+
+	KSI_CTX_free(ctx);
+
+	removePublicationsFileCache(dir, url);
+}
+
+static int (*fileReadResponse)(KSI_RequestHandle *) = NULL;
+static int (*fileSendPublicationRequest)(KSI_NetworkClient *, KSI_RequestHandle **) = NULL;
+static size_t notModifiedCount;
+static size_t unconditionalCount;
+
+/* Answers conditional requests with 304, as a server would for an unchanged file. */
+static int notModifiedReadResponse(KSI_RequestHandle *handle) {
+	if (handle->ifNoneMatch != NULL || handle->ifModifiedSince != NULL) {
+		notModifiedCount++;
+		handle->err.code = 304;
+		handle->completed = true;
+		return KSI_OK;
+	}
+
+	unconditionalCount++;
+	return fileReadResponse(handle);
+}
+
+static int notModifiedSendPublicationRequest(KSI_NetworkClient *client, KSI_RequestHandle **handle) {
+	int res = fileSendPublicationRequest(client, handle);
+
+	if (res == KSI_OK) {
+		fileReadResponse = (*handle)->readResponse;
+		(*handle)->readResponse = notModifiedReadResponse;
+	}
+
+	return res;
+}
+
+static void testReceivePublicationsFileNotModifiedDamagedCache(CuTest *tc) {
+	int res;
+	KSI_PublicationsFile *pubFile = NULL;
+	KSI_CTX *ctx = NULL;
+	const char *dir = ".";
+	char url[1024];
+	char path[1024];
+	FILE *f = NULL;
+	long len = 0;
+	time_t now = time(NULL);
+
+	KSI_snprintf(url, sizeof(url), "%s", getFullResourcePathUri(TEST_PUBLICATIONS_FILE));
+
+	res = newCacheTestCtx(url, dir, &ctx);
+	CuAssert(tc, "Unable to create new context.", res == KSI_OK && ctx != NULL);
+
+	fileSendPublicationRequest = ctx->netProvider->sendPublicationRequest;
+	ctx->netProvider->sendPublicationRequest = notModifiedSendPublicationRequest;
+	notModifiedCount = 0;
+	unconditionalCount = 0;
+
+	/* An expired copy whose data file has been truncated. */
+	res = writePublicationsFileCache(dir, url, now - 7200);
+	CuAssert(tc, "Unable to write publications file cache.", res == 0);
+
+	res = getPublicationsFileCachePath(dir, url, "bin", path, sizeof(path));
+	CuAssert(tc, "Unable to get cache path.", res == 0);
+	f = fopen(path, "wb");
+	CuAssert(tc, "Unable to truncate the cached file.", f != NULL && fwrite("\x07\x01", 1, 2, f) == 2);
+	fclose(f);
+
+	res = KSI_receivePublicationsFile(ctx, &pubFile);
+	CuAssert(tc, "Unusable copy should be downloaded again.", res == KSI_OK && pubFile != NULL);
+	CuAssert(tc, "Conditional request should be followed by an unconditional one.", notModifiedCount == 1 && unconditionalCount == 1);
+
+	res = KSI_verifyPublicationsFile(ctx, pubFile);
+	CuAssert(tc, "Downloaded publications file should verify.", res == KSI_OK);
+
+	/* The cache is repaired. */
+	f = fopen(path, "rb");
+	CuAssert(tc, "Unable to open the cached file.", f != NULL);
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	fclose(f);
+	CuAssert(tc, "Cached file should be replaced.", len > 2);
+
+	KSI_PublicationsFile_free(pubFile);
+	KSI_CTX_free(ctx);
+
+	removePublicationsFileCache(dir, url);
+}
+
+static void assertSamePublication(CuTest *tc, const char *msg, KSI_PublicationRecord *expected, KSI_PublicationRecord *actual) {
+	char *exp = NULL;
+	char *act = NULL;
+
+	CuAssert(tc, msg, (expected == NULL) == (actual == NULL));
+	if (expected == NULL) return;
+
+	CuAssert(tc, "Unable to encode publication.", KSI_PublicationRecord_toBase32(expected, &exp) == KSI_OK);
+	CuAssert(tc, "Unable to encode publication.", KSI_PublicationRecord_toBase32(actual, &act) == KSI_OK);
+	CuAssert(tc, msg, !strcmp(exp, act));
+
+	KSI_free(exp);
+	KSI_free(act);
+}
+
+static void testMapPublicationsFile(CuTest *tc) {
+	int res;
+	KSI_PublicationsFile *loaded = NULL;
+	KSI_PublicationsFile *mapped = NULL;
+	KSI_LIST(KSI_PublicationRecord) *loadedList = NULL;
+	KSI_LIST(KSI_PublicationRecord) *mappedList = NULL;
+	KSI_PublicationRecord *rec = NULL;
+	KSI_Integer *pubTime = NULL;
+	char *loadedRaw = NULL;
+	char *mappedRaw = NULL;
+	size_t loadedRaw_len = 0;
+	size_t mappedRaw_len = 0;
+	size_t i;
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_PublicationsFile_fromFile(ctx, getFullResourcePath(TEST_PUBLICATIONS_FILE), &loaded);
+	CuAssert(tc, "Unable to read publications file.", res == KSI_OK && loaded != NULL);
+
+	res = KSI_PublicationsFile_mapFile(ctx, getFullResourcePath(TEST_PUBLICATIONS_FILE), &mapped);
+	CuAssert(tc, "Unable to map publications file.", res == KSI_OK && mapped != NULL);
+	CuAssert(tc, "Records should not be decoded when mapping.", mapped->publications == NULL && mapped->timeIndex_len > 0);
+
+	res = KSI_PublicationsFile_getPublications(loaded, &loadedList);
+	CuAssert(tc, "Unable to get publications.", res == KSI_OK && loadedList != NULL);
+
+	for (i = 0; i < KSI_PublicationRecordList_length(loadedList); i++) {
+		KSI_PublicationRecord *expected = NULL;
+		KSI_PublicationRecord *actual = NULL;
+
+		res = KSI_PublicationRecordList_elementAt(loadedList, i, &expected);
+		CuAssert(tc, "Unable to get publication.", res == KSI_OK && expected != NULL);
+
+		res = KSI_PublicationsFile_findPublication(mapped, expected, &actual);
+		CuAssert(tc, "Unable to find publication.", res == KSI_OK);
+		assertSamePublication(tc, "Mapped file should contain the same publication.", expected, actual);
+		KSI_PublicationRecord_free(actual);
+		actual = NULL;
+
+		res = KSI_PublicationsFile_getNearestPublication(mapped, expected->publishedData->time, &actual);
+		CuAssert(tc, "Unable to get nearest publication.", res == KSI_OK);
+		KSI_PublicationRecord_free(actual);
+	}
+
+	/* Between two publications. */
+	res = KSI_Integer_new(ctx, 1398902400 + 1, &pubTime);
+	CuAssert(tc, "Unable to create integer.", res == KSI_OK);
+
+	res = KSI_PublicationsFile_getNearestPublication(loaded, pubTime, &rec);
+	CuAssert(tc, "Unable to get nearest publication.", res == KSI_OK);
+	{
+		KSI_PublicationRecord *actual = NULL;
+		res = KSI_PublicationsFile_getNearestPublication(mapped, pubTime, &actual);
+		CuAssert(tc, "Unable to get nearest publication.", res == KSI_OK);
+		assertSamePublication(tc, "Nearest publications differ.", rec, actual);
+		KSI_PublicationRecord_free(actual);
+	}
+	KSI_PublicationRecord_free(rec);
+	rec = NULL;
+
+	res = KSI_PublicationsFile_getLatestPublication(loaded, NULL, &rec);
+	CuAssert(tc, "Unable to get latest publication.", res == KSI_OK && rec != NULL);
+	{
+		KSI_PublicationRecord *actual = NULL;
+		res = KSI_PublicationsFile_getLatestPublication(mapped, NULL, &actual);
+		CuAssert(tc, "Unable to get latest publication.", res == KSI_OK);
+		assertSamePublication(tc, "Latest publications differ.", rec, actual);
+	}
+	rec = NULL;
+
+	/* Decoding all records must preserve the file order. */
+	res = KSI_PublicationsFile_getPublications(mapped, &mappedList);
+	CuAssert(tc, "Unable to get publications.", res == KSI_OK && mappedList != NULL);
+	CuAssert(tc, "Publication count mismatch.", KSI_PublicationRecordList_length(mappedList) == KSI_PublicationRecordList_length(loadedList));
+
+	for (i = 0; i < KSI_PublicationRecordList_length(loadedList); i++) {
+		KSI_PublicationRecord *expected = NULL;
+		KSI_PublicationRecord *actual = NULL;
+
+		KSI_PublicationRecordList_elementAt(loadedList, i, &expected);
+		KSI_PublicationRecordList_elementAt(mappedList, i, &actual);
+		assertSamePublication(tc, "Publication order mismatch.", expected, actual);
+	}
+
+	res = KSI_PublicationsFile_serialize(ctx, loaded, &loadedRaw, &loadedRaw_len);
+	CuAssert(tc, "Unable to serialize publications file.", res == KSI_OK);
+
+	res = KSI_PublicationsFile_serialize(ctx, mapped, &mappedRaw, &mappedRaw_len);
+	CuAssert(tc, "Unable to serialize mapped publications file.", res == KSI_OK);
+	CuAssert(tc, "Serialized files differ.", loadedRaw_len == mappedRaw_len && !memcmp(loadedRaw, mappedRaw, loadedRaw_len));
+
+	KSI_free(loadedRaw);
+	KSI_free(mappedRaw);
+	KSI_Integer_free(pubTime);
+	KSI_PublicationsFile_free(loaded);
+	KSI_PublicationsFile_free(mapped);
+}
+
 static void testVerifyPublicationsFileWithOrganization(CuTest *tc) {
 	int res;
 	KSI_PublicationsFile *pubFile = NULL;
@@ -537,6 +1150,63 @@ static void testPublicationStringEncodingAndDecoding(CuTest *tc) {
 	KSI_free(out);
 }
 
+static void testPublicationStringCache(CuTest *tc) {
+	static const char publication[] = "AAAAAA-CTJR3I-AANBWU-RY76YF-7TH2M5-KGEZVA-WLLRGD-3GKYBG-AM5WWV-4MCLSP-XPRDDI-UFMHBA";
+	static const char tampered[] = "AAAAAA-CTJR3I-AANBWU-RY76YF-7TH2M5-KGEZVA-WLLRGD-3GKYBG-AM5WWV-4MCLSP-XPRDDI-UFMHBB";
+	int res;
+	KSI_PublicationData *first = NULL;
+	KSI_PublicationData *second = NULL;
+	KSI_PublicationData *invalid = NULL;
+	KSI_Integer *otherTime = NULL;
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_PublicationData_fromBase32(ctx, publication, &first);
+	CuAssert(tc, "Failed decoding publication string.", res == KSI_OK && first != NULL);
+
+	res = KSI_PublicationData_fromBase32(ctx, publication, &second);
+	CuAssert(tc, "Failed decoding cached publication string.", res == KSI_OK && second != NULL && second != first);
+	CuAssert(tc, "Cached publication imprint mismatch.", KSI_DataHash_equals(first->imprint, second->imprint));
+	CuAssert(tc, "Cached publication time mismatch.", KSI_Integer_equals(first->time, second->time));
+
+	/* Changing one of the objects must not change the others. */
+	res = KSI_Integer_new(ctx, 1, &otherTime);
+	CuAssert(tc, "Unable to create integer.", res == KSI_OK);
+	KSI_Integer_free(first->time);
+	res = KSI_PublicationData_setTime(first, otherTime);
+	CuAssert(tc, "Unable to set publication time.", res == KSI_OK);
+	CuAssert(tc, "Cached publication time changed.", KSI_Integer_equalsUInt(second->time, 1397520000));
+
+	res = KSI_PublicationData_fromBase32(ctx, tampered, &invalid);
+	CuAssert(tc, "Publication string with invalid CRC should fail.", res == KSI_INVALID_FORMAT && invalid == NULL);
+
+	KSI_PublicationData_free(first);
+	KSI_PublicationData_free(second);
+}
+
+static void testBase32DecodeBatch(CuTest *tc) {
+	const char *input[] = {"MZXW6===", "mzxw6ytb-oi======", "", "MZXW6YTBOI"};
+	const char *invalid[] = {"MZXW6===", "MZXW0==="};
+	unsigned char *data[4];
+	size_t data_len[4];
+	int res;
+
+	res = KSI_base32DecodeBatch(input, 4, data, data_len);
+	CuAssert(tc, "Unable to decode base32 strings.", res == KSI_OK);
+	CuAssert(tc, "Invalid decoded value.", data_len[0] == 3 && !memcmp(data[0], "foo", 3));
+	CuAssert(tc, "Invalid decoded lower case value.", data_len[1] == 6 && !memcmp(data[1], "foobar", 6));
+	CuAssert(tc, "Invalid decoded empty value.", data_len[2] == 0);
+	CuAssert(tc, "Invalid decoded unpadded value.", data_len[3] == 6 && !memcmp(data[3], "foobar", 6));
+
+	KSI_free(data[0]);
+	KSI_free(data[1]);
+	KSI_free(data[2]);
+	KSI_free(data[3]);
+
+	res = KSI_base32DecodeBatch(invalid, 2, data, data_len);
+	CuAssert(tc, "Invalid base32 digit should fail.", res == KSI_INVALID_FORMAT && data[0] == NULL && data[1] == NULL);
+}
+
 static void testFindPublicationByPubStr(CuTest *tc) {
 	static const char publication[] = "AAAAAA-CTJR3I-AANBWU-RY76YF-7TH2M5-KGEZVA-WLLRGD-3GKYBG-AM5WWV-4MCLSP-XPRDDI-UFMHBA";
 	int res;
@@ -945,16 +1615,140 @@ static void testGetLatestPublicationOfFuture(CuTest *tc) {
 	KSI_Integer_free(tm);
 }
 
+static void testPublicationLookupOnReorderedList(CuTest *tc) {
+	int res;
+	KSI_PublicationsFile *pubFile = NULL;
+	KSI_LIST(KSI_PublicationRecord) *orig = NULL;
+	KSI_LIST(KSI_PublicationRecord) *reversed = NULL;
+	KSI_PublicationRecord *last = NULL;
+	size_t i;
+
+	res = KSI_PublicationsFile_fromFile(ctx, getFullResourcePath(TEST_PUBLICATIONS_FILE), &pubFile);
+	CuAssert(tc, "Unable to read publications file", res == KSI_OK && pubFile != NULL);
+
+	res = KSI_PublicationsFile_getPublications(pubFile, &orig);
+	CuAssert(tc, "Unable to get publications.", res == KSI_OK && KSI_PublicationRecordList_length(orig) > 1);
+
+	res = KSI_PublicationRecordList_new(&reversed);
+	CuAssert(tc, "Unable to create publications list.", res == KSI_OK && reversed != NULL);
+
+	for (i = KSI_PublicationRecordList_length(orig); i > 0; i--) {
+		KSI_PublicationRecord *pr = NULL;
+
+		res = KSI_PublicationRecordList_elementAt(orig, i - 1, &pr);
+		CuAssert(tc, "Unable to get publication record.", res == KSI_OK && pr != NULL);
+
+		res = KSI_PublicationRecordList_append(reversed, KSI_PublicationRecord_ref(pr));
+		CuAssert(tc, "Unable to append publication record.", res == KSI_OK);
+	}
+
+	res = KSI_PublicationsFile_setPublications(pubFile, reversed);
+	CuAssert(tc, "Unable to set publications.", res == KSI_OK);
+
+	/* The file lists the publications in ascending order. */
+	res = KSI_PublicationRecordList_elementAt(orig, KSI_PublicationRecordList_length(orig) - 1, &last);
+	CuAssert(tc, "Unable to get publication record.", res == KSI_OK && last != NULL);
+
+	for (i = 0; i < KSI_PublicationRecordList_length(orig); i++) {
+		KSI_PublicationRecord *pr = NULL;
+		KSI_PublicationRecord *found = NULL;
+		KSI_Integer *tm = NULL;
+		KSI_Integer *before = NULL;
+
+		res = KSI_PublicationRecordList_elementAt(orig, i, &pr);
+		CuAssert(tc, "Unable to get publication record.", res == KSI_OK && pr != NULL);
+
+		tm = pr->publishedData->time;
+
+		res = KSI_PublicationsFile_getPublicationDataByTime(pubFile, tm, &found);
+		CuAssert(tc, "Publication not found by time.", res == KSI_OK && found != NULL && KSI_Integer_equals(found->publishedData->time, tm));
+
+		res = KSI_Integer_new(ctx, KSI_Integer_getUInt64(tm) - 1, &before);
+		CuAssert(tc, "Unable to create integer", res == KSI_OK && before != NULL);
+
+		res = KSI_PublicationsFile_getNearestPublication(pubFile, before, &found);
+		CuAssert(tc, "Nearest publication not found.", res == KSI_OK && found != NULL);
+		CuAssert(tc, "Unexpected nearest publication.", KSI_Integer_compare(found->publishedData->time, tm) <= 0 && KSI_Integer_compare(found->publishedData->time, before) > 0);
+		KSI_PublicationRecord_free(found);
+		found = NULL;
+
+		res = KSI_PublicationsFile_getLatestPublication(pubFile, before, &found);
+		CuAssert(tc, "Unexpected latest publication.", res == KSI_OK && found == last);
+
+		KSI_Integer_free(before);
+	}
+
+	KSI_PublicationRecordList_free(orig);
+	KSI_PublicationsFile_free(pubFile);
+}
+
+static void testPublicationLookupAfterInPlaceEdit(CuTest *tc) {
+	int res;
+	KSI_PublicationsFile *pubFile = NULL;
+	KSI_LIST(KSI_PublicationRecord) *list = NULL;
+	KSI_PublicationRecord *first = NULL;
+	KSI_PublicationRecord *last = NULL;
+	KSI_PublicationRecord *noTime = NULL;
+	KSI_PublicationRecord *found = NULL;
+	KSI_Integer *firstTime = NULL;
+	size_t len;
+
+	res = KSI_PublicationsFile_fromFile(ctx, getFullResourcePath(TEST_PUBLICATIONS_FILE), &pubFile);
+	CuAssert(tc, "Unable to read publications file", res == KSI_OK && pubFile != NULL);
+
+	res = KSI_PublicationsFile_getPublications(pubFile, &list);
+	CuAssert(tc, "Unable to get publications.", res == KSI_OK && KSI_PublicationRecordList_length(list) > 1);
+	len = KSI_PublicationRecordList_length(list);
+
+	res = KSI_PublicationRecordList_elementAt(list, 0, &first);
+	CuAssert(tc, "Unable to get publication record.", res == KSI_OK && first != NULL);
+
+	res = KSI_PublicationRecordList_elementAt(list, len - 1, &last);
+	CuAssert(tc, "Unable to get publication record.", res == KSI_OK && last != NULL);
+
+	res = KSI_Integer_new(ctx, KSI_Integer_getUInt64(first->publishedData->time), &firstTime);
+	CuAssert(tc, "Unable to create integer", res == KSI_OK && firstTime != NULL);
+
+	/* Replace the first record in place; the list keeps its length and the old record is freed. */
+	res = KSI_PublicationRecordList_replaceAt(list, 0, KSI_PublicationRecord_ref(last));
+	CuAssert(tc, "Unable to replace publication record.", res == KSI_OK && KSI_PublicationRecordList_length(list) == len);
+
+	res = KSI_PublicationsFile_getPublicationDataByTime(pubFile, firstTime, &found);
+	CuAssert(tc, "Replaced publication must not be found.", res == KSI_OK && found == NULL);
+
+	res = KSI_PublicationsFile_getPublicationDataByTime(pubFile, last->publishedData->time, &found);
+	CuAssert(tc, "Publication not found by time.", res == KSI_OK && found == last);
+
+	/* A record without a publication time is ignored by the lookups. */
+	res = KSI_PublicationRecord_new(ctx, &noTime);
+	CuAssert(tc, "Unable to create publication record.", res == KSI_OK && noTime != NULL);
+
+	res = KSI_PublicationRecordList_append(list, noTime);
+	CuAssert(tc, "Unable to append publication record.", res == KSI_OK);
+
+	res = KSI_PublicationsFile_getPublicationDataByTime(pubFile, last->publishedData->time, &found);
+	CuAssert(tc, "Publication not found by time.", res == KSI_OK && found == last);
+
+	res = KSI_PublicationsFile_getLatestPublication(pubFile, firstTime, &found);
+	CuAssert(tc, "Unexpected latest publication.", res == KSI_OK && found == last);
+
+	KSI_Integer_free(firstTime);
+	KSI_PublicationsFile_free(pubFile);
+}
 
 CuSuite* KSITest_Publicationsfile_getSuite(void) {
 	CuSuite* suite = CuSuiteNew();
 
 	SUITE_ADD_TEST(suite, testLoadPublicationsFile);
 	SUITE_ADD_TEST(suite, testLoadPublicationsFileWithNoCerts);
+	SUITE_ADD_TEST(suite, testGetPKICertificateById);
+	SUITE_ADD_TEST(suite, testGetPKICertificateByIdAfterInPlaceEdit);
 	SUITE_ADD_TEST(suite, testLoadPublicationsFileContainsInvalidSignatureAndUnknownElement);
 	SUITE_ADD_TEST(suite, testVerifyPublicationsFile);
 	SUITE_ADD_TEST(suite, testVerifyPublicationsFileContainsIntermediateCerts);
 	SUITE_ADD_TEST(suite, testPublicationStringEncodingAndDecoding);
+	SUITE_ADD_TEST(suite, testPublicationStringCache);
+	SUITE_ADD_TEST(suite, testBase32DecodeBatch);
 	SUITE_ADD_TEST(suite, testFindPublicationByPubStr);
 	SUITE_ADD_TEST(suite, testFindPublicationByTime);
 	SUITE_ADD_TEST(suite, testFindPublicationRef);
@@ -972,8 +1766,14 @@ CuSuite* KSITest_Publicationsfile_getSuite(void) {
 	SUITE_ADD_TEST(suite, testGetLatestPublicationOf0);
 	SUITE_ADD_TEST(suite, testGetLatestPublicationOfLast);
 	SUITE_ADD_TEST(suite, testGetLatestPublicationOfFuture);
+	SUITE_ADD_TEST(suite, testPublicationLookupOnReorderedList);
+	SUITE_ADD_TEST(suite, testPublicationLookupAfterInPlaceEdit);
 	SUITE_ADD_TEST(suite, testReceivePublicationsFileInvalidConstraints);
 	SUITE_ADD_TEST(suite, testReceivePublicationsFileInvalidPki);
+	SUITE_ADD_TEST(suite, testReceivePublicationsFileTtl);
+	SUITE_ADD_TEST(suite, testReceivePublicationsFileFromCache);
+	SUITE_ADD_TEST(suite, testReceivePublicationsFileNotModifiedDamagedCache);
+	SUITE_ADD_TEST(suite, testMapPublicationsFile);
 
 	return suite;
 }
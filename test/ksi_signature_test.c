@@ -20,6 +20,8 @@
 #include <string.h>
 #include "all_tests.h"
 #include <ksi/signature.h>
+#include <ksi/signature_container.h>
+#include <ksi/signature_store.h>
 #include "../src/ksi/ctx_impl.h"
 
 #include "../src/ksi/signature_impl.h"
@@ -968,6 +970,353 @@ static void testCreateHasher(CuTest *tc) {
 }
 
 
+static void testSignatureContainer(CuTest *tc) {
+#define TEST_SIGNATURE_FILE "resource/tlv/ok-sig-2014-04-30.1.ksig"
+#define TEST_EXT_SIGNATURE_FILE "resource/tlv/ok-sig-2014-04-30.1-extended.ksig"
+#define TEST_OTHER_SIGNATURE_FILE "resource/tlv/ok-sig-2014-06-2.ksig"
+	int res;
+	KSI_Signature *sigs[] = { NULL, NULL, NULL };
+	KSI_Signature *sig = NULL;
+	KSI_SignatureContainerBuilder *builder = NULL;
+	KSI_SignatureContainer *container = NULL;
+	KSI_DataHash *hsh = NULL;
+	KSI_DataHash *missing = NULL;
+	unsigned char *raw = NULL;
+	size_t raw_len = 0;
+	unsigned char *exp = NULL;
+	size_t exp_len = 0;
+	unsigned char *out = NULL;
+	size_t out_len = 0;
+	size_t plain_len = 0;
+	size_t *pos = NULL;
+	/* Record i of the container is sigs[order[i]]. */
+	static const size_t order[] = { 0, 1, 2, 0 };
+	size_t i;
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_Signature_fromFile(ctx, getFullResourcePath(TEST_SIGNATURE_FILE), &sigs[0]);
+	CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && sigs[0] != NULL);
+
+	res = KSI_Signature_fromFile(ctx, getFullResourcePath(TEST_EXT_SIGNATURE_FILE), &sigs[1]);
+	CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && sigs[1] != NULL);
+
+	res = KSI_Signature_fromFile(ctx, getFullResourcePath(TEST_OTHER_SIGNATURE_FILE), &sigs[2]);
+	CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && sigs[2] != NULL);
+
+	res = KSI_SignatureContainerBuilder_new(ctx, &builder);
+	CuAssert(tc, "Unable to create container builder.", res == KSI_OK && builder != NULL);
+
+	for (i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+		res = KSI_SignatureContainerBuilder_add(builder, sigs[order[i]]);
+		CuAssert(tc, "Unable to add signature to the container.", res == KSI_OK);
+
+		res = KSI_Signature_serialize(sigs[order[i]], &exp, &exp_len);
+		CuAssert(tc, "Unable to serialize signature.", res == KSI_OK);
+		plain_len += exp_len;
+		KSI_free(exp);
+		exp = NULL;
+	}
+
+	res = KSI_SignatureContainerBuilder_serialize(builder, &raw, &raw_len);
+	CuAssert(tc, "Unable to serialize the container.", res == KSI_OK && raw != NULL);
+
+	/* The repeated signature and the shared aggregation chains are stored once. */
+	CuAssert(tc, "Shared components not deduplicated.", raw_len < plain_len);
+
+	res = KSI_SignatureContainer_parse(ctx, raw, raw_len - 1, &container);
+	CuAssert(tc, "Truncated container may not be parsed.", res == KSI_INVALID_FORMAT && container == NULL);
+
+	res = KSI_SignatureContainer_parse(ctx, raw, raw_len, &container);
+	CuAssert(tc, "Unable to parse the container.", res == KSI_OK && container != NULL);
+	CuAssert(tc, "Unexpected record count.", KSI_SignatureContainer_getCount(container) == 4);
+
+	for (i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+		res = KSI_SignatureContainer_getSignature(container, i, &sig);
+		CuAssert(tc, "Unable to get signature from the container.", res == KSI_OK && sig != NULL);
+
+		res = KSI_Signature_serialize(sig, &out, &out_len);
+		CuAssert(tc, "Unable to serialize signature.", res == KSI_OK);
+
+		res = KSI_Signature_serialize(sigs[order[i]], &exp, &exp_len);
+		CuAssert(tc, "Unable to serialize signature.", res == KSI_OK);
+
+		CuAssert(tc, "Signature changed in the container.", out_len == exp_len && !memcmp(out, exp, exp_len));
+
+		KSI_free(out);
+		out = NULL;
+		KSI_free(exp);
+		exp = NULL;
+		KSI_Signature_free(sig);
+		sig = NULL;
+	}
+
+	res = KSI_SignatureContainer_getSignature(container, 4, &sig);
+	CuAssert(tc, "Record out of range may not be returned.", res == KSI_INVALID_ARGUMENT && sig == NULL);
+
+	/* All the test signatures sign the same document, the first record is found. */
+	res = KSI_Signature_getDocumentHash(sigs[2], &hsh);
+	CuAssert(tc, "Unable to get document hash.", res == KSI_OK && hsh != NULL);
+
+	res = KSI_SignatureContainer_indexOf(container, hsh, &pos);
+	CuAssert(tc, "Unable to find the record by document hash.", res == KSI_OK && pos != NULL && *pos == 0);
+	KSI_free(pos);
+	pos = NULL;
+
+	res = KSI_DataHash_create(ctx, "missing", 7, KSI_HASHALG_SHA2_256, &missing);
+	CuAssert(tc, "Unable to create data hash.", res == KSI_OK && missing != NULL);
+
+	res = KSI_SignatureContainer_indexOf(container, missing, &pos);
+	CuAssert(tc, "Unknown document hash may not be found.", res == KSI_OK && pos == NULL);
+
+	KSI_DataHash_free(missing);
+	KSI_SignatureContainer_free(container);
+	KSI_SignatureContainerBuilder_free(builder);
+	KSI_free(raw);
+	for (i = 0; i < sizeof(sigs) / sizeof(sigs[0]); i++) {
+		KSI_Signature_free(sigs[i]);
+	}
+#undef TEST_OTHER_SIGNATURE_FILE
+#undef TEST_EXT_SIGNATURE_FILE
+#undef TEST_SIGNATURE_FILE
+}
+
+static int writeTestFile(const char *fileName, const unsigned char *raw, size_t raw_len) {
+	FILE *f = NULL;
+	int ok;
+
+	f = fopen(fileName, "wb");
+	if (f == NULL) return 0;
+	ok = fwrite(raw, 1, raw_len, f) == raw_len;
+	if (fclose(f) != 0) ok = 0;
+
+	return ok;
+}
+
+static void testSignatureStore(CuTest *tc) {
+#define TEST_SIGNATURE_FILE "resource/tlv/ok-sig-2014-04-30.1.ksig"
+#define TEST_EXT_SIGNATURE_FILE "resource/tlv/ok-sig-2014-04-30.1-extended.ksig"
+#define TEST_STORE_FILE "signature_store_test.ksig"
+#define TEST_STORE_CONTAINER_FILE "signature_store_test.ksigc"
+	int res;
+	KSI_Signature *sigs[] = { NULL, NULL };
+	KSI_Signature *sig = NULL;
+	KSI_SignatureStore *store = NULL;
+	KSI_SignatureContainerBuilder *builder = NULL;
+	KSI_DataHash *hsh = NULL;
+	KSI_DataHash *missing = NULL;
+	unsigned char *raw = NULL;
+	size_t raw_len = 0;
+	unsigned char *exp = NULL;
+	size_t exp_len = 0;
+	unsigned char *out = NULL;
+	size_t out_len = 0;
+	unsigned char buf[0x4000];
+	size_t buf_len = 0;
+	size_t *pos = NULL;
+	/* Signature i of the files is sigs[order[i]]. */
+	static const size_t order[] = { 1, 0, 1 };
+	static const char *files[] = { TEST_STORE_FILE, TEST_STORE_CONTAINER_FILE };
+	size_t i;
+	size_t j;
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_Signature_fromFile(ctx, getFullResourcePath(TEST_SIGNATURE_FILE), &sigs[0]);
+	CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && sigs[0] != NULL);
+
+	res = KSI_Signature_fromFile(ctx, getFullResourcePath(TEST_EXT_SIGNATURE_FILE), &sigs[1]);
+	CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && sigs[1] != NULL);
+
+	res = KSI_SignatureContainerBuilder_new(ctx, &builder);
+	CuAssert(tc, "Unable to create container builder.", res == KSI_OK && builder != NULL);
+
+	for (i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+		res = KSI_Signature_serialize(sigs[order[i]], &raw, &raw_len);
+		CuAssert(tc, "Unable to serialize signature.", res == KSI_OK && buf_len + raw_len <= sizeof(buf));
+		memcpy(buf + buf_len, raw, raw_len);
+		buf_len += raw_len;
+		KSI_free(raw);
+		raw = NULL;
+
+		res = KSI_SignatureContainerBuilder_add(builder, sigs[order[i]]);
+		CuAssert(tc, "Unable to add signature to the container.", res == KSI_OK);
+	}
+
+	CuAssert(tc, "Unable to write the signature file.", writeTestFile(TEST_STORE_FILE, buf, buf_len));
+
+	res = KSI_SignatureContainerBuilder_serialize(builder, &raw, &raw_len);
+	CuAssert(tc, "Unable to serialize the container.", res == KSI_OK && raw != NULL);
+	CuAssert(tc, "Unable to write the container file.", writeTestFile(TEST_STORE_CONTAINER_FILE, raw, raw_len));
+	KSI_free(raw);
+	raw = NULL;
+
+	res = KSI_DataHash_create(ctx, "missing", 7, KSI_HASHALG_SHA2_256, &missing);
+	CuAssert(tc, "Unable to create data hash.", res == KSI_OK && missing != NULL);
+
+	for (j = 0; j < sizeof(files) / sizeof(files[0]); j++) {
+		res = KSI_SignatureStore_open(ctx, files[j], &store);
+		CuAssert(tc, "Unable to open the signature store.", res == KSI_OK && store != NULL);
+		CuAssert(tc, "Unexpected signature count.", KSI_SignatureStore_getCount(store) == 3);
+
+		for (i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+			res = KSI_SignatureStore_getSignature(store, i, &sig);
+			CuAssert(tc, "Unable to get signature from the store.", res == KSI_OK && sig != NULL);
+
+			res = KSI_Signature_serialize(sig, &out, &out_len);
+			CuAssert(tc, "Unable to serialize signature.", res == KSI_OK);
+
+			res = KSI_Signature_serialize(sigs[order[i]], &exp, &exp_len);
+			CuAssert(tc, "Unable to serialize signature.", res == KSI_OK);
+
+			CuAssert(tc, "Signature changed in the store.", out_len == exp_len && !memcmp(out, exp, exp_len));
+
+			KSI_free(out);
+			out = NULL;
+			KSI_free(exp);
+			exp = NULL;
+			KSI_Signature_free(sig);
+			sig = NULL;
+		}
+
+		res = KSI_SignatureStore_getSignature(store, 3, &sig);
+		CuAssert(tc, "Signature out of range may not be returned.", res == KSI_INVALID_ARGUMENT && sig == NULL);
+
+		/* The document hash is read from the encoded signature, the first match is returned. */
+		res = KSI_Signature_getDocumentHash(sigs[0], &hsh);
+		CuAssert(tc, "Unable to get document hash.", res == KSI_OK && hsh != NULL);
+
+		res = KSI_SignatureStore_indexOf(store, hsh, &pos);
+		CuAssert(tc, "Unable to find the signature by document hash.", res == KSI_OK && pos != NULL && *pos == 0);
+		KSI_free(pos);
+		pos = NULL;
+
+		res = KSI_SignatureStore_indexOf(store, missing, &pos);
+		CuAssert(tc, "Unknown document hash may not be found.", res == KSI_OK && pos == NULL);
+
+		KSI_SignatureStore_free(store);
+		store = NULL;
+	}
+
+	/* Trailing garbage after the signatures. */
+	buf[buf_len++] = 0x01;
+	CuAssert(tc, "Unable to write the signature file.", writeTestFile(TEST_STORE_FILE, buf, buf_len));
+
+	res = KSI_SignatureStore_open(ctx, TEST_STORE_FILE, &store);
+	CuAssert(tc, "Invalid signature file may not be opened.", res == KSI_INVALID_FORMAT && store == NULL);
+
+	remove(TEST_STORE_FILE);
+	remove(TEST_STORE_CONTAINER_FILE);
+
+	KSI_DataHash_free(missing);
+	KSI_SignatureContainerBuilder_free(builder);
+	for (i = 0; i < sizeof(sigs) / sizeof(sigs[0]); i++) {
+		KSI_Signature_free(sigs[i]);
+	}
+#undef TEST_STORE_CONTAINER_FILE
+#undef TEST_STORE_FILE
+#undef TEST_EXT_SIGNATURE_FILE
+#undef TEST_SIGNATURE_FILE
+}
+
+static void testSignatureStoreDocumentHashes(CuTest *tc) {
+#define TEST_MULTI_DOC_FILE "resource/tlv/signature-store-multi-doc.ksig"
+#define TEST_STORE_CONTAINER_FILE "signature_store_multi_doc_test.ksigc"
+	int res;
+	KSI_SignatureStore *store = NULL;
+	KSI_SignatureContainerBuilder *builder = NULL;
+	KSI_SignatureContainer *container = NULL;
+	KSI_Signature *sigs[] = { NULL, NULL, NULL, NULL };
+	KSI_DataHash *hsh = NULL;
+	KSI_DataHash *other = NULL;
+	unsigned char *raw = NULL;
+	size_t raw_len = 0;
+	size_t *pos = NULL;
+	/* Record number of the first signature of the document of signature i of the fixture. */
+	static const size_t first[] = { 0, 1, 2, 1 };
+	char files[2][1024];
+	size_t i;
+	size_t j;
+
+	KSI_ERR_clearErrors(ctx);
+
+	KSI_snprintf(files[0], sizeof(files[0]), "%s", getFullResourcePath(TEST_MULTI_DOC_FILE));
+	KSI_snprintf(files[1], sizeof(files[1]), "%s", TEST_STORE_CONTAINER_FILE);
+
+	res = KSI_SignatureStore_open(ctx, files[0], &store);
+	CuAssert(tc, "Unable to open the signature store.", res == KSI_OK && store != NULL);
+	CuAssert(tc, "Unexpected signature count.", KSI_SignatureStore_getCount(store) == 4);
+
+	res = KSI_SignatureContainerBuilder_new(ctx, &builder);
+	CuAssert(tc, "Unable to create container builder.", res == KSI_OK && builder != NULL);
+
+	for (i = 0; i < sizeof(sigs) / sizeof(sigs[0]); i++) {
+		res = KSI_SignatureStore_getSignature(store, i, &sigs[i]);
+		CuAssert(tc, "Unable to get signature from the store.", res == KSI_OK && sigs[i] != NULL);
+
+		res = KSI_SignatureContainerBuilder_add(builder, sigs[i]);
+		CuAssert(tc, "Unable to add signature to the container.", res == KSI_OK);
+	}
+
+	KSI_SignatureStore_free(store);
+	store = NULL;
+
+	/* The fixture holds three different documents, not in the order of their hashes. */
+	res = KSI_Signature_getDocumentHash(sigs[0], &hsh);
+	CuAssert(tc, "Unable to get document hash.", res == KSI_OK && hsh != NULL);
+	res = KSI_Signature_getDocumentHash(sigs[2], &other);
+	CuAssert(tc, "Unable to get document hash.", res == KSI_OK && other != NULL);
+	CuAssert(tc, "Fixture must have different document hashes.", !KSI_DataHash_equals(hsh, other));
+
+	res = KSI_SignatureContainerBuilder_serialize(builder, &raw, &raw_len);
+	CuAssert(tc, "Unable to serialize the container.", res == KSI_OK && raw != NULL);
+	CuAssert(tc, "Unable to write the container file.", writeTestFile(TEST_STORE_CONTAINER_FILE, raw, raw_len));
+
+	res = KSI_SignatureContainer_parse(ctx, raw, raw_len, &container);
+	CuAssert(tc, "Unable to parse the container.", res == KSI_OK && container != NULL);
+
+	for (i = 0; i < sizeof(sigs) / sizeof(sigs[0]); i++) {
+		hsh = NULL;
+		res = KSI_Signature_getDocumentHash(sigs[i], &hsh);
+		CuAssert(tc, "Unable to get document hash.", res == KSI_OK && hsh != NULL);
+
+		res = KSI_SignatureContainer_indexOf(container, hsh, &pos);
+		CuAssert(tc, "Container record not found by document hash.", res == KSI_OK && pos != NULL && *pos == first[i]);
+		KSI_free(pos);
+		pos = NULL;
+	}
+
+	for (j = 0; j < sizeof(files) / sizeof(files[0]); j++) {
+		res = KSI_SignatureStore_open(ctx, files[j], &store);
+		CuAssert(tc, "Unable to open the signature store.", res == KSI_OK && store != NULL);
+
+		for (i = 0; i < sizeof(sigs) / sizeof(sigs[0]); i++) {
+			hsh = NULL;
+			res = KSI_Signature_getDocumentHash(sigs[i], &hsh);
+			CuAssert(tc, "Unable to get document hash.", res == KSI_OK && hsh != NULL);
+
+			res = KSI_SignatureStore_indexOf(store, hsh, &pos);
+			CuAssert(tc, "Signature not found by document hash.", res == KSI_OK && pos != NULL && *pos == first[i]);
+			KSI_free(pos);
+			pos = NULL;
+		}
+
+		KSI_SignatureStore_free(store);
+		store = NULL;
+	}
+
+	remove(TEST_STORE_CONTAINER_FILE);
+
+	KSI_SignatureContainer_free(container);
+	KSI_SignatureContainerBuilder_free(builder);
+	KSI_free(raw);
+	for (i = 0; i < sizeof(sigs) / sizeof(sigs[0]); i++) {
+		KSI_Signature_free(sigs[i]);
+	}
+#undef TEST_STORE_CONTAINER_FILE
+#undef TEST_MULTI_DOC_FILE
+}
+
 CuSuite* KSITest_Signature_getSuite(void) {
 	CuSuite* suite = CuSuiteNew();
 
@@ -999,6 +1348,9 @@ CuSuite* KSITest_Signature_getSuite(void) {
 	SUITE_ADD_TEST(suite, testSignatureGetPublicationInfo);
 	SUITE_ADD_TEST(suite, testSignatureGetPublicationInfo_verifyNullPointer);
 	SUITE_ADD_TEST(suite, testCreateHasher);
+	SUITE_ADD_TEST(suite, testSignatureContainer);
+	SUITE_ADD_TEST(suite, testSignatureStore);
+	SUITE_ADD_TEST(suite, testSignatureStoreDocumentHashes);
 
 	return suite;
 }
@@ -188,6 +188,96 @@ static void testParseTlv16(CuTest* tc) {
 	CuAssert(tc, "Unexpected header length.", 4 == ftlv.hdr_len);
 }
 
+static void testFtlvMemScan(CuTest* tc) {
+	int res;
+	/* TLV8 type = 7, length = 3; TLV16 type = 0x2aa, length = 2; truncated TLV8 type = 1, length = 5. */
+	unsigned char raw[] = "\x07\x03" "abc" "\x82\xaa\x00\x02" "de" "\x01\x05" "fg";
+	KSI_FTLV arr[4];
+	size_t rd = 0;
+	size_t consumed = 0;
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_FTLV_memScan(raw, sizeof(raw) - 1, arr, 4, &rd, &consumed);
+	CuAssert(tc, "Failed to scan TLVs.", res == KSI_OK && rd == 2 && consumed == 11);
+	CuAssert(tc, "TLV8 header mismatch.", arr[0].off == 0 && arr[0].tag == 7 && arr[0].hdr_len == 2 && arr[0].dat_len == 3);
+	CuAssert(tc, "TLV16 header mismatch.", arr[1].off == 5 && arr[1].tag == 0x2aa && arr[1].hdr_len == 4 && arr[1].dat_len == 2);
+
+	/* Scanning stops when the output buffer is full. */
+	res = KSI_FTLV_memScan(raw, sizeof(raw) - 1, arr, 1, &rd, &consumed);
+	CuAssert(tc, "Failed to scan TLVs.", res == KSI_OK && rd == 1 && consumed == 5);
+
+	res = KSI_FTLV_memScan(raw, sizeof(raw) - 1, NULL, 0, &rd, &consumed);
+	CuAssert(tc, "Failed to count TLVs.", res == KSI_OK && rd == 2 && consumed == 11);
+
+	res = KSI_FTLV_memReadN(raw, sizeof(raw) - 1, NULL, 0, &rd);
+	CuAssert(tc, "Truncated TLV may not be read.", res == KSI_INVALID_FORMAT);
+
+	res = KSI_FTLV_memReadN(raw, 11, arr, 4, &rd);
+	CuAssert(tc, "Failed to read TLVs.", res == KSI_OK && rd == 2 && arr[1].off == 5 && arr[1].tag == 0x2aa);
+}
+
+static void testFtlvReader(CuTest* tc) {
+	int res;
+	/* TLV16 type = 0x2aa, length = 2; TLV8 type = 7, length = 3; TLV8 type = 1, length = 0. */
+	unsigned char raw[] = "\x82\xaa\x00\x02" "de" "\x07\x03" "abc" "\x01\x00";
+	static const size_t ends[] = { 6, 11, 13 };
+	KSI_FTLV_Reader *reader = NULL;
+	unsigned char *tlv = NULL;
+	size_t tlv_len = 0;
+	unsigned char *window = NULL;
+	size_t window_len = 0;
+	size_t consumed = 0;
+	size_t off;
+	size_t start;
+	size_t n;
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_FTLV_Reader_new(&reader);
+	CuAssert(tc, "Unable to create TLV reader.", res == KSI_OK && reader != NULL);
+
+	/* Byte by byte, as from a non-blocking socket. */
+	for (off = 0, n = 0, start = 0; off < sizeof(raw) - 1; off++) {
+		res = KSI_FTLV_Reader_feed(reader, raw + off, 1, &consumed, &tlv, &tlv_len);
+		CuAssert(tc, "Unable to feed TLV reader.", res == KSI_OK && consumed == 1);
+
+		CuAssert(tc, "TLV completed at wrong offset.", (tlv != NULL) == (off + 1 == ends[n]));
+		if (tlv != NULL) {
+			CuAssert(tc, "TLV content mismatch.", tlv_len == ends[n] - start && !memcmp(tlv, raw + start, tlv_len));
+			KSI_free(tlv);
+			tlv = NULL;
+			start = ends[n++];
+		}
+	}
+	CuAssert(tc, "Wrong number of TLVs.", n == 3);
+
+	/* All at once, each call stops at the end of a TLV. */
+	for (off = 0, n = 0; off < sizeof(raw) - 1; off += consumed, n++) {
+		res = KSI_FTLV_Reader_feed(reader, raw + off, sizeof(raw) - 1 - off, &consumed, &tlv, &tlv_len);
+		CuAssert(tc, "Unable to feed TLV reader.", res == KSI_OK && tlv != NULL && off + consumed == ends[n]);
+		KSI_free(tlv);
+		tlv = NULL;
+	}
+	CuAssert(tc, "Wrong number of TLVs.", n == 3);
+
+	/* The window never reaches past the header or the current TLV. */
+	res = KSI_FTLV_Reader_getWindow(reader, &window, &window_len);
+	CuAssert(tc, "Unable to get reader window.", res == KSI_OK && window_len == 2);
+	memcpy(window, raw, window_len);
+
+	res = KSI_FTLV_Reader_advance(reader, window_len + 1, &tlv, &tlv_len);
+	CuAssert(tc, "Advancing past the window must fail.", res == KSI_INVALID_ARGUMENT);
+
+	res = KSI_FTLV_Reader_advance(reader, window_len, &tlv, &tlv_len);
+	CuAssert(tc, "Unable to advance the reader.", res == KSI_OK && tlv == NULL);
+
+	res = KSI_FTLV_Reader_getWindow(reader, &window, &window_len);
+	CuAssert(tc, "TLV16 header must be completed.", res == KSI_OK && window_len == 2);
+
+	KSI_FTLV_Reader_free(reader);
+}
+
 static void testTlvGetUint64(CuTest* tc) {
 	int res;
 	/* TLV type = 1a, length = 8 */
@@ -633,6 +723,8 @@ CuSuite* KSITest_TLV_getSuite(void)
 	SUITE_ADD_TEST(suite, testTlvSetRawAsNull);
 	SUITE_ADD_TEST(suite, testParseTlv8);
 	SUITE_ADD_TEST(suite, testParseTlv16);
+	SUITE_ADD_TEST(suite, testFtlvMemScan);
+	SUITE_ADD_TEST(suite, testFtlvReader);
 	SUITE_ADD_TEST(suite, testTlvGetUint64);
 	SUITE_ADD_TEST(suite, testTlvGetUint64Overflow);
 	SUITE_ADD_TEST(suite, testTlvGetStringValue);
@@ -99,6 +99,42 @@ static void TestAddValidLookupFile(CuTest *tc) {
 
 }
 
+static void TestSharedTruststore(CuTest *tc) {
+	int res;
+	KSI_CTX *ctx2 = NULL;
+	KSI_PKITruststore *pki = NULL;
+	KSI_PKITruststore *shared = NULL;
+	KSI_PKITruststore *other = NULL;
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSI_CTX_getPKITruststore(ctx, &pki);
+	CuAssert(tc, "Unable to get PKI trustsore.", res == KSI_OK && pki != NULL);
+
+	res = KSI_CTX_new(&ctx2);
+	CuAssert(tc, "Unable to create second context.", res == KSI_OK && ctx2 != NULL);
+
+	res = KSI_PKITruststore_newShared(ctx2, pki, &shared);
+	CuAssert(tc, "Unable to share PKI truststore.", res == KSI_OK && shared != NULL);
+
+	res = KSI_PKITruststore_new(ctx2, 1, &other);
+	CuAssert(tc, "Unable to create default PKI truststore.", res == KSI_OK && other != NULL);
+
+	/* Modifying a shared truststore must not affect the original. */
+	res = KSI_PKITruststore_addLookupFile(shared, getFullResourcePath("resource/crt/mock.crt"));
+	CuAssert(tc, "Adding lookup file to shared truststore failed.", res == KSI_OK);
+
+	res = KSI_PKITruststore_addLookupFile(other, "KSI_ThisFileDoesProbablyNotExist");
+	CuAssert(tc, "Adding missing lookup file did not fail.", res != KSI_OK);
+
+	KSI_PKITruststore_free(shared);
+	KSI_PKITruststore_free(other);
+	KSI_CTX_free(ctx2);
+
+	res = KSI_PKITruststore_addLookupFile(pki, getFullResourcePath("resource/crt/mock.crt"));
+	CuAssert(tc, "Original truststore not usable after freeing the shared one.", res == KSI_OK);
+}
+
 
 
 static void TestParseAndSeraializeCert(CuTest *tc) {
@@ -251,6 +287,7 @@ CuSuite* KSITest_Truststore_getSuite(void)
 
 	SUITE_ADD_TEST(suite, TestAddInvalidLookupFile);
 	SUITE_ADD_TEST(suite, TestAddValidLookupFile);
+	SUITE_ADD_TEST(suite, TestSharedTruststore);
 	SUITE_ADD_TEST(suite, TestParseAndSeraializeCert);
 	SUITE_ADD_TEST(suite, TestExtractingOfPKICertificate);
 	SUITE_ADD_TEST(suite, TestPKICertificateToString);
@@ -2831,6 +2831,93 @@ static void testRule_CalendarAuthenticationRecordSignatureVerification_verifyErr
 #undef TEST_CERT_FILE
 }
 
+static void testRule_CalendarAuthenticationRecordSignatureVerification_cachedResult(CuTest *tc) {
+#define TEST_SIGNATURE_FILE    "resource/tlv/ok-sig-2014-06-2.ksig"
+#define TEST_WRONG_SIG_FILE    "resource/tlv/signature-cal-auth-wrong-signing-value.ksig"
+#define TEST_PUBLICATIONS_FILE "resource/tlv/publications.tlv"
+#define TEST_CERT_FILE         "resource/crt/mock.crt"
+
+	int res = KSI_UNKNOWN_ERROR;
+	KSI_VerificationContext verCtx;
+	KSI_RuleVerificationResult verRes;
+	KSI_PKITruststore *pki = NULL;
+	VerificationTempData tempData;
+	KSI_CTX *ctx = NULL;
+	KSI_Signature *signature = NULL;
+	KSI_Signature *wrongSignature = NULL;
+	KSI_PublicationsFile *userPublicationsFile = NULL;
+	int i;
+
+	KSI_ERR_clearErrors(ctx);
+
+	res = KSITest_CTX_clone(&ctx);
+	CuAssert(tc, "Unable to create new context.", res == KSI_OK && ctx != NULL);
+
+	res = KSI_Signature_fromFile(ctx, getFullResourcePath(TEST_SIGNATURE_FILE), &signature);
+	CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && signature != NULL);
+
+	res = KSI_Signature_fromFile(ctx, getFullResourcePath(TEST_WRONG_SIG_FILE), &wrongSignature);
+	CuAssert(tc, "Unable to read signature from file.", res == KSI_OK && wrongSignature != NULL);
+
+	res = KSI_PublicationsFile_fromFile(ctx, getFullResourcePath(TEST_PUBLICATIONS_FILE), &userPublicationsFile);
+	CuAssert(tc, "Unable to read publications file", res == KSI_OK && userPublicationsFile != NULL);
+
+	res = KSI_PKITruststore_new(ctx, 0, &pki);
+	CuAssert(tc, "Unable to get PKI truststore from context.", res == KSI_OK && pki != NULL);
+
+	res = KSI_PKITruststore_addLookupFile(pki, getFullResourcePath(TEST_CERT_FILE));
+	CuAssert(tc, "Unable to read certificate", res == KSI_OK);
+
+	res = KSI_CTX_setPKITruststore(ctx, pki);
+	CuAssert(tc, "Unable to set new PKI truststrore for KSI context.", res == KSI_OK);
+
+	/* The second round is served from the verification cache of the truststore. */
+	for (i = 0; i < 2; i++) {
+		res = KSI_VerificationContext_init(&verCtx, ctx);
+		CuAssert(tc, "Unable to create verification context.", res == KSI_OK);
+		memset(&tempData, 0, sizeof(tempData));
+		verCtx.tempData = &tempData;
+		verCtx.signature = signature;
+		verCtx.userPublicationsFile = userPublicationsFile;
+
+		TEST_VERIFICATION_STEP_INIT;
+
+		res = KSI_VerificationRule_CalendarAuthenticationRecordSignatureVerification(&verCtx, &verRes);
+		CuAssert(tc, "Failed to verify calendar authentication record signature", res == KSI_OK && verRes.resultCode == KSI_VER_RES_OK);
+
+		TEST_ASSERT_VERIFICATION_STEP_SUCCEEDED(KSI_VERIFY_CALAUTHREC_WITH_SIGNATURE);
+
+		KSI_VerificationContext_clean(&verCtx);
+
+		/* A different signature value over the same data must not match the cached result. */
+		res = KSI_VerificationContext_init(&verCtx, ctx);
+		CuAssert(tc, "Unable to create verification context.", res == KSI_OK);
+		memset(&tempData, 0, sizeof(tempData));
+		verCtx.tempData = &tempData;
+		verCtx.signature = wrongSignature;
+		verCtx.userPublicationsFile = userPublicationsFile;
+
+		TEST_VERIFICATION_STEP_INIT;
+
+		res = KSI_VerificationRule_CalendarAuthenticationRecordSignatureVerification(&verCtx, &verRes);
+		CuAssert(tc, "Wrong error result returned", res == KSI_OK && verRes.resultCode == KSI_VER_RES_FAIL && verRes.errorCode == KSI_VER_ERR_KEY_2);
+
+		TEST_ASSERT_VERIFICATION_STEP_FAILED(KSI_VERIFY_CALAUTHREC_WITH_SIGNATURE);
+
+		KSI_VerificationContext_clean(&verCtx);
+	}
+
+	KSI_PublicationsFile_free(userPublicationsFile);
+	KSI_Signature_free(signature);
+	KSI_Signature_free(wrongSignature);
+	KSI_CTX_free(ctx);
+
+#undef TEST_SIGNATURE_FILE
+#undef TEST_WRONG_SIG_FILE
+#undef TEST_PUBLICATIONS_FILE
+#undef TEST_CERT_FILE
+}
+
 static void testRule_PublicationsFileContainsSignaturePublication(CuTest *tc) {
 #define TEST_SIGNATURE_FILE    "resource/tlv/ok-sig-2014-04-30.1-extended.ksig"
 #define TEST_PUBLICATIONS_FILE "resource/tlv/publications.tlv"
@@ -4410,6 +4497,7 @@ CuSuite* KSITest_VerificationRules_getSuite(void) {
 	SUITE_ADD_TEST(suite, testRule_CertificateExistence_verifyErrorResult);
 	SUITE_ADD_TEST(suite, testRule_CalendarAuthenticationRecordSignatureVerification);
 	SUITE_ADD_TEST(suite, testRule_CalendarAuthenticationRecordSignatureVerification_verifyErrorResult);
+	SUITE_ADD_TEST(suite, testRule_CalendarAuthenticationRecordSignatureVerification_cachedResult);
 	SUITE_ADD_TEST(suite, testRule_PublicationsFileContainsSignaturePublication);
 	SUITE_ADD_TEST(suite, testRule_PublicationsFileContainsSignaturePublication_verifyErrorResult);
 	SUITE_ADD_TEST(suite, testRule_PublicationsFileContainsPublication);